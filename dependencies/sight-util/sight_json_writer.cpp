@@ -0,0 +1,175 @@
+#include "sight_json_writer.h"
+
+#include <charconv>
+#include <cmath>
+
+namespace sight {
+
+    SightJsonWriter::SightJsonWriter(std::ostream& out, int indent)
+        : out(out), indent(indent) {
+    }
+
+    SightJsonWriter& SightJsonWriter::beginObject() {
+        beforeValue();
+        out << '{';
+        levels.push_back({ false, true });
+        return *this;
+    }
+
+    SightJsonWriter& SightJsonWriter::endObject() {
+        bool empty = levels.back().empty;
+        levels.pop_back();
+        if (!empty) {
+            newLine();
+        }
+        out << '}';
+        return *this;
+    }
+
+    SightJsonWriter& SightJsonWriter::beginArray() {
+        beforeValue();
+        out << '[';
+        levels.push_back({ true, true });
+        return *this;
+    }
+
+    SightJsonWriter& SightJsonWriter::endArray() {
+        bool empty = levels.back().empty;
+        levels.pop_back();
+        if (!empty) {
+            newLine();
+        }
+        out << ']';
+        return *this;
+    }
+
+    SightJsonWriter& SightJsonWriter::key(std::string_view key) {
+        auto& level = levels.back();
+        if (!level.empty) {
+            out << ',';
+        }
+        level.empty = false;
+        newLine();
+        writeString(key);
+        out << (indent > 0 ? ": " : ":");
+        afterKey = true;
+        return *this;
+    }
+
+    SightJsonWriter& SightJsonWriter::value(std::string_view str) {
+        beforeValue();
+        writeString(str);
+        return *this;
+    }
+
+    SightJsonWriter& SightJsonWriter::value(const char* str) {
+        return value(std::string_view(str));
+    }
+
+    SightJsonWriter& SightJsonWriter::value(double number) {
+        if (!std::isfinite(number)) {
+            return null();
+        }
+
+        beforeValue();
+        char buf[32];
+        std::to_chars_result result;
+        if (std::trunc(number) == number && std::fabs(number) < 9007199254740992.0) {
+            result = std::to_chars(buf, buf + sizeof(buf), static_cast<int64_t>(number));
+        } else {
+            // shortest text which reads back to the same number.
+            result = std::to_chars(buf, buf + sizeof(buf), number);
+        }
+        out.write(buf, result.ptr - buf);
+        return *this;
+    }
+
+    SightJsonWriter& SightJsonWriter::value(bool b) {
+        beforeValue();
+        out << (b ? "true" : "false");
+        return *this;
+    }
+
+    SightJsonWriter& SightJsonWriter::null() {
+        beforeValue();
+        out << "null";
+        return *this;
+    }
+
+    bool SightJsonWriter::done() const {
+        return levels.empty() && !afterKey && out.good();
+    }
+
+    void SightJsonWriter::beforeValue() {
+        if (afterKey) {
+            afterKey = false;
+            return;
+        }
+        if (levels.empty()) {
+            // the root value
+            return;
+        }
+
+        auto& level = levels.back();
+        if (!level.empty) {
+            out << ',';
+        }
+        level.empty = false;
+        newLine();
+    }
+
+    void SightJsonWriter::newLine() {
+        if (indent <= 0) {
+            return;
+        }
+        out << '\n';
+        for (size_t i = 0; i < levels.size() * indent; i++) {
+            out << ' ';
+        }
+    }
+
+    void SightJsonWriter::writeString(std::string_view str) {
+        static const char hex[] = "0123456789abcdef";
+
+        out << '"';
+        size_t start = 0;
+        for (size_t i = 0; i < str.size(); i++) {
+            auto c = static_cast<unsigned char>(str[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                continue;
+            }
+
+            out.write(str.data() + start, i - start);
+            start = i + 1;
+            switch (c) {
+            case '"':
+                out << "\\\"";
+                break;
+            case '\\':
+                out << "\\\\";
+                break;
+            case '\n':
+                out << "\\n";
+                break;
+            case '\r':
+                out << "\\r";
+                break;
+            case '\t':
+                out << "\\t";
+                break;
+            case '\b':
+                out << "\\b";
+                break;
+            case '\f':
+                out << "\\f";
+                break;
+            default:
+                out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+                break;
+            }
+        }
+        out.write(str.data() + start, str.size() - start);
+        out << '"';
+    }
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace sight {
+
+    /**
+     * @brief Write json to a stream while walking the data, no json tree is built.
+     * Keys must be written before values in objects. NOT thread safe.
+     */
+    class SightJsonWriter {
+    public:
+        /**
+         * @param indent  spaces of one level, 0 for compact json.
+         */
+        explicit SightJsonWriter(std::ostream& out, int indent = 2);
+
+        SightJsonWriter& beginObject();
+        SightJsonWriter& endObject();
+        SightJsonWriter& beginArray();
+        SightJsonWriter& endArray();
+
+        SightJsonWriter& key(std::string_view key);
+
+        SightJsonWriter& value(std::string_view str);
+        SightJsonWriter& value(const char* str);
+        /**
+         * @brief Integral numbers are written without a fraction, NaN and infinity are written as `null`.
+         */
+        SightJsonWriter& value(double number);
+        SightJsonWriter& value(bool b);
+        SightJsonWriter& null();
+
+        /**
+         * @return true if all objects and arrays are closed, and the stream is good.
+         */
+        bool done() const;
+
+    private:
+        struct Level {
+            bool array = false;
+            bool empty = true;
+        };
+
+        std::ostream& out;
+        int indent = 2;
+        std::vector<Level> levels;
+        // a key is written, the next value belongs to it.
+        bool afterKey = false;
+
+        void beforeValue();
+        void newLine();
+        void writeString(std::string_view str);
+    };
+
+}
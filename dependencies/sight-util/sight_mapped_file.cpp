@@ -0,0 +1,137 @@
+#include "sight_mapped_file.h"
+
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#    include "sight_defines.h"
+#    include <Windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace sight {
+
+    SightMappedFile::~SightMappedFile() {
+        close();
+    }
+
+    SightMappedFile::SightMappedFile(SightMappedFile&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    SightMappedFile& SightMappedFile::operator=(SightMappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            pointer = std::exchange(other.pointer, nullptr);
+            length = std::exchange(other.length, 0);
+            opened = std::exchange(other.opened, false);
+#ifdef _WIN32
+            fileHandle = std::exchange(other.fileHandle, nullptr);
+            mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+        }
+        return *this;
+    }
+
+    bool SightMappedFile::open(std::string_view path) {
+        close();
+        std::string pathString(path);
+
+#ifdef _WIN32
+        auto file = CreateFileA(pathString.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            return false;
+        }
+        fileHandle = file;
+        opened = true;
+        if (fileSize.QuadPart == 0) {
+            return true;
+        }
+
+        auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            close();
+            return false;
+        }
+        mappingHandle = mapping;
+        auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view) {
+            close();
+            return false;
+        }
+        pointer = static_cast<const char*>(view);
+        length = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int fd = ::open(pathString.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        opened = true;
+        if (st.st_size == 0) {
+            ::close(fd);
+            return true;
+        }
+
+        auto view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping keeps the file referenced.
+        ::close(fd);
+        if (view == MAP_FAILED) {
+            opened = false;
+            return false;
+        }
+        pointer = static_cast<const char*>(view);
+        length = static_cast<size_t>(st.st_size);
+#endif
+        return true;
+    }
+
+    void SightMappedFile::close() {
+#ifdef _WIN32
+        if (pointer) {
+            UnmapViewOfFile(pointer);
+        }
+        if (mappingHandle) {
+            CloseHandle(mappingHandle);
+        }
+        if (fileHandle) {
+            CloseHandle(fileHandle);
+        }
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+#else
+        if (pointer) {
+            munmap(const_cast<char*>(pointer), length);
+        }
+#endif
+        pointer = nullptr;
+        length = 0;
+        opened = false;
+    }
+
+    bool SightMappedFile::isOpen() const {
+        return opened;
+    }
+
+    const char* SightMappedFile::data() const {
+        return pointer;
+    }
+
+    size_t SightMappedFile::size() const {
+        return length;
+    }
+
+}
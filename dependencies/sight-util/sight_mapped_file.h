@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace sight {
+
+    /**
+     * @brief A read-only memory mapped file.
+     * The mapping is released when this object is closed or destroyed. NOT thread safe.
+     */
+    class SightMappedFile {
+    public:
+        SightMappedFile() = default;
+        ~SightMappedFile();
+
+        SightMappedFile(SightMappedFile const&) = delete;
+        SightMappedFile& operator=(SightMappedFile const&) = delete;
+
+        SightMappedFile(SightMappedFile&& other) noexcept;
+        SightMappedFile& operator=(SightMappedFile&& other) noexcept;
+
+        /**
+         * @brief Map the whole file. An opened mapping will be closed first.
+         * 
+         * @param path 
+         * @return true  success, an empty file is also mapped (`size()` is 0)
+         * @return false 
+         */
+        bool open(std::string_view path);
+
+        void close();
+
+        bool isOpen() const;
+
+        const char* data() const;
+        size_t size() const;
+
+    private:
+        const char* pointer = nullptr;
+        size_t length = 0;
+        bool opened = false;
+
+#ifdef _WIN32
+        void* fileHandle = nullptr;
+        void* mappingHandle = nullptr;
+#endif
+    };
+
+}
@@ -8,9 +8,11 @@
 #include "sstream"
 
 #include <cstring>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <sys/stat.h>
 #include <random>
 
@@ -21,10 +23,44 @@
 #    include <psapi.h>
 #endif
 
+#ifdef _WIN32
+#    include <io.h>
+#else
+#    include <fcntl.h>
+#    include <unistd.h>
+#endif
+
 namespace sight {
 
     std::string emptyString("");
 
+    namespace {
+
+        struct OwnWrite {
+            std::filesystem::file_time_type modifyTime;
+            uintmax_t size = 0;
+        };
+
+        std::mutex g_OwnWritesLock;
+        // key: normal path
+        std::unordered_map<std::string, OwnWrite> g_OwnWrites;
+
+        std::string ownWriteKey(std::string_view path) {
+            return std::filesystem::path(path).lexically_normal().generic_string();
+        }
+
+        bool statFile(std::filesystem::path const& path, OwnWrite& out) {
+            std::error_code ec;
+            out.modifyTime = std::filesystem::last_write_time(path, ec);
+            if (ec) {
+                return false;
+            }
+            out.size = std::filesystem::file_size(path, ec);
+            return !ec;
+        }
+
+    }
+
 
     ProcessUsageInfo currentProcessUsageInfo() {
         ProcessUsageInfo usageInfo;
@@ -248,6 +284,83 @@ namespace sight {
         return false;
     }
 
+    void recordOwnWrite(std::string_view path) {
+        auto key = ownWriteKey(path);
+        OwnWrite write;
+        bool ok = statFile(key, write);
+
+        std::lock_guard lock(g_OwnWritesLock);
+        if (ok) {
+            g_OwnWrites[key] = write;
+        } else {
+            g_OwnWrites.erase(key);
+        }
+    }
+
+    bool isOwnWrite(std::string_view path) {
+        auto key = ownWriteKey(path);
+        OwnWrite current;
+        bool ok = statFile(key, current);
+
+        std::lock_guard lock(g_OwnWritesLock);
+        auto iter = g_OwnWrites.find(key);
+        if (iter == g_OwnWrites.end()) {
+            return false;
+        }
+        if (ok && iter->second.modifyTime == current.modifyTime && iter->second.size == current.size) {
+            return true;
+        }
+        // changed by others, later events are not ours.
+        g_OwnWrites.erase(iter);
+        return false;
+    }
+
+    bool syncFile(FILE* fp) {
+        if (fflush(fp) != 0) {
+            return false;
+        }
+#ifdef _WIN32
+        return _commit(_fileno(fp)) == 0;
+#else
+        return fsync(fileno(fp)) == 0;
+#endif
+    }
+
+    bool writeFileAtomic(std::string_view path, std::string_view content) {
+        std::filesystem::path target(path);
+        // starts with a `.`, so the project file tree ignores it.
+        auto temp = target;
+        temp.replace_filename("." + target.filename().generic_string() + ".tmp");
+
+        FILE* fp = fopen(temp.generic_string().c_str(), "wb");
+        if (!fp) {
+            return false;
+        }
+        bool ok = fwrite(content.data(), 1, content.size(), fp) == content.size() && syncFile(fp);
+        ok = fclose(fp) == 0 && ok;
+
+        std::error_code ec;
+        if (ok) {
+            std::filesystem::rename(temp, target, ec);
+        }
+        if (!ok || ec) {
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+
+#ifndef _WIN32
+        // make the rename itself durable.
+        auto dir = target.has_parent_path() ? target.parent_path().generic_string() : std::string(".");
+        int fd = open(dir.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            fsync(fd);
+            close(fd);
+        }
+#endif
+        recordOwnWrite(path);
+        return true;
+    }
+
     int normalRandomInt(int min, int max) {
         
         std::random_device rd;
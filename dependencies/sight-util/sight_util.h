@@ -222,6 +222,33 @@ namespace sight {
 
     bool isValidPath(const std::filesystem::path& p);
 
+    /**
+     * @brief Write `content` to a temp file beside `path`, flush it to disk, then rename it to `path`.
+     * `path` is either the old file or the new one, never a truncated one.
+     *
+     * @return true if success
+     */
+    bool writeFileAtomic(std::string_view path, std::string_view content);
+
+    /**
+     * @brief Remember the modify time and size of a file which is written by this process, see `isOwnWrite`.
+     * `writeFileAtomic` calls it. Thread safe.
+     */
+    void recordOwnWrite(std::string_view path);
+
+    /**
+     * @brief Thread safe.
+     * @return true if the file is not changed since `recordOwnWrite`, so a change event of it is caused by this process.
+     */
+    bool isOwnWrite(std::string_view path);
+
+    /**
+     * @brief Flush `fp` and its data on disk (fsync).
+     *
+     * @return true if success
+     */
+    bool syncFile(FILE* fp);
+
 
     int normalRandomInt(int min = 0, int max = 99999999);
 }
\ No newline at end of file
@@ -135,6 +135,7 @@ namespace sight {
         bool terminalWindow = false;
         bool codeSetSettingsWindow = false;
         bool graphOutputJsonConfigWindow = false;
+        bool staleOutputsWindow = false;
 
         bool layoutReset = false;
 
@@ -153,6 +154,15 @@ namespace sight {
         UIWindowStatus windowStatus;
 
         bool autoSave = false;
+        // keep a binary copy of each yaml graph in `.sight/cache/` of the project, and load from it when it is up to date.
+        // It is written when the graph is saved.
+        bool graphBinaryCache = false;
+        // autosave appends changes to a journal next to each yaml graph, see sight_graph_journal.h
+        bool graphJournal = true;
+        // watch folders of the project, and refresh what is changed outside.
+        bool watchProject = true;
+        // build stale outputs after files are changed outside, see `watchProject`.
+        bool buildOnProjectChange = false;
 
         std::string lastUseEntityOperation = "";
         // program working directory, for debug usage.
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "absl/container/btree_map.h"
+
+// file name of the build manifest, under the target folder.
+#define SIGHT_BUILD_MANIFEST_FILE "build-manifest.yaml"
+
+namespace sight {
+
+    /**
+     * @brief FNV-1a, for build inputs and outputs.
+     */
+    struct BuildHasher {
+        uint64_t value = 14695981039346656037ull;
+
+        void add(const void* p, size_t size) {
+            auto bytes = static_cast<const unsigned char*>(p);
+            for (size_t i = 0; i < size; i++) {
+                value ^= bytes[i];
+                value *= 1099511628211ull;
+            }
+        }
+
+        template<class T>
+            requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+        void add(T v) {
+            add(&v, sizeof(v));
+        }
+
+        void add(std::string_view str) {
+            add(str.size());
+            add(str.data(), str.size());
+        }
+    };
+
+    /**
+     * @brief Add content of a file to `hasher`.
+     *
+     * @return false if the file can not be read, nothing is added then.
+     */
+    bool hashFileContent(std::string_view path, BuildHasher& hasher);
+
+    /**
+     * @brief What a graph is built from, and what it is built to.
+     */
+    struct BuildManifestEntry {
+        // the graph file and its journal
+        uint64_t graphHash = 0;
+        // templates, entities, code template and plugins which the graph uses.
+        uint64_t inputHash = 0;
+        // empty if the graph has no output file.
+        std::string outputPath;
+        uint64_t outputHash = 0;
+    };
+
+    /**
+     * @brief Graphs of the last build, a graph is generated again only if its inputs or its output are changed.
+     */
+    class BuildManifest {
+    public:
+        /**
+         * @param path  the manifest file, it is created by `save` if it does not exist.
+         * @return int CODE_OK, CODE_FILE_NOT_EXISTS, CODE_FILE_FORMAT_ERROR. Entries are cleared if it is not CODE_OK.
+         */
+        int load(std::string_view path);
+
+        /**
+         * @return int CODE_OK, CODE_FILE_ERROR
+         */
+        int save() const;
+
+        BuildManifestEntry const* find(std::string_view graphPath) const;
+        void set(std::string_view graphPath, BuildManifestEntry entry);
+        void remove(std::string_view graphPath);
+
+        /**
+         * @brief Remove entries of graphs which are not in `graphPaths`, e.g. deleted graphs.
+         */
+        void retain(std::vector<std::string> const& graphPaths);
+
+        /**
+         * @brief true if the output of `entry` is still the file which the build wrote.
+         */
+        static bool isOutputUpToDate(BuildManifestEntry const& entry);
+
+    private:
+        std::string path;
+        // key: graph path, relative to the project folder.
+        absl::btree_map<std::string, BuildManifestEntry> entries;
+    };
+
+}
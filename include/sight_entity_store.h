@@ -0,0 +1,126 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+
+// folder of entity files, under the project folder.
+#define SIGHT_ENTITIES_FOLDER "entities/"
+// index of entity files, under `SIGHT_ENTITIES_FOLDER`.
+#define SIGHT_ENTITIES_INDEX_FILE "index.yaml"
+
+namespace sight {
+
+    struct SightEntity;
+
+    /**
+     * @brief A field which is saved in the index, so it can be searched before fields of the entity are read.
+     */
+    struct EntityIndexField {
+        std::string name;
+        std::string type;
+    };
+
+    struct EntityFileChange {
+        std::string name;
+        // template address before the change, empty if the entity is added.
+        std::string oldTemplateAddress;
+        bool added = false;
+        // the file is deleted, or it has another entity now.
+        bool removed = false;
+    };
+
+    /**
+     * @brief Entities are saved one file per entity, with an index of names, template addresses and files.
+     * Opening a project only reads the index, fields of an entity are read when it is used. Only changed entities
+     * are written.
+     * Call by ui thread.
+     */
+    class EntityStore {
+    public:
+        /**
+         * @brief Read the index. Entities only have name, template address, parent entity and type id, use `loadFields` to
+         * read the rest, names and types of fields are in `indexFieldsOf`. Entity files which are not in the index (e.g. added by vcs) are read at once.
+         * A project which only has the old `entities.yaml` is read in full, and it is split at the next `save`.
+         *
+         * @param baseDir  the project folder, ends with `/`.
+         * @return int CODE_OK, CODE_FILE_ERROR if there is no entity file, CODE_FILE_FORMAT_ERROR
+         */
+        int load(std::string_view baseDir, absl::btree_map<std::string, SightEntity>& entities);
+
+        bool isLoaded(std::string_view name) const;
+
+        /**
+         * @return fields of the entity from the index, nullptr if its fields are read, use them instead.
+         */
+        std::vector<EntityIndexField> const* indexFieldsOf(std::string_view name) const;
+
+        /**
+         * @brief Path of the file of the entity, empty if it has no file yet or the project is not split yet.
+         */
+        std::string filePathOf(std::string_view name) const;
+
+        /**
+         * @brief Read fields of the entity from its file, nothing is done if they are already read.
+         *
+         * @return int CODE_OK, CODE_FILE_ERROR, CODE_FILE_FORMAT_ERROR
+         */
+        int loadFields(SightEntity& entity);
+
+        /**
+         * @brief A file of the folder is changed outside, e.g. by vcs. The entity is read again, files which are same
+         * as what `save` wrote are skipped. Removed entities are only reported, use `markRemoved` for them.
+         *
+         * @param file  file name under the folder
+         * @return int CODE_OK, CODE_FILE_ERROR, CODE_FILE_FORMAT_ERROR
+         */
+        int reloadFile(std::string_view file, absl::btree_map<std::string, SightEntity>& entities, std::vector<EntityFileChange>& changes);
+
+        /**
+         * @brief The entity is added or changed, it will be written at the next `save`.
+         */
+        void markDirty(std::string_view name);
+
+        /**
+         * @brief The entity is deleted, its file will be deleted at the next `save`.
+         */
+        void markRemoved(std::string_view name);
+
+        /**
+         * @brief Write dirty entities, delete files of removed entities, and write the index if it is changed.
+         *
+         * @return int CODE_OK, CODE_FILE_ERROR
+         */
+        int save(absl::btree_map<std::string, SightEntity> const& entities);
+
+    private:
+        struct Item {
+            // file name under the folder
+            std::string file;
+            bool loaded = false;
+            // from the index, used until the entity is loaded.
+            std::vector<EntityIndexField> fields;
+        };
+
+        // ends with `/`
+        std::string folder;
+        // path of the old `entities.yaml`, not empty if the project is not split yet.
+        std::string legacyFile;
+        // key: entity full name
+        absl::flat_hash_map<std::string, Item> items;
+        absl::flat_hash_set<std::string> dirty;
+        // files of removed entities
+        absl::flat_hash_set<std::string> removedFiles;
+        bool indexChanged = false;
+
+        std::string fileNameOf(std::string_view name) const;
+        int loadEntityFile(std::string const& file, absl::btree_map<std::string, SightEntity>& entities);
+        int loadLegacyFile(absl::btree_map<std::string, SightEntity>& entities);
+        int saveIndex(absl::btree_map<std::string, SightEntity> const& entities);
+    };
+
+}
@@ -0,0 +1,398 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+
+#include "sight_mapped_file.h"
+
+// extension of a binary graph file, or a graph's binary cache.
+#define SIGHT_GRAPH_BINARY_EXT ".sgb"
+
+namespace sight {
+
+    class SightNodeGraph;
+    struct SightNode;
+    struct SightNodePort;
+
+    /**
+     * @brief Binary graph file, version 1.
+     * Layout: header, then sections. Every section starts at an 8 bytes aligned offset.
+     * All numbers are little-endian, records are read in place from the mapped file.
+     * Strings are (offset, size) pairs into the string section, every string is followed by a '\0'.
+     */
+    inline constexpr char sightGraphBinaryMagic[8] = { 'S', 'I', 'G', 'H', 'T', 'G', 'B', '\0' };
+    inline constexpr uint32_t sightGraphBinaryVersion = 1;
+    inline constexpr uint32_t sightGraphBinaryByteOrder = 0x01020304;
+
+    struct SightGraphBinaryString {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    struct SightGraphBinarySection {
+        uint64_t offset = 0;
+        // record count, or byte count of the string section.
+        uint32_t count = 0;
+        uint32_t reserved = 0;
+    };
+
+    struct SightGraphBinaryHeader {
+        char magic[8];
+        uint32_t version = sightGraphBinaryVersion;
+        uint32_t byteOrder = sightGraphBinaryByteOrder;
+        uint64_t fileSize = 0;
+
+        // the yaml file which this binary is made from, both are 0 if it is not a cache.
+        uint64_t sourceSize = 0;
+        int64_t sourceModifyTime = 0;
+
+        SightGraphBinarySection strings;
+        SightGraphBinarySection nodes;
+        SightGraphBinarySection ports;
+        SightGraphBinarySection connections;
+        SightGraphBinarySection floats;
+        SightGraphBinarySection settings;
+        SightGraphBinarySection saveAsJsonHistory;
+    };
+
+    enum class SightGraphBinaryOwner : uint8_t {
+        // a node of the graph
+        None,
+        // a component of the node `ownerId`
+        Node,
+        // a component of the connection `ownerId`
+        Connection,
+    };
+
+    struct SightGraphBinaryNode {
+        uint32_t id = 0;
+        uint32_t ownerId = 0;
+        SightGraphBinaryString name;
+        // empty if the node has no template.
+        SightGraphBinaryString templateAddress;
+        float positionX = 0;
+        float positionY = 0;
+        // ports of this node are `ports[firstPort, firstPort + portCount)`, inputs, outputs, then fields.
+        uint32_t firstPort = 0;
+        uint32_t portCount = 0;
+        SightGraphBinaryOwner ownerKind = SightGraphBinaryOwner::None;
+        uint8_t hasPosition = 1;
+        uint8_t reserved[2] = { 0 };
+    };
+
+    enum class SightGraphBinaryValueKind : uint8_t {
+        // yaml null
+        None,
+        // text of a yaml scalar, the port type decides how to read it.
+        String,
+        Int,
+        Float,
+        Double,
+        Bool,
+        // `floats[first, first + count)`
+        Floats,
+    };
+
+    struct SightGraphBinaryPort {
+        uint32_t id = 0;
+        uint32_t type = 0;
+        // 0 if the port has no parent.
+        uint32_t parent = 0;
+        SightGraphBinaryString name;
+        SightGraphBinaryString customPortName;
+
+        union {
+            int64_t i;
+            double d;
+            float f;
+            uint8_t b;
+            SightGraphBinaryString string;
+            struct {
+                uint32_t first;
+                uint32_t count;
+            } floats;
+        } value = { 0 };
+
+        // NodePortType
+        uint8_t kind = 0;
+        SightGraphBinaryValueKind valueKind = SightGraphBinaryValueKind::None;
+        uint8_t dynamicPort = 0;
+        uint8_t reserved = 0;
+    };
+
+    struct SightGraphBinaryConnection {
+        uint32_t id = 0;
+        uint32_t left = 0;
+        uint32_t right = 0;
+        int32_t priority = 0;
+        uint8_t generateCode = 1;
+        uint8_t reserved[3] = { 0 };
+    };
+
+    /**
+     * @brief One item of graph settings, the value is the text of the yaml scalar.
+     */
+    struct SightGraphBinarySetting {
+        SightGraphBinaryString key;
+        SightGraphBinaryString value;
+    };
+
+    static_assert(std::is_trivially_copyable_v<SightGraphBinaryHeader>);
+    static_assert(std::is_trivially_copyable_v<SightGraphBinaryNode>);
+    static_assert(std::is_trivially_copyable_v<SightGraphBinaryPort>);
+    static_assert(std::is_trivially_copyable_v<SightGraphBinaryConnection>);
+    static_assert(sizeof(SightGraphBinaryPort) % 8 == 0);
+
+    /**
+     * @brief Collect records and write a binary graph file.
+     */
+    class SightGraphBinaryWriter {
+    public:
+        /**
+         * @brief Add a string to the string section, same strings are stored once.
+         */
+        SightGraphBinaryString addString(std::string_view str);
+
+        uint32_t addFloats(const float* p, uint32_t count);
+
+        void addSetting(std::string_view key, std::string_view value);
+
+        /**
+         * @brief Same as the reader's, so records can be used before they are written.
+         * The result is invalid after next `addString`.
+         */
+        std::string_view str(SightGraphBinaryString str) const;
+        std::span<const SightGraphBinaryPort> portsOf(SightGraphBinaryNode const& node) const;
+        std::span<const float> floatsOf(SightGraphBinaryPort const& port) const;
+
+        /**
+         * @brief Remove all records and strings, the memory is kept for reuse.
+         */
+        void clear();
+
+        std::vector<SightGraphBinaryNode> nodes;
+        std::vector<SightGraphBinaryPort> ports;
+        std::vector<SightGraphBinaryConnection> connections;
+        std::vector<float> floats;
+        std::vector<SightGraphBinarySetting> settings;
+        std::vector<SightGraphBinaryString> saveAsJsonHistory;
+
+        uint64_t sourceSize = 0;
+        int64_t sourceModifyTime = 0;
+
+        /**
+         * @brief
+         *
+         * @param path
+         * @return int CODE_OK, CODE_FILE_ERROR
+         */
+        int writeTo(std::string_view path) const;
+
+        /**
+         * @brief The content of `writeTo`.
+         */
+        std::string toBuffer() const;
+
+        /**
+         * @brief Hash of records and strings, the source stamp is not included.
+         */
+        uint64_t contentHash() const;
+
+    private:
+        std::string strings;
+        absl::flat_hash_map<std::string, SightGraphBinaryString> stringIndex;
+    };
+
+    /**
+     * @brief Read a binary graph file through mmap, nothing is copied.
+     * Views and records are valid until the reader is closed.
+     */
+    class SightGraphBinaryReader {
+    public:
+        /**
+         * @brief Map the file and check the header and section bounds.
+         *
+         * @param path
+         * @return int CODE_OK, CODE_FILE_ERROR, CODE_FILE_FORMAT_ERROR
+         */
+        int open(std::string_view path);
+
+        /**
+         * @brief Read a binary graph in memory, like `open`. `data` must be 8 bytes aligned and outlive the reader.
+         */
+        int openMemory(const char* data, size_t size);
+
+        void close();
+
+        SightGraphBinaryHeader const& header() const;
+
+        std::span<const SightGraphBinaryNode> nodes() const;
+        std::span<const SightGraphBinaryPort> ports() const;
+        std::span<const SightGraphBinaryPort> ports(SightGraphBinaryNode const& node) const;
+        std::span<const SightGraphBinaryConnection> connections() const;
+        std::span<const float> floats() const;
+        std::span<const float> floats(SightGraphBinaryPort const& port) const;
+        std::span<const SightGraphBinarySetting> settings() const;
+        std::span<const SightGraphBinaryString> saveAsJsonHistory() const;
+
+        /**
+         * @brief
+         *
+         * @param str
+         * @return std::string_view  the data is '\0' terminated. Empty if `str` is out of range.
+         */
+        std::string_view str(SightGraphBinaryString str) const;
+
+    private:
+        SightMappedFile file;
+        // the mapped file, or the memory of `openMemory`.
+        const char* base = nullptr;
+        size_t length = 0;
+
+        int check();
+
+        template<class T>
+        std::span<const T> section(SightGraphBinarySection const& s) const {
+            if (s.count == 0) {
+                return {};
+            }
+            return { reinterpret_cast<const T*>(base + s.offset), s.count };
+        }
+    };
+
+    // the reader and the writer have the same records, these let templates read both.
+    // ports and floats of the writer have other names, because of its public members.
+    inline std::span<const SightGraphBinaryNode> nodesOf(SightGraphBinaryReader const& reader) {
+        return reader.nodes();
+    }
+
+    inline std::span<const SightGraphBinaryNode> nodesOf(SightGraphBinaryWriter const& writer) {
+        return writer.nodes;
+    }
+
+    inline std::span<const SightGraphBinaryPort> portsOf(SightGraphBinaryReader const& reader, SightGraphBinaryNode const& record) {
+        return reader.ports(record);
+    }
+
+    inline std::span<const SightGraphBinaryPort> portsOf(SightGraphBinaryWriter const& writer, SightGraphBinaryNode const& record) {
+        return writer.portsOf(record);
+    }
+
+    inline std::span<const float> floatsOf(SightGraphBinaryReader const& reader, SightGraphBinaryPort const& record) {
+        return reader.floats(record);
+    }
+
+    inline std::span<const float> floatsOf(SightGraphBinaryWriter const& writer, SightGraphBinaryPort const& record) {
+        return writer.floatsOf(record);
+    }
+
+    inline std::span<const SightGraphBinaryConnection> connectionsOf(SightGraphBinaryReader const& reader) {
+        return reader.connections();
+    }
+
+    inline std::span<const SightGraphBinaryConnection> connectionsOf(SightGraphBinaryWriter const& writer) {
+        return writer.connections;
+    }
+
+    inline std::span<const SightGraphBinarySetting> settingsOf(SightGraphBinaryReader const& reader) {
+        return reader.settings();
+    }
+
+    inline std::span<const SightGraphBinarySetting> settingsOf(SightGraphBinaryWriter const& writer) {
+        return writer.settings;
+    }
+
+    inline std::span<const SightGraphBinaryString> saveAsJsonHistoryOf(SightGraphBinaryReader const& reader) {
+        return reader.saveAsJsonHistory();
+    }
+
+    inline std::span<const SightGraphBinaryString> saveAsJsonHistoryOf(SightGraphBinaryWriter const& writer) {
+        return writer.saveAsJsonHistory;
+    }
+
+    /**
+     * @brief Copy a node record and its ports to `to`, strings and floats are copied too.
+     * The owner is not changed, components are not copied.
+     */
+    void copyNodeRecord(SightGraphBinaryWriter& to, SightGraphBinaryReader const& from, SightGraphBinaryNode const& record);
+    void copyNodeRecord(SightGraphBinaryWriter& to, SightGraphBinaryWriter const& from, SightGraphBinaryNode const& record);
+
+    /**
+     * @brief Check the magic of a file.
+     */
+    bool isGraphBinaryFile(std::string_view path);
+
+    /**
+     * @brief `baseDir/.sight/cache/dir/name.yaml.sgb` for `baseDir/dir/name.yaml`. The folder starts with a `.`,
+     * so the project file tree ignores it.
+     *
+     * @return empty if the yaml file is not in `baseDir`.
+     */
+    std::string graphBinaryCachePath(std::string_view yamlPath, std::string_view baseDir);
+
+    /**
+     * @brief Size and last modify time of a file, used to check if a cache is outdated.
+     *
+     * @return true if the file exists.
+     */
+    bool graphSourceStamp(std::string_view path, uint64_t& size, int64_t& modifyTime);
+
+    /**
+     * @brief Open the binary cache of a yaml file, if it is made from the current yaml file.
+     *
+     * @return int CODE_OK, CODE_FILE_NOT_EXISTS if there is no yaml file, CODE_FAIL if the cache is outdated,
+     * or the error of `SightGraphBinaryReader::open`.
+     */
+    int openGraphBinaryCache(SightGraphBinaryReader& reader, std::string_view cachePath, std::string_view yamlPath);
+
+    /**
+     * @brief Read all records of a yaml graph file into `writer`, no template is needed.
+     *
+     * @return int CODE_OK, CODE_FILE_ERROR, CODE_FILE_FORMAT_ERROR
+     */
+    int readGraphYamlRecords(std::string_view yamlPath, SightGraphBinaryWriter& writer);
+
+    /**
+     * @brief Convert a yaml graph file to binary, no template is needed.
+     *
+     * @return int CODE_OK, CODE_FILE_ERROR, CODE_FILE_FORMAT_ERROR
+     */
+    int convertGraphYamlToBinary(std::string_view yamlPath, std::string_view binaryPath);
+
+    /**
+     * @brief Convert a binary graph file to yaml, the output is the same as `SightNodeGraph::saveToFile`.
+     *
+     * @return int CODE_OK, CODE_FILE_ERROR, CODE_FILE_FORMAT_ERROR
+     */
+    int convertGraphBinaryToYaml(std::string_view binaryPath, std::string_view yamlPath);
+
+    /**
+     * @brief Write records as a yaml graph file, the file is replaced atomically.
+     *
+     * @return int CODE_OK, CODE_FILE_ERROR
+     */
+    int writeGraphYaml(SightGraphBinaryReader const& reader, std::string_view yamlPath);
+    int writeGraphYaml(SightGraphBinaryWriter const& data, std::string_view yamlPath);
+
+    /**
+     * @brief Instantiate a node from a record, ports are matched by name like the yaml loader.
+     * Components are not loaded here.
+     *
+     * @param node  the new node, it is managed by `graph`.
+     * @return int CODE_OK, CODE_NO_TEMPLATE_ADDRESS, CODE_TEMPLATE_ADDRESS_INVALID, CODE_GRAPH_BROKEN
+     */
+    int loadNodeData(SightGraphBinaryReader const& reader, SightGraphBinaryNode const& record, SightNode*& node, SightNodeGraph* graph);
+    int loadNodeData(SightGraphBinaryWriter const& data, SightGraphBinaryNode const& record, SightNode*& node, SightNodeGraph* graph);
+
+    /**
+     * @brief Append the records of `node` (and its components) to `writer`.
+     */
+    void writeNodeData(SightGraphBinaryWriter& writer, SightNode const& node, SightGraphBinaryOwner ownerKind = SightGraphBinaryOwner::None, uint32_t ownerId = 0);
+
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+
+#include "sight_graph_binary.h"
+
+// extension of a graph's journal file.
+#define SIGHT_GRAPH_JOURNAL_EXT ".sgj"
+// a full save is done instead of appending, if the journal is bigger than this.
+#define SIGHT_GRAPH_JOURNAL_COMPACT_SIZE (1 << 20)
+
+namespace sight {
+
+    /**
+     * @brief Journal of a yaml graph, version 1.
+     * Autosave appends what is changed since the last save, instead of writing the whole yaml file.
+     * A full save removes the journal. `SightNodeGraph::load` replays it if it belongs to the current yaml file.
+     *
+     * Layout: header, then entries. An entry is `SightGraphJournalEntry`, removed node ids, removed connection ids,
+     * padding to 8 bytes, then a binary graph (see sight_graph_binary.h) which holds the nodes and connections
+     * to add or replace, and the settings if `flags` has `SightGraphJournalEntryFlags::Settings`.
+     * A broken entry (e.g. the app crashed while writing it) and all entries after it are ignored.
+     */
+    inline constexpr char sightGraphJournalMagic[8] = { 'S', 'I', 'G', 'H', 'T', 'G', 'J', '\0' };
+    inline constexpr uint32_t sightGraphJournalVersion = 1;
+
+    struct SightGraphJournalHeader {
+        char magic[8];
+        uint32_t version = sightGraphJournalVersion;
+        uint32_t reserved = 0;
+        // the yaml file which this journal is based on.
+        uint64_t sourceSize = 0;
+        int64_t sourceModifyTime = 0;
+    };
+
+    namespace SightGraphJournalEntryFlags {
+        inline constexpr uint32_t Settings = 1 << 0;
+    }
+
+    struct SightGraphJournalEntry {
+        // bytes after this struct
+        uint32_t size = 0;
+        uint32_t flags = 0;
+        uint32_t removedNodeCount = 0;
+        uint32_t removedConnectionCount = 0;
+        // of the bytes after this struct.
+        uint64_t checksum = 0;
+    };
+
+    static_assert(sizeof(SightGraphJournalHeader) % 8 == 0);
+    static_assert(sizeof(SightGraphJournalEntry) % 8 == 0);
+
+    /**
+     * @brief The graph file (yaml and journal), and what is changed in memory since it is written.
+     */
+    struct SightGraphJournalBase {
+        // nodes, ports, connections and components which are changed, see `SightNodeGraph::markDirty`.
+        absl::flat_hash_set<uint32_t> changedIds;
+        bool settingsChanged = false;
+
+        // bytes of the journal file, or queued to it.
+        size_t journalSize = 0;
+        // false if the changes are not known, then the next save must be a full one.
+        bool valid = false;
+    };
+
+    /**
+     * @brief What an entry has: top-level nodes and connections which are added or changed, with their components.
+     */
+    struct SightGraphJournalChanges {
+        SightGraphBinaryWriter data;
+        std::vector<uint32_t> removedNodes;
+        std::vector<uint32_t> removedConnections;
+        // true if `data` has the settings and saveAsJsonHistory.
+        bool settings = false;
+    };
+
+    /**
+     * @brief Hashes of nodes, connections and settings, they do not depend on the order of records.
+     */
+    struct SightGraphRecordHashes {
+        // key: id of a node or a connection, value: hash of it with its components.
+        absl::flat_hash_map<uint32_t, uint64_t> nodes;
+        absl::flat_hash_map<uint32_t, uint64_t> connections;
+        uint64_t settings = 0;
+
+        bool operator==(SightGraphRecordHashes const&) const = default;
+    };
+
+    /**
+     * @brief `dir/.name.yaml.sgj` for `dir/name.yaml`.
+     */
+    std::string graphJournalPath(std::string_view yamlPath);
+
+    /**
+     * @brief Hash records of a snapshot, e.g. to compare the graph with its file.
+     */
+    void hashGraphRecords(SightGraphBinaryWriter const& data, SightGraphRecordHashes& hashes);
+
+    /**
+     * @return false if nothing is changed.
+     */
+    bool makeGraphJournalEntry(SightGraphJournalChanges const& changes, std::string& entry);
+
+    /**
+     * @brief Append an entry and flush it to disk. A journal of another version of the yaml file is dropped first.
+     *
+     * @return int CODE_OK, CODE_FILE_ERROR
+     */
+    int appendGraphJournal(std::string_view yamlPath, std::string_view entry);
+
+    /**
+     * @brief Apply entries of the journal to records of the yaml file.
+     * A torn or broken tail is cut off the file, so later entries are appended after the last good one.
+     *
+     * @param data  records of the yaml file, nodes must be before their components.
+     * @param journalSize  bytes of the valid part of the journal, 0 if it does not exist or is not for the yaml file.
+     * @return int how many entries are applied.
+     */
+    int replayGraphJournal(std::string_view yamlPath, SightGraphBinaryWriter& data, size_t* journalSize = nullptr);
+
+    /**
+     * @return true if a journal of the current yaml file exists, and it has entries.
+     */
+    bool hasGraphJournal(std::string_view yamlPath);
+
+    void removeGraphJournal(std::string_view yamlPath);
+
+}
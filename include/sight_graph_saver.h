@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "sight_graph_binary.h"
+#include "sight_node.h"
+
+namespace sight {
+
+    struct SightGraphSaveStatus {
+        // a snapshot is being written.
+        bool saving = false;
+        // snapshots which wait for writing.
+        int pending = 0;
+        // written snapshots
+        uint saved = 0;
+        // snapshots which are replaced by a newer one of the same file before they are written.
+        uint coalesced = 0;
+        std::string lastError;
+    };
+
+    /**
+     * @brief Write a graph snapshot, used by both the save thread and sync saves.
+     *
+     * @param path  a yaml graph file, or a binary one (`.sgb`).
+     * @param cachePath  binary cache of a yaml file, empty for no cache.
+     * @param data  records of the graph, see `SightNodeGraph::snapshot`.
+     * @return int CODE_OK, CODE_FILE_ERROR
+     */
+    int writeGraphSnapshot(std::string_view path, std::string_view cachePath, SightGraphBinaryWriter& data);
+
+    /**
+     * @brief Write a snapshot on the save thread, the thread is started at the first call.
+     * If an older snapshot of `path` is still waiting, it is replaced by this one.
+     */
+    void queueGraphSave(std::string_view path, std::string_view cachePath, SightGraphBinaryWriter&& data, SaveReason saveReason);
+
+    /**
+     * @brief Append a journal entry of a yaml graph on the save thread, see sight_graph_journal.h.
+     * Entries are never replaced, a later full save of `path` removes the journal.
+     */
+    void queueGraphJournal(std::string_view path, std::string&& entry);
+
+    /**
+     * @return true if a snapshot of `path` is waiting or being written.
+     */
+    bool isGraphSaving(std::string_view path);
+
+    /**
+     * @brief Block until all snapshots of `path` are written.
+     */
+    void waitGraphSave(std::string_view path);
+
+    /**
+     * @brief
+     *
+     * @return true if the last save of `path` failed, the failure is cleared.
+     */
+    bool takeGraphSaveFailure(std::string_view path);
+
+    SightGraphSaveStatus getGraphSaveStatus();
+
+    /**
+     * @brief Write all waiting snapshots, then stop the save thread.
+     */
+    void stopGraphSaveThread();
+
+}
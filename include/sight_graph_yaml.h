@@ -0,0 +1,45 @@
+#pragma once
+
+#include <functional>
+#include <istream>
+#include <string>
+#include <string_view>
+
+#include "sight_graph_binary.h"
+
+namespace sight {
+
+    /**
+     * @brief Callbacks of `readGraphYaml`, every one can be empty.
+     * `line` is 1-based. Return a code other than CODE_OK to stop reading, `readGraphYaml` returns that code.
+     */
+    struct SightGraphYamlCallbacks {
+        // a node or a component. The owner of a component is always reported before the component.
+        std::function<int(SightGraphBinaryWriter const& data, SightGraphBinaryNode const& record, int line)> onNode;
+        // components of the connection are reported after it, by `onNode`.
+        std::function<int(SightGraphBinaryConnection const& record, int line)> onConnection;
+        std::function<int(std::string_view whoAmI)> onWhoAmI;
+        std::function<void(std::string_view key, std::string_view value)> onSetting;
+        std::function<void(std::string_view path)> onSaveAsJsonHistory;
+
+        // if false, records of a node (or a connection) are removed from `data` after they are reported.
+        bool keepRecords = false;
+    };
+
+    /**
+     * @brief Read a yaml graph by parser events, no `YAML::Node` tree is built.
+     * Nodes, components and connections are reported as soon as they end, as records in `data`.
+     *
+     * @param errorMessage  set if the file is bad, it starts with `line x, column y`.
+     * @return int CODE_OK, CODE_FILE_FORMAT_ERROR, or the code returned by a callback.
+     */
+    int readGraphYaml(std::istream& in, SightGraphBinaryWriter& data, SightGraphYamlCallbacks const& callbacks, std::string* errorMessage = nullptr);
+
+    /**
+     * @brief Read the `who-am-i` of a yaml file, reading stops when it is found.
+     *
+     * @return std::string empty if the file is not a yaml file or it has no `who-am-i`.
+     */
+    std::string readYamlWhoAmI(std::string_view path);
+
+}
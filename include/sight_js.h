@@ -4,6 +4,7 @@
 // Js engine and something else.
 #pragma once
 
+#include <chrono>
 #include <future>
 #include <map>
 #include <string_view>
@@ -14,6 +15,8 @@
 #include "shared_queue.h"
 #include "sight_js_parser.h"
 #include "sight_node.h"
+#include "sight_json_writer.h"
+#include "sight_build_manifest.h"
 
 #include "sight_plugin.h"
 #include "v8.h"
@@ -24,6 +27,8 @@
 
 namespace sight{
 
+    class SightGraphBinaryWriter;
+
     enum class JsCommandType {
         JsCommandHolder,
         // run a file and flush node cache
@@ -47,6 +52,8 @@ namespace sight{
         PluginReload,
         PluginEnable,
         PluginDisable,
+        // reload the plugin of a folder, or load it if it is new.
+        PluginReloadAt,
 
         ProjectBuild,
         ProjectClean,
@@ -54,6 +61,8 @@ namespace sight{
         ProjectCodeSetBuild,
         // load all plugins of the project.
         ProjectLoadPlugins,
+        // build graphs of the project, paths are separated by '\n'.
+        ProjectBuildGraphs,
     };
 
     struct JsCommand {
@@ -133,6 +142,9 @@ namespace sight{
 
         void buildNodeCache();
 
+        /**
+         * @brief Nodes are copied at the first call, most generators never read them.
+         */
         std::vector<SightNode>& getCachedNodes();
 
         SightNode findNodeWithId(uint id);
@@ -164,6 +176,7 @@ namespace sight{
         SightNodeGraph* graph = nullptr;
 
         std::vector<SightNode> cachedNodes; 
+        bool nodeCacheBuilt = false;
     };
 
     struct CodeTemplateFunc : public CommonOperation{
@@ -213,9 +226,16 @@ namespace sight{
 
     /**
      * js thread run function.
+     * The js engine is initialized first, then it waits for `startJsThreadWork`.
      */
     void jsThreadRun(const char * exeName);
 
+    /**
+     * @brief Called by the main thread once, after the project is opened (or there is no project to open).
+     * Let the js thread read the project, and wait until its engine is created, so js commands can be added.
+     */
+    void startJsThreadWork();
+
     /**
      * run a js file. | only call this function from js thread.
      * this function should be thread-safe!
@@ -226,19 +246,94 @@ namespace sight{
 
     int runJsFile(v8::Isolate* isolate, const char* filepath, std::promise<int>* promise = nullptr, v8::Local<v8::Value>* resultOuter = nullptr);
 
+    /**
+     * @brief Compile a js file to a function without running it, `module` and `exports` are its parameters if `withModule`.
+     * Errors are logged. Only call this function from js thread, `functionOut` belongs to the caller's handle scope.
+     * @return CODE_OK, CODE_FILE_NOT_EXISTS, CODE_FILE_ERROR
+     */
+    int compileJsFile(v8::Isolate* isolate, const char* filepath, bool withModule, v8::Local<v8::Function>& functionOut);
+
+    /**
+     * @brief Call the compiled function of a js file, `module` and `exports` are passed if `module` is not empty.
+     * Only call this function from js thread.
+     * @return CODE_OK, CODE_FAIL if an exception is thrown, CODE_SCRIPT_NO_RESULT
+     */
+    int callJsFileFunction(v8::Isolate* isolate, v8::Local<v8::Function> function, v8::Local<v8::Object> module = {}, v8::Local<v8::Value>* resultOuter = nullptr);
+
+    /**
+     * @brief Nodes and template nodes which scripts added since the last flush. It is moved to the ui thread as a whole
+     * by one `UICommandType::AddNodeBatch`, and the ui thread moves the nodes into the graph.
+     */
+    struct JsNodeBatch {
+        std::vector<SightNode> nodes;
+        // `templateNode` of them is allocated by js thread, `addTemplateNode` takes it.
+        std::vector<SightNodeTemplateAddress> templateNodes;
+        // when js thread sends it.
+        std::chrono::steady_clock::time_point sendTime;
+
+        JsNodeBatch() = default;
+        JsNodeBatch(JsNodeBatch const&) = delete;
+        JsNodeBatch& operator=(JsNodeBatch const&) = delete;
+        JsNodeBatch(JsNodeBatch&&) = default;
+        JsNodeBatch& operator=(JsNodeBatch&&) = default;
+
+        bool empty() const;
+    };
+
+    /**
+     * @brief Sizes of node batches, and latencies from sent by js thread to applied by ui thread. Updated by ui thread.
+     */
+    struct JsNodeBatchStats {
+        uint batchCount = 0;
+        size_t nodeCount = 0;
+        size_t templateNodeCount = 0;
+        // nodes and template nodes
+        size_t maxBatchSize = 0;
+        float lastLatencyMs = 0;
+        float maxLatencyMs = 0;
+        float totalLatencyMs = 0;
+    };
+
+    /**
+     * @brief Call by ui thread after `batch` is applied.
+     */
+    void recordJsNodeBatch(JsNodeBatch const& batch);
+
+    JsNodeBatchStats const& getJsNodeBatchStats();
+
     /**
      * only call this function from js thread.
-     * todo a sync flag with ui thread.
+     * Nothing is sent if no node is added.
      * @param promise
      */
     void flushJsNodeCache(std::promise<int>* promise = nullptr);
 
     /**
-     *
+     * @brief Drop the node batch, template nodes of it are freed.
      */
     void clearJsNodeCache();
 
-    int parseGraph(std::string_view filename, bool generateTargetLang = true, bool writeToOutFile = true);
+    /**
+     * @param outputPathOut  set to the output file if it is written. The file is not written if its content is same, so
+     *                       its modify time is kept.
+     */
+    int parseGraph(std::string_view filename, bool generateTargetLang = true, bool writeToOutFile = true, std::string* outputPathOut = nullptr);
+
+    /**
+     * @brief Same as above, but the graph is loaded already.
+     */
+    int parseGraph(SightNodeGraph& graph, bool generateTargetLang = true, bool writeToOutFile = true, std::string* outputPathOut = nullptr);
+
+    /**
+     * @brief Hash what a yaml graph is built from: `graphHash` of the file and its journal, `inputHash` of templates,
+     * entities and the code template which it uses, and `pluginHash`. Called by js thread.
+     *
+     * @param entityHashes  key: template address of an entity, value: hash of its file.
+     * @param records  records of the graph with its journal, so the graph can be loaded without reading the file again.
+     * @return int CODE_OK, CODE_FILE_ERROR, CODE_FILE_FORMAT_ERROR
+     */
+    int hashGraphBuildInputs(std::string_view yamlPath, uint64_t pluginHash, absl::flat_hash_map<std::string, uint64_t> const& entityHashes,
+                             BuildManifestEntry& entry, SightGraphBinaryWriter& records);
 
     /**
      * @brief checkTinyData(), tinyData()
@@ -268,6 +363,14 @@ namespace sight{
 
     v8::Local<v8::Function> recompileFunction(v8::Isolate* isolate, std::string sourceCode);
 
+    /**
+     * @brief Write a js value as json, the same as `JSON.stringify` for plain data. No string is made for the whole value.
+     * `undefined` and functions are skipped in objects, and written as `null` in arrays.
+     *
+     * @return false if the value is too deep (e.g. it has a cycle), or a property can not be read.
+     */
+    bool writeJsValueToJson(v8::Isolate* isolate, v8::Local<v8::Value> value, SightJsonWriter& writer, int depth = 0);
+
     void registerToGlobal(v8::Isolate* isolate, std::map<std::string, std::string>* map);
 
     void registerToGlobal(v8::Isolate* isolate, v8::Local<v8::Value> object);
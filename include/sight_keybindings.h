@@ -41,6 +41,9 @@ namespace sight {
         SightKeyWrapper insertNode;
         SightKeyWrapper markNode;
         SightKeyWrapper detachNode;
+
+        // search palette
+        SightKeyWrapper search;
     };
 
 
@@ -18,6 +18,7 @@
 #include <sys/stat.h>
 #include <vector>
 #include <map>
+#include <memory>
 
 
 #include "yaml-cpp/yaml.h"
@@ -151,6 +152,12 @@ namespace sight {
          */
         SightNodeValue& operator=(SightNodeValue const& rhs);
 
+        /**
+         * @brief Take the large string buffer from rhs instead of copying it.
+         */
+        SightNodeValue(SightNodeValue&& rhs) noexcept;
+        SightNodeValue& operator=(SightNodeValue&& rhs) noexcept;
+
         ~SightNodeValue();
         
     private:
@@ -160,6 +167,45 @@ namespace sight {
         void stringFree();
     };
 
+    /**
+     * @brief An interned port name.
+     * The string itself lives in a global symbol table, so copying a port name is just copying an id and a pointer,
+     * and two names are equal if and only if their ids are equal.
+     * Id 0 is the empty name (title bar ports).
+     */
+    struct SightPortName {
+        SightPortName() = default;
+        explicit SightPortName(std::string_view name);
+
+        SightPortName& operator=(std::string_view name);
+
+        /**
+         * @brief Find an already interned name, this will not add `name` to the symbol table.
+         * 
+         * @param name 
+         * @param out  set to the interned name if found.
+         * @return true  found
+         * @return false no port can have this name.
+         */
+        static bool find(std::string_view name, SightPortName& out);
+
+        uint getId() const;
+        std::string const& str() const;
+        const char* c_str() const;
+        size_t size() const;
+        bool empty() const;
+
+        bool operator==(SightPortName const& rhs) const;
+        /**
+         * @brief Compare with a raw string. Prefer compare with another SightPortName, that is an integer comparison.
+         */
+        bool operator==(std::string_view name) const;
+
+    private:
+        uint id = 0;
+        const std::string* pointer = nullptr;
+    };
+
     /**
      * 
      */
@@ -172,8 +218,11 @@ namespace sight {
         char* varName = nullptr;
         short varNameLength = 0;
 
-        std::string customPortName;
+        SightPortName customPortName;
 
+        SightNodePortOptions() = default;
+        SightNodePortOptions(SightNodePortOptions const& rhs);
+        SightNodePortOptions(SightNodePortOptions&& rhs) noexcept;
         ~SightNodePortOptions();
 
         void initVarName(); 
@@ -191,20 +240,41 @@ namespace sight {
         bool show = true;
         bool readonly = false;
         std::string errorMsg;
-        // render as a combo box 
-        std::vector<std::string> alternatives;
+        // render as a combo box. Shared with the template port, replace the whole list if you need to change it.
+        std::shared_ptr<const std::vector<std::string>> alternatives;
         // show as a type list
         bool typeList = false;
         // allow a port list? 
         bool dynamic = false;
     };
 
+    /**
+     * @brief Copy-on-write options of a port. Ports which are instantiated or copied from one share its options,
+     * read them by `->`, `edit()` gives the port its own copy at the first write.
+     */
+    struct SightPortOptionsRef {
+        SightPortOptionsRef();
+
+        SightBaseNodePortOptions const* operator->() const {
+            return pointer.get();
+        }
+
+        SightBaseNodePortOptions const& operator*() const {
+            return *pointer;
+        }
+
+        SightBaseNodePortOptions& edit();
+
+    private:
+        std::shared_ptr<SightBaseNodePortOptions> pointer;
+    };
+
 
     struct SightBaseNodePort {
-        std::string portName;
+        SightPortName portName;
         // input/output ...
         NodePortType kind;
-        SightBaseNodePortOptions options;
+        SightPortOptionsRef options;
 
         uint type;
 
@@ -223,6 +293,8 @@ namespace sight {
         virtual uint getType() const;
 
         const char* getPortName() const;
+
+        SightBaseNodePortOptions const& getOptions() const;
     };
 
     /**
@@ -248,6 +320,11 @@ namespace sight {
 
         SightNodePort() = default;
         ~SightNodePort() = default;
+        SightNodePort(SightNodePort const&) = default;
+        // moving a port does not copy the value buffers.
+        SightNodePort(SightNodePort&&) = default;
+        SightNodePort& operator=(SightNodePort const&) = default;
+        SightNodePort& operator=(SightNodePort&&) = default;
         SightNodePort(NodePortType kind, uint type, const SightJsNodePort* templateNodePort = nullptr);
 
         /**
@@ -414,6 +491,17 @@ namespace sight {
 
         bool changeRight(uint newRight);
         bool changeLeft(uint newLeft);
+
+        int getPriority() const;
+        /**
+         * @brief change priority, re-sort both ports and mark the graph's adjacency stale.
+         */
+        void setPriority(int priority);
+
+        /**
+         * @brief connection order of a port: bigger priority first, then smaller id.
+         */
+        static bool orderBefore(SightNodeConnection const* c1, SightNodeConnection const* c2);
     };
 
     /**
@@ -585,8 +673,9 @@ namespace sight {
         /**
          * @brief No dot call this function mutiple times.
          * 
+         * @return false if the event throws.
          */
-        void callEventOnInstantiate();
+        bool callEventOnInstantiate();
 
         /**
          * @brief Does this node component compatible?
@@ -814,6 +903,8 @@ namespace sight {
         // called by js thread
         ScriptFunctionWrapper::Function generateCodeWork;
         ScriptFunctionWrapper::Function onReverseActive;
+        // sources of the js thread functions, used to find changed templates when a plugin reloads.
+        std::string functionsSource;
 
         // events ,  called by ui thread.
         ScriptFunctionWrapper onInstantiate;
@@ -826,6 +917,10 @@ namespace sight {
 
         SightJsNode();
         ~SightJsNode() = default;
+        SightJsNode(SightJsNode const&) = default;
+        SightJsNode(SightJsNode&&) noexcept = default;
+        SightJsNode& operator=(SightJsNode const&) = default;
+        SightJsNode& operator=(SightJsNode&&) noexcept = default;
 
         /**
          *
@@ -835,6 +930,13 @@ namespace sight {
 
         void compact();
 
+        /**
+         * @brief Compare everything except the style and the js thread functions' objects.
+         * 
+         * @param node  a node which is not compacted, e.g. a reloaded one.
+         */
+        bool isSameDefinition(SightJsNode const& node) const;
+
         /**
          * TODO  this function should be DELETED!
          * instantiate a node by this node.
@@ -854,7 +956,10 @@ namespace sight {
         void updateStyle();
         bool isStyleInitialized() const;
 
-        void callEventOnInstantiate(SightNode* p) const;
+        /**
+         * @return false if the event throws.
+         */
+        bool callEventOnInstantiate(SightNode* p) const;
 
         bool checkAsComponent() const;
 
@@ -906,6 +1011,8 @@ namespace sight {
         SightJsNode* templateNode = nullptr;
         //
         std::vector<SightNodeTemplateAddress> children;
+        // key: name of a child, value: index of `children`
+        absl::flat_hash_map<std::string, size_t> childIndexes;
 
         SightNodeTemplateAddress();
         ~SightNodeTemplateAddress();
@@ -966,6 +1073,10 @@ namespace sight {
 
         // node template | for render
         std::vector<SightNodeTemplateAddress> templateAddressList;
+        // key: name, value: index of `templateAddressList`
+        absl::flat_hash_map<std::string, size_t> templateAddressIndexes;
+        // key: full address without `sight://`, value: template node in `templateNodeArray`
+        absl::flat_hash_map<std::string, SightJsNode*> templateNodeMap;
 
         SightArray<SightJsNode> templateNodeArray{ LITTLE_ARRAY_SIZE * 2 };
         SightArray<SightJsNodePort> templateNodePortArray{ MEDIUM_ARRAY_SIZE };
@@ -1021,6 +1132,10 @@ namespace sight {
      */
     int addTemplateNode(const SightNodeTemplateAddress& templateAddress, bool isUpdate = false);
 
+    /**
+     * @brief Delete a template, or a folder with all templates in it.
+     * @return false if `fullName` is not found.
+     */
     bool delTemplateNode(std::string_view fullName);
 
     /**
@@ -1093,7 +1208,7 @@ namespace sight {
 
     inline bool isNodePortShowValue(SightNodePort const& port){
         uint type = port.getType();
-        return port.options.showValue && type != IntTypeProcess && type != IntTypeObject;
+        return port.options->showValue && type != IntTypeProcess && type != IntTypeObject;
     }
 
     /**
@@ -1,12 +1,19 @@
 
 #pragma once
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "sight_node.h"
+#include "sight_graph_journal.h"
 #include <vector>
 
 namespace sight {
 
+    class SightGraphBinaryReader;
+    class SightGraphBinaryWriter;
+    struct SightGraphBinaryNode;
+    struct SightGraphBinaryConnection;
+
     struct SightNodeGraphOutputJsonConfig {
         std::string nodeRootName = "nodes";
         std::string connectionRootName = "connections";
@@ -25,6 +32,134 @@ namespace sight {
         CaseTypes fieldNameCaseType = CaseTypes::None;
     };
 
+    /**
+     * @brief One edge of the adjacency index.
+     */
+    struct SightNodeGraphEdge {
+        SightNodeConnection* connection = nullptr;
+        // the port which is queried.
+        SightNodePort* self = nullptr;
+        // the port on the other side of the connection.
+        SightNodePort* target = nullptr;
+
+        inline operator SightNodePortConnection() const {
+            return { self, target, connection };
+        }
+    };
+
+    /**
+     * @brief Adjacency index of a graph's connections.
+     * Every port owns a contiguous row of edges, ordered by `SightNodeConnection::orderBefore`,
+     * and each edge has its ports already resolved, so traversals do not need to look up the id map.
+     * An edit only marks the rows of the ports it touches, they are read again from `SightNodePort::connections` at the
+     * next query. The whole index is rebuilt only after `markStale`.
+     */
+    class SightNodeGraphAdjacency {
+    public:
+        struct EdgeRange {
+            const SightNodeGraphEdge* first = nullptr;
+            const SightNodeGraphEdge* last = nullptr;
+
+            inline const SightNodeGraphEdge* begin() const {
+                return first;
+            }
+            inline const SightNodeGraphEdge* end() const {
+                return last;
+            }
+            inline size_t size() const {
+                return last - first;
+            }
+            inline bool empty() const {
+                return first == last;
+            }
+            inline SightNodeGraphEdge const& front() const {
+                return *first;
+            }
+            inline SightNodeGraphEdge const& back() const {
+                return *(last - 1);
+            }
+        };
+
+        /**
+         * @brief Edges which `left` is `portId`, target is the right port.
+         * 
+         * @param portId 
+         * @return EdgeRange 
+         */
+        EdgeRange successors(uint portId) const;
+
+        /**
+         * @brief Edges which `right` is `portId`, target is the left port.
+         * 
+         * @param portId 
+         * @return EdgeRange 
+         */
+        EdgeRange predecessors(uint portId) const;
+
+        /**
+         * @brief successors or predecessors, depends on port's kind.
+         */
+        EdgeRange edgesOf(SightNodePort const& port) const;
+
+        /**
+         * @brief Everything is rebuilt at the next `update`.
+         */
+        void markStale();
+        /**
+         * @brief Rows of the port are read again at the next `update`, a port which is removed loses its rows.
+         */
+        void markPortStale(uint portId);
+        bool isStale() const;
+
+        /**
+         * @brief Read stale rows again, or rebuild everything after `markStale`.
+         */
+        void update(SightNodeGraph& graph);
+
+        /**
+         * @brief Rebuild from all alive connections of the graph.
+         * 
+         * @param graph 
+         */
+        void rebuild(SightNodeGraph& graph);
+
+        void clear();
+
+    private:
+        // key: port id. The heap memory of a row is kept when the map grows.
+        using Rows = absl::flat_hash_map<uint, std::vector<SightNodeGraphEdge>>;
+
+        Rows outRows;
+        Rows inRows;
+        absl::flat_hash_set<uint> stalePorts;
+        bool stale = true;
+
+        static EdgeRange find(Rows const& rows, uint portId);
+        static void sortRow(std::vector<SightNodeGraphEdge>& row);
+        void updatePort(SightNodeGraph& graph, uint portId);
+    };
+
+    /**
+     * @brief Result of `SightNodeGraph::analyze()`, it only covers process-chain edges,
+     * which are the edges code generation walks through (see `SightNode::findPortByProcess()`).
+     */
+    struct SightNodeGraphAnalysis {
+        uint enterNode = 0;
+        // node ids reachable from the enter node, ordered by a topological order. Nodes of a cycle are adjacent.
+        std::vector<uint> topologicalOrder;
+        // each item is a strongly connected component which has more than 1 node, or a node links to itself.
+        std::vector<std::vector<uint>> cycles;
+        // cycles which can be reached from the enter node, index of `cycles`. Code generation can not finish if this is not empty.
+        std::vector<size_t> reachableCycles;
+        // alive nodes which can not be reached from the enter node, they will not generate code.
+        std::vector<uint> unreachableNodes;
+
+        /**
+         * @brief Describe reachable cycles, e.g. "cycle: 1021 -> 1035 -> 1021"
+         */
+        std::string cycleMessage() const;
+    };
+
     /**
      * A graph contains many nodes.
      */
@@ -119,10 +254,23 @@ namespace sight {
          */
         int load(std::string_view path);
 
+        /**
+         * @brief Load records which are already read from `path` and its journal, the file is not read again.
+         * @return CODE_OK success.
+         */
+        int load(std::string_view path, SightGraphBinaryWriter const& records);
+
+        /**
+         * @brief Save if the graph is edited. The graph is snapshotted here, and written on the save thread,
+         * see sight_graph_saver.h. Autosave of a yaml graph snapshots only what is marked by `markDirty(id)`,
+         * and appends it to the journal.
+         *
+         * @return int CODE_OK if the snapshot is queued, CODE_FAIL if the graph is broken.
+         */
         int save(SaveReason saveReason = SaveReason::User);
 
         /**
-         * Save graph data to file.
+         * Save graph data to file, wait until it is written.
          * @param path
          * @param set       if true, then set this->filepath to path
          * @param saveAnyway  if true, broken flag will be omitted.
@@ -130,6 +278,33 @@ namespace sight {
          */
         int saveToFile(const char* path = nullptr, bool set = false, bool saveAnyway = false, SaveReason saveReason = SaveReason::User);
 
+        /**
+         * @brief Load a binary graph file (see sight_graph_binary.h). `load` calls it for `.sgb` files and valid caches.
+         * 
+         * @param path 
+         * @return int CODE_OK, CODE_FAIL if a node can not be loaded, CODE_FILE_ERROR, CODE_FILE_FORMAT_ERROR
+         */
+        int loadBinary(std::string_view path);
+
+        /**
+         * @brief Save graph data as binary, the yaml file is not touched.
+         * 
+         * @param path 
+         * @param sourcePath  if not empty, the binary is a cache of this yaml file, and records its size and modify time.
+         * @return int CODE_OK, CODE_FILE_ERROR
+         */
+        int saveToBinaryFile(std::string_view path, std::string_view sourcePath = {});
+
+        /**
+         * @brief Copy the graph into flat records, it is cheap and the records do not refer to the graph.
+         */
+        void snapshot(SightGraphBinaryWriter& writer) const;
+
+        /**
+         * @brief Compare the graph with its yaml file and journal, e.g. after the file is changed outside.
+         * A binary graph, a file which is written by sight itself (see `isOwnWrite`), or a file which can not be read, is treated as same.
+         */
+        bool isSameAsFile() const;
 
         void setFilePath(const char* path);
         const char* getFilePath() const;
@@ -188,7 +363,22 @@ namespace sight {
          */
         void checkAndFixIdError();
 
+        /**
+         * @brief Something is changed, but it is not known what, so the next save is a full one.
+         */
         void markDirty();
+
+        /**
+         * @brief A node, port, connection or component is changed, added or removed.
+         * Autosave appends only what is marked to the journal, instead of writing the whole file.
+         */
+        void markDirty(uint anyThingId);
+
+        /**
+         * @brief Settings or saveAsJsonHistory are changed.
+         */
+        void markSettingsDirty();
+
         bool isDirty() const;
 
         void markBroken(bool broken = true, std::string_view str = {});
@@ -225,6 +415,13 @@ namespace sight {
          */
         int outputJson(std::string_view path, bool overwrite, SightNodeGraphOutputJsonConfig const& config) const;
 
+        /**
+         * @brief Same data as `outputJson`, in the binary runtime format, see sight_runtime_graph.h.
+         *
+         * @return int CODE_OK, CODE_FILE_EXISTS, CODE_FILE_ERROR, CODE_FAIL if a value can not be written.
+         */
+        int outputRuntimeGraph(std::string_view path, bool overwrite, SightNodeGraphOutputJsonConfig const& config) const;
+
         // SightArray<SightComponentContainer>& getComponentContainers();
 
         // create container
@@ -287,6 +484,84 @@ namespace sight {
 
         bool detachNodeConnections(uint nodeId, bool onlyTitleBarPort = true);
 
+        /**
+         * @brief The adjacency index, it will be rebuilt first if it is stale.
+         * Do not keep the result across connection changes.
+         * 
+         * @return SightNodeGraphAdjacency const& 
+         */
+        SightNodeGraphAdjacency const& getAdjacency();
+
+        /**
+         * @brief Call this after nodes, connections or ports changed, the adjacency index is rebuilt at the next query.
+         * Functions of SightNodeGraph, SightNode, SightNodePort and SightNodeConnection already call it or the ones below.
+         * This also invalidates `analyze()` and `verifyId()` caches.
+         */
+        void markAdjacencyStale();
+
+        /**
+         * @brief Same as `markAdjacencyStale`, but only rows of the port are read again.
+         */
+        void markPortAdjacencyStale(uint portId);
+
+        /**
+         * @brief Rows of all ports of the node, and of ports connected to them, are read again. e.g. the node is added,
+         * removed, or its port vectors are moved.
+         */
+        void markNodeAdjacencyStale(SightNode const& node);
+
+        SightNodeGraphAdjacency::EdgeRange successors(uint portId);
+        SightNodeGraphAdjacency::EdgeRange predecessors(uint portId);
+
+        /**
+         * @brief Start a batch of mutations. Until the outermost `commit()`:
+         * `registerNode` only registers ids, the onInstantiate event and `nodeAdded` are delayed;
+         * `addConnection` does not sort port connections; `markDirty` is recorded but not applied.
+         * Ids are still registered at once, so `createConnection` can find ports of nodes in the same batch.
+         * Batches can be nested.
+         */
+        void beginBatch();
+
+        /**
+         * @brief Apply the delayed work of the batch in one pass. 
+         * 
+         * @param rollbackOnEventError  if an onInstantiate event throws, delete nodes and connections of the batch
+         *                              like `rollback`, and `nodeAdded` is not dispatched.
+         * @return int CODE_OK, CODE_FAIL if there is no batch or the batch is rolled back.
+         */
+        int commit(bool rollbackOnEventError = false);
+
+        /**
+         * @brief Delete nodes and connections which are added in current batch, and drop the delayed work.
+         * This ends the batch, even if it is nested.
+         */
+        void rollback();
+
+        bool isInBatch() const;
+
+        /**
+         * @brief Free nodes and connections which are marked as deleted and whose ids are not in `referencedIds`.
+         * Does nothing in a batch.
+         * 
+         * @param referencedIds ids still used by undo/redo records.
+         * @param budget max objects to free, 0 means no limit.
+         * @return int how many objects are freed.
+         */
+        int reclaimDeleted(absl::flat_hash_set<uint> const& referencedIds, int budget = 0);
+
+        /**
+         * @brief Increase when nodes/connections changed.
+         */
+        uint getStructureVersion() const;
+
+        /**
+         * @brief Topological order, cycles and reachability from the enter node.
+         * The result is cached until nodes/connections or the enter node changed.
+         * 
+         * @return SightNodeGraphAnalysis const& 
+         */
+        SightNodeGraphAnalysis const& analyze();
+
 
     private:
         // save and read path.
@@ -310,6 +585,35 @@ namespace sight {
 
         std::vector<std::string> saveAsJsonHistory;
 
+        SightNodeGraphAdjacency adjacency;
+        // increase when nodes/connections changed.
+        uint structureVersion = 1;
+        // structureVersion of last successful verifyId()
+        uint idVerifiedVersion = 0;
+
+        SightNodeGraphAnalysis analysis;
+        // structureVersion of `analysis`
+        uint analysisVersion = 0;
+
+        // what is changed since the yaml file and its journal are written, autosave appends it to the journal.
+        SightGraphJournalBase journalBase;
+
+        struct BatchState {
+            int depth = 0;
+            // nodes registered in batch, their events are not called yet.
+            std::vector<SightNode*> nodes;
+            // ids of connections created in batch.
+            std::vector<uint> connections;
+            // ports which connections need to be sorted.
+            absl::flat_hash_set<uint> unsortedPorts;
+            bool dirty = false;
+        } batch;
+
+        /**
+         * @brief Delete connections and nodes which are added in a batch, the dirty flag is kept.
+         */
+        void discardBatch(BatchState const& state);
+
         /**
          * Dispose graph.
          */
@@ -321,8 +625,66 @@ namespace sight {
         void reset();
 
         void rebuildIdMap();
+
+        /**
+         * @brief Load records of a binary file, or records of a yaml file with its journal applied.
+         */
+        template<class Source>
+        int loadRecords(Source const& source);
+
+        /**
+         * @brief Nothing is changed since the graph is loaded from or fully saved to `filepath`.
+         */
+        void resetJournalBase();
+
+        /**
+         * @brief Set `editing`, or the dirty flag of the batch.
+         */
+        void markEdited();
+
+        /**
+         * @brief Records of what `journalBase` marks as changed: top-level nodes and connections with their components.
+         * Marked ids which are not found any more are removed ones.
+         */
+        void snapshotChanges(SightGraphJournalChanges& changes) const;
+
+        void snapshotSettings(SightGraphBinaryWriter& writer) const;
+
+        /**
+         * @brief Register a loaded node, or add it to the component container of its owner.
+         *
+         * @param loadedNodes  loaded nodes and components by id, `node` is added if it is attached.
+         * @return int CODE_OK, CODE_FAIL if the owner is not loaded.
+         */
+        int attachLoadedNode(SightNode* node, SightGraphBinaryNode const& record, absl::flat_hash_map<uint, SightNode*>& loadedNodes);
+
+        /**
+         * @return int CODE_OK, CODE_FAIL if a port is not found.
+         */
+        int loadConnection(SightGraphBinaryConnection const& record);
+
+        void loadSetting(std::string_view key, std::string_view value);
+
+        /**
+         * @brief Load `yamlPath`'s binary cache if it is up to date.
+         * 
+         * @return int CODE_OK if loaded.
+         */
+        int loadBinaryCache(std::string_view yamlPath);
+
+        /**
+         * set graph ref of nodes, connections and their components.
+         */
+        void bindGraphRefs();
     };
 
+    /**
+     * @brief Parse a yaml graph into records and apply its journal ahead, e.g. while a project is opening.
+     * The next `SightNodeGraph::load` of the path uses them if the file is not changed, it only makes nodes from
+     * the records, which needs templates of the ui thread. Only the last prefetched graph is kept. Thread safe.
+     */
+    void prefetchGraph(std::string_view yamlPath);
+
     /**
      * @brief Get the Replaceable(suitable) Port object
      * 
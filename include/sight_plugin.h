@@ -29,6 +29,8 @@ namespace sight {
     class Plugin {
     public:
         using V8ObjectType = v8::Persistent<v8::Object, v8::CopyablePersistentTraits<v8::Object>>;
+        // key: canonical path of a load file, value: the function compiled from the file.
+        using CompiledFiles = absl::flat_hash_map<std::string, v8::Local<v8::Function>>;
 
         Plugin(PluginManager* pluginManager, std::string name, std::string path, std::string version, std::string author);
 
@@ -49,14 +51,24 @@ namespace sight {
          */
         int load();
 
+        /**
+         * @brief Read `package.js` only, the load files are run by `justLoad`.
+         *
+         * @return CODE_OK, or the same codes as `load`
+         */
+        int loadPackage();
+
         int reload();
 
         /**
          * @brief only use when load a disabled plugin!
          * 
+         * All load files are compiled before any of them runs. If one throws, templates and nodes which earlier files
+         * added are dropped.
+         * @param compiledFiles  files in it are not compiled again, others are compiled by `compileJsFile`.
          * @return int 
          */
-        int justLoad(v8::Local<v8::Context> context);
+        int justLoad(v8::Local<v8::Context> context, CompiledFiles const* compiledFiles = nullptr);
 
         /**
          * @brief disabled this plugin
@@ -85,6 +97,13 @@ namespace sight {
         // disabledByProject
         bool isDisabledByProject() const;
 
+        std::vector<std::string> const& getDepends() const;
+
+        /**
+         * @brief Canonical paths of load files which exist, in load order.
+         */
+        std::vector<std::string> getLoadFilePaths() const;
+
     private:
         std::string name;
         std::string path;
@@ -129,6 +148,13 @@ namespace sight {
 
         int loadPluginAt(std::string_view path);
 
+        /**
+         * @brief Load plugins at `paths` together. Load files of all plugins are read and compiled by background threads,
+         * then they are run in the order of `depends`. Missing and circular depends are reported before running.
+         * @return count of loaded plugins
+         */
+        int loadPluginsAt(std::vector<std::string> const& paths);
+
         v8::Isolate* getIsolate();
 
         void addSearchPath(const char* path);
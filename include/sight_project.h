@@ -4,12 +4,15 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <string>
 #include <string_view>
 #include <tuple>
 #include <vector>
 #include <map>
+#include <mutex>
+#include <thread>
 #include "atomic"
 #include "sys/types.h"
 
@@ -22,6 +25,13 @@
 #include "sight_node.h"
 #include "sight_node_graph.h"
 #include "sight_code_set.h"
+#include "sight_json_writer.h"
+#include "sight_project_index.h"
+#include "sight_entity_store.h"
+#include "sight_template_usage.h"
+#include "sight_stale_outputs.h"
+#include "sight_project_watcher.h"
+#include "sight_type_registry.h"
 
 #include "crude_json.h"
 
@@ -122,7 +132,12 @@ namespace sight {
 
         std::string getSimpleName() const;
 
-        bool writeToJson(SightNodeValue const& value, crude_json::value & parent, std::string_view key) const;
+        /**
+         * @brief Write `value` by the render kind.
+         *
+         * @return false if the type can not be written, nothing is written then.
+         */
+        bool writeToJson(SightNodeValue const& value, SightJsonWriter& writer) const;
     };
 
 
@@ -249,6 +264,40 @@ namespace sight {
 
     };
 
+    enum class ProjectLoadPhase {
+        Config,
+        Style,
+        Entities,
+        FileIndex,
+        LastGraph,
+        Plugins,
+
+        // count of phases, not a phase.
+        Count,
+    };
+
+    /**
+     * @brief Time of each phase of opening a project. Phases run on different threads, the loading window shows them.
+     * Thread safe.
+     */
+    struct ProjectLoadTimings {
+        void begin(ProjectLoadPhase phase);
+        void end(ProjectLoadPhase phase);
+
+        /**
+         * @param finished  set to true if the phase is over.
+         * @return float milliseconds, a running phase counts until now. -1 if the phase is not started.
+         */
+        float elapsedMs(ProjectLoadPhase phase, bool* finished = nullptr) const;
+
+        static const char* name(ProjectLoadPhase phase);
+
+    private:
+        // microseconds of the steady clock, 0 if it is not happened.
+        std::atomic<int64_t> beginTimes[static_cast<int>(ProjectLoadPhase::Count)] = {};
+        std::atomic<int64_t> endTimes[static_cast<int>(ProjectLoadPhase::Count)] = {};
+    };
+
     /**
      * project class.
      * todo add thread safe guard.
@@ -261,6 +310,7 @@ namespace sight {
 
         Project() = default;
         Project(const char* baseDir, bool createIfNotExist);
+        ~Project();
 
         int codeSetBuild();
         int build(const char* target);
@@ -270,7 +320,21 @@ namespace sight {
         uint nextNodeOrPortId();
         uint maxNodeOrPortId() const;
 
+        /**
+         * @brief Config is loaded first, then styles, entities, the file index scan and the last graph are read on worker
+         * threads. It returns when styles and entities are applied, the scan and the last graph may be still running, see
+         * `waitLoadTasks`.
+         */
         int load();
+
+        /**
+         * @brief Wait for the file index scan and the last graph read which are started by `load`.
+         * The file cache is built here if the scan did not run.
+         */
+        void waitLoadTasks();
+
+        ProjectLoadTimings const& getLoadTimings() const;
+
         int loadConfigFile();
         /**
          * @brief load type style, 
@@ -327,9 +391,14 @@ namespace sight {
          */
         uint addTypeInfo(TypeInfo info, TypeStyle const& typeStyle, bool merge = false);
 
-        TypeInfo const& getTypeInfo(uint id, bool* isFind = nullptr);
+        /**
+         * @brief Constant time, for ports which are drawn every frame.
+         *
+         * @return an empty type info if not found.
+         */
+        TypeInfo const& getTypeInfo(uint id, bool* isFind = nullptr) const;
 
-        std::tuple<TypeInfo const&, bool> findTypeInfo(uint id);
+        std::tuple<TypeInfo const&, bool> findTypeInfo(uint id) const;
 
         std::string getBaseDir() const;
 
@@ -368,12 +437,21 @@ namespace sight {
 
         absl::btree_map<std::string, BuildTarget> & getBuildTargetMap();
 
-        absl::btree_map<uint, TypeInfo> const& getTypeInfoMap() const;
+        TypeRegistry const& getTypeRegistry() const;
 
         std::string getLastOpenGraph() const;
 
+        /**
+         * @brief All entities, fields of an entity may be not read yet, use `getSightEntity` to get a full entity.
+         */
         absl::btree_map<std::string, SightEntity> const& getEntitiesMap() const;
+        /**
+         * @brief Only a lookup, fields of the entity may be not read yet.
+         */
         SightEntity const* getSightEntity(std::string_view fullName) const;
+        /**
+         * @brief Fields of the entity are read from its file if they are not read yet.
+         */
         SightEntity* getSightEntity(std::string_view fullName);
 
         bool hasEntity(std::string_view fullName) const;
@@ -381,10 +459,35 @@ namespace sight {
         bool updateEntity(SightEntity const& entity, SightEntity const& oldEntity);
         bool delEntity(std::string_view fullName);
 
-        void updateEntitiesToTemplateNode() const;
+        /**
+         * @brief Add the template node of an entity which is not added yet. Template nodes of entities are added when
+         * they are used, by a graph or the node menu.
+         * Call by ui thread.
+         *
+         * @return true if the template node is added.
+         */
+        bool registerEntityTemplate(std::string_view templateAddress);
+
+        /**
+         * @brief Add template nodes of all entities which are not added yet. Call by ui thread.
+         */
+        void updateEntitiesToTemplateNode();
+
+        /**
+         * @return true if some template nodes of entities are not added yet. Can be called by any thread.
+         */
+        bool hasPendingEntityTemplates() const;
 
+        /**
+         * @brief Generate all graphs, graphs which are up to date are skipped. Called by js thread.
+         */
         void parseAllGraphs() const;
 
+        /**
+         * @brief Generate these graphs, graphs which are up to date are skipped. Called by js thread.
+         */
+        void parseGraphs(std::vector<std::string> const& graphPaths) const;
+
         /**
          * @brief check is any graph has the template node's instance.
          * 
@@ -394,6 +497,56 @@ namespace sight {
          */
         bool isAnyGraphHasTemplate(std::string_view templateAddress, std::string* pathOut = nullptr);
 
+        /**
+         * @brief Graphs which use the template, files in the project are only read if they are changed.
+         * Unsaved changes of the current graph are not included.
+         */
+        std::vector<TemplateUsage> findTemplateUsages(std::string_view templateAddress);
+
+        TemplateUsageIndex& getTemplateUsageIndex();
+
+        /**
+         * @brief Outputs of graphs which use the template are stale. Graphs are found when stale outputs are read, so
+         * template usages are refreshed once for many templates.
+         */
+        void markTemplateStale(std::string_view templateAddress);
+        void markCodeTemplateStale(std::string_view codeTemplate);
+        void markGraphStale(std::string_view graphPath);
+
+        /**
+         * @brief Graphs are generated by the js thread.
+         * @param graphPaths  separated by '\n'
+         */
+        void onGraphsBuilt(std::string_view graphPaths);
+
+        StaleOutputs const& getStaleOutputs();
+
+        /**
+         * @brief Graphs of the file cache, used by building and template usages. Can be called by any thread,
+         * it waits for the file scan.
+         */
+        std::vector<std::string> getGraphPaths() const;
+
+        /**
+         * @brief Generate graphs of stale outputs, by the js thread.
+         */
+        void buildStaleOutputs();
+
+        /**
+         * @brief Watch graph, src, plugin and entity folders, see `onFilesChanged`. Nothing is done if
+         * `SightSettings::watchProject` is false.
+         */
+        void startWatcher();
+        void stopWatcher();
+
+        /**
+         * @brief Files are changed outside, called by ui thread. Only changed folders of the file tree are read again,
+         * the current graph is reloaded if it has no unsaved changes, changed plugins are reloaded and changed entities
+         * are read again.
+         * @param paths  separated by '\n'
+         */
+        void onFilesChanged(std::string_view paths);
+
         std::string pathSrcFolder() const;
         std::string pathTargetFolder() const;
 
@@ -414,11 +567,29 @@ namespace sight {
         bool createIfNotExist;
         ProjectConfig projectConfig;
         ProjectFile fileCache;
+        // kinds of files in the project folder, it makes `buildFilesCache` read only changed files.
+        ProjectFileIndex fileIndex;
+        bool fileIndexLoaded = false;
+        TemplateUsageIndex templateUsageIndex;
+        StaleOutputs staleOutputs;
+        // marked by `markTemplateStale` and `markCodeTemplateStale`, not applied to `staleOutputs` yet.
+        absl::flat_hash_set<std::string> staleTemplates;
+        absl::flat_hash_set<std::string> staleCodeTemplates;
+        // graphs of `fileCache`, for other threads.
+        mutable std::mutex graphPathsLock;
+        std::vector<std::string> graphPathsCache;
+        ProjectWatcher watcher;
+        ProjectLoadTimings loadTimings;
+        // tasks started by `load`
+        std::thread fileScanThread;
+        std::thread lastGraphThread;
+        // the file cache is built by `fileScanThread`, `fileCache` and `fileIndex` are not read before it is true.
+        std::atomic<bool> filesCacheReady = false;
         SightCodeSetSettings codeSetSettings;
 
         std::atomic<uint> typeIdIncr;
         absl::btree_map<std::string, uint> typeMap;
-        absl::btree_map<uint, TypeInfo> typeInfoMap;
+        TypeRegistry typeRegistry;
 
         std::string lastOpenGraph{};
         std::string lastBuildTarget{};
@@ -427,6 +598,11 @@ namespace sight {
         absl::btree_map<std::string, BuildTarget> buildTargetMap;
         // key: entity full name
         absl::btree_map<std::string, SightEntity> entitiesMap;
+        EntityStore entityStore;
+        // entities which template node is not added. key: template address, value: entity full name
+        absl::flat_hash_map<std::string, std::string> pendingEntityTemplates;
+        // !pendingEntityTemplates.empty(), for other threads.
+        std::atomic<bool> entityTemplatesPending = false;
 
         // cache for all type names
         std::vector<std::string> typeListCache;
@@ -438,9 +614,53 @@ namespace sight {
         // file locations
         std::string pathConfigFile() const;
         std::string pathStyleConfigFile() const;
-        std::string pathEntitiesConfigFile() const;
 
 
+        void applyStyleInfo(std::vector<std::pair<uint, TypeStyle>> const& styles);
+        /**
+         * @brief Add types of entities which are read by `entityStore`.
+         * @param status  status of `EntityStore::load`
+         */
+        int applyEntities(int status);
+
+        /**
+         * @brief Wait for `fileScanThread`, build the file cache here if the scan did not run.
+         */
+        void waitFileScan();
+
+        /**
+         * @brief Only join the threads started by `load` which are still running, nothing is built here.
+         */
+        void joinLoadThreads();
+
+        /**
+         * @brief Stat graphs of the file cache, and count changed ones.
+         * It waits for the file scan first.
+         */
+        void refreshTemplateUsages();
+
+        /**
+         * @brief Apply `staleTemplates` and `staleCodeTemplates` to `staleOutputs`.
+         */
+        void applyStaleTemplates();
+
+        /**
+         * @brief Copy graphs of `fileCache` to `graphPathsCache`, after the file cache is changed.
+         */
+        void updateGraphPaths();
+
+        /**
+         * @brief Read a folder of the file tree again, the deepest folder in the tree is read if it is not in the tree.
+         */
+        void refreshFilesAt(std::string_view folder);
+
+        void applyEntityFileChanges(std::vector<EntityFileChange> const& changes);
+
+        /**
+         * @param all  true if `graphPaths` are all graphs, entries of other graphs are dropped from the manifest.
+         */
+        void buildGraphs(std::vector<std::string> const& graphPaths, bool all) const;
+
         void initTypeMap();
 
         void initFolders();
@@ -472,6 +692,12 @@ namespace sight {
 
     Project* currentProject();
 
+    /**
+     * @brief Add template nodes of all entities of current project which are not added yet.
+     * Template nodes are owned by ui thread, so other threads wait the ui thread to add them.
+     */
+    void ensureEntityTemplates();
+
     /**
      * todo multiple thread test.
      * @param str
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+
+#include "sight_defines.h"
+
+// file name of the index, under the project folder. It starts with a `.`, so the file tree ignores it.
+#define SIGHT_PROJECT_INDEX_FILE ".sight-files.idx"
+
+namespace sight {
+
+    /**
+     * @brief Project file index, version 1.
+     * Layout: `SightProjectIndexHeader`, then `count` items. An item is `SightProjectIndexItem`, then `pathLength` bytes of
+     * the path relative to the project folder.
+     */
+    inline constexpr char sightProjectIndexMagic[8] = { 'S', 'I', 'G', 'H', 'T', 'F', 'I', '\0' };
+    inline constexpr uint32_t sightProjectIndexVersion = 1;
+
+    enum class ProjectIndexKind : uint8_t {
+        Regular,
+        // a yaml file which `who-am-i` is `sight-graph`
+        YamlGraph,
+        // a binary graph, see sight_graph_binary.h
+        BinaryGraph,
+    };
+
+    struct SightProjectIndexHeader {
+        char magic[8];
+        uint32_t version = sightProjectIndexVersion;
+        uint32_t count = 0;
+    };
+
+    struct SightProjectIndexItem {
+        uint64_t size = 0;
+        int64_t modifyTime = 0;
+        uint32_t pathLength = 0;
+        ProjectIndexKind kind = ProjectIndexKind::Regular;
+        uint8_t reserved[3] = { 0 };
+    };
+
+    static_assert(sizeof(SightProjectIndexItem) % 8 == 0);
+
+    /**
+     * @brief A regular file found by the project file scan.
+     */
+    struct ProjectIndexFile {
+        // full path
+        std::string path;
+        uint64_t size = 0;
+        int64_t modifyTime = 0;
+        ProjectIndexKind kind = ProjectIndexKind::Regular;
+    };
+
+    /**
+     * @brief What kind a file is, by size, modify time and the first bytes of graph files.
+     * It is saved under the project folder, so a file is only read again if its stat is changed.
+     */
+    class ProjectFileIndex {
+    public:
+        /**
+         * @param baseDir  the project folder, ends with `/`.
+         * @return int CODE_OK, CODE_FILE_NOT_EXISTS, CODE_FILE_FORMAT_ERROR. Items are cleared if it is not CODE_OK.
+         */
+        int load(std::string_view baseDir);
+
+        /**
+         * @brief Save if anything is changed since `load` or the last `save`.
+         *
+         * @return int CODE_OK, CODE_FILE_ERROR
+         */
+        int save();
+
+        /**
+         * @brief Stat `files`, and set their kind. Files which are new or changed are sniffed, on several threads.
+         * Items of files which are not in `files` are dropped.
+         *
+         * @param folder  if not empty, `files` are only files of this folder (full path, ends with `/`), and items of
+         *                other folders are kept.
+         */
+        void refresh(std::vector<ProjectIndexFile>& files, std::string_view folder = {});
+
+        // files which kind is from the index, and files which are read, by the last `refresh`.
+        uint hits = 0;
+        uint sniffed = 0;
+
+    private:
+        struct Item {
+            uint64_t size = 0;
+            int64_t modifyTime = 0;
+            ProjectIndexKind kind = ProjectIndexKind::Regular;
+        };
+
+        std::string baseDir;
+        // key: path relative to `baseDir`
+        absl::flat_hash_map<std::string, Item> items;
+        bool dirty = false;
+
+        std::string_view relativePath(std::string_view path) const;
+    };
+
+    /**
+     * @brief Find the kind of a file by its extension and first bytes, a yaml file is only parsed if
+     * its `who-am-i` is not at the top of the file.
+     */
+    ProjectIndexKind sniffProjectFile(std::string_view path);
+
+}
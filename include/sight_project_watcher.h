@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sight {
+
+    /**
+     * @brief Watch folders of a project on a thread, changes are reported after they stop for a while.
+     * Only linux (inotify) is supported now, `start` returns CODE_NOT_IMPLEMENTED on other platforms.
+     */
+    class ProjectWatcher {
+    public:
+        /**
+         * @brief Called by the watcher thread.
+         * @param paths  changed files and directories, sorted and unique. A watched folder is reported if events are lost.
+         */
+        using Callback = std::function<void(std::vector<std::string>&& paths)>;
+
+        ProjectWatcher() = default;
+        ~ProjectWatcher();
+
+        ProjectWatcher(ProjectWatcher const&) = delete;
+        ProjectWatcher& operator=(ProjectWatcher const&) = delete;
+
+        /**
+         * @param folders  watched with their sub folders, they end with `/`. Missing folders are skipped.
+         * @return int CODE_OK, CODE_FAIL if it is already started, CODE_FILE_ERROR, CODE_NOT_IMPLEMENTED
+         */
+        int start(std::vector<std::string> folders, Callback callback);
+
+        void stop();
+
+        bool isRunning() const;
+
+    private:
+        std::thread thread;
+        std::atomic<bool> running = false;
+        int inotifyFd = -1;
+        // write end wakes up the thread to stop.
+        int wakeFds[2] = { -1, -1 };
+    };
+
+}
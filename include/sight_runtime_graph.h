@@ -0,0 +1,382 @@
+/**
+ * @brief Runtime graph file (`.srg`), the binary version of the `SaveAsJson` output.
+ * This header is standalone (C++17, no other sight header), copy it to the runtime which loads graphs.
+ *
+ * Layout: `Header`, then sections, every one starts at an 8 bytes aligned offset. All numbers are little endian.
+ * - strings: utf-8, every string ends with '\0', `StringRef` points into it.
+ * - nodes: sorted by id, ports of a node are `members[firstMember, firstMember + memberCount)`.
+ * - members: ports which have a name, same as `members` of the json output.
+ * - data: `data` of the json output, if `Header::flags` has `HeaderFlags::ExportData`.
+ * - connections: sorted by id.
+ * - ids: connection ids of process ports, and right connections of nodes.
+ *
+ * Usage:
+ *     sight::runtime::GraphFile file;
+ *     if (file.open("main.srg")) {
+ *         auto node = file.findNode(3001);
+ *         for (auto const& member : file.members(*node)) { ... file.str(member.name) ... }
+ *     }
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(_WIN32)
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+// extension of a runtime graph file.
+#define SIGHT_RUNTIME_GRAPH_EXT ".srg"
+
+namespace sight::runtime {
+
+    inline constexpr char graphMagic[8] = { 'S', 'I', 'G', 'H', 'T', 'R', 'G', '\0' };
+    inline constexpr uint32_t graphVersion = 1;
+    inline constexpr uint32_t graphByteOrder = 0x01020304;
+
+    struct StringRef {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    struct Section {
+        uint64_t offset = 0;
+        // count of records
+        uint64_t count = 0;
+    };
+
+    namespace HeaderFlags {
+        inline constexpr uint32_t ExportData = 1 << 0;
+        inline constexpr uint32_t IncludeRightConnections = 1 << 1;
+        inline constexpr uint32_t IncludeNodeIdOnConnectionData = 1 << 2;
+    }
+
+    struct Header {
+        char magic[8];
+        uint32_t version = graphVersion;
+        uint32_t byteOrder = graphByteOrder;
+        // `SightNodeGraphOutputJsonConfig::nodeRootName` and `connectionRootName`
+        StringRef nodeRootName;
+        StringRef connectionRootName;
+        // HeaderFlags
+        uint32_t flags = 0;
+        // CaseTypes of member names and data keys.
+        uint32_t caseType = 0;
+
+        Section strings;
+        Section nodes;
+        Section members;
+        Section data;
+        Section connections;
+        Section ids;
+    };
+
+    enum class ValueKind : uint8_t {
+        // no value, e.g. the port has no template port.
+        None,
+        String,
+        Int,
+        Float,
+        Double,
+        Bool,
+        // connection ids of a process port, `ids[first, first + count)`
+        Ids,
+    };
+
+    struct Value {
+        union {
+            int64_t i;
+            double d;
+            float f;
+            uint8_t b;
+            StringRef string;
+            struct {
+                uint32_t first;
+                uint32_t count;
+            } ids;
+        } u = { 0 };
+        ValueKind kind = ValueKind::None;
+        uint8_t reserved[7] = { 0 };
+    };
+
+    struct Member {
+        StringRef name;
+        uint32_t id = 0;
+        uint32_t reserved = 0;
+        Value value;
+    };
+
+    struct DataItem {
+        StringRef key;
+        Value value;
+    };
+
+    struct Node {
+        uint32_t id = 0;
+        uint32_t reserved = 0;
+        StringRef name;
+        // empty if the node has no template.
+        StringRef templateName;
+        uint32_t firstMember = 0;
+        uint32_t memberCount = 0;
+        uint32_t firstData = 0;
+        uint32_t dataCount = 0;
+        // connections which left port is on this node, `ids[first, first + count)`. Empty unless
+        // `HeaderFlags::IncludeRightConnections` is set.
+        uint32_t firstRightConnection = 0;
+        uint32_t rightConnectionCount = 0;
+    };
+
+    struct Connection {
+        uint32_t id = 0;
+        uint32_t left = 0;
+        uint32_t right = 0;
+        // 0 unless `HeaderFlags::IncludeNodeIdOnConnectionData` is set.
+        uint32_t leftNode = 0;
+        uint32_t rightNode = 0;
+        uint32_t reserved = 0;
+        // a json object of data from components (`appendDataToOutput`), empty if there is none.
+        StringRef componentData;
+    };
+
+    static_assert(sizeof(Header) % 8 == 0);
+    static_assert(sizeof(Value) == 16);
+    static_assert(sizeof(Member) % 8 == 0);
+    static_assert(sizeof(DataItem) % 8 == 0);
+    static_assert(sizeof(Node) % 8 == 0);
+    static_assert(sizeof(Connection) % 8 == 0);
+
+    template<class T>
+    struct Range {
+        const T* first = nullptr;
+        size_t count = 0;
+
+        const T* begin() const {
+            return first;
+        }
+        const T* end() const {
+            return first + count;
+        }
+        size_t size() const {
+            return count;
+        }
+        bool empty() const {
+            return count == 0;
+        }
+        T const& operator[](size_t i) const {
+            return first[i];
+        }
+    };
+
+    /**
+     * @brief Read a runtime graph in place, records are not copied or parsed. NOT thread safe for open/close.
+     */
+    class GraphFile {
+    public:
+        GraphFile() = default;
+        ~GraphFile() {
+            close();
+        }
+
+        GraphFile(GraphFile const&) = delete;
+        GraphFile& operator=(GraphFile const&) = delete;
+
+        /**
+         * @brief Map the file to memory, and check it.
+         */
+        bool open(const char* path) {
+            close();
+#if defined(_WIN32)
+            HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE) {
+                return false;
+            }
+            LARGE_INTEGER fileSize;
+            HANDLE mapping = nullptr;
+            if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+                mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            }
+            CloseHandle(file);
+            if (!mapping) {
+                return false;
+            }
+            auto p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+            if (!p) {
+                return false;
+            }
+            mapped = p;
+            mappedSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+            int fd = ::open(path, O_RDONLY);
+            if (fd < 0) {
+                return false;
+            }
+            struct stat st;
+            void* p = MAP_FAILED;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            }
+            ::close(fd);
+            if (p == MAP_FAILED) {
+                return false;
+            }
+            mapped = p;
+            mappedSize = static_cast<size_t>(st.st_size);
+#endif
+            if (!openMemory(static_cast<const char*>(mapped), mappedSize)) {
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Use a file which is already in memory, `data` must be 8 bytes aligned and live longer than this.
+         */
+        bool openMemory(const char* data, size_t size) {
+            base = nullptr;
+            length = 0;
+            if (!data || size < sizeof(Header) || reinterpret_cast<uintptr_t>(data) % 8 != 0) {
+                return false;
+            }
+
+            auto h = reinterpret_cast<Header const*>(data);
+            if (std::memcmp(h->magic, graphMagic, sizeof(graphMagic)) != 0 || h->version != graphVersion || h->byteOrder != graphByteOrder) {
+                return false;
+            }
+            if (!checkSection(h->strings, 1, size) || !checkSection(h->nodes, sizeof(Node), size) || !checkSection(h->members, sizeof(Member), size) ||
+                !checkSection(h->data, sizeof(DataItem), size) || !checkSection(h->connections, sizeof(Connection), size) ||
+                !checkSection(h->ids, sizeof(uint32_t), size)) {
+                return false;
+            }
+
+            base = data;
+            length = size;
+            return true;
+        }
+
+        void close() {
+            if (mapped) {
+#if defined(_WIN32)
+                UnmapViewOfFile(mapped);
+#else
+                munmap(mapped, mappedSize);
+#endif
+            }
+            mapped = nullptr;
+            mappedSize = 0;
+            base = nullptr;
+            length = 0;
+        }
+
+        bool isOpen() const {
+            return base != nullptr;
+        }
+
+        Header const& header() const {
+            return *reinterpret_cast<Header const*>(base);
+        }
+
+        Range<Node> nodes() const {
+            return section<Node>(header().nodes);
+        }
+
+        Range<Connection> connections() const {
+            return section<Connection>(header().connections);
+        }
+
+        Range<Member> members(Node const& node) const {
+            return subRange(section<Member>(header().members), node.firstMember, node.memberCount);
+        }
+
+        Range<DataItem> data(Node const& node) const {
+            return subRange(section<DataItem>(header().data), node.firstData, node.dataCount);
+        }
+
+        Range<uint32_t> rightConnections(Node const& node) const {
+            return subRange(section<uint32_t>(header().ids), node.firstRightConnection, node.rightConnectionCount);
+        }
+
+        /**
+         * @brief Connection ids of a `ValueKind::Ids` value.
+         */
+        Range<uint32_t> ids(Value const& value) const {
+            if (value.kind != ValueKind::Ids) {
+                return {};
+            }
+            return subRange(section<uint32_t>(header().ids), value.u.ids.first, value.u.ids.count);
+        }
+
+        std::string_view str(StringRef ref) const {
+            auto const& s = header().strings;
+            if (static_cast<uint64_t>(ref.offset) + ref.length > s.count) {
+                return {};
+            }
+            return { base + s.offset + ref.offset, ref.length };
+        }
+
+        /**
+         * @brief Binary search by id.
+         * @return nullptr if not found.
+         */
+        Node const* findNode(uint32_t id) const {
+            return findById(nodes(), id);
+        }
+
+        Connection const* findConnection(uint32_t id) const {
+            return findById(connections(), id);
+        }
+
+    private:
+        const char* base = nullptr;
+        size_t length = 0;
+        void* mapped = nullptr;
+        size_t mappedSize = 0;
+
+        static bool checkSection(Section const& s, size_t recordSize, size_t size) {
+            return s.offset % 8 == 0 && s.offset <= size && s.count <= (size - s.offset) / recordSize;
+        }
+
+        template<class T>
+        Range<T> section(Section const& s) const {
+            return { reinterpret_cast<const T*>(base + s.offset), static_cast<size_t>(s.count) };
+        }
+
+        template<class T>
+        static Range<T> subRange(Range<T> all, uint32_t first, uint32_t count) {
+            if (static_cast<uint64_t>(first) + count > all.count) {
+                return {};
+            }
+            return { all.first + first, count };
+        }
+
+        template<class T>
+        static T const* findById(Range<T> all, uint32_t id) {
+            size_t low = 0;
+            size_t high = all.count;
+            while (low < high) {
+                auto mid = low + (high - low) / 2;
+                if (all.first[mid].id < id) {
+                    low = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            return low < all.count && all.first[low].id == id ? all.first + low : nullptr;
+        }
+    };
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sys/types.h"
+
+namespace sight {
+
+    enum class SearchItemKind : u_char {
+        Template,
+        Entity,
+        EntityField,
+        Graph,
+        // a node of the opened graph
+        Node,
+        // a string value of a port of the opened graph
+        PortValue,
+    };
+
+    const char* getSearchItemKindName(SearchItemKind kind);
+
+    struct SearchItem {
+        SearchItemKind kind = SearchItemKind::Template;
+        // the query is matched against it.
+        std::string text;
+        // shown after the text, not matched.
+        std::string detail;
+        // template address, entity name, or graph path.
+        std::string target;
+        // node id of `Node` and `PortValue`
+        uint id = 0;
+    };
+
+    struct SearchResult {
+        SearchItem item;
+        int score = 0;
+    };
+
+    /**
+     * @brief Replace all items of `source`, e.g. a template or an entity. Items are kept per source, so a change only
+     * updates the items of what is changed.
+     * Thread safe, a query which is running is not blocked for long.
+     */
+    void setSearchItems(std::string_view source, std::vector<SearchItem>&& items);
+
+    void removeSearchItems(std::string_view source);
+
+    /**
+     * @brief Remove items of every source which starts with `prefix`.
+     */
+    void removeSearchItemsByPrefix(std::string_view prefix);
+
+    size_t getSearchItemCount();
+
+    /**
+     * @brief Run a query on the search thread, the thread is started at the first call.
+     * A query which is not done is dropped when a new one comes.
+     */
+    void postSearchQuery(std::string_view query);
+
+    /**
+     * @brief Results of the last done query, the best first.
+     *
+     * @return false if there is no new result since the last call, `out` is not changed then.
+     */
+    bool takeSearchResults(std::vector<SearchResult>& out, std::string* queryOut = nullptr);
+
+    /**
+     * @brief Fuzzy match, chars of `query` must be in `text` in order, case insensitive.
+     * Consecutive chars, starts of words and a match at the start score higher.
+     *
+     * @return -1 if not matched.
+     */
+    int fuzzyMatchScore(std::string_view query, std::string_view text);
+
+    void stopSearchThread();
+
+}
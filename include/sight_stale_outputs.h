@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/btree_map.h"
+
+namespace sight {
+
+    class TemplateUsageIndex;
+
+    struct StaleOutput {
+        // key of the graph in `TemplateUsageIndex`
+        std::string graphPath;
+        // empty if the graph has no output file.
+        std::string outputPath;
+        // what is changed first, e.g. `template: a.b.c`
+        std::string reason;
+    };
+
+    /**
+     * @brief Outputs of graphs which are older than what they are generated from.
+     * Edges are: entity -> template node -> graphs, code template -> graphs, graph -> output file, all of them are
+     * taken from `TemplateUsageIndex`. Used by the ui thread.
+     */
+    class StaleOutputs {
+    public:
+        /**
+         * @brief A template node is replaced or deleted, e.g. by an entity or a plugin reload.
+         */
+        void markTemplate(TemplateUsageIndex const& index, std::string_view templateAddress);
+
+        void markCodeTemplate(TemplateUsageIndex const& index, std::string_view codeTemplate);
+
+        void markGraph(TemplateUsageIndex const& index, std::string_view graphPath);
+
+        /**
+         * @brief The graph is generated, or it is already up to date.
+         */
+        void markBuilt(std::string_view graphPath);
+
+        /**
+         * @return graph paths of stale outputs.
+         */
+        std::vector<std::string> graphPaths() const;
+
+        absl::btree_map<std::string, StaleOutput> const& getOutputs() const;
+
+        bool empty() const;
+
+        void clear();
+
+    private:
+        // key: graph path
+        absl::btree_map<std::string, StaleOutput> outputs;
+
+        void mark(TemplateUsageIndex const& index, std::string const& key, std::string_view reason);
+    };
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+
+#include "sight_defines.h"
+
+namespace sight {
+
+    class SightGraphBinaryWriter;
+
+    struct TemplateUsage {
+        std::string graphPath;
+        // nodes and components of the template in the graph
+        uint count = 0;
+    };
+
+    /**
+     * @brief Which graphs use a template or a code template, and the output file of a graph. Used by the ui thread.
+     * A graph is counted when it is saved, or read again (no template is needed) if its files are changed.
+     */
+    class TemplateUsageIndex {
+    public:
+        struct GraphInfo {
+            // the yaml (or binary) file and the journal, used to find changed files.
+            uint64_t size = 0;
+            int64_t modifyTime = 0;
+            uint64_t journalSize = 0;
+            // false if counted from a snapshot, the stat is taken after the snapshot is written.
+            bool stamped = false;
+            // `SightGraphBinaryWriter::contentHash`, 0 if it is not known.
+            uint64_t contentHash = 0;
+            // key: template address, value: count
+            absl::flat_hash_map<std::string, uint> templates;
+            std::string codeTemplate;
+            std::string outputPath;
+        };
+
+        /**
+         * @brief Count templates of a snapshot which is saved to `path`.
+         *
+         * @return false if the graph is already counted with the same content.
+         */
+        bool updateGraph(std::string_view path, SightGraphBinaryWriter const& data);
+
+        /**
+         * @brief Stat graph files, and read changed ones on several threads. Graphs which are not in `graphPaths` are dropped.
+         */
+        void refresh(std::vector<std::string> const& graphPaths);
+
+        /**
+         * @return graphs which use the template, sorted by path.
+         */
+        std::vector<TemplateUsage> find(std::string_view templateAddress) const;
+
+        /**
+         * @return graphs which use the code template, sorted by path.
+         */
+        std::vector<std::string> findByCodeTemplate(std::string_view codeTemplate) const;
+
+        /**
+         * @return the output file of the graph, empty if it has none or the graph is not counted.
+         */
+        std::string outputOf(std::string_view graphPath) const;
+
+        /**
+         * @brief The key of a graph path, graph paths of this index are keys.
+         */
+        static std::string keyOf(std::string_view graphPath);
+
+        void clear();
+
+    private:
+        // key: graph path
+        absl::flat_hash_map<std::string, GraphInfo> graphs;
+        // key: template address, value: graph path -> count
+        absl::flat_hash_map<std::string, absl::flat_hash_map<std::string, uint>> usages;
+        // key: code template name, value: graph paths
+        absl::flat_hash_map<std::string, absl::flat_hash_set<std::string>> codeTemplateUsages;
+
+        void setGraph(std::string const& key, GraphInfo&& info);
+        void removeGraph(std::string const& key);
+    };
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "sys/types.h"
+
+namespace sight {
+
+    struct TypeInfo;
+
+    /**
+     * @brief Types by id. Ids are small integers, built-in ids are `[0, IntTypeNext)` and other ids count from
+     * `IntTypeNext`, so an id is an index of a vector. Whether a type can connect to another one only depends on the ids,
+     * see `checkRule`.
+     * Call by ui thread.
+     */
+    class TypeRegistry {
+    public:
+        TypeRegistry();
+        ~TypeRegistry();
+
+        TypeRegistry(TypeRegistry const&) = delete;
+        TypeRegistry& operator=(TypeRegistry const&) = delete;
+
+        /**
+         * @return nullptr if not found.
+         */
+        TypeInfo const* find(uint id) const;
+        TypeInfo* find(uint id);
+
+        /**
+         * @brief Add or replace the type of `info.intValue`. The returned pointer is valid until the type is removed.
+         *
+         * @return nullptr if the id can not be a type id.
+         */
+        TypeInfo* add(TypeInfo const& info);
+
+        bool remove(uint id);
+
+        size_t size() const;
+
+        /**
+         * @brief Can a port of type `from` connect to a port of type `to` ? Same type, or any type except process to object.
+         */
+        static bool checkRule(uint from, uint to);
+
+        /**
+         * @brief Call `fn(TypeInfo const&)` for every type, ordered by id.
+         */
+        template<class Fn>
+        void forEach(Fn&& fn) const {
+            for (const auto& item : types) {
+                if (item) {
+                    fn(*item);
+                }
+            }
+        }
+
+    private:
+        // index: slot of the id
+        std::vector<std::unique_ptr<TypeInfo>> types;
+        size_t count = 0;
+
+        static constexpr size_t invalidSlot = SIZE_MAX;
+        static size_t slotOf(uint id);
+    };
+
+}
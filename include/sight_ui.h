@@ -40,8 +40,8 @@ namespace sight {
         JsEndInit,
 
         // node editor part
-        AddNode = 200,
-        AddTemplateNode = 201,
+        // data is a `JsNodeBatch*`, the command owns it.
+        AddNodeBatch = 200,
 
         // script part
 
@@ -49,6 +49,14 @@ namespace sight {
         RegScriptGlobalFunctions = 300,
         RunScriptFile,
         PluginReloadOver, 
+        // a code template is replaced, the name is the arg.
+        CodeTemplateChanged,
+        // graphs are generated (or up to date), paths are separated by '\n'.
+        GraphsBuilt,
+        // files of the project are changed outside, paths are separated by '\n'.
+        ProjectFilesChanged,
+        // add template nodes of entities which are not added yet, `promise` is set after.
+        RegisterEntityTemplates,
 
     };
 
@@ -81,6 +89,8 @@ namespace sight {
         // struct EntityField* first = nullptr;
         std::vector<EntityField> fields;
         std::string showInfoEntityName;
+        // graphs which use `showInfoEntityName`, filled by the `Find usages` button.
+        std::vector<TemplateUsage> showInfoUsages;
         int selectedFieldIndex = -1;
 
         void addField();
@@ -313,6 +323,11 @@ namespace sight {
      */
     UIStatus* currentUIStatus();
 
+    /**
+     * @return true if it is called by the thread which runs the ui loop.
+     */
+    bool isUIThread();
+
     /**
      * @brief 
      * 
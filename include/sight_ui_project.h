@@ -36,5 +36,10 @@ namespace sight {
      * 
      */
     void showCodeSetSettingsWindow();
+
+    /**
+     * @brief Outputs which are older than their graphs, templates or code templates.
+     */
+    void showStaleOutputsWindow();
     
 }
\ No newline at end of file
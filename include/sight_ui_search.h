@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+namespace sight {
+
+    struct SightEntity;
+    struct EntityIndexField;
+    struct ProjectFile;
+    class SightNodeGraph;
+
+    /**
+     * @brief Items of the search palette, see sight_search_index.h. Call by ui thread.
+     */
+    void indexTemplateForSearch(std::string_view templateAddress);
+    void removeTemplateFromSearch(std::string_view templateAddress);
+
+    /**
+     * @param indexFields  fields from the entity index, they are indexed if fields of the entity are not read yet.
+     */
+    void indexEntityForSearch(SightEntity const& entity, std::vector<EntityIndexField> const* indexFields = nullptr);
+    void removeEntityFromSearch(std::string_view name);
+    void removeAllEntitiesFromSearch();
+
+    void indexGraphFilesForSearch(ProjectFile const& root);
+
+    /**
+     * @brief Names and string values of all nodes of the graph, nodes of the last graph are removed.
+     */
+    void indexGraphNodesForSearch(SightNodeGraph* graph);
+
+    void initSearchPalette();
+    void disposeSearchPalette();
+
+    /**
+     * @brief Open the palette (Ctrl+P), graph files and nodes of the current graph are indexed again.
+     */
+    void openSearchPalette();
+    void showSearchPalette();
+
+}
@@ -9,6 +9,8 @@
 #include "sight_node.h"
 #include "sight_ui.h"
 
+#include "absl/container/flat_hash_set.h"
+
 
 #include "yaml-cpp/yaml.h"
 
@@ -71,7 +73,14 @@ namespace sight {
         void undo();
         void redo();
 
-        void freeNodeData();
+        /**
+         * @brief Insert ids of nodes/connections this record references into `ids`.
+         * Nodes at both ends of a referenced connection are referenced too.
+         * 
+         * @param ids 
+         * @param graph  used to find endpoint nodes of connections.
+         */
+        void collectRefs(absl::flat_hash_set<uint>& ids, SightNodeGraph* graph) const;
 
         void init();
         
@@ -97,6 +106,16 @@ namespace sight {
      */
     UndoCommand* lastUndoCommand();
 
+    /**
+     * @brief Free deleted nodes/connections of `graph` which no undo/redo record references.
+     * It returns at once if nothing changed since last finished pass.
+     * 
+     * @param graph 
+     * @param budget max objects to free, 0 means no limit.
+     * @return int how many objects are freed.
+     */
+    int reclaimDeletedObjects(SightNodeGraph* graph, int budget = 0);
+
 
     bool isRedoEnable();
     void redo();
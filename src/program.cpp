@@ -57,15 +57,18 @@ int main(int argc, char* argv[]){
         }
     }
 
+    // the js engine is initialized while the project is opening, the js thread waits for `startJsThreadWork`
+    // before it reads the project.
+    logDebug("start js thread!");
+    std::thread jsThread(sight::jsThreadRun, argv[0]);
+
     if (!settings->lastOpenProject.empty()) {
         openProject(settings->lastOpenProject.c_str(), true);
     } else {
         // 
         logDebug("no path, do not load project.");
     }
-
-    logDebug("start js thread!");
-    std::thread jsThread(sight::jsThreadRun, argv[0]);
+    sight::startJsThreadWork();
 
     // logDebug("start network thread");
     // initNetworkServer(getSightSettings()->networkListenPort);
@@ -14,6 +14,7 @@
 #include "sight_js.h"
 #include "sight_log.h"
 #include "sight_project.h"
+#include "sight_graph_saver.h"
 
 
 #include "yaml-cpp/yaml.h"
@@ -70,6 +71,26 @@ namespace sight {
             sightSettings.autoSave = n.as<bool>();
         }
 
+        n = root["graphBinaryCache"];
+        if (n.IsDefined()) {
+            sightSettings.graphBinaryCache = n.as<bool>();
+        }
+
+        n = root["graphJournal"];
+        if (n.IsDefined()) {
+            sightSettings.graphJournal = n.as<bool>();
+        }
+
+        n = root["watchProject"];
+        if (n.IsDefined()) {
+            sightSettings.watchProject = n.as<bool>();
+        }
+
+        n = root["buildOnProjectChange"];
+        if (n.IsDefined()) {
+            sightSettings.buildOnProjectChange = n.as<bool>();
+        }
+
         n = root["windowStatus"];
         if (n.IsDefined()) {
             auto& windowStatus = sightSettings.windowStatus;
@@ -84,6 +105,7 @@ namespace sight {
             windowStatus.terminalWindow = n["terminal"].as<bool>(false);
             windowStatus.codeSetSettingsWindow = n["codeSetSettingsWindow"].as<bool>(false);
             windowStatus.graphOutputJsonConfigWindow = n["graphOutputJsonConfigWindow"].as<bool>(false);
+            windowStatus.staleOutputsWindow = n["staleOutputsWindow"].as<bool>(false);
         }
 
         n = root["lastUseEntityOperation"];
@@ -125,6 +147,10 @@ namespace sight {
         out << YAML::Key << "networkListenPort" << YAML::Value << sightSettings.networkListenPort;
         out << YAML::Key << "lastOpenProject" << YAML::Value << sightSettings.lastOpenProject;
         out << YAML::Key << "autoSave" << YAML::Value << sightSettings.autoSave;
+        out << YAML::Key << "graphBinaryCache" << YAML::Value << sightSettings.graphBinaryCache;
+        out << YAML::Key << "graphJournal" << YAML::Value << sightSettings.graphJournal;
+        out << YAML::Key << "watchProject" << YAML::Value << sightSettings.watchProject;
+        out << YAML::Key << "buildOnProjectChange" << YAML::Value << sightSettings.buildOnProjectChange;
 
         // windows status
         out << YAML::Key << "windowStatus" << YAML::Value << YAML::BeginMap;
@@ -140,6 +166,7 @@ namespace sight {
         out << YAML::Key << "terminal" << YAML::Value << windowStatus.terminalWindow;
         out << YAML::Key << "codeSetSettingsWindow" << YAML::Value << windowStatus.codeSetSettingsWindow;
         out << YAML::Key << "graphOutputJsonConfigWindow" << YAML::Value << windowStatus.graphOutputJsonConfigWindow;
+        out << YAML::Key << "staleOutputsWindow" << YAML::Value << windowStatus.staleOutputsWindow;
         out << YAML::EndMap;        // end of windowStatus
         
         out << YAML::Key << "lastUseEntityOperation" << YAML::Value << sightSettings.lastUseEntityOperation;
@@ -166,6 +193,8 @@ namespace sight {
         if (p) {
             p->save();
         }
+        // write graphs which are still waiting.
+        stopGraphSaveThread();
         // exit(v);
     }
 
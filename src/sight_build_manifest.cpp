@@ -0,0 +1,138 @@
+#include "sight_build_manifest.h"
+
+#include "sight.h"
+#include "sight_log.h"
+#include "sight_util.h"
+
+#include "yaml-cpp/yaml.h"
+
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+#include "absl/container/flat_hash_set.h"
+
+namespace sight {
+
+    namespace {
+
+        constexpr const char* manifestWhoAmI = "sight-build-manifest";
+        constexpr int manifestVersion = 1;
+
+    }
+
+    bool hashFileContent(std::string_view path, BuildHasher& hasher) {
+        std::ifstream in(std::string(path), std::ios::binary);
+        if (!in.is_open()) {
+            return false;
+        }
+
+        BuildHasher fileHasher;
+        char buf[16 * 1024];
+        while (in) {
+            in.read(buf, sizeof(buf));
+            fileHasher.add(buf, static_cast<size_t>(in.gcount()));
+        }
+        if (in.bad()) {
+            return false;
+        }
+        hasher.add(fileHasher.value);
+        return true;
+    }
+
+    int BuildManifest::load(std::string_view path) {
+        this->path = path;
+        entries.clear();
+
+        std::error_code ec;
+        if (!std::filesystem::exists(this->path, ec)) {
+            return CODE_FILE_NOT_EXISTS;
+        }
+
+        try {
+            auto root = YAML::LoadFile(this->path);
+            auto temp = root[whoAmI];
+            if (!temp.IsDefined() || temp.as<std::string>() != manifestWhoAmI || root["version"].as<int>(0) != manifestVersion) {
+                logDebug("build manifest is outdated or bad: $0", path);
+                return CODE_FILE_FORMAT_ERROR;
+            }
+
+            for (const auto& item : root["graphs"]) {
+                auto& node = item.second;
+                BuildManifestEntry entry;
+                entry.graphHash = node["graphHash"].as<uint64_t>();
+                entry.inputHash = node["inputHash"].as<uint64_t>();
+                entry.outputPath = node["outputPath"].as<std::string>("");
+                entry.outputHash = node["outputHash"].as<uint64_t>(0);
+                entries[item.first.as<std::string>()] = std::move(entry);
+            }
+        } catch (const YAML::Exception& e) {
+            logDebug("load build manifest error. $0, $1", path, e.what());
+            entries.clear();
+            return CODE_FILE_FORMAT_ERROR;
+        }
+        return CODE_OK;
+    }
+
+    int BuildManifest::save() const {
+        YAML::Emitter out;
+        out << YAML::BeginMap;
+        out << YAML::Key << whoAmI << YAML::Value << manifestWhoAmI;
+        out << YAML::Key << "version" << YAML::Value << manifestVersion;
+        out << YAML::Key << "graphs" << YAML::Value << YAML::BeginMap;
+        for (const auto& [graphPath, entry] : entries) {
+            out << YAML::Key << graphPath << YAML::BeginMap;
+            out << YAML::Key << "graphHash" << YAML::Value << entry.graphHash;
+            out << YAML::Key << "inputHash" << YAML::Value << entry.inputHash;
+            out << YAML::Key << "outputPath" << YAML::Value << entry.outputPath;
+            out << YAML::Key << "outputHash" << YAML::Value << entry.outputHash;
+            out << YAML::EndMap;
+        }
+        out << YAML::EndMap;
+        out << YAML::EndMap;
+
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+        std::string content(out.c_str());
+        content += '\n';
+        if (!writeFileAtomic(path, content)) {
+            logError("write build manifest failed: $0", path);
+            return CODE_FILE_ERROR;
+        }
+        return CODE_OK;
+    }
+
+    BuildManifestEntry const* BuildManifest::find(std::string_view graphPath) const {
+        auto iter = entries.find(graphPath);
+        return iter == entries.end() ? nullptr : &iter->second;
+    }
+
+    void BuildManifest::set(std::string_view graphPath, BuildManifestEntry entry) {
+        entries[graphPath] = std::move(entry);
+    }
+
+    void BuildManifest::remove(std::string_view graphPath) {
+        entries.erase(graphPath);
+    }
+
+    void BuildManifest::retain(std::vector<std::string> const& graphPaths) {
+        absl::flat_hash_set<std::string_view> alive(graphPaths.begin(), graphPaths.end());
+        for (auto iter = entries.begin(); iter != entries.end();) {
+            if (alive.contains(iter->first)) {
+                ++iter;
+            } else {
+                iter = entries.erase(iter);
+            }
+        }
+    }
+
+    bool BuildManifest::isOutputUpToDate(BuildManifestEntry const& entry) {
+        if (entry.outputPath.empty()) {
+            return true;
+        }
+
+        BuildHasher hasher;
+        return hashFileContent(entry.outputPath, hasher) && hasher.value == entry.outputHash;
+    }
+
+}
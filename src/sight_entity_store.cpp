@@ -0,0 +1,516 @@
+#include "sight_entity_store.h"
+
+#include "sight.h"
+#include "sight_log.h"
+#include "sight_project.h"
+#include "sight_util.h"
+
+#include "yaml-cpp/yaml.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <vector>
+
+namespace sight {
+
+    namespace {
+
+        constexpr const char* entityWhoAmI = "sight-entity";
+        constexpr const char* indexWhoAmI = "sight-entities-index";
+
+        YAML::Emitter& operator<<(YAML::Emitter& out, SightEntity const& entity) {
+            out << YAML::Key << entity.templateAddress << YAML::BeginMap;
+            out << YAML::Key << "name" << YAML::Value << entity.name;
+            out << YAML::Key << "typeId" << YAML::Value << entity.typeId;
+            out << YAML::Key << "parentEntity" << YAML::Value << entity.parentEntity;
+
+            out << YAML::Key << "fields" << YAML::BeginMap;
+            for (const auto& item : entity.fields) {
+                out << YAML::Key << item.name << YAML::BeginMap;
+                out << YAML::Key << "type" << YAML::Value << item.type;
+                out << YAML::Key << "defaultValue" << YAML::Value << item.defaultValue;
+
+                out << YAML::Key << "options" << YAML::BeginMap;
+                out << YAML::Key << "portType" << YAML::Value << item.options.portTypeValue();
+                out << YAML::Key << "show" << YAML::Value << item.options.portOptions.show;
+                out << YAML::Key << "showValue" << YAML::Value << item.options.portOptions.showValue;
+                out << YAML::Key << "readonly" << YAML::Value << item.options.portOptions.readonly;
+                out << YAML::EndMap;
+
+                out << YAML::EndMap;
+            }
+            out << YAML::EndMap;
+
+            out << YAML::EndMap;
+            return out;
+        }
+
+        SightEntity loadEntity(std::string const& templateAddress, YAML::Node const& node) {
+            SightEntity entity;
+            entity.templateAddress = templateAddress;
+            entity.name = node["name"].as<std::string>();
+            auto tmp = node["typeId"];
+            if (tmp.IsDefined()) {
+                entity.typeId = tmp.as<uint>();
+            }
+
+            if (node["parentEntity"]) {
+                entity.parentEntity = node["parentEntity"].as<std::string>();
+            }
+
+            auto fieldsNode = node["fields"];
+            for (const auto& item : fieldsNode) {
+                std::string name = item.first.as<std::string>();
+                auto& dataNode = item.second;
+                entity.fields.emplace_back(name, dataNode["type"].as<std::string>(), dataNode["defaultValue"].as<std::string>());
+
+                auto& f = entity.fields.back();
+                auto optionsNode = dataNode["options"];
+                if (optionsNode.IsDefined()) {
+                    f.options.portType = static_cast<NodePortType>(optionsNode["portType"].as<int>());
+                    f.options.portOptions.show = optionsNode["show"].as<bool>();
+                    f.options.portOptions.showValue = optionsNode["showValue"].as<bool>();
+                    f.options.portOptions.readonly = optionsNode["readonly"].as<bool>();
+                }
+            }
+
+            return entity;
+        }
+
+        /**
+         * @brief Content of the file of one entity.
+         */
+        std::string entityFileContent(SightEntity const& entity) {
+            YAML::Emitter out;
+            out << YAML::BeginMap;
+            out << YAML::Key << whoAmI << YAML::Value << entityWhoAmI;
+            out << entity;
+            out << YAML::EndMap;
+
+            std::string content(out.c_str());
+            content += '\n';
+            return content;
+        }
+
+        /**
+         * @brief Read a yaml file of entities, `entities.yaml` or a file of one entity.
+         */
+        int readEntities(std::string const& path, const char* expectWhoAmI, std::vector<SightEntity>& entities) {
+            try {
+                auto root = YAML::LoadFile(path);
+                auto temp = root[whoAmI];
+                if (temp.IsDefined() && temp.as<std::string>() != expectWhoAmI) {
+                    logDebug("entity file who-am-i error: $0", path);
+                    return CODE_FILE_ERROR;
+                }
+
+                for (const auto& item : root) {
+                    auto key = item.first.as<std::string>();
+                    if (key == whoAmI) {
+                        continue;
+                    }
+                    entities.push_back(loadEntity(key, item.second));
+                }
+            } catch (const YAML::BadFile& e) {
+                return CODE_FILE_ERROR;
+            } catch (const YAML::Exception& e) {
+                logDebug("load entity file error. $0, $1", path, e.what());
+                return CODE_FILE_FORMAT_ERROR;
+            }
+            return CODE_OK;
+        }
+
+    }
+
+    int EntityStore::load(std::string_view baseDir, absl::btree_map<std::string, SightEntity>& entities) {
+        folder = std::string(baseDir) + SIGHT_ENTITIES_FOLDER;
+        legacyFile.clear();
+        items.clear();
+        dirty.clear();
+        removedFiles.clear();
+        indexChanged = false;
+
+        std::error_code ec;
+        auto indexPath = folder + SIGHT_ENTITIES_INDEX_FILE;
+        // entities of an index which is written before fields are in it.
+        std::vector<std::string> withoutFields;
+        if (!std::filesystem::exists(indexPath, ec)) {
+            auto legacyPath = std::string(baseDir) + "entities.yaml";
+            if (std::filesystem::exists(legacyPath, ec)) {
+                legacyFile = legacyPath;
+                return loadLegacyFile(entities);
+            }
+            if (!std::filesystem::is_directory(folder, ec)) {
+                return CODE_FILE_ERROR;
+            }
+            // the index is lost, all files are read below.
+            indexChanged = true;
+        } else {
+            try {
+                auto root = YAML::LoadFile(indexPath);
+                auto temp = root[whoAmI];
+                if (temp.IsDefined() && temp.as<std::string>() != indexWhoAmI) {
+                    logDebug("entity index who-am-i error: $0", indexPath);
+                    return CODE_FILE_ERROR;
+                }
+
+                for (const auto& item : root["entities"]) {
+                    SightEntity entity;
+                    entity.name = item.first.as<std::string>();
+                    auto& node = item.second;
+                    entity.templateAddress = node["templateAddress"].as<std::string>();
+                    entity.parentEntity = node["parentEntity"].as<std::string>("");
+                    entity.typeId = node["typeId"].as<uint>(0);
+
+                    Item entityItem{ node["file"].as<std::string>(), false };
+                    if (auto fieldsNode = node["fields"]; fieldsNode.IsDefined()) {
+                        for (const auto& field : fieldsNode) {
+                            entityItem.fields.push_back({ field.first.as<std::string>(), field.second.as<std::string>() });
+                        }
+                    } else {
+                        withoutFields.push_back(entity.name);
+                    }
+                    items[entity.name] = std::move(entityItem);
+                    entities[entity.name] = std::move(entity);
+                }
+            } catch (const YAML::Exception& e) {
+                logDebug("load entity index error. $0, $1", indexPath, e.what());
+                return CODE_FILE_FORMAT_ERROR;
+            }
+        }
+
+        // files may be added or deleted without the index, e.g. by vcs.
+        absl::flat_hash_set<std::string> files;
+        std::filesystem::directory_iterator iterator(folder, ec);
+        if (ec) {
+            return CODE_OK;
+        }
+        for (const auto& entry : iterator) {
+            auto file = entry.path().filename().generic_string();
+            if (entry.is_regular_file(ec) && file != SIGHT_ENTITIES_INDEX_FILE && endsWith(file, ".yaml")) {
+                files.insert(std::move(file));
+            }
+        }
+
+        absl::flat_hash_set<std::string> knownFiles;
+        for (auto iter = items.begin(); iter != items.end();) {
+            if (files.contains(iter->second.file)) {
+                knownFiles.insert(iter->second.file);
+                ++iter;
+                continue;
+            }
+
+            logDebug("entity file is missing: $0", iter->second.file);
+            entities.erase(iter->first);
+            items.erase(iter++);
+            indexChanged = true;
+        }
+        for (const auto& file : files) {
+            if (knownFiles.contains(file)) {
+                continue;
+            }
+            int status = loadEntityFile(file, entities);
+            if (status != CODE_OK) {
+                logWarning("read entity file failed: $0, $1", file, status);
+            }
+            indexChanged = true;
+        }
+
+        // read them once, the index has their fields after the next `save`.
+        for (const auto& name : withoutFields) {
+            auto iter = entities.find(name);
+            if (iter != entities.end() && loadFields(iter->second) == CODE_OK) {
+                indexChanged = true;
+            }
+        }
+
+        return CODE_OK;
+    }
+
+    bool EntityStore::isLoaded(std::string_view name) const {
+        auto iter = items.find(name);
+        return iter == items.end() || iter->second.loaded;
+    }
+
+    std::vector<EntityIndexField> const* EntityStore::indexFieldsOf(std::string_view name) const {
+        auto iter = items.find(name);
+        if (iter == items.end() || iter->second.loaded) {
+            return nullptr;
+        }
+        return &iter->second.fields;
+    }
+
+    std::string EntityStore::filePathOf(std::string_view name) const {
+        auto iter = items.find(name);
+        if (iter == items.end() || !legacyFile.empty()) {
+            return {};
+        }
+        return folder + iter->second.file;
+    }
+
+    int EntityStore::loadFields(SightEntity& entity) {
+        auto iter = items.find(entity.name);
+        if (iter == items.end() || iter->second.loaded) {
+            return CODE_OK;
+        }
+
+        std::vector<SightEntity> list;
+        int status = readEntities(folder + iter->second.file, entityWhoAmI, list);
+        if (status != CODE_OK) {
+            return status;
+        }
+        if (list.empty() || list.front().name != entity.name) {
+            logDebug("entity file does not match the index: $0", iter->second.file);
+            return CODE_FILE_FORMAT_ERROR;
+        }
+
+        entity.fields = std::move(list.front().fields);
+        iter->second.loaded = true;
+        return CODE_OK;
+    }
+
+    int EntityStore::reloadFile(std::string_view file, absl::btree_map<std::string, SightEntity>& entities, std::vector<EntityFileChange>& changes) {
+        if (folder.empty() || !legacyFile.empty() || file == SIGHT_ENTITIES_INDEX_FILE || !endsWith(std::string(file), ".yaml")) {
+            return CODE_OK;
+        }
+
+        std::string oldName;
+        for (const auto& [name, item] : items) {
+            if (item.file == file) {
+                oldName = name;
+                break;
+            }
+        }
+
+        auto path = folder + std::string(file);
+        std::error_code ec;
+        if (!std::filesystem::exists(path, ec)) {
+            if (!oldName.empty() && !dirty.contains(oldName)) {
+                changes.push_back({ oldName, entities[oldName].templateAddress, false, true });
+            }
+            return CODE_OK;
+        }
+
+        std::string content;
+        if (std::ifstream in(path, std::ios::binary); in.is_open()) {
+            content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        std::vector<SightEntity> list;
+        int status = readEntities(path, entityWhoAmI, list);
+        if (status != CODE_OK) {
+            return status;
+        }
+        if (list.empty()) {
+            return CODE_FILE_FORMAT_ERROR;
+        }
+
+        auto& entity = list.front();
+        if (!oldName.empty() && oldName != entity.name && !dirty.contains(oldName)) {
+            // renamed in the file, the old one is gone. Its item is dropped here, so its file is not deleted by `save`.
+            changes.push_back({ oldName, entities[oldName].templateAddress, false, true });
+            items.erase(oldName);
+        }
+
+        auto itemIter = items.find(entity.name);
+        auto entityIter = entities.find(entity.name);
+        if (itemIter != items.end() && itemIter->second.file != file) {
+            logWarning("entity $0 is in more than one file, ignore: $1", entity.name, file);
+            return CODE_OK;
+        }
+        EntityFileChange change{ entity.name };
+        if (entityIter != entities.end()) {
+            if (itemIter != items.end() && itemIter->second.loaded && entityFileContent(entityIter->second) == content) {
+                // written by `save`
+                return CODE_OK;
+            }
+            if (dirty.contains(entity.name)) {
+                logWarning("entity $0 is changed outside, but it has unsaved changes.", entity.name);
+                return CODE_OK;
+            }
+            change.oldTemplateAddress = entityIter->second.templateAddress;
+            entity.typeId = entityIter->second.typeId;
+        } else {
+            change.added = true;
+        }
+
+        logDebug("entity file is changed: $0", file);
+        items[entity.name] = { std::string(file), true };
+        entities[entity.name] = std::move(entity);
+        indexChanged = true;
+        changes.push_back(std::move(change));
+        return CODE_OK;
+    }
+
+    void EntityStore::markDirty(std::string_view name) {
+        auto& item = items[name];
+        if (item.file.empty()) {
+            item.file = fileNameOf(name);
+        }
+        item.loaded = true;
+        removedFiles.erase(item.file);
+        dirty.emplace(name);
+        indexChanged = true;
+    }
+
+    void EntityStore::markRemoved(std::string_view name) {
+        auto iter = items.find(name);
+        if (iter == items.end()) {
+            return;
+        }
+
+        removedFiles.insert(iter->second.file);
+        dirty.erase(iter->first);
+        items.erase(iter);
+        indexChanged = true;
+    }
+
+    int EntityStore::save(absl::btree_map<std::string, SightEntity> const& entities) {
+        if (folder.empty()) {
+            return CODE_FAIL;
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(folder, ec);
+
+        int status = CODE_OK;
+        std::vector<std::string> failed;
+        for (const auto& name : dirty) {
+            auto entityIter = entities.find(name);
+            auto itemIter = items.find(name);
+            if (entityIter == entities.end() || itemIter == items.end()) {
+                continue;
+            }
+
+            if (!writeFileAtomic(folder + itemIter->second.file, entityFileContent(entityIter->second))) {
+                logError("write entity file failed: $0", itemIter->second.file);
+                failed.push_back(name);
+                status = CODE_FILE_ERROR;
+            }
+        }
+        dirty.clear();
+        dirty.insert(failed.begin(), failed.end());
+
+        for (const auto& file : removedFiles) {
+            std::filesystem::remove(folder + file, ec);
+        }
+        removedFiles.clear();
+
+        if (indexChanged || !std::filesystem::exists(folder + SIGHT_ENTITIES_INDEX_FILE, ec)) {
+            if (saveIndex(entities) != CODE_OK) {
+                return CODE_FILE_ERROR;
+            }
+        }
+
+        if (!legacyFile.empty() && status == CODE_OK) {
+            // keep the old file, but it is not read any more.
+            std::filesystem::rename(legacyFile, legacyFile + ".bak", ec);
+            if (ec) {
+                logWarning("rename $0 failed: $1", legacyFile, ec.message());
+            }
+            legacyFile.clear();
+        }
+        return status;
+    }
+
+    std::string EntityStore::fileNameOf(std::string_view name) const {
+        std::string base;
+        for (char c : name) {
+            bool keep = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.' || c == '-' || c == '_';
+            base += keep ? c : '_';
+        }
+        if (base.empty() || base.front() == '.') {
+            base.insert(base.begin(), '_');
+        }
+
+        absl::flat_hash_set<std::string_view> usedFiles;
+        for (const auto& [key, item] : items) {
+            if (key != name) {
+                usedFiles.insert(item.file);
+            }
+        }
+        usedFiles.insert(SIGHT_ENTITIES_INDEX_FILE);
+
+        auto file = base + ".yaml";
+        for (int i = 2; usedFiles.contains(file); i++) {
+            file = base + "-" + std::to_string(i) + ".yaml";
+        }
+        return file;
+    }
+
+    int EntityStore::loadEntityFile(std::string const& file, absl::btree_map<std::string, SightEntity>& entities) {
+        std::vector<SightEntity> list;
+        int status = readEntities(folder + file, entityWhoAmI, list);
+        if (status != CODE_OK) {
+            return status;
+        }
+
+        for (auto& entity : list) {
+            if (items.contains(entity.name)) {
+                logWarning("entity $0 is in more than one file, ignore: $1", entity.name, file);
+                continue;
+            }
+            items[entity.name] = { file, true };
+            entities[entity.name] = std::move(entity);
+        }
+        return CODE_OK;
+    }
+
+    int EntityStore::loadLegacyFile(absl::btree_map<std::string, SightEntity>& entities) {
+        std::vector<SightEntity> list;
+        int status = readEntities(legacyFile, "sight-entities", list);
+        if (status != CODE_OK) {
+            return status;
+        }
+
+        for (auto& entity : list) {
+            markDirty(entity.name);
+            entities[entity.name] = std::move(entity);
+        }
+        return CODE_OK;
+    }
+
+    int EntityStore::saveIndex(absl::btree_map<std::string, SightEntity> const& entities) {
+        YAML::Emitter out;
+        out << YAML::BeginMap;
+        out << YAML::Key << whoAmI << YAML::Value << indexWhoAmI;
+        out << YAML::Key << "entities" << YAML::Value << YAML::BeginMap;
+        for (const auto& [name, entity] : entities) {
+            auto iter = items.find(name);
+            if (iter == items.end()) {
+                continue;
+            }
+
+            out << YAML::Key << name << YAML::BeginMap;
+            out << YAML::Key << "templateAddress" << YAML::Value << entity.templateAddress;
+            out << YAML::Key << "parentEntity" << YAML::Value << entity.parentEntity;
+            out << YAML::Key << "typeId" << YAML::Value << entity.typeId;
+            out << YAML::Key << "file" << YAML::Value << iter->second.file;
+            out << YAML::Key << "fields" << YAML::Value << YAML::BeginMap;
+            if (iter->second.loaded) {
+                for (const auto& field : entity.fields) {
+                    out << YAML::Key << field.name << YAML::Value << field.type;
+                }
+            } else {
+                for (const auto& field : iter->second.fields) {
+                    out << YAML::Key << field.name << YAML::Value << field.type;
+                }
+            }
+            out << YAML::EndMap;
+            out << YAML::EndMap;
+        }
+        out << YAML::EndMap;
+        out << YAML::EndMap;
+
+        std::string content(out.c_str());
+        content += '\n';
+        if (!writeFileAtomic(folder + SIGHT_ENTITIES_INDEX_FILE, content)) {
+            logError("write entity index failed: $0", folder);
+            return CODE_FILE_ERROR;
+        }
+        indexChanged = false;
+        return CODE_OK;
+    }
+
+}
@@ -0,0 +1,931 @@
+#include "sight_graph_binary.h"
+#include "sight_graph_yaml.h"
+
+#include "sight.h"
+#include "sight_build_manifest.h"
+#include "sight_defines.h"
+#include "sight_log.h"
+#include "sight_node.h"
+#include "sight_node_graph.h"
+#include "sight_project.h"
+#include "sight_util.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+#include "absl/strings/numbers.h"
+#include "yaml-cpp/yaml.h"
+
+namespace sight {
+
+    namespace {
+
+        constexpr uint64_t alignSection(uint64_t offset) {
+            return (offset + 7) & ~static_cast<uint64_t>(7);
+        }
+
+        NodePortType portKindOf(SightGraphBinaryPort const& port) {
+            return static_cast<NodePortType>(static_cast<int>(NodePortType::Input) + port.kind);
+        }
+
+        template<class Source>
+        void copyNodeRecordFrom(SightGraphBinaryWriter& to, Source const& from, SightGraphBinaryNode const& record) {
+            SightGraphBinaryNode copy = record;
+            copy.name = to.addString(from.str(record.name));
+            copy.templateAddress = to.addString(from.str(record.templateAddress));
+            copy.firstPort = static_cast<uint32_t>(to.ports.size());
+            for (auto port : portsOf(from, record)) {
+                port.name = to.addString(from.str(port.name));
+                port.customPortName = to.addString(from.str(port.customPortName));
+                if (port.valueKind == SightGraphBinaryValueKind::String) {
+                    port.value.string = to.addString(from.str(port.value.string));
+                } else if (port.valueKind == SightGraphBinaryValueKind::Floats) {
+                    auto floats = floatsOf(from, port);
+                    port.value.floats = { to.addFloats(floats.data(), static_cast<uint32_t>(floats.size())), static_cast<uint32_t>(floats.size()) };
+                }
+                to.ports.push_back(port);
+            }
+            copy.portCount = static_cast<uint32_t>(to.ports.size()) - copy.firstPort;
+            to.nodes.push_back(copy);
+        }
+
+        template<class Source>
+        struct BinaryToYamlContext {
+            Source const& reader;
+            YAML::Emitter& out;
+            // key: owner id, value: index of component records.
+            absl::flat_hash_map<uint32_t, std::vector<uint32_t>> nodeComponents;
+            absl::flat_hash_map<uint32_t, std::vector<uint32_t>> connectionComponents;
+        };
+
+        template<class Source>
+        void emitNode(BinaryToYamlContext<Source>& context, SightGraphBinaryNode const& record);
+
+        template<class Source>
+        void emitComponents(BinaryToYamlContext<Source>& context, std::vector<uint32_t> const& list) {
+            auto& out = context.out;
+            auto nodes = nodesOf(context.reader);
+            out << YAML::Key << "components" << YAML::Value << YAML::BeginMap;
+            for (auto index : list) {
+                out << YAML::Key << nodes[index].id << YAML::Value;
+                emitNode(context, nodes[index]);
+            }
+            out << YAML::EndMap;
+        }
+
+        template<class Source>
+        void emitNode(BinaryToYamlContext<Source>& context, SightGraphBinaryNode const& record) {
+            auto& out = context.out;
+            auto& reader = context.reader;
+
+            out << YAML::BeginMap;
+            out << YAML::Key << "name" << YAML::Value << std::string(reader.str(record.name));
+            out << YAML::Key << "id" << YAML::Value << record.id;
+            if (record.hasPosition) {
+                out << YAML::Key << "position" << YAML::Value << YAML::Flow << YAML::BeginSeq << record.positionX << record.positionY << YAML::EndSeq;
+            }
+            if (record.templateAddress.size > 0) {
+                out << YAML::Key << "template" << YAML::Value << std::string(reader.str(record.templateAddress));
+            }
+
+            auto ports = portsOf(reader, record);
+            auto emitPorts = [&](const char* key, NodePortType kind) {
+                out << YAML::Key << key << YAML::Value << YAML::BeginMap;
+                for (const auto& port : ports) {
+                    if (portKindOf(port) != kind) {
+                        continue;
+                    }
+                    out << YAML::Key << port.id << YAML::Value << YAML::BeginMap;
+                    out << YAML::Key << "name" << YAML::Value << std::string(reader.str(port.name));
+                    out << YAML::Key << "type" << YAML::Value << port.type;
+                    if (port.parent) {
+                        out << YAML::Key << "parent" << YAML::Value << port.parent;
+                    }
+
+                    out << YAML::Key << "value" << YAML::Value;
+                    switch (port.valueKind) {
+                    case SightGraphBinaryValueKind::None:
+                        out << YAML::Null;
+                        break;
+                    case SightGraphBinaryValueKind::String:
+                        out << std::string(reader.str(port.value.string));
+                        break;
+                    case SightGraphBinaryValueKind::Int:
+                        out << static_cast<int>(port.value.i);
+                        break;
+                    case SightGraphBinaryValueKind::Float:
+                        out << port.value.f;
+                        break;
+                    case SightGraphBinaryValueKind::Double:
+                        out << port.value.d;
+                        break;
+                    case SightGraphBinaryValueKind::Bool:
+                        out << (port.value.b != 0);
+                        break;
+                    case SightGraphBinaryValueKind::Floats:
+                        out << YAML::BeginSeq;
+                        for (auto f : floatsOf(reader, port)) {
+                            out << f;
+                        }
+                        out << YAML::EndSeq;
+                        break;
+                    }
+
+                    out << YAML::Key << "options" << YAML::BeginMap;
+                    out << YAML::Key << "customPortName" << YAML::Value << std::string(reader.str(port.customPortName));
+                    out << YAML::Key << "dynamicPort" << YAML::Value << (port.dynamicPort != 0);
+                    out << YAML::EndMap;
+
+                    out << YAML::EndMap;
+                }
+                out << YAML::EndMap;
+            };
+            emitPorts("inputs", NodePortType::Input);
+            emitPorts("outputs", NodePortType::Output);
+            emitPorts("fields", NodePortType::Field);
+
+            if (auto iter = context.nodeComponents.find(record.id); iter != context.nodeComponents.end()) {
+                emitComponents(context, iter->second);
+            }
+            out << YAML::EndMap;
+        }
+
+        /**
+         * @brief Write a port value by the port's real type, the same as the yaml emitter.
+         */
+        void writePortValue(SightGraphBinaryWriter& writer, SightGraphBinaryPort& record, SightNodePort const& item) {
+            auto& value = item.value;
+            switch (item.getType()) {
+            case IntTypeFloat:
+                record.valueKind = SightGraphBinaryValueKind::Float;
+                record.value.f = value.u.f;
+                break;
+            case IntTypeDouble:
+                record.valueKind = SightGraphBinaryValueKind::Double;
+                record.value.d = value.u.d;
+                break;
+            case IntTypeInt:
+            case IntTypeLong:
+                record.valueKind = SightGraphBinaryValueKind::Int;
+                record.value.i = value.u.i;
+                break;
+            case IntTypeString:
+                record.valueKind = SightGraphBinaryValueKind::String;
+                record.value.string = writer.addString(value.u.string);
+                break;
+            case IntTypeLargeString:
+                record.valueKind = SightGraphBinaryValueKind::String;
+                record.value.string = writer.addString(value.u.largeString.pointer ? value.u.largeString.pointer : "");
+                break;
+            case IntTypeBool:
+                record.valueKind = SightGraphBinaryValueKind::Bool;
+                record.value.b = value.u.b ? 1 : 0;
+                break;
+            case IntTypeChar:
+                record.valueKind = SightGraphBinaryValueKind::String;
+                record.value.string = writer.addString(std::string_view(value.u.string, value.u.string[0] ? 1 : 0));
+                break;
+            case IntTypeVector3:
+                record.valueKind = SightGraphBinaryValueKind::Floats;
+                record.value.floats = { writer.addFloats(value.u.vector3, 3), 3 };
+                break;
+            case IntTypeVector4:
+            case IntTypeColor:
+                record.valueKind = SightGraphBinaryValueKind::Floats;
+                record.value.floats = { writer.addFloats(value.u.vector4, 4), 4 };
+                break;
+            default:
+            {
+                record.valueKind = SightGraphBinaryValueKind::None;
+                if (!isBuiltInType(item.getType())) {
+                    auto [typeInfo, find] = currentProject()->findTypeInfo(item.getType());
+                    if (find && typeInfo.render.kind == TypeInfoRenderKind::ComboBox) {
+                        record.valueKind = SightGraphBinaryValueKind::Int;
+                        record.value.i = value.u.i;
+                    }
+                }
+                break;
+            }
+            }
+        }
+
+        template<class Source>
+        bool valueAsInt(Source const& reader, SightGraphBinaryPort const& record, int& result) {
+            switch (record.valueKind) {
+            case SightGraphBinaryValueKind::Int:
+                result = static_cast<int>(record.value.i);
+                return true;
+            case SightGraphBinaryValueKind::Float:
+                result = static_cast<int>(record.value.f);
+                return true;
+            case SightGraphBinaryValueKind::Double:
+                result = static_cast<int>(record.value.d);
+                return true;
+            case SightGraphBinaryValueKind::Bool:
+                result = record.value.b;
+                return true;
+            case SightGraphBinaryValueKind::String:
+                return absl::SimpleAtoi(reader.str(record.value.string), &result);
+            default:
+                return false;
+            }
+        }
+
+        template<class Source>
+        bool valueAsDouble(Source const& reader, SightGraphBinaryPort const& record, double& result) {
+            switch (record.valueKind) {
+            case SightGraphBinaryValueKind::Int:
+                result = static_cast<double>(record.value.i);
+                return true;
+            case SightGraphBinaryValueKind::Float:
+                result = record.value.f;
+                return true;
+            case SightGraphBinaryValueKind::Double:
+                result = record.value.d;
+                return true;
+            case SightGraphBinaryValueKind::String:
+                return absl::SimpleAtod(reader.str(record.value.string), &result);
+            default:
+                return false;
+            }
+        }
+
+        template<class Source>
+        bool valueAsBool(Source const& reader, SightGraphBinaryPort const& record, bool& result) {
+            switch (record.valueKind) {
+            case SightGraphBinaryValueKind::Bool:
+                result = record.value.b != 0;
+                return true;
+            case SightGraphBinaryValueKind::Int:
+                result = record.value.i != 0;
+                return true;
+            case SightGraphBinaryValueKind::String:
+                return absl::SimpleAtob(reader.str(record.value.string), &result);
+            default:
+                return false;
+            }
+        }
+
+        template<class Source>
+        std::string_view valueAsString(Source const& reader, SightGraphBinaryPort const& record) {
+            if (record.valueKind == SightGraphBinaryValueKind::String) {
+                return reader.str(record.value.string);
+            }
+            return {};
+        }
+
+        template<class Source>
+        void readFloats(Source const& reader, SightGraphBinaryPort const& record, float* p, uint32_t size) {
+            if (record.valueKind != SightGraphBinaryValueKind::Floats) {
+                return;
+            }
+            auto floats = floatsOf(reader, record);
+            std::copy_n(floats.begin(), std::min<size_t>(size, floats.size()), p);
+        }
+
+        /**
+         * @brief Binary version of `loadPortInfo`.
+         */
+        template<class Source>
+        int loadPortInfo(Source const& reader, SightGraphBinaryPort const& record, std::vector<SightNodePort>& list) {
+            auto name = reader.str(record.name);
+
+            SightNodePort* pointer = nullptr;
+            SightPortName portName;
+            if (record.dynamicPort) {
+                portName = name;
+                list.push_back({});
+                pointer = &(list.back());
+            } else if (SightPortName::find(name, portName)) {
+                // a name which is never interned can not be a template port's name.
+                for (auto& item : list) {
+                    if (item.portName == portName) {
+                        pointer = &item;
+                        break;
+                    }
+                }
+            }
+
+            if (!pointer) {
+                logDebug("$0 not found", name);
+                return CODE_FAIL;
+            }
+
+            auto& port = *pointer;
+            port.portName = portName;
+            port.id = record.id;
+            port.kind = portKindOf(record);
+            port.type = record.type;
+
+            auto type = port.getType();     // update to real type.
+            auto& u = port.value.u;
+            switch (type) {
+            case IntTypeFloat:
+            {
+                double d = 0;
+                if (valueAsDouble(reader, record, d)) {
+                    u.f = static_cast<float>(d);
+                }
+                break;
+            }
+            case IntTypeDouble:
+                valueAsDouble(reader, record, u.d);
+                break;
+            case IntTypeInt:
+            case IntTypeLong:
+                valueAsInt(reader, record, u.i);
+                break;
+            case IntTypeString:
+            {
+                auto str = valueAsString(reader, record);
+                snprintf(u.string, std::size(u.string), "%.*s", static_cast<int>(str.size()), str.data());
+                break;
+            }
+            case IntTypeLargeString:
+            {
+                auto str = valueAsString(reader, record);
+                port.value.stringCheck(str.size());
+                std::memcpy(u.largeString.pointer, str.data(), str.size());
+                u.largeString.pointer[str.size()] = '\0';
+                break;
+            }
+            case IntTypeBool:
+                valueAsBool(reader, record, u.b);
+                break;
+            case IntTypeProcess:
+            case IntTypeButton:
+            case IntTypeObject:
+                break;
+            case IntTypeChar:
+            {
+                auto str = valueAsString(reader, record);
+                if (!str.empty()) {
+                    u.string[0] = str[0];
+                }
+                break;
+            }
+            case IntTypeVector3:
+                readFloats(reader, record, u.vector3, 3);
+                break;
+            case IntTypeVector4:
+            case IntTypeColor:
+                readFloats(reader, record, u.vector4, 4);
+                break;
+            default:
+            {
+                if (!isBuiltInType(type)) {
+                    auto [typeInfo, find] = currentProject()->findTypeInfo(type);
+                    if (find && typeInfo.render.kind == TypeInfoRenderKind::ComboBox) {
+                        valueAsInt(reader, record, u.i);
+                    }
+                } else {
+                    logDebug("type error, unHandled: $0, $1", type, getTypeName(type));
+                }
+            } break;
+            }
+
+            port.oldValue = port.value;
+
+            if (record.customPortName.size > 0) {
+                port.ownOptions.customPortName = reader.str(record.customPortName);
+            }
+            port.ownOptions.dynamicPort = record.dynamicPort != 0;
+            if (record.parent) {
+                port.parent = record.parent;
+            }
+            return CODE_OK;
+        }
+
+        template<class Source>
+        int loadNodeDataFrom(Source const& reader, SightGraphBinaryNode const& record, SightNode*& node, SightNodeGraph* graph) {
+            auto templateNodeAddress = reader.str(record.templateAddress);
+            if (templateNodeAddress.empty()) {
+                return CODE_NO_TEMPLATE_ADDRESS;
+            }
+            // strings of the reader and the writer are '\0' terminated.
+            auto templateNode = findTemplateNode(templateNodeAddress.data());
+            if (!templateNode) {
+                logDebug("template not found: $0", templateNodeAddress);
+                return CODE_TEMPLATE_ADDRESS_INVALID;
+            }
+
+            int status = CODE_OK;
+            auto nodePointer = templateNode->instantiate(graph, false);
+            nodePointer->nodeId = record.id;
+            nodePointer->nodeName = reader.str(record.name);
+            if (record.hasPosition) {
+                nodePointer->position.x = record.positionX;
+                nodePointer->position.y = record.positionY;
+            }
+
+            for (auto const& port : portsOf(reader, record)) {
+                std::vector<SightNodePort>* list = nullptr;
+                switch (portKindOf(port)) {
+                case NodePortType::Input:
+                    list = &nodePointer->inputPorts;
+                    break;
+                case NodePortType::Output:
+                    list = &nodePointer->outputPorts;
+                    break;
+                case NodePortType::Field:
+                    list = &nodePointer->fields;
+                    break;
+                default:
+                    break;
+                }
+                if (!list || loadPortInfo(reader, port, *list) != CODE_OK) {
+                    status = CODE_GRAPH_BROKEN;
+                }
+            }
+
+            // fix no-data-port's id.   Happened when template node add any port(s).
+            auto nodeFunc = [](std::vector<SightNodePort>& list) {
+                for (auto& item : list) {
+                    if (item.id <= 0) {
+                        item.id = nextNodeOrPortId();
+                    }
+                }
+            };
+            CALL_NODE_FUNC(nodePointer);
+
+            node = nodePointer;
+            return status;
+        }
+
+        /**
+         * @brief Emit records as a yaml graph, the layout is the same as the emitters of nodes and connections.
+         */
+        template<class Source>
+        int writeGraphYamlFrom(Source const& reader, std::string_view yamlPath) {
+            YAML::Emitter out;
+            BinaryToYamlContext<Source> context{ reader, out };
+            auto nodes = nodesOf(reader);
+            for (uint32_t i = 0; i < nodes.size(); i++) {
+                auto const& record = nodes[i];
+                if (record.ownerKind == SightGraphBinaryOwner::Node) {
+                    context.nodeComponents[record.ownerId].push_back(i);
+                } else if (record.ownerKind == SightGraphBinaryOwner::Connection) {
+                    context.connectionComponents[record.ownerId].push_back(i);
+                }
+            }
+
+            out << YAML::BeginMap;
+            out << YAML::Key << whoAmI << YAML::Value << "sight-graph";
+
+            out << YAML::Key << "nodes" << YAML::Value << YAML::BeginMap;
+            for (auto const& record : nodes) {
+                if (record.ownerKind == SightGraphBinaryOwner::None) {
+                    out << YAML::Key << record.id << YAML::Value;
+                    emitNode(context, record);
+                }
+            }
+            out << YAML::EndMap;
+
+            out << YAML::Key << "connections" << YAML::Value << YAML::BeginMap;
+            for (auto const& connection : connectionsOf(reader)) {
+                out << YAML::Key << connection.id << YAML::Value << YAML::BeginMap;
+                out << YAML::Key << "id" << YAML::Value << connection.id;
+                out << YAML::Key << "left" << YAML::Value << connection.left;
+                out << YAML::Key << "right" << YAML::Value << connection.right;
+                out << YAML::Key << "priority" << YAML::Value << connection.priority;
+                out << YAML::Key << "generateCode" << YAML::Value << (connection.generateCode != 0);
+                if (auto iter = context.connectionComponents.find(connection.id); iter != context.connectionComponents.end()) {
+                    emitComponents(context, iter->second);
+                }
+                out << YAML::EndMap;
+            }
+            out << YAML::EndMap;
+
+            out << YAML::Key << "settings" << YAML::Value << YAML::BeginMap;
+            for (auto const& item : settingsOf(reader)) {
+                out << YAML::Key << std::string(reader.str(item.key)) << YAML::Value << std::string(reader.str(item.value));
+            }
+            out << YAML::EndMap;
+
+            out << YAML::Key << "saveAsJsonHistory" << YAML::Value << YAML::BeginSeq;
+            for (auto const& item : saveAsJsonHistoryOf(reader)) {
+                out << std::string(reader.str(item));
+            }
+            out << YAML::EndSeq;
+            out << YAML::EndMap;
+
+            std::string content(out.c_str());
+            content.push_back('\n');
+            return writeFileAtomic(yamlPath, content) ? CODE_OK : CODE_FILE_ERROR;
+        }
+
+    }
+
+    SightGraphBinaryString SightGraphBinaryWriter::addString(std::string_view str) {
+        if (str.empty()) {
+            return {};
+        }
+
+        auto [iter, inserted] = stringIndex.try_emplace(str);
+        if (inserted) {
+            iter->second = { static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(str.size()) };
+            strings.append(str);
+            strings.push_back('\0');
+        }
+        return iter->second;
+    }
+
+    uint32_t SightGraphBinaryWriter::addFloats(const float* p, uint32_t count) {
+        auto first = static_cast<uint32_t>(floats.size());
+        floats.insert(floats.end(), p, p + count);
+        return first;
+    }
+
+    void SightGraphBinaryWriter::addSetting(std::string_view key, std::string_view value) {
+        settings.push_back({ addString(key), addString(value) });
+    }
+
+    std::string_view SightGraphBinaryWriter::str(SightGraphBinaryString str) const {
+        if (str.size == 0 || static_cast<uint64_t>(str.offset) + str.size >= strings.size()) {
+            return {};
+        }
+        return { strings.data() + str.offset, str.size };
+    }
+
+    std::span<const SightGraphBinaryPort> SightGraphBinaryWriter::portsOf(SightGraphBinaryNode const& node) const {
+        if (static_cast<uint64_t>(node.firstPort) + node.portCount > ports.size()) {
+            return {};
+        }
+        return std::span<const SightGraphBinaryPort>(ports).subspan(node.firstPort, node.portCount);
+    }
+
+    std::span<const float> SightGraphBinaryWriter::floatsOf(SightGraphBinaryPort const& port) const {
+        if (port.valueKind != SightGraphBinaryValueKind::Floats || static_cast<uint64_t>(port.value.floats.first) + port.value.floats.count > floats.size()) {
+            return {};
+        }
+        return std::span<const float>(floats).subspan(port.value.floats.first, port.value.floats.count);
+    }
+
+    void SightGraphBinaryWriter::clear() {
+        nodes.clear();
+        ports.clear();
+        connections.clear();
+        floats.clear();
+        settings.clear();
+        saveAsJsonHistory.clear();
+        strings.clear();
+        stringIndex.clear();
+    }
+
+    int SightGraphBinaryWriter::writeTo(std::string_view path) const {
+        return writeFileAtomic(path, toBuffer()) ? CODE_OK : CODE_FILE_ERROR;
+    }
+
+    uint64_t SightGraphBinaryWriter::contentHash() const {
+        BuildHasher hasher;
+        auto addSection = [&hasher](auto const& records) {
+            hasher.add(records.size());
+            hasher.add(records.data(), records.size() * sizeof(records.front()));
+        };
+        hasher.add(std::string_view(strings));
+        addSection(nodes);
+        addSection(ports);
+        addSection(connections);
+        addSection(floats);
+        addSection(settings);
+        addSection(saveAsJsonHistory);
+        return hasher.value;
+    }
+
+    std::string SightGraphBinaryWriter::toBuffer() const {
+        SightGraphBinaryHeader header;
+        std::memcpy(header.magic, sightGraphBinaryMagic, sizeof(header.magic));
+        header.sourceSize = sourceSize;
+        header.sourceModifyTime = sourceModifyTime;
+
+        uint64_t offset = sizeof(SightGraphBinaryHeader);
+        auto place = [&offset](SightGraphBinarySection& section, size_t count, size_t bytes) {
+            offset = alignSection(offset);
+            section.offset = offset;
+            section.count = static_cast<uint32_t>(count);
+            offset += bytes;
+        };
+        // the string section always has a '\0' at offset 0, so an empty string is valid too.
+        place(header.strings, strings.size() + 1, strings.size() + 1);
+        place(header.nodes, nodes.size(), nodes.size() * sizeof(SightGraphBinaryNode));
+        place(header.ports, ports.size(), ports.size() * sizeof(SightGraphBinaryPort));
+        place(header.connections, connections.size(), connections.size() * sizeof(SightGraphBinaryConnection));
+        place(header.floats, floats.size(), floats.size() * sizeof(float));
+        place(header.settings, settings.size(), settings.size() * sizeof(SightGraphBinarySetting));
+        place(header.saveAsJsonHistory, saveAsJsonHistory.size(), saveAsJsonHistory.size() * sizeof(SightGraphBinaryString));
+        header.fileSize = offset;
+
+        // sections are placed in order, gaps are zeros.
+        std::string buffer(offset, '\0');
+        auto write = [&buffer](SightGraphBinarySection const& section, const void* p, size_t bytes) {
+            if (bytes > 0) {
+                std::memcpy(buffer.data() + section.offset, p, bytes);
+            }
+        };
+        std::memcpy(buffer.data(), &header, sizeof(header));
+
+        // +1: string offsets are shifted by the leading '\0'.
+        std::memcpy(buffer.data() + header.strings.offset + 1, strings.data(), strings.size());
+        write(header.nodes, nodes.data(), nodes.size() * sizeof(SightGraphBinaryNode));
+        write(header.ports, ports.data(), ports.size() * sizeof(SightGraphBinaryPort));
+        write(header.connections, connections.data(), connections.size() * sizeof(SightGraphBinaryConnection));
+        write(header.floats, floats.data(), floats.size() * sizeof(float));
+        write(header.settings, settings.data(), settings.size() * sizeof(SightGraphBinarySetting));
+        write(header.saveAsJsonHistory, saveAsJsonHistory.data(), saveAsJsonHistory.size() * sizeof(SightGraphBinaryString));
+
+        return buffer;
+    }
+
+    int SightGraphBinaryReader::open(std::string_view path) {
+        close();
+        if (!file.open(path)) {
+            return CODE_FILE_ERROR;
+        }
+        base = file.data();
+        length = file.size();
+        return check();
+    }
+
+    int SightGraphBinaryReader::openMemory(const char* data, size_t size) {
+        close();
+        base = data;
+        length = size;
+        return check();
+    }
+
+    int SightGraphBinaryReader::check() {
+        auto fail = [this]() {
+            close();
+            return CODE_FILE_FORMAT_ERROR;
+        };
+
+        if (!base || length < sizeof(SightGraphBinaryHeader)) {
+            return fail();
+        }
+        auto const& h = header();
+        if (std::memcmp(h.magic, sightGraphBinaryMagic, sizeof(h.magic)) != 0 || h.version != sightGraphBinaryVersion ||
+            h.byteOrder != sightGraphBinaryByteOrder || h.fileSize != length) {
+            return fail();
+        }
+
+        auto check = [&h](SightGraphBinarySection const& section, size_t recordSize) {
+            return section.offset % 8 == 0 && section.offset <= h.fileSize &&
+                   static_cast<uint64_t>(section.count) * recordSize <= h.fileSize - section.offset;
+        };
+        if (!check(h.strings, 1) || !check(h.nodes, sizeof(SightGraphBinaryNode)) || !check(h.ports, sizeof(SightGraphBinaryPort)) ||
+            !check(h.connections, sizeof(SightGraphBinaryConnection)) || !check(h.floats, sizeof(float)) ||
+            !check(h.settings, sizeof(SightGraphBinarySetting)) || !check(h.saveAsJsonHistory, sizeof(SightGraphBinaryString))) {
+            return fail();
+        }
+        if (h.strings.count == 0 || base[h.strings.offset + h.strings.count - 1] != '\0') {
+            return fail();
+        }
+
+        for (auto const& node : nodes()) {
+            if (static_cast<uint64_t>(node.firstPort) + node.portCount > h.ports.count) {
+                return fail();
+            }
+        }
+        return CODE_OK;
+    }
+
+    void SightGraphBinaryReader::close() {
+        file.close();
+        base = nullptr;
+        length = 0;
+    }
+
+    SightGraphBinaryHeader const& SightGraphBinaryReader::header() const {
+        return *reinterpret_cast<const SightGraphBinaryHeader*>(base);
+    }
+
+    std::span<const SightGraphBinaryNode> SightGraphBinaryReader::nodes() const {
+        return section<SightGraphBinaryNode>(header().nodes);
+    }
+
+    std::span<const SightGraphBinaryPort> SightGraphBinaryReader::ports() const {
+        return section<SightGraphBinaryPort>(header().ports);
+    }
+
+    std::span<const SightGraphBinaryPort> SightGraphBinaryReader::ports(SightGraphBinaryNode const& node) const {
+        return ports().subspan(node.firstPort, node.portCount);
+    }
+
+    std::span<const SightGraphBinaryConnection> SightGraphBinaryReader::connections() const {
+        return section<SightGraphBinaryConnection>(header().connections);
+    }
+
+    std::span<const float> SightGraphBinaryReader::floats() const {
+        return section<float>(header().floats);
+    }
+
+    std::span<const float> SightGraphBinaryReader::floats(SightGraphBinaryPort const& port) const {
+        auto all = floats();
+        if (port.valueKind != SightGraphBinaryValueKind::Floats || static_cast<uint64_t>(port.value.floats.first) + port.value.floats.count > all.size()) {
+            return {};
+        }
+        return all.subspan(port.value.floats.first, port.value.floats.count);
+    }
+
+    std::span<const SightGraphBinarySetting> SightGraphBinaryReader::settings() const {
+        return section<SightGraphBinarySetting>(header().settings);
+    }
+
+    std::span<const SightGraphBinaryString> SightGraphBinaryReader::saveAsJsonHistory() const {
+        return section<SightGraphBinaryString>(header().saveAsJsonHistory);
+    }
+
+    std::string_view SightGraphBinaryReader::str(SightGraphBinaryString str) const {
+        auto const& strings = header().strings;
+        if (str.size == 0 || static_cast<uint64_t>(str.offset) + 1 + str.size >= strings.count) {
+            return {};
+        }
+        // +1: the leading '\0'
+        return { base + strings.offset + 1 + str.offset, str.size };
+    }
+
+    bool isGraphBinaryFile(std::string_view path) {
+        std::ifstream fin{ std::string(path), std::ios::in | std::ios::binary };
+        char magic[sizeof(sightGraphBinaryMagic)] = { 0 };
+        if (!fin.is_open() || !fin.read(magic, sizeof(magic))) {
+            return false;
+        }
+        return std::memcmp(magic, sightGraphBinaryMagic, sizeof(magic)) == 0;
+    }
+
+    std::string graphBinaryCachePath(std::string_view yamlPath, std::string_view baseDir) {
+        if (baseDir.empty()) {
+            return {};
+        }
+        std::error_code ec;
+        auto base = std::filesystem::absolute(baseDir, ec).lexically_normal();
+        auto path = std::filesystem::absolute(yamlPath, ec).lexically_normal();
+        if (ec) {
+            return {};
+        }
+        auto relative = path.lexically_relative(base);
+        if (relative.empty() || *relative.begin() == "..") {
+            return {};
+        }
+        return (base / ".sight" / "cache" / relative).generic_string() + SIGHT_GRAPH_BINARY_EXT;
+    }
+
+    bool graphSourceStamp(std::string_view path, uint64_t& size, int64_t& modifyTime) {
+        std::error_code ec;
+        std::filesystem::path p(path);
+        auto fileSize = std::filesystem::file_size(p, ec);
+        if (ec) {
+            return false;
+        }
+        auto time = std::filesystem::last_write_time(p, ec);
+        if (ec) {
+            return false;
+        }
+        size = fileSize;
+        modifyTime = static_cast<int64_t>(time.time_since_epoch().count());
+        return true;
+    }
+
+    int openGraphBinaryCache(SightGraphBinaryReader& reader, std::string_view cachePath, std::string_view yamlPath) {
+        uint64_t sourceSize = 0;
+        int64_t sourceModifyTime = 0;
+        if (!graphSourceStamp(yamlPath, sourceSize, sourceModifyTime)) {
+            return CODE_FILE_NOT_EXISTS;
+        }
+
+        int status = reader.open(cachePath);
+        if (status != CODE_OK) {
+            return status;
+        }
+        auto const& header = reader.header();
+        if (header.sourceSize != sourceSize || header.sourceModifyTime != sourceModifyTime) {
+            // outdated
+            reader.close();
+            return CODE_FAIL;
+        }
+        return CODE_OK;
+    }
+
+    int readGraphYamlRecords(std::string_view yamlPath, SightGraphBinaryWriter& writer) {
+        std::ifstream fin{ std::string(yamlPath) };
+        if (!fin.is_open()) {
+            return CODE_FILE_ERROR;
+        }
+
+        SightGraphYamlCallbacks callbacks;
+        callbacks.keepRecords = true;
+        callbacks.onWhoAmI = [](std::string_view value) {
+            return value == "sight-graph" ? CODE_OK : CODE_FILE_FORMAT_ERROR;
+        };
+        callbacks.onSetting = [&writer](std::string_view key, std::string_view value) {
+            writer.addSetting(key, value);
+        };
+        callbacks.onSaveAsJsonHistory = [&writer](std::string_view path) {
+            writer.saveAsJsonHistory.push_back(writer.addString(path));
+        };
+
+        std::string errorMessage;
+        int status = readGraphYaml(fin, writer, callbacks, &errorMessage);
+        if (status != CODE_OK) {
+            logError("read file $0 error: $1", yamlPath, errorMessage);
+        }
+        return status;
+    }
+
+    int convertGraphYamlToBinary(std::string_view yamlPath, std::string_view binaryPath) {
+        SightGraphBinaryWriter writer;
+        int status = readGraphYamlRecords(yamlPath, writer);
+        if (status != CODE_OK) {
+            return status;
+        }
+
+        graphSourceStamp(yamlPath, writer.sourceSize, writer.sourceModifyTime);
+        return writer.writeTo(binaryPath);
+    }
+
+    int convertGraphBinaryToYaml(std::string_view binaryPath, std::string_view yamlPath) {
+        SightGraphBinaryReader reader;
+        int status = reader.open(binaryPath);
+        if (status != CODE_OK) {
+            return status;
+        }
+        return writeGraphYaml(reader, yamlPath);
+    }
+
+    int writeGraphYaml(SightGraphBinaryReader const& reader, std::string_view yamlPath) {
+        return writeGraphYamlFrom(reader, yamlPath);
+    }
+
+    int writeGraphYaml(SightGraphBinaryWriter const& data, std::string_view yamlPath) {
+        return writeGraphYamlFrom(data, yamlPath);
+    }
+
+    void copyNodeRecord(SightGraphBinaryWriter& to, SightGraphBinaryReader const& from, SightGraphBinaryNode const& record) {
+        copyNodeRecordFrom(to, from, record);
+    }
+
+    void copyNodeRecord(SightGraphBinaryWriter& to, SightGraphBinaryWriter const& from, SightGraphBinaryNode const& record) {
+        copyNodeRecordFrom(to, from, record);
+    }
+
+    int loadNodeData(SightGraphBinaryReader const& reader, SightGraphBinaryNode const& record, SightNode*& node, SightNodeGraph* graph) {
+        return loadNodeDataFrom(reader, record, node, graph);
+    }
+
+    int loadNodeData(SightGraphBinaryWriter const& data, SightGraphBinaryNode const& record, SightNode*& node, SightNodeGraph* graph) {
+        return loadNodeDataFrom(data, record, node, graph);
+    }
+
+    void writeNodeData(SightGraphBinaryWriter& writer, SightNode const& node, SightGraphBinaryOwner ownerKind, uint32_t ownerId) {
+        SightGraphBinaryNode record;
+        record.id = node.nodeId;
+        record.ownerKind = ownerKind;
+        record.ownerId = ownerId;
+        record.name = writer.addString(node.nodeName);
+        record.positionX = node.position.x;
+        record.positionY = node.position.y;
+        if (node.templateNode) {
+            auto address = findTemplateNode(&node);
+            if (address) {
+                record.templateAddress = writer.addString(address->fullTemplateAddress);
+            }
+        }
+
+        record.firstPort = static_cast<uint32_t>(writer.ports.size());
+        // the same as yaml, kind is decided by which list the port is in.
+        auto portWork = [&writer](SightNodePort const& item, NodePortType kind) {
+            SightGraphBinaryPort port;
+            port.id = item.id;
+            port.type = item.type;
+            port.parent = item.parent;
+            port.kind = static_cast<uint8_t>(static_cast<int>(kind) - static_cast<int>(NodePortType::Input));
+            port.name = writer.addString(item.portName.str());
+            port.customPortName = writer.addString(item.ownOptions.customPortName.str());
+            port.dynamicPort = item.ownOptions.dynamicPort ? 1 : 0;
+            writePortValue(writer, port, item);
+            writer.ports.push_back(port);
+        };
+        for (auto const& item : node.inputPorts) {
+            portWork(item, NodePortType::Input);
+        }
+        for (auto const& item : node.outputPorts) {
+            portWork(item, NodePortType::Output);
+        }
+        for (auto const& item : node.fields) {
+            portWork(item, NodePortType::Field);
+        }
+        record.portCount = static_cast<uint32_t>(writer.ports.size()) - record.firstPort;
+        writer.nodes.push_back(record);
+
+        if (node.componentContainer) {
+            for (auto const& item : node.componentContainer->components) {
+                writeNodeData(writer, *item, SightGraphBinaryOwner::Node, node.nodeId);
+            }
+        }
+    }
+
+}
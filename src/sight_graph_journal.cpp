@@ -0,0 +1,427 @@
+#include "sight_graph_journal.h"
+
+#include "sight.h"
+
+#include "sight_build_manifest.h"
+#include "sight_defines.h"
+#include "sight_log.h"
+#include "sight_util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+
+namespace sight {
+
+    namespace {
+
+        using RecordRange = std::pair<size_t, size_t>;
+
+        /**
+         * @brief Records of a snapshot, grouped by top-level nodes and connections.
+         */
+        struct SnapshotGroups {
+            // key: node id, value: [begin, end) of the node and its components in `nodes`.
+            absl::flat_hash_map<uint32_t, RecordRange> nodes;
+            // key: connection id, value: [begin, end) of its components in `nodes`.
+            absl::flat_hash_map<uint32_t, RecordRange> connectionComponents;
+        };
+
+        void groupSnapshot(SightGraphBinaryWriter const& data, SnapshotGroups& groups) {
+            // components follow their owner, see `SightNodeGraph::snapshot`.
+            RecordRange* current = nullptr;
+            uint32_t currentConnection = 0;
+            for (size_t i = 0; i < data.nodes.size(); i++) {
+                auto const& record = data.nodes[i];
+                switch (record.ownerKind) {
+                case SightGraphBinaryOwner::None:
+                    current = &groups.nodes[record.id];
+                    *current = { i, i };
+                    currentConnection = 0;
+                    break;
+                case SightGraphBinaryOwner::Connection:
+                    if (!current || currentConnection != record.ownerId) {
+                        current = &groups.connectionComponents[record.ownerId];
+                        *current = { i, i };
+                        currentConnection = record.ownerId;
+                    }
+                    break;
+                case SightGraphBinaryOwner::Node:
+                    break;
+                }
+                if (current) {
+                    current->second = i + 1;
+                }
+            }
+        }
+
+        void hashNodeRecord(BuildHasher& hasher, SightGraphBinaryWriter const& data, SightGraphBinaryNode const& record) {
+            hasher.add(record.id);
+            hasher.add(record.ownerId);
+            hasher.add(record.ownerKind);
+            hasher.add(data.str(record.name));
+            hasher.add(data.str(record.templateAddress));
+            hasher.add(record.hasPosition);
+            hasher.add(record.positionX);
+            hasher.add(record.positionY);
+
+            auto ports = data.portsOf(record);
+            hasher.add(ports.size());
+            for (auto const& port : ports) {
+                hasher.add(port.id);
+                hasher.add(port.type);
+                hasher.add(port.parent);
+                hasher.add(port.kind);
+                hasher.add(port.dynamicPort);
+                hasher.add(data.str(port.name));
+                hasher.add(data.str(port.customPortName));
+                hasher.add(port.valueKind);
+                switch (port.valueKind) {
+                case SightGraphBinaryValueKind::None:
+                    break;
+                case SightGraphBinaryValueKind::String:
+                    hasher.add(data.str(port.value.string));
+                    break;
+                case SightGraphBinaryValueKind::Int:
+                    hasher.add(port.value.i);
+                    break;
+                case SightGraphBinaryValueKind::Float:
+                    hasher.add(port.value.f);
+                    break;
+                case SightGraphBinaryValueKind::Double:
+                    hasher.add(port.value.d);
+                    break;
+                case SightGraphBinaryValueKind::Bool:
+                    hasher.add(port.value.b);
+                    break;
+                case SightGraphBinaryValueKind::Floats:
+                    for (auto f : data.floatsOf(port)) {
+                        hasher.add(f);
+                    }
+                    break;
+                }
+            }
+        }
+
+        void hashRange(BuildHasher& hasher, SightGraphBinaryWriter const& data, RecordRange range) {
+            for (auto i = range.first; i < range.second; i++) {
+                hashNodeRecord(hasher, data, data.nodes[i]);
+            }
+        }
+
+        void hashSnapshot(SightGraphBinaryWriter const& data, SnapshotGroups const& groups, SightGraphRecordHashes& hashes) {
+            hashes.nodes.clear();
+            hashes.connections.clear();
+            hashes.nodes.reserve(groups.nodes.size());
+            hashes.connections.reserve(data.connections.size());
+
+            for (auto const& [id, range] : groups.nodes) {
+                BuildHasher hasher;
+                hashRange(hasher, data, range);
+                hashes.nodes[id] = hasher.value;
+            }
+
+            for (auto const& connection : data.connections) {
+                BuildHasher hasher;
+                hasher.add(connection.id);
+                hasher.add(connection.left);
+                hasher.add(connection.right);
+                hasher.add(connection.priority);
+                hasher.add(connection.generateCode);
+                if (auto iter = groups.connectionComponents.find(connection.id); iter != groups.connectionComponents.end()) {
+                    hashRange(hasher, data, iter->second);
+                }
+                hashes.connections[connection.id] = hasher.value;
+            }
+
+            BuildHasher hasher;
+            for (auto const& item : data.settings) {
+                hasher.add(data.str(item.key));
+                hasher.add(data.str(item.value));
+            }
+            hasher.add(data.saveAsJsonHistory.size());
+            for (auto const& item : data.saveAsJsonHistory) {
+                hasher.add(data.str(item));
+            }
+            hashes.settings = hasher.value;
+        }
+
+        uint64_t checksumOf(std::string_view bytes) {
+            BuildHasher hasher;
+            hasher.add(bytes.data(), bytes.size());
+            return hasher.value;
+        }
+
+        std::string readWholeFile(std::string const& path) {
+            std::ifstream fin{ path, std::ios::in | std::ios::binary };
+            if (!fin.is_open()) {
+                return {};
+            }
+            return { std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>() };
+        }
+
+        /**
+         * @return true if `content` is a journal of the yaml file which has the stamp.
+         */
+        bool isJournalOf(std::string_view content, uint64_t sourceSize, int64_t sourceModifyTime) {
+            if (content.size() < sizeof(SightGraphJournalHeader)) {
+                return false;
+            }
+            SightGraphJournalHeader header;
+            std::memcpy(&header, content.data(), sizeof(header));
+            return std::memcmp(header.magic, sightGraphJournalMagic, sizeof(header.magic)) == 0 && header.version == sightGraphJournalVersion &&
+                   header.sourceSize == sourceSize && header.sourceModifyTime == sourceModifyTime;
+        }
+
+        /**
+         * @brief Apply one entry to `data`, see `replayGraphJournal`.
+         */
+        void applyEntry(SightGraphBinaryWriter& data, std::span<const uint32_t> removedNodes, std::span<const uint32_t> removedConnections,
+                        SightGraphBinaryReader const& changes, uint32_t flags) {
+            absl::flat_hash_set<uint32_t> removed(removedNodes.begin(), removedNodes.end());
+            absl::flat_hash_set<uint32_t> replaced;
+            for (auto const& record : changes.nodes()) {
+                if (record.ownerKind == SightGraphBinaryOwner::None) {
+                    replaced.insert(record.id);
+                }
+            }
+            absl::flat_hash_set<uint32_t> dropConnections(removedConnections.begin(), removedConnections.end());
+            for (auto const& connection : changes.connections()) {
+                dropConnections.insert(connection.id);
+            }
+
+            // records to drop, and ports of removed nodes (not replaced ones), their connections are removed too.
+            absl::flat_hash_set<uint32_t> dropNodes;
+            absl::flat_hash_set<uint32_t> removedTree;
+            absl::flat_hash_set<uint32_t> removedPorts;
+            for (auto const& record : data.nodes) {
+                bool drop = false;
+                bool inRemovedTree = false;
+                if (record.ownerKind == SightGraphBinaryOwner::None) {
+                    inRemovedTree = removed.contains(record.id);
+                    drop = inRemovedTree || replaced.contains(record.id);
+                } else if (record.ownerKind == SightGraphBinaryOwner::Node) {
+                    inRemovedTree = removedTree.contains(record.ownerId);
+                    drop = dropNodes.contains(record.ownerId);
+                }
+                if (drop) {
+                    dropNodes.insert(record.id);
+                }
+                if (inRemovedTree) {
+                    removedTree.insert(record.id);
+                    for (auto const& port : data.portsOf(record)) {
+                        removedPorts.insert(port.id);
+                    }
+                }
+            }
+
+            for (auto const& connection : data.connections) {
+                if (removedPorts.contains(connection.left) || removedPorts.contains(connection.right)) {
+                    dropConnections.insert(connection.id);
+                }
+            }
+            // components of dropped connections
+            for (auto const& record : data.nodes) {
+                if ((record.ownerKind == SightGraphBinaryOwner::Connection && dropConnections.contains(record.ownerId)) ||
+                    (record.ownerKind == SightGraphBinaryOwner::Node && dropNodes.contains(record.ownerId))) {
+                    dropNodes.insert(record.id);
+                }
+            }
+
+            std::erase_if(data.nodes, [&dropNodes](SightGraphBinaryNode const& record) { return dropNodes.contains(record.id); });
+            std::erase_if(data.connections, [&dropConnections](SightGraphBinaryConnection const& connection) {
+                return dropConnections.contains(connection.id);
+            });
+
+            // ports of dropped records are left in `data.ports`, nothing refers to them.
+            for (auto const& record : changes.nodes()) {
+                copyNodeRecord(data, changes, record);
+            }
+            for (auto const& connection : changes.connections()) {
+                data.connections.push_back(connection);
+            }
+
+            if (flags & SightGraphJournalEntryFlags::Settings) {
+                data.settings.clear();
+                for (auto const& item : changes.settings()) {
+                    data.addSetting(changes.str(item.key), changes.str(item.value));
+                }
+                data.saveAsJsonHistory.clear();
+                for (auto const& item : changes.saveAsJsonHistory()) {
+                    data.saveAsJsonHistory.push_back(data.addString(changes.str(item)));
+                }
+            }
+        }
+
+    }
+
+    std::string graphJournalPath(std::string_view yamlPath) {
+        std::filesystem::path path(yamlPath);
+        auto filename = "." + path.filename().generic_string() + SIGHT_GRAPH_JOURNAL_EXT;
+        return path.replace_filename(filename).generic_string();
+    }
+
+    void hashGraphRecords(SightGraphBinaryWriter const& data, SightGraphRecordHashes& hashes) {
+        SnapshotGroups groups;
+        groupSnapshot(data, groups);
+        hashSnapshot(data, groups, hashes);
+    }
+
+    bool makeGraphJournalEntry(SightGraphJournalChanges const& changes, std::string& entry) {
+        auto const& data = changes.data;
+        if (!changes.settings && data.nodes.empty() && data.connections.empty() && changes.removedNodes.empty() &&
+            changes.removedConnections.empty()) {
+            return false;
+        }
+
+        std::string payload;
+        payload.append(reinterpret_cast<const char*>(changes.removedNodes.data()), changes.removedNodes.size() * sizeof(uint32_t));
+        payload.append(reinterpret_cast<const char*>(changes.removedConnections.data()), changes.removedConnections.size() * sizeof(uint32_t));
+        payload.resize((payload.size() + 7) & ~static_cast<size_t>(7), '\0');
+        payload.append(data.toBuffer());
+
+        SightGraphJournalEntry header;
+        header.size = static_cast<uint32_t>(payload.size());
+        header.flags = changes.settings ? SightGraphJournalEntryFlags::Settings : 0;
+        header.removedNodeCount = static_cast<uint32_t>(changes.removedNodes.size());
+        header.removedConnectionCount = static_cast<uint32_t>(changes.removedConnections.size());
+        header.checksum = checksumOf(payload);
+
+        entry.assign(reinterpret_cast<const char*>(&header), sizeof(header));
+        entry.append(payload);
+        return true;
+    }
+
+    int appendGraphJournal(std::string_view yamlPath, std::string_view entry) {
+        uint64_t sourceSize = 0;
+        int64_t sourceModifyTime = 0;
+        if (!graphSourceStamp(yamlPath, sourceSize, sourceModifyTime)) {
+            return CODE_FILE_ERROR;
+        }
+
+        auto path = graphJournalPath(yamlPath);
+        SightGraphJournalHeader header;
+        bool append = false;
+        {
+            std::ifstream fin{ path, std::ios::in | std::ios::binary };
+            char buf[sizeof(SightGraphJournalHeader)];
+            if (fin.is_open() && fin.read(buf, sizeof(buf))) {
+                append = isJournalOf({ buf, sizeof(buf) }, sourceSize, sourceModifyTime);
+            }
+        }
+
+        FILE* fp = fopen(path.c_str(), append ? "ab" : "wb");
+        if (!fp) {
+            return CODE_FILE_ERROR;
+        }
+        bool ok = true;
+        if (!append) {
+            std::memcpy(header.magic, sightGraphJournalMagic, sizeof(header.magic));
+            header.sourceSize = sourceSize;
+            header.sourceModifyTime = sourceModifyTime;
+            ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+        }
+        ok = ok && fwrite(entry.data(), 1, entry.size(), fp) == entry.size() && syncFile(fp);
+        ok = fclose(fp) == 0 && ok;
+        return ok ? CODE_OK : CODE_FILE_ERROR;
+    }
+
+    int replayGraphJournal(std::string_view yamlPath, SightGraphBinaryWriter& data, size_t* journalSize) {
+        if (journalSize) {
+            *journalSize = 0;
+        }
+        uint64_t sourceSize = 0;
+        int64_t sourceModifyTime = 0;
+        if (!graphSourceStamp(yamlPath, sourceSize, sourceModifyTime)) {
+            return 0;
+        }
+        auto path = graphJournalPath(yamlPath);
+        auto content = readWholeFile(path);
+        if (!isJournalOf(content, sourceSize, sourceModifyTime)) {
+            return 0;
+        }
+
+        int count = 0;
+        size_t offset = sizeof(SightGraphJournalHeader);
+        // records are read in place, so the binary graph is copied to 8 bytes aligned memory.
+        std::vector<uint64_t> aligned;
+        while (offset + sizeof(SightGraphJournalEntry) <= content.size()) {
+            SightGraphJournalEntry entry;
+            std::memcpy(&entry, content.data() + offset, sizeof(entry));
+            auto payloadOffset = offset + sizeof(entry);
+            if (entry.size > content.size() - payloadOffset) {
+                break;
+            }
+            std::string_view payload(content.data() + payloadOffset, entry.size);
+            if (checksumOf(payload) != entry.checksum) {
+                break;
+            }
+
+            auto idBytes = (static_cast<size_t>(entry.removedNodeCount) + entry.removedConnectionCount) * sizeof(uint32_t);
+            auto imageOffset = (idBytes + 7) & ~static_cast<size_t>(7);
+            if (imageOffset > payload.size()) {
+                break;
+            }
+            std::vector<uint32_t> ids(entry.removedNodeCount + entry.removedConnectionCount);
+            std::memcpy(ids.data(), payload.data(), idBytes);
+
+            auto image = payload.substr(imageOffset);
+            aligned.assign((image.size() + 7) / 8, 0);
+            std::memcpy(aligned.data(), image.data(), image.size());
+            SightGraphBinaryReader changes;
+            if (changes.openMemory(reinterpret_cast<const char*>(aligned.data()), image.size()) != CODE_OK) {
+                break;
+            }
+
+            std::span<const uint32_t> allIds(ids);
+            applyEntry(data, allIds.first(entry.removedNodeCount), allIds.subspan(entry.removedNodeCount), changes, entry.flags);
+            offset = payloadOffset + entry.size;
+            count++;
+        }
+
+        if (offset != content.size()) {
+            logWarning("journal $0 is broken after $1 entries, the rest is dropped.", path, count);
+            // later entries are appended after the last good one, not after the torn tail.
+            std::error_code ec;
+            std::filesystem::resize_file(path, offset, ec);
+            if (ec) {
+                logError("truncate journal $0 failed: $1", path, ec.message());
+            }
+        }
+        if (journalSize) {
+            *journalSize = offset;
+        }
+        return count;
+    }
+
+    bool hasGraphJournal(std::string_view yamlPath) {
+        uint64_t sourceSize = 0;
+        int64_t sourceModifyTime = 0;
+        if (!graphSourceStamp(yamlPath, sourceSize, sourceModifyTime)) {
+            return false;
+        }
+
+        auto path = graphJournalPath(yamlPath);
+        std::ifstream fin{ path, std::ios::in | std::ios::binary };
+        char buf[sizeof(SightGraphJournalHeader) + sizeof(SightGraphJournalEntry)];
+        if (!fin.is_open() || !fin.read(buf, sizeof(buf))) {
+            // no entry
+            return false;
+        }
+        return isJournalOf({ buf, sizeof(buf) }, sourceSize, sourceModifyTime);
+    }
+
+    void removeGraphJournal(std::string_view yamlPath) {
+        std::error_code ec;
+        std::filesystem::remove(graphJournalPath(yamlPath), ec);
+    }
+
+}
@@ -0,0 +1,212 @@
+#include "sight_graph_saver.h"
+
+#include "sight_defines.h"
+#include "sight_graph_journal.h"
+#include "sight_log.h"
+#include "sight_util.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "absl/container/flat_hash_set.h"
+
+namespace sight {
+
+    namespace {
+
+        struct SaveTask {
+            std::string path;
+            std::string cachePath;
+            SightGraphBinaryWriter data;
+            SaveReason saveReason = SaveReason::Automatic;
+            // not empty: append it to the journal of `path`, instead of writing `data`.
+            std::string journalEntry;
+        };
+
+        struct GraphSaver {
+            std::mutex mutex;
+            // a task is added, or the thread should stop.
+            std::condition_variable taskCond;
+            // a task is done.
+            std::condition_variable doneCond;
+
+            std::deque<SaveTask> tasks;
+            // path of the task which is being written.
+            std::string savingPath;
+            bool saving = false;
+            bool stop = false;
+            std::thread thread;
+
+            uint saved = 0;
+            uint coalesced = 0;
+            std::string lastError;
+            absl::flat_hash_set<std::string> failedPaths;
+
+            bool hasTask(std::string_view path) const {
+                return (saving && savingPath == path) ||
+                       std::any_of(tasks.begin(), tasks.end(), [path](SaveTask const& task) { return task.path == path; });
+            }
+        };
+
+        /**
+         * @brief The only accessor of the saver, safe from any thread.
+         * Never freed, so the thread is not destroyed with static objects while it is running.
+         */
+        GraphSaver& graphSaver() {
+            static auto saver = new GraphSaver();
+            return *saver;
+        }
+
+        void saveThreadRun() {
+            auto& saver = graphSaver();
+            std::unique_lock<std::mutex> lock(saver.mutex);
+            while (true) {
+                saver.taskCond.wait(lock, [&saver]() { return saver.stop || !saver.tasks.empty(); });
+                if (saver.tasks.empty()) {
+                    // stop, and all tasks are done.
+                    break;
+                }
+
+                SaveTask task = std::move(saver.tasks.front());
+                saver.tasks.pop_front();
+                saver.saving = true;
+                saver.savingPath = task.path;
+                lock.unlock();
+
+                int status = task.journalEntry.empty() ? writeGraphSnapshot(task.path, task.cachePath, task.data)
+                                                       : appendGraphJournal(task.path, task.journalEntry);
+                if (status == CODE_OK && task.saveReason == SaveReason::User) {
+                    logDebug("save over to: $0", task.path);
+                }
+
+                lock.lock();
+                saver.saving = false;
+                saver.savingPath.clear();
+                if (status == CODE_OK) {
+                    saver.saved++;
+                    saver.failedPaths.erase(task.path);
+                } else {
+                    saver.lastError = "save " + task.path + " failed: " + std::to_string(status);
+                    saver.failedPaths.insert(task.path);
+                }
+                saver.doneCond.notify_all();
+            }
+        }
+
+    }
+
+    int writeGraphSnapshot(std::string_view path, std::string_view cachePath, SightGraphBinaryWriter& data) {
+        if (endsWith(std::string(path), SIGHT_GRAPH_BINARY_EXT)) {
+            return data.writeTo(path);
+        }
+
+        int status = writeGraphYaml(data, path);
+        if (status != CODE_OK) {
+            return status;
+        }
+        // the yaml file has all changes now.
+        removeGraphJournal(path);
+        if (!cachePath.empty()) {
+            // the cache is checked against the yaml file which is just written.
+            graphSourceStamp(path, data.sourceSize, data.sourceModifyTime);
+            std::error_code ec;
+            std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), ec);
+            if (data.writeTo(cachePath) != CODE_OK) {
+                logWarning("write binary cache of $0 failed", path);
+            }
+        }
+        return CODE_OK;
+    }
+
+    void queueGraphSave(std::string_view path, std::string_view cachePath, SightGraphBinaryWriter&& data, SaveReason saveReason) {
+        auto& saver = graphSaver();
+
+        std::unique_lock<std::mutex> lock(saver.mutex);
+        // journal entries before it must be kept in order, so only the last task can be replaced.
+        auto iter = std::find_if(saver.tasks.rbegin(), saver.tasks.rend(), [path](SaveTask const& task) { return task.path == path; });
+        if (iter != saver.tasks.rend() && iter->journalEntry.empty()) {
+            // only the newest snapshot matters.
+            iter->cachePath = cachePath;
+            iter->data = std::move(data);
+            if (saveReason == SaveReason::User) {
+                iter->saveReason = saveReason;
+            }
+            saver.coalesced++;
+        } else {
+            saver.tasks.push_back({ std::string(path), std::string(cachePath), std::move(data), saveReason });
+        }
+
+        if (!saver.thread.joinable()) {
+            saver.stop = false;
+            saver.thread = std::thread(saveThreadRun);
+        }
+        lock.unlock();
+        saver.taskCond.notify_one();
+    }
+
+    void queueGraphJournal(std::string_view path, std::string&& entry) {
+        auto& saver = graphSaver();
+
+        std::unique_lock<std::mutex> lock(saver.mutex);
+        SaveTask task;
+        task.path = path;
+        task.journalEntry = std::move(entry);
+        saver.tasks.push_back(std::move(task));
+
+        if (!saver.thread.joinable()) {
+            saver.stop = false;
+            saver.thread = std::thread(saveThreadRun);
+        }
+        lock.unlock();
+        saver.taskCond.notify_one();
+    }
+
+    bool isGraphSaving(std::string_view path) {
+        auto& saver = graphSaver();
+        std::lock_guard<std::mutex> lock(saver.mutex);
+        return saver.hasTask(path);
+    }
+
+    void waitGraphSave(std::string_view path) {
+        auto& saver = graphSaver();
+        std::unique_lock<std::mutex> lock(saver.mutex);
+        saver.doneCond.wait(lock, [&saver, path]() { return !saver.hasTask(path); });
+    }
+
+    bool takeGraphSaveFailure(std::string_view path) {
+        auto& saver = graphSaver();
+        std::lock_guard<std::mutex> lock(saver.mutex);
+        return saver.failedPaths.erase(path) > 0;
+    }
+
+    SightGraphSaveStatus getGraphSaveStatus() {
+        SightGraphSaveStatus status;
+        auto& saver = graphSaver();
+        std::lock_guard<std::mutex> lock(saver.mutex);
+        status.saving = saver.saving;
+        status.pending = static_cast<int>(saver.tasks.size());
+        status.saved = saver.saved;
+        status.coalesced = saver.coalesced;
+        status.lastError = saver.lastError;
+        return status;
+    }
+
+    void stopGraphSaveThread() {
+        auto& saver = graphSaver();
+        {
+            std::lock_guard<std::mutex> lock(saver.mutex);
+            saver.stop = true;
+        }
+        saver.taskCond.notify_one();
+        if (saver.thread.joinable()) {
+            saver.thread.join();
+        }
+    }
+
+}
@@ -0,0 +1,608 @@
+#include "sight_graph_yaml.h"
+
+#include "sight.h"
+#include "sight_defines.h"
+#include "sight_node.h"
+
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "yaml-cpp/eventhandler.h"
+#include "yaml-cpp/exceptions.h"
+#include "yaml-cpp/mark.h"
+#include "yaml-cpp/parser.h"
+
+namespace sight {
+
+    namespace {
+
+        /**
+         * @brief Thrown by handlers to stop the parser.
+         */
+        struct ReadAbort {
+            int code = CODE_FAIL;
+            std::string message;
+        };
+
+        std::string positionOf(YAML::Mark const& mark) {
+            return "line " + std::to_string(mark.line + 1) + ", column " + std::to_string(mark.column + 1);
+        }
+
+        [[noreturn]] void formatError(YAML::Mark const& mark, std::string_view msg) {
+            throw ReadAbort{ CODE_FILE_FORMAT_ERROR, positionOf(mark) + ": " + std::string(msg) };
+        }
+
+        template<class T>
+        T parseInt(YAML::Mark const& mark, std::string_view value) {
+            T result = 0;
+            if (!absl::SimpleAtoi(value, &result)) {
+                formatError(mark, "bad integer `" + std::string(value) + "`");
+            }
+            return result;
+        }
+
+        float parseFloat(YAML::Mark const& mark, std::string_view value) {
+            float result = 0;
+            if (!absl::SimpleAtof(value, &result)) {
+                formatError(mark, "bad number `" + std::string(value) + "`");
+            }
+            return result;
+        }
+
+        /**
+         * @brief Same words as yaml-cpp's `as<bool>()`.
+         */
+        bool parseBool(YAML::Mark const& mark, std::string_view value) {
+            auto lower = absl::AsciiStrToLower(value);
+            if (lower == "true" || lower == "yes" || lower == "on" || lower == "y") {
+                return true;
+            }
+            if (lower == "false" || lower == "no" || lower == "off" || lower == "n") {
+                return false;
+            }
+            formatError(mark, "bad bool `" + std::string(value) + "`");
+        }
+
+        enum class Scope {
+            Root,
+            Nodes,
+            // a node or a component
+            Node,
+            Position,
+            Ports,
+            Port,
+            PortValue,
+            PortOptions,
+            Components,
+            Connections,
+            Connection,
+            Settings,
+            History,
+            // unknown keys, all children are ignored.
+            Skip,
+        };
+
+        struct Frame {
+            Scope scope = Scope::Skip;
+            bool isMap = true;
+
+            // map only, the key of current value.
+            std::string key;
+            YAML::Mark keyMark;
+            bool hasKey = false;
+            // sequence only, index of current item.
+            int index = 0;
+
+            // Ports only
+            NodePortType portKind = NodePortType::Input;
+            // Components only
+            SightGraphBinaryOwner ownerKind = SightGraphBinaryOwner::None;
+        };
+
+        struct NodeState {
+            SightGraphBinaryNode record;
+            int line = 0;
+            std::vector<SightGraphBinaryPort> ports;
+
+            // finished components, and their components.
+            std::vector<SightGraphBinaryNode> components;
+            std::vector<int> componentLines;
+            // index of components which are owned by this node, their owner id is set when this node ends.
+            std::vector<size_t> ownComponents;
+        };
+
+        class GraphYamlHandler : public YAML::EventHandler {
+        public:
+            GraphYamlHandler(SightGraphBinaryWriter& data, SightGraphYamlCallbacks const& callbacks)
+                : data(data)
+                , callbacks(callbacks) {}
+
+            void OnDocumentStart(const YAML::Mark& mark) override {}
+
+            void OnDocumentEnd() override {}
+
+            void OnNull(const YAML::Mark& mark, YAML::anchor_t anchor) override {
+                if (frames.empty()) {
+                    // empty file
+                    return;
+                }
+                onScalar(mark, nullptr);
+            }
+
+            void OnAlias(const YAML::Mark& mark, YAML::anchor_t anchor) override {
+                formatError(mark, "alias is not supported");
+            }
+
+            void OnScalar(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, const std::string& value) override {
+                if (frames.empty()) {
+                    formatError(mark, "a graph must be a map");
+                }
+                onScalar(mark, &value);
+            }
+
+            void OnSequenceStart(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, YAML::EmitterStyle::value style) override {
+                if (frames.empty()) {
+                    formatError(mark, "a graph must be a map");
+                }
+                onCollectionStart(mark, false);
+            }
+
+            void OnSequenceEnd() override {
+                onCollectionEnd();
+            }
+
+            void OnMapStart(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, YAML::EmitterStyle::value style) override {
+                if (frames.empty()) {
+                    frames.push_back({ .scope = Scope::Root });
+                    return;
+                }
+                onCollectionStart(mark, true);
+            }
+
+            void OnMapEnd() override {
+                onCollectionEnd();
+            }
+
+        private:
+            SightGraphBinaryWriter& data;
+            SightGraphYamlCallbacks const& callbacks;
+
+            std::vector<Frame> frames;
+            std::vector<NodeState> nodeStack;
+
+            SightGraphBinaryPort port;
+            float portFloats[4] = { 0 };
+            uint32_t portFloatCount = 0;
+
+            SightGraphBinaryConnection connection;
+            int connectionLine = 0;
+            std::vector<SightGraphBinaryNode> connectionComponents;
+            std::vector<int> connectionComponentLines;
+
+            static void check(int status) {
+                if (status != CODE_OK) {
+                    throw ReadAbort{ status, {} };
+                }
+            }
+
+            void nextValue(Frame& frame) {
+                if (frame.isMap) {
+                    frame.hasKey = false;
+                } else {
+                    frame.index++;
+                }
+            }
+
+            void onScalar(YAML::Mark const& mark, const std::string* value) {
+                auto& frame = frames.back();
+                if (frame.isMap && !frame.hasKey) {
+                    frame.key = value ? *value : std::string();
+                    frame.keyMark = mark;
+                    frame.hasKey = true;
+                    return;
+                }
+
+                scalarValue(frame, mark, value);
+                nextValue(frame);
+            }
+
+            void onCollectionStart(YAML::Mark const& mark, bool isMap) {
+                auto& parent = frames.back();
+                if (parent.isMap && !parent.hasKey) {
+                    formatError(mark, "complex key is not supported");
+                }
+
+                Frame child = childOf(parent, mark, isMap);
+                frames.push_back(std::move(child));
+            }
+
+            void onCollectionEnd() {
+                Frame frame = std::move(frames.back());
+                frames.pop_back();
+
+                switch (frame.scope) {
+                case Scope::Node:
+                    endNode();
+                    break;
+                case Scope::Port:
+                    nodeStack.back().ports.push_back(port);
+                    break;
+                case Scope::PortValue:
+                    port.valueKind = SightGraphBinaryValueKind::Floats;
+                    port.value.floats = { data.addFloats(portFloats, portFloatCount), portFloatCount };
+                    break;
+                case Scope::Connection:
+                    endConnection();
+                    break;
+                default:
+                    break;
+                }
+
+                if (!frames.empty()) {
+                    nextValue(frames.back());
+                }
+            }
+
+            Frame childOf(Frame const& parent, YAML::Mark const& mark, bool isMap) {
+                Frame child;
+                child.isMap = isMap;
+                auto const& key = parent.key;
+
+                switch (parent.scope) {
+                case Scope::Root:
+                    if (isMap && key == "nodes") {
+                        child.scope = Scope::Nodes;
+                    } else if (isMap && key == "connections") {
+                        child.scope = Scope::Connections;
+                    } else if (isMap && key == "settings") {
+                        child.scope = Scope::Settings;
+                    } else if (!isMap && key == "saveAsJsonHistory") {
+                        child.scope = Scope::History;
+                    }
+                    break;
+                case Scope::Nodes:
+                    if (isMap) {
+                        child.scope = Scope::Node;
+                        beginNode(mark, SightGraphBinaryOwner::None);
+                    }
+                    break;
+                case Scope::Components:
+                    if (isMap) {
+                        child.scope = Scope::Node;
+                        beginNode(mark, parent.ownerKind);
+                    }
+                    break;
+                case Scope::Node:
+                    if (key == "position") {
+                        nodeStack.back().record.hasPosition = 1;
+                        if (!isMap) {
+                            child.scope = Scope::Position;
+                        }
+                    } else if (isMap && (key == "inputs" || key == "outputs" || key == "fields")) {
+                        child.scope = Scope::Ports;
+                        child.portKind = key == "inputs" ? NodePortType::Input : (key == "outputs" ? NodePortType::Output : NodePortType::Field);
+                    } else if (isMap && key == "components") {
+                        child.scope = Scope::Components;
+                        child.ownerKind = SightGraphBinaryOwner::Node;
+                    }
+                    break;
+                case Scope::Ports:
+                    if (isMap) {
+                        child.scope = Scope::Port;
+                        port = {};
+                        port.id = parseInt<uint32_t>(parent.keyMark, key);
+                        port.kind = static_cast<uint8_t>(static_cast<int>(parent.portKind) - static_cast<int>(NodePortType::Input));
+                    }
+                    break;
+                case Scope::Port:
+                    if (isMap && key == "options") {
+                        child.scope = Scope::PortOptions;
+                    } else if (!isMap && key == "value") {
+                        child.scope = Scope::PortValue;
+                        portFloatCount = 0;
+                    }
+                    break;
+                case Scope::Connections:
+                    if (isMap) {
+                        child.scope = Scope::Connection;
+                        connection = {};
+                        connection.id = parseInt<uint32_t>(parent.keyMark, key);
+                        connectionLine = mark.line + 1;
+                        connectionComponents.clear();
+                        connectionComponentLines.clear();
+                    }
+                    break;
+                case Scope::Connection:
+                    if (isMap && key == "components") {
+                        child.scope = Scope::Components;
+                        child.ownerKind = SightGraphBinaryOwner::Connection;
+                    }
+                    break;
+                default:
+                    break;
+                }
+                return child;
+            }
+
+            void scalarValue(Frame const& frame, YAML::Mark const& mark, const std::string* value) {
+                std::string_view text = value ? std::string_view(*value) : std::string_view();
+                auto const& key = frame.key;
+
+                switch (frame.scope) {
+                case Scope::Root:
+                    if (key == whoAmI && callbacks.onWhoAmI) {
+                        check(callbacks.onWhoAmI(text));
+                    }
+                    break;
+                case Scope::Node:
+                {
+                    auto& record = nodeStack.back().record;
+                    if (key == "name") {
+                        record.name = data.addString(text);
+                    } else if (key == "id") {
+                        record.id = value ? parseInt<uint32_t>(mark, text) : 0;
+                    } else if (key == "template") {
+                        record.templateAddress = data.addString(text);
+                    } else if (key == "position") {
+                        record.hasPosition = 1;
+                    }
+                    break;
+                }
+                case Scope::Position:
+                    if (value && frame.index < 2) {
+                        auto& record = nodeStack.back().record;
+                        (frame.index == 0 ? record.positionX : record.positionY) = parseFloat(mark, text);
+                    }
+                    break;
+                case Scope::Port:
+                    if (key == "name") {
+                        port.name = data.addString(text);
+                    } else if (key == "type") {
+                        port.type = value ? parseInt<uint32_t>(mark, text) : 0;
+                    } else if (key == "parent") {
+                        port.parent = value ? parseInt<uint32_t>(mark, text) : 0;
+                    } else if (key == "value") {
+                        if (value) {
+                            port.valueKind = SightGraphBinaryValueKind::String;
+                            port.value.string = data.addString(text);
+                        } else {
+                            port.valueKind = SightGraphBinaryValueKind::None;
+                        }
+                    }
+                    break;
+                case Scope::PortValue:
+                    if (frame.index < static_cast<int>(std::size(portFloats))) {
+                        portFloats[frame.index] = value ? parseFloat(mark, text) : 0;
+                        portFloatCount = frame.index + 1;
+                    }
+                    break;
+                case Scope::PortOptions:
+                    if (key == "customPortName") {
+                        port.customPortName = data.addString(text);
+                    } else if (key == "dynamicPort") {
+                        port.dynamicPort = value && parseBool(mark, text) ? 1 : 0;
+                    }
+                    break;
+                case Scope::Connection:
+                    if (!value) {
+                        break;
+                    }
+                    if (key == "left") {
+                        connection.left = parseInt<uint32_t>(mark, text);
+                    } else if (key == "right") {
+                        connection.right = parseInt<uint32_t>(mark, text);
+                    } else if (key == "priority") {
+                        connection.priority = parseInt<int32_t>(mark, text);
+                    } else if (key == "generateCode") {
+                        connection.generateCode = parseBool(mark, text) ? 1 : 0;
+                    }
+                    break;
+                case Scope::Settings:
+                    if (callbacks.onSetting) {
+                        callbacks.onSetting(key, text);
+                    }
+                    break;
+                case Scope::History:
+                    if (value && callbacks.onSaveAsJsonHistory) {
+                        callbacks.onSaveAsJsonHistory(text);
+                    }
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            void beginNode(YAML::Mark const& mark, SightGraphBinaryOwner ownerKind) {
+                auto& state = nodeStack.emplace_back();
+                state.line = mark.line + 1;
+                state.record.ownerKind = ownerKind;
+                state.record.hasPosition = 0;
+                if (ownerKind == SightGraphBinaryOwner::Connection) {
+                    state.record.ownerId = connection.id;
+                }
+            }
+
+            void endNode() {
+                NodeState state = std::move(nodeStack.back());
+                nodeStack.pop_back();
+
+                auto& record = state.record;
+                record.firstPort = static_cast<uint32_t>(data.ports.size());
+                record.portCount = static_cast<uint32_t>(state.ports.size());
+                data.ports.insert(data.ports.end(), state.ports.begin(), state.ports.end());
+                for (auto index : state.ownComponents) {
+                    state.components[index].ownerId = record.id;
+                }
+
+                auto moveTo = [&state](std::vector<SightGraphBinaryNode>& list, std::vector<int>& lines) {
+                    list.push_back(state.record);
+                    lines.push_back(state.line);
+                    list.insert(list.end(), state.components.begin(), state.components.end());
+                    lines.insert(lines.end(), state.componentLines.begin(), state.componentLines.end());
+                };
+
+                switch (record.ownerKind) {
+                case SightGraphBinaryOwner::None:
+                {
+                    auto first = data.nodes.size();
+                    std::vector<int> lines;
+                    moveTo(data.nodes, lines);
+                    reportNodes(first, lines);
+                    break;
+                }
+                case SightGraphBinaryOwner::Node:
+                {
+                    auto& owner = nodeStack.back();
+                    owner.ownComponents.push_back(owner.components.size());
+                    moveTo(owner.components, owner.componentLines);
+                    break;
+                }
+                case SightGraphBinaryOwner::Connection:
+                    moveTo(connectionComponents, connectionComponentLines);
+                    break;
+                }
+            }
+
+            void endConnection() {
+                data.connections.push_back(connection);
+                if (callbacks.onConnection) {
+                    check(callbacks.onConnection(connection, connectionLine));
+                }
+
+                auto first = data.nodes.size();
+                data.nodes.insert(data.nodes.end(), connectionComponents.begin(), connectionComponents.end());
+                reportNodes(first, connectionComponentLines);
+            }
+
+            /**
+             * @brief Report `data.nodes[first, ...)`, then drop records if they are not kept.
+             */
+            void reportNodes(size_t first, std::vector<int> const& lines) {
+                if (callbacks.onNode) {
+                    for (size_t i = first; i < data.nodes.size(); i++) {
+                        check(callbacks.onNode(data, data.nodes[i], lines[i - first]));
+                    }
+                }
+                if (!callbacks.keepRecords) {
+                    data.clear();
+                }
+            }
+        };
+
+        /**
+         * @brief Find `who-am-i` of the root map, and stop.
+         */
+        class WhoAmIHandler : public YAML::EventHandler {
+        public:
+            struct Found {};
+
+            std::string result;
+
+            void OnDocumentStart(const YAML::Mark& mark) override {}
+
+            void OnDocumentEnd() override {}
+
+            void OnNull(const YAML::Mark& mark, YAML::anchor_t anchor) override {
+                onScalar({});
+            }
+
+            void OnAlias(const YAML::Mark& mark, YAML::anchor_t anchor) override {
+                onScalar({});
+            }
+
+            void OnScalar(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, const std::string& value) override {
+                onScalar(value);
+            }
+
+            void OnSequenceStart(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, YAML::EmitterStyle::value style) override {
+                if (depth == 0) {
+                    // not a map
+                    throw Found{};
+                }
+                depth++;
+            }
+
+            void OnSequenceEnd() override {
+                onCollectionEnd();
+            }
+
+            void OnMapStart(const YAML::Mark& mark, const std::string& tag, YAML::anchor_t anchor, YAML::EmitterStyle::value style) override {
+                depth++;
+            }
+
+            void OnMapEnd() override {
+                onCollectionEnd();
+            }
+
+        private:
+            int depth = 0;
+            bool isKey = true;
+            bool matched = false;
+
+            void onScalar(std::string_view value) {
+                if (depth != 1) {
+                    return;
+                }
+                if (isKey) {
+                    matched = value == whoAmI;
+                } else if (matched) {
+                    result = value;
+                    throw Found{};
+                }
+                isKey = !isKey;
+            }
+
+            void onCollectionEnd() {
+                depth--;
+                if (depth == 1) {
+                    // a collection is a key or a value of the root map.
+                    matched = false;
+                    isKey = !isKey;
+                }
+            }
+        };
+
+    }
+
+    int readGraphYaml(std::istream& in, SightGraphBinaryWriter& data, SightGraphYamlCallbacks const& callbacks, std::string* errorMessage) {
+        GraphYamlHandler handler(data, callbacks);
+        try {
+            YAML::Parser parser(in);
+            parser.HandleNextDocument(handler);
+        } catch (const ReadAbort& e) {
+            if (errorMessage) {
+                *errorMessage = e.message;
+            }
+            return e.code;
+        } catch (const YAML::ParserException& e) {
+            if (errorMessage) {
+                *errorMessage = positionOf(e.mark) + ": " + e.msg;
+            }
+            return CODE_FILE_FORMAT_ERROR;
+        }
+        return CODE_OK;
+    }
+
+    std::string readYamlWhoAmI(std::string_view path) {
+        std::ifstream fin{ std::string(path) };
+        if (!fin.is_open()) {
+            return {};
+        }
+
+        WhoAmIHandler handler;
+        try {
+            YAML::Parser parser(fin);
+            parser.HandleNextDocument(handler);
+        } catch (const WhoAmIHandler::Found&) {
+            return handler.result;
+        } catch (const YAML::Exception&) {
+            return {};
+        }
+        return {};
+    }
+
+}
@@ -34,6 +34,9 @@
 #include "sight_plugin.h"
 #include "sight_code_set.h"
 #include "sight_node_graph.h"
+#include "sight_runtime_graph.h"
+#include "sight_graph_binary.h"
+#include "sight_graph_journal.h"
 
 #include "v8.h"
 #include "libplatform/libplatform.h"
@@ -46,6 +49,8 @@
 #include "v8pp/property.hpp"
 #include "v8pp/object.hpp"
 #include "v8pp/json.hpp"
+#include "absl/container/btree_set.h"
+#include "absl/strings/str_split.h"
 
 #ifdef __linux__
 #define isnumber isdigit
@@ -71,10 +76,15 @@ namespace sight {
 }
 static sight::V8Runtime *g_V8Runtime = nullptr;
 
+// set by the main thread when the project is opened, the js thread reads the project after it.
+static std::promise<void> g_ProjectOpened;
+// set by the js thread when `g_V8Runtime` is created, the main thread reads `g_V8Runtime` after it.
+static std::promise<void> g_JsEngineReady;
+
 // cache for js script, it will send to ui thread once
-static std::vector<sight::SightNode> g_NodeCache;
-//
-static std::vector<sight::SightNodeTemplateAddress> g_TemplateNodeCache;
+static sight::JsNodeBatch g_NodeBatch;
+// updated by ui thread
+static sight::JsNodeBatchStats g_NodeBatchStats;
 
 namespace sight {
 
@@ -276,7 +286,14 @@ namespace sight {
             return getPortValue(isolate, port->getType(), port->value);
         };
         auto set = [portHandle, isolate](Local<Value> arg) {
-            return setPortValue(isolate, portHandle.get(), arg);
+            auto port = portHandle.get();
+            if (!setPortValue(isolate, port, arg)) {
+                return false;
+            }
+            if (port->node && port->node->graph) {
+                port->node->graph->markDirty(port->getId());
+            }
+            return true;
         };
 
         object->Set(context, v8pp::to_v8(isolate, "get"), v8pp::wrap_function(isolate, "get", get)).ToChecked();
@@ -1056,7 +1073,7 @@ namespace sight {
         }
 
         void v8AddNode(SightNode const& node) {
-            g_NodeCache.push_back(node);
+            g_NodeBatch.nodes.push_back(node);
         }
 
         void v8AddTemplateNode(const FunctionCallbackInfo<Value> &args) {
@@ -1113,25 +1130,25 @@ namespace sight {
 
                     temp = option->Get(context, v8pp::to_v8(isolate, "showValue"));
                     if (!temp.IsEmpty() && ((tempVal = temp.ToLocalChecked())->IsBoolean())) {
-                        port.options.showValue = v8pp::from_v8<bool>(isolate, tempVal);
+                        port.options.edit().showValue = v8pp::from_v8<bool>(isolate, tempVal);
                     }
 
                     temp = option->Get(context, v8pp::to_v8(isolate, "show"));
                     if (!temp.IsEmpty() && ((tempVal = temp.ToLocalChecked())->IsBoolean())) {
-                        port.options.show = v8pp::from_v8<bool>(isolate, tempVal);
+                        port.options.edit().show = v8pp::from_v8<bool>(isolate, tempVal);
                     }
 
                     temp = option->Get(context, v8pp::to_v8(isolate, "typeList"));
                     if (!temp.IsEmpty() && ((tempVal = temp.ToLocalChecked())->IsBoolean())) {
-                        port.options.typeList = v8pp::from_v8<bool>(isolate, tempVal);
+                        port.options.edit().typeList = v8pp::from_v8<bool>(isolate, tempVal);
                     }
 
                     temp = option->Get(context, v8pp::to_v8(isolate, "dynamic"));
                     if (!temp.IsEmpty() && ((tempVal = temp.ToLocalChecked())->IsBoolean())) {
-                        port.options.dynamic = v8pp::from_v8<bool>(isolate, tempVal);
+                        port.options.edit().dynamic = v8pp::from_v8<bool>(isolate, tempVal);
                     }
 
-                    if(port.options.dynamic && nodePortType != NodePortType::Output) {
+                    if(port.options->dynamic && nodePortType != NodePortType::Output) {
                         logDebug("portName $0, it's nodePortType is $1, it cannot be dynamic, ignore.", portName, nodePortType);
                     }
 
@@ -1352,6 +1369,19 @@ namespace sight {
                 }
             }
 
+            // the functions are new objects every time, the ui thread compares the sources instead.
+            auto appendSource = [isolate, &context, templateNode](ScriptFunctionWrapper::Function const& f) {
+                if (!f.IsEmpty()) {
+                    templateNode->functionsSource += functionProtoToString(isolate, context, f.Get(isolate));
+                }
+                templateNode->functionsSource += '\n';
+            };
+            appendSource(templateNode->generateCodeWork);
+            appendSource(templateNode->onReverseActive);
+            appendSource(templateNode->component.beforeGenerate.function);
+            appendSource(templateNode->component.afterGenerate.function);
+            appendSource(templateNode->component.appendDataToOutput.function);
+
             // check name
             if (!endsWith(address, templateNode->nodeName)) {
                 if (!endsWith(address, "/")) {
@@ -1360,7 +1390,7 @@ namespace sight {
                 address += templateNode->nodeName;
             }
 
-            g_TemplateNodeCache.emplace_back(
+            g_NodeBatch.templateNodes.emplace_back(
                 address,
                 sightNode
             );
@@ -1466,9 +1496,11 @@ namespace sight {
                 return rValue.SetUndefined();
             }
 
-            auto c = selfPort->connections[0];
-            SightNodePortConnection connection(node->graph, c, node);
-            auto targetNode = connection.target->node;
+            auto edges = node->graph->getAdjacency().edgesOf(*selfPort);
+            if (edges.empty()) {
+                return rValue.SetUndefined();
+            }
+            auto targetNode = edges.front().target->node;
             if (!targetAddressOrName.empty()) {
                 if (!targetNode->templateNode) {
                     return rValue.SetUndefined();
@@ -1539,7 +1571,8 @@ namespace sight {
             }
 
             auto p = currentProject();
-            int code = g->outputJson(filepath, true, *( p->getGraphOutputJsonConfig() ));
+            auto const& config = *( p->getGraphOutputJsonConfig() );
+            int code = endsWith(std::string(filepath), SIGHT_RUNTIME_GRAPH_EXT) ? g->outputRuntimeGraph(filepath, true, config) : g->outputJson(filepath, true, config);
             logDebug("output json result: $0", code);
         }
 
@@ -1675,7 +1708,7 @@ namespace sight {
             .property("node", &SightNodePort::getNode)
             .function("nodeId", &SightNodePort::getNodeId)
             .function("setKind", &SightNodePort::setKind)
-            .var("options", &SightNodePort::options);
+            .property("options", &SightNodePort::getOptions);
         nodePortClass.auto_wrap_objects(true);
         module.class_("SightNodePort", nodePortClass);
 
@@ -1726,7 +1759,7 @@ namespace sight {
         // connection class
         v8pp::class_<SightNodeConnection> connectionClass(isolate);
         connectionClass.ctor<>()
-            .var("priority", &SightNodeConnection::priority)
+            .property("priority", &SightNodeConnection::getPriority, &SightNodeConnection::setPriority)
             .var("connectionId", &SightNodeConnection::connectionId)
             .var("id", &SightNodeConnection::connectionId)
             .var("left", &SightNodeConnection::left)
@@ -1806,6 +1839,7 @@ namespace sight {
             if (iter != map.end()) {
                 logWarning("replace code template: $0. New description: $1", name, desc);
                 iter->second = {lang, name, desc, callback};
+                addUICommand(UICommandType::CodeTemplateChanged, strdup(name), 0, true);
             } else {
                 map[name] = { lang, name, desc, callback };
             }
@@ -1948,34 +1982,34 @@ namespace sight {
         }
     }
 
-    void flushJsNodeCache(std::promise<int>* promise /*= nullptr */){
-        // send nodes to ui thread.
-        if (!g_NodeCache.empty()) {
-            auto size = g_NodeCache.size();
-            auto *nodePointer = (SightNode **) malloc(size * sizeof(void *));
-            int index = 0;
-            for (const auto &item : g_NodeCache) {
-                // copy item to array
-                nodePointer[index++] = item.clone();
-            }
-            g_NodeCache.clear();
-
-            // pluginManager()->getPluginStatus().addNodesFinished = false;
-            addUICommand(UICommandType::AddNode, nodePointer, size);
-        }
+    bool JsNodeBatch::empty() const {
+        return nodes.empty() && templateNodes.empty();
+    }
 
-        if (!g_TemplateNodeCache.empty()) {
-            auto size = g_TemplateNodeCache.size();
-            auto *pointer = (SightNodeTemplateAddress **) malloc(size * sizeof(void *));
-            int index = 0;
+    void recordJsNodeBatch(JsNodeBatch const& batch) {
+        auto& stats = g_NodeBatchStats;
+        auto latencyMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - batch.sendTime).count();
+        stats.batchCount++;
+        stats.nodeCount += batch.nodes.size();
+        stats.templateNodeCount += batch.templateNodes.size();
+        stats.maxBatchSize = std::max(stats.maxBatchSize, batch.nodes.size() + batch.templateNodes.size());
+        stats.lastLatencyMs = latencyMs;
+        stats.maxLatencyMs = std::max(stats.maxLatencyMs, latencyMs);
+        stats.totalLatencyMs += latencyMs;
+        logDebug("node batch applied, nodes: $0, template nodes: $1, latency(ms): $2", batch.nodes.size(), batch.templateNodes.size(), latencyMs);
+    }
 
-            for (const auto &item : g_TemplateNodeCache) {
-                pointer[index++] = new SightNodeTemplateAddress(item.name, item.templateNode);
-            }
-            g_TemplateNodeCache.clear();
+    JsNodeBatchStats const& getJsNodeBatchStats() {
+        return g_NodeBatchStats;
+    }
 
-            // pluginManager()->getPluginStatus().addTemplateNodesFinished = false;
-            addUICommand(UICommandType::AddTemplateNode, pointer, size);
+    void flushJsNodeCache(std::promise<int>* promise /*= nullptr */){
+        // send nodes to ui thread, the vectors are moved, nodes are not copied.
+        if (!g_NodeBatch.empty()) {
+            auto batch = new JsNodeBatch(std::move(g_NodeBatch));
+            g_NodeBatch = JsNodeBatch();
+            batch->sendTime = std::chrono::steady_clock::now();
+            addUICommand(UICommandType::AddNodeBatch, batch, 0, false);
         }
 
         if (promise) {
@@ -1986,8 +2020,10 @@ namespace sight {
     }
 
     void clearJsNodeCache(){
-        g_NodeCache.clear();
-        g_TemplateNodeCache.clear();
+        for (auto& item : g_NodeBatch.templateNodes) {
+            item.dispose();
+        }
+        g_NodeBatch = JsNodeBatch();
     }
 
     /**
@@ -2003,8 +2039,27 @@ namespace sight {
         
         
         v8::HandleScope handle_scope(isolate);
-        auto context = isolate->GetCurrentContext();
 
+        Local<Function> function;
+        auto code = compileJsFile(isolate, filepath, !(module.IsEmpty() || module->IsNullOrUndefined()), function);
+        if (code != CODE_OK) {
+            if (promise) {
+                promise->set_value(0);
+            }
+            return code;
+        }
+        code = callJsFileFunction(isolate, function, module, resultOuter);
+        if (promise) {
+            promise->set_value(code == CODE_FAIL ? 0 : 1);
+        }
+        if (code == CODE_OK) {
+            logDebug("js file success ran.");
+        }
+        return code;
+    }
+
+    int compileJsFile(v8::Isolate* isolate, const char* filepath, bool withModule, v8::Local<v8::Function>& functionOut) {
+        auto context = isolate->GetCurrentContext();
         TryCatch tryCatch(isolate);
 
         auto maySource = readFile(isolate, filepath);
@@ -2019,7 +2074,7 @@ namespace sight {
         v8::ScriptCompiler::Source source(sourceCode, scriptOrigin);
         MaybeLocal<Function> mayFunction;
 
-        if (module.IsEmpty() || module->IsNullOrUndefined()) {
+        if (!withModule) {
             mayFunction = v8::ScriptCompiler::CompileFunction(context, &source, 0, nullptr);
         } else {
             v8::Local<v8::String> paramModule = v8::String::NewFromUtf8(isolate, "module").ToLocalChecked();
@@ -2031,9 +2086,6 @@ namespace sight {
         
         if (mayFunction.IsEmpty()) {
             logDebug("js file compile error: $0", filepath);
-            if (promise) {
-                promise->set_value(0);
-            }
 
             if (tryCatch.HasCaught()) {
                 //
@@ -2043,7 +2095,13 @@ namespace sight {
             }
             return CODE_FILE_ERROR;
         }
-        Local<Function> function = mayFunction.ToLocalChecked();
+        functionOut = mayFunction.ToLocalChecked();
+        return CODE_OK;
+    }
+
+    int callJsFileFunction(v8::Isolate* isolate, v8::Local<v8::Function> function, v8::Local<v8::Object> module, v8::Local<v8::Value>* resultOuter) {
+        auto context = isolate->GetCurrentContext();
+        TryCatch tryCatch(isolate);
         Local<Object> recv = Object::New(isolate);
         MaybeLocal<Value> result;
 
@@ -2069,9 +2127,6 @@ namespace sight {
         
         if (tryCatch.HasCaught()) {
             logDebug("js file has error");
-            if (promise) {
-                promise->set_value(0);
-            }
 
             //
             std::string errorMsg;
@@ -2080,16 +2135,12 @@ namespace sight {
             return CODE_FAIL;
         }
 
-        if (promise) {
-            promise->set_value(1);
-        }
         if (resultOuter) {
             if (result.IsEmpty()) {
                 return CODE_SCRIPT_NO_RESULT;
             }
             *resultOuter = result.ToLocalChecked();
         }
-        logDebug("js file success ran.");
         return CODE_OK;
     }
 
@@ -2205,7 +2256,7 @@ namespace sight {
             auto nodeFunc = [node, isolate, &context, &arg$, graphObject](std::vector<SightNodePort> & list, bool isOutput = false) {
 
                 for (const auto &item : list) {
-                    std::string name = item.portName;
+                    std::string name = item.portName.str();
                     auto emptyFunc = [](){
                         return std::string();
                     };
@@ -2214,24 +2265,18 @@ namespace sight {
                         // reverseActive this port.
                         //
                         if (!item.isConnect()) {
-                            logError("ReverseActive Error, no connection: $1, $0", item.portName, item.getId());
+                            logError("ReverseActive Error, no connection: $1, $0", item.portName.str(), item.getId());
                             return "";      // maybe need throw sth ?
                         }
 
-                        auto & connections = item.connections;
-                        if (connections.size() == 1) {
+                        auto edges = node->graph->getAdjacency().edgesOf(item);
+                        if (edges.size() == 1) {
                             // 1
-                            auto c = connections.front();
-                            SightNodePortConnection connection(node->graph, c, node);
-                            if (connection.bad()) {
-                                logError("bad connection");
-                                return "";
-                            }
-
-                            auto targetNode = connection.target->node;
+                            auto target = edges.front().target;
+                            auto targetNode = target->node;
                             auto targetJsNode = findTemplateNode(targetNode);
                             if (targetJsNode) {
-                                return runGenerateFunction(targetJsNode->onReverseActive,isolate, targetNode, connection.target->getId());
+                                return runGenerateFunction(targetJsNode->onReverseActive,isolate, targetNode, target->getId());
                             }
                         } else {
                             logError("multiple connections, do not support yet.");
@@ -2410,14 +2455,16 @@ namespace sight {
         return "";
     }
     
-    std::string parseConnection(Isolate* isolate, SightNodeConnection* connection) {
+    std::string parseConnection(Isolate* isolate, SightNodeGraphEdge const& edge) {
         auto& data = g_V8Runtime->parsingGraphData;
+        auto connection = edge.connection;
         if (data.connectionCodeTemplate.empty() || !connection->generateCode) {
             return {};
         }
         
-        auto leftNode = connection->findLeftPort()->node;
-        auto rightNode = connection->findRightPort()->node;
+        // ports are resolved by the adjacency index.
+        auto leftNode = edge.self->kind == NodePortType::Output ? edge.self->node : edge.target->node;
+        auto rightNode = edge.self->kind == NodePortType::Output ? edge.target->node : edge.self->node;
 
         auto isLeftHasGenerated = data.getGenerateInfo(leftNode->getNodeId()).hasGenerated();
         auto isRightHasGenerated = data.getGenerateInfo(rightNode->getNodeId()).hasGenerated();
@@ -2463,14 +2510,11 @@ namespace sight {
             return;
         }
 
-        auto func = [&finalSource, isolate](std::vector<SightNodePort>& list) {
+        auto& adjacency = data.currentNode->graph->getAdjacency();
+        auto func = [&finalSource, isolate, &adjacency](std::vector<SightNodePort>& list) {
             for (auto& item : list) {
-                if (!item.isConnect()) {
-                    continue;
-                }
-
-                for (auto& conn : item.connections) {
-                    auto code = parseConnection(isolate, conn);
+                for (auto& edge : adjacency.edgesOf(item)) {
+                    auto code = parseConnection(isolate, edge);
                     if (!code.empty()) {
                         finalSource << code;
                     }
@@ -2556,15 +2600,15 @@ namespace sight {
         // active the next.
         auto port = node->findPortByProcess();
         if (port) {
-            auto g = node->graph;
-            if (port->connections.size() == 1) {
-                parsingLink.link.push_back(SightNodePortConnection(g, port->connections.front(), node).target->node);
+            auto edges = node->graph->successors(port->getId());
+            if (edges.size() == 1) {
+                parsingLink.link.push_back(edges.front().target->node);
             } else {
                 // question: append 1st item to parsingLink.link ? 
                 // use reverse order.
-                for (auto iter = port->connections.rbegin(); iter != port->connections.rend(); iter++) {
-                    auto& item = *iter;
-                    data.addNewLink(SightNodePortConnection(g, item, node).target->node);
+                for (auto iter = edges.end(); iter != edges.begin(); ) {
+                    --iter;
+                    data.addNewLink(iter->target->node);
                 }
 
                 // move parsingLink to last
@@ -2587,6 +2631,16 @@ namespace sight {
             return CODE_FAIL;
         }
 
+        // a loop-back may be intended, it only fails if it reaches the generate times limit.
+        auto& analysis = graph.analyze();
+        if (!analysis.reachableCycles.empty()) {
+            logWarning("process chain has a cycle, graph: $0\n$1", graph.getFilePath(), analysis.cycleMessage());
+        }
+        if (!analysis.unreachableNodes.empty()) {
+            logWarning("$0 node(s) can not be reached from the enter node, they will not generate code. graph: $1", 
+                analysis.unreachableNodes.size(), graph.getFilePath());
+        }
+
         // parse the enter node.
         auto isolate = g_V8Runtime->isolate;
         TryCatch tryCatch(isolate);
@@ -2643,7 +2697,7 @@ namespace sight {
                         errorInfo.nodeId = portInfo->node->getNodeId();
                     }
 
-                    tmpErrorMsg << portInfo->portName;
+                    tmpErrorMsg << portInfo->portName.str();
                 } else {
                     tmpErrorMsg << "[No Port Info]";
                 }
@@ -2668,6 +2722,11 @@ namespace sight {
                 tmpErrorMsg << std::endl;
             }
 
+            // the cycle is the likely cause.
+            if (!analysis.reachableCycles.empty()) {
+                tmpErrorMsg << "Process chain has a cycle!\n" << analysis.cycleMessage() << std::endl;
+            }
+
             // maybe need append more info ?
             errorMsg = tmpErrorMsg.str();
             // logDebug(tmpErrorMsg.str());
@@ -2753,6 +2812,32 @@ namespace sight {
                 addUICommand(UICommandType::PluginReloadOver, CommandArgs::copyFrom(msg));
                 break;
             }
+            case JsCommandType::PluginReloadAt:
+            {
+                std::string_view path = command.args.argString;
+                Plugin* plugin = nullptr;
+                for (const auto& [name, item] : pluginManager()->getPluginMap()) {
+                    if (path == item->getPath()) {
+                        plugin = item;
+                        break;
+                    }
+                }
+
+                std::string msg;
+                if (plugin) {
+                    plugin->reload();
+                    flushJsNodeCache();
+                    msg = plugin->getName() + " Load Success " ICON_MD_DONE;
+                } else if (std::filesystem::is_directory(path) && pluginManager()->loadPluginAt(path) == CODE_OK) {
+                    flushJsNodeCache();
+                    msg = std::string(path) + " Load Success " ICON_MD_DONE;
+                } else {
+                    logDebug("no plugin at: $0", path);
+                    break;
+                }
+                addUICommand(UICommandType::PluginReloadOver, CommandArgs::copyFrom(msg));
+                break;
+            }
             case JsCommandType::PluginEnable:
                 pluginManager()->enablePlugin(command.args.argString);
                 break;
@@ -2774,6 +2859,12 @@ namespace sight {
             case JsCommandType::ProjectLoadPlugins:
                 currentProject()->loadPlugins();
                 break;
+            case JsCommandType::ProjectBuildGraphs:
+            {
+                std::vector<std::string> graphPaths = absl::StrSplit(command.args.argString, '\n', absl::SkipEmpty());
+                currentProject()->parseGraphs(graphPaths);
+                break;
+            }
             }
 
             command.args.dispose();
@@ -2786,6 +2877,9 @@ namespace sight {
 
     void jsThreadRun(const char *exeName) {
         initJsEngine(exeName);
+        g_JsEngineReady.set_value();
+        // bindings and commands read the project.
+        g_ProjectOpened.get_future().wait();
 
         logDebug("init code set");
         initCodeSet();
@@ -2806,6 +2900,11 @@ namespace sight {
         destroyJsEngine();
     }
 
+    void startJsThreadWork() {
+        g_ProjectOpened.set_value();
+        g_JsEngineReady.get_future().wait();
+    }
+
     int addJsCommand(JsCommandType type, int argInt) {
         JsCommand command = {
                 type,
@@ -2867,6 +2966,66 @@ namespace sight {
         return {};
     }
 
+    bool writeJsValueToJson(v8::Isolate* isolate, v8::Local<v8::Value> value, SightJsonWriter& writer, int depth) {
+        // same as the limit of nested objects of yaml-cpp.
+        constexpr int maxDepth = 64;
+        if (depth > maxDepth) {
+            return false;
+        }
+
+        if (value.IsEmpty() || value->IsNullOrUndefined() || value->IsFunction() || value->IsSymbol()) {
+            writer.null();
+        } else if (value->IsBoolean()) {
+            writer.value(value->IsTrue());
+        } else if (value->IsNumber()) {
+            writer.value(value.As<v8::Number>()->Value());
+        } else if (value->IsString()) {
+            v8::String::Utf8Value str(isolate, value);
+            writer.value(std::string_view(*str, str.length()));
+        } else if (value->IsArray()) {
+            auto context = isolate->GetCurrentContext();
+            auto array = value.As<v8::Array>();
+            writer.beginArray();
+            for (uint32_t i = 0; i < array->Length(); i++) {
+                v8::Local<v8::Value> element;
+                if (!array->Get(context, i).ToLocal(&element) || !writeJsValueToJson(isolate, element, writer, depth + 1)) {
+                    return false;
+                }
+            }
+            writer.endArray();
+        } else if (value->IsObject()) {
+            auto context = isolate->GetCurrentContext();
+            auto object = value.As<v8::Object>();
+            v8::Local<v8::Array> keys;
+            if (!object->GetOwnPropertyNames(context).ToLocal(&keys)) {
+                return false;
+            }
+
+            writer.beginObject();
+            for (uint32_t i = 0; i < keys->Length(); i++) {
+                v8::Local<v8::Value> key;
+                v8::Local<v8::Value> member;
+                if (!keys->Get(context, i).ToLocal(&key) || !object->Get(context, key).ToLocal(&member)) {
+                    return false;
+                }
+                if (member->IsUndefined() || member->IsFunction() || member->IsSymbol()) {
+                    continue;
+                }
+
+                v8::String::Utf8Value keyString(isolate, key);
+                writer.key(std::string_view(*keyString, keyString.length()));
+                if (!writeJsValueToJson(isolate, member, writer, depth + 1)) {
+                    return false;
+                }
+            }
+            writer.endObject();
+        } else {
+            // e.g. BigInt, JSON.stringify throws for it.
+            return false;
+        }
+        return true;
+    }
+
     void registerToGlobal(v8::Isolate* isolate, std::map<std::string, std::string>* map) {
         HandleScope handleScope(isolate);
         auto context = isolate->GetCurrentContext();
@@ -2955,11 +3114,11 @@ namespace sight {
     }
 
     const char* sight::SightNodePortWrapper::getErrorMsg() const {
-        return pointer->options.errorMsg.c_str();
+        return pointer->options->errorMsg.c_str();
     }
 
     void SightNodePortWrapper::setErrorMsg(const char* msg) {
-        pointer->options.errorMsg = msg;
+        pointer->options.edit().errorMsg = msg;
     }
 
     void sight::SightNodePortWrapper::setType(uint v) {
@@ -2975,19 +3134,19 @@ namespace sight {
     }
 
     void sight::SightNodePortWrapper::setReadonly(bool v) {
-        pointer->options.readonly = v;
+        pointer->options.edit().readonly = v;
     }
 
     bool sight::SightNodePortWrapper::isReadonly() const {
-        return pointer->options.readonly;
+        return pointer->options->readonly;
     }
 
     void sight::SightNodePortWrapper::setShow(bool v) {
-        pointer->options.show = v;
+        pointer->options.edit().show = v;
     }
 
     bool sight::SightNodePortWrapper::isShow() const {
-        return pointer->options.show;
+        return pointer->options->show;
     }
 
     void sight::SightNodePortWrapper::deleteLinks() {
@@ -3010,7 +3169,7 @@ namespace sight {
     }
 
     SightNodeGraphWrapper::SightNodeGraphWrapper(SightNodeGraph* graph) : graph(graph) {
-        buildNodeCache();
+        // cachedNodes will be built when script reads `nodes` at first time.
     }
 
     SightNode sight::SightNodeGraphWrapper::findNodeByPortId(uint id) {
@@ -3074,6 +3233,7 @@ namespace sight {
 
     void sight::SightNodeGraphWrapper::buildNodeCache() {
         cachedNodes.clear();
+        nodeCacheBuilt = true;
         if (!graph) {
             return;
         }
@@ -3084,6 +3244,9 @@ namespace sight {
     }
 
     std::vector<SightNode>& sight::SightNodeGraphWrapper::getCachedNodes() {
+        if (!nodeCacheBuilt) {
+            buildNodeCache();
+        }
         return cachedNodes;
     }
 
@@ -3140,8 +3303,97 @@ namespace sight {
         return names;
     }
 
-    int parseGraph(std::string_view filename, bool generateTargetLang, bool writeToOutFile) {
+    namespace {
+
+        void hashFunctionSource(BuildHasher& hasher, ScriptFunctionWrapper::Function const& function) {
+            if (function.IsEmpty()) {
+                hasher.add(std::string_view{});
+                return;
+            }
+
+            auto isolate = g_V8Runtime->isolate;
+            HandleScope handleScope(isolate);
+            hasher.add(functionProtoToString(isolate, isolate->GetCurrentContext(), function.Get(isolate)));
+        }
+
+        void hashTemplateNode(BuildHasher& hasher, SightJsNode const& templateNode) {
+            hasher.add(templateNode.nodeName);
+            for (auto ports : { &templateNode.inputPorts, &templateNode.outputPorts, &templateNode.fields }) {
+                hasher.add(ports->size());
+                for (auto const* port : *ports) {
+                    hasher.add(port->portName.str());
+                    hasher.add(port->kind);
+                    hasher.add(port->type);
+                }
+            }
+            hashFunctionSource(hasher, templateNode.generateCodeWork);
+            hashFunctionSource(hasher, templateNode.onReverseActive);
+        }
+
+    }
+
+    int hashGraphBuildInputs(std::string_view yamlPath, uint64_t pluginHash, absl::flat_hash_map<std::string, uint64_t> const& entityHashes,
+                             BuildManifestEntry& entry, SightGraphBinaryWriter& records) {
+        BuildHasher graphHasher;
+        if (!hashFileContent(yamlPath, graphHasher)) {
+            return CODE_FILE_ERROR;
+        }
+        bool hasJournal = getSightSettings()->graphJournal && hasGraphJournal(yamlPath);
+        if (hasJournal) {
+            hashFileContent(graphJournalPath(yamlPath), graphHasher);
+        }
+        entry.graphHash = graphHasher.value;
+
+        records.clear();
+        int status = readGraphYamlRecords(yamlPath, records);
+        if (status != CODE_OK) {
+            return status;
+        }
+        if (hasJournal) {
+            replayGraphJournal(yamlPath, records);
+        }
+
+        BuildHasher inputHasher;
+        inputHasher.add(pluginHash);
+
+        // templates which the graph uses, in order.
+        absl::btree_set<std::string_view> templateAddresses;
+        for (auto const& record : records.nodes) {
+            templateAddresses.insert(records.str(record.templateAddress));
+        }
+        for (auto address : templateAddresses) {
+            inputHasher.add(address);
+            if (auto iter = entityHashes.find(address); iter != entityHashes.end()) {
+                inputHasher.add(iter->second);
+            }
+            auto templateNode = findTemplateNode(std::string(address).c_str());
+            inputHasher.add(templateNode != nullptr);
+            if (templateNode) {
+                hashTemplateNode(inputHasher, *templateNode);
+            }
+        }
+
+        for (auto const& setting : records.settings) {
+            auto key = records.str(setting.key);
+            if (key != "codeTemplate") {
+                continue;
+            }
+            auto& map = g_V8Runtime->codeTemplateMap;
+            auto iter = map.find(std::string(records.str(setting.value)));
+            inputHasher.add(iter != map.end());
+            if (iter != map.end()) {
+                inputHasher.add(iter->second.enableHeader);
+                inputHasher.add(iter->second.enableFooter);
+                hashFunctionSource(inputHasher, iter->second.function.function);
+            }
+        }
+        entry.inputHash = inputHasher.value;
+        return CODE_OK;
+    }
+
+    int parseGraph(std::string_view filename, bool generateTargetLang, bool writeToOutFile, std::string* outputPathOut) {
         logDebug(filename);
+        ensureEntityTemplates();
         SightNodeGraph graph;
         int i = graph.load(filename);
         if (i == 1) {
@@ -3150,7 +3402,11 @@ namespace sight {
         if (i < 0) {
             return CODE_FAIL;
         }
+        return parseGraph(graph, generateTargetLang, writeToOutFile, outputPathOut);
+    }
 
+    int parseGraph(SightNodeGraph& graph, bool generateTargetLang, bool writeToOutFile, std::string* outputPathOut) {
+        int i = CODE_OK;
         std::string source;
         std::string errorMsg;
         if (parseGraphToJs(graph, source, errorMsg) != CODE_OK) {
@@ -3193,8 +3449,20 @@ namespace sight {
             if (settings.outputFilePath.empty()) {
                 logWarning("graph $0 do not have a output path.", graph.getFilePath());
             } else {
-                std::ofstream out(settings.outputFilePath.data(), std::ios::trunc);
-                out << source;
+                // same content is not written again, so builds of other tools which use it are not invalidated.
+                std::string oldSource;
+                bool same = false;
+                if (std::ifstream in(settings.outputFilePath, std::ios::binary); in.is_open()) {
+                    oldSource.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+                    same = oldSource == source;
+                }
+                if (!same) {
+                    std::ofstream out(settings.outputFilePath.data(), std::ios::trunc);
+                    out << source;
+                }
+                if (outputPathOut) {
+                    *outputPathOut = settings.outputFilePath;
+                }
             }
         } else {
             logDebug("source do not to write to file");
@@ -92,6 +92,7 @@ namespace sight {
         CHECK_RETURN("insertNode", keybindingds->insertNode);
         CHECK_RETURN("markNode", keybindingds->markNode);
         CHECK_RETURN("detachNode", keybindingds->detachNode);
+        CHECK_RETURN("search", keybindingds->search);
 
         keybindingds->esc = getFromKeyMap("esc");
         return keybindingds;
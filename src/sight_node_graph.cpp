@@ -6,25 +6,186 @@
 #include "sight_project.h"
 #include "sight_js.h"
 #include "sight_event_bus.h"
+#include "sight_graph_binary.h"
+#include "sight_graph_saver.h"
+#include "sight_graph_yaml.h"
+#include "sight_util.h"
+#include "sight_json_writer.h"
+#include "sight_runtime_graph.h"
 
 #include <iostream>
 #include <stdexcept>
 #include <string_view>
 #include <filesystem>
+#include <cstring>
 #include <fstream>
+#include <sstream>
 #include <vector>
+#include <algorithm>
+#include <mutex>
+#include <optional>
 
-#include "crude_json.h"
 #include "v8-isolate.h"
 
 #include "absl/container/flat_hash_set.h"
+#include "absl/strings/numbers.h"
 
 #define VALUE_STR 	"value"
 
 
 namespace sight {
+
+    namespace {
+
+        /**
+         * @return the binary cache of a yaml graph in the current project, empty if the cache is off.
+         */
+        std::string binaryCachePathOf(std::string_view yamlPath) {
+            auto project = currentProject();
+            if (!getSightSettings()->graphBinaryCache || !project) {
+                return {};
+            }
+            return graphBinaryCachePath(yamlPath, project->getBaseDir());
+        }
+
+        /**
+         * @brief Records of a yaml graph which are read by `prefetchGraph`, its journal is applied already.
+         */
+        struct PrefetchedGraph {
+            std::string path;
+            uint64_t size = 0;
+            int64_t modifyTime = 0;
+            SightGraphBinaryWriter data;
+            int journalEntries = 0;
+            size_t journalSize = 0;
+        };
+
+        std::mutex prefetchMutex;
+        std::optional<PrefetchedGraph> prefetchedGraph;
+
+        /**
+         * @return the prefetched graph of `path` if it is not changed since, otherwise empty.
+         */
+        std::optional<PrefetchedGraph> takePrefetchedGraph(std::string_view path) {
+            std::optional<PrefetchedGraph> item;
+            {
+                std::lock_guard lock(prefetchMutex);
+                if (!prefetchedGraph || prefetchedGraph->path != path) {
+                    return {};
+                }
+                item.swap(prefetchedGraph);
+            }
+
+            uint64_t size = 0;
+            int64_t modifyTime = 0;
+            if (!graphSourceStamp(path, size, modifyTime) || size != item->size || modifyTime != item->modifyTime) {
+                return {};
+            }
+            return item;
+        }
+
+        void writeConnectionData(SightGraphBinaryWriter& writer, SightNodeConnection const& connection) {
+            SightGraphBinaryConnection record;
+            record.id = connection.connectionId;
+            record.left = connection.leftPortId();
+            record.right = connection.rightPortId();
+            record.priority = connection.priority;
+            record.generateCode = connection.generateCode ? 1 : 0;
+            writer.connections.push_back(record);
+
+            if (connection.componentContainer) {
+                for (auto const& item : connection.componentContainer->components) {
+                    writeNodeData(writer, *item, SightGraphBinaryOwner::Connection, connection.connectionId);
+                }
+            }
+        }
+
+        /**
+         * @brief Map components in `container` (and their components) to `ownerId`.
+         */
+        void collectComponentOwners(SightComponentContainer const* container, uint ownerId, absl::flat_hash_map<uint, uint>& owners) {
+            if (!container) {
+                return;
+            }
+            for (auto const& item : container->components) {
+                owners[item->nodeId] = ownerId;
+                collectComponentOwners(item->componentContainer, ownerId, owners);
+            }
+        }
+
+        /**
+         * @brief Merge data of components (`appendDataToOutput`) into the json object which is being written,
+         * by v8 values directly.
+         *
+         * @param keys  keys of the object, a component can not overwrite them.
+         * @return int CODE_OK, CODE_FAIL if a value can not be json, the object is not complete then.
+         */
+        int writeComponentData(SightComponentContainer* componentContainer, SightJsonWriter& writer, absl::flat_hash_set<std::string>& keys) {
+            if (!componentContainer) {
+                return CODE_OK;
+            }
+
+            auto isolate = getJsIsolate();
+            for (auto& item : componentContainer->components) {
+                const auto& component = item->templateNode->component;
+                if (!component.appendDataToOutput) {
+                    continue;
+                }
+
+                v8::HandleScope handleScope(isolate);
+                v8::TryCatch tryCatch(isolate);
+                auto context = isolate->GetCurrentContext();
+                v8::Local<v8::Value> data;
+                if (!component.appendDataToOutput.callByReadonly(isolate, item).ToLocal(&data)) {
+                    continue;
+                }
+                if (data->IsString() && !v8::JSON::Parse(context, data.As<v8::String>()).ToLocal(&data)) {
+                    // a json string, as older components return.
+                    logError("append data failed, component not return json string: $0", item->nodeId);
+                    continue;
+                }
+                if (!data->IsObject() || data->IsArray()) {
+                    logError("append data failed, component not return object: $0", item->nodeId);
+                    continue;
+                }
+
+                auto object = data.As<v8::Object>();
+                v8::Local<v8::Array> names;
+                if (!object->GetOwnPropertyNames(context).ToLocal(&names)) {
+                    continue;
+                }
+                for (uint32_t i = 0; i < names->Length(); i++) {
+                    v8::Local<v8::Value> name;
+                    v8::Local<v8::Value> member;
+                    if (!names->Get(context, i).ToLocal(&name) || !object->Get(context, name).ToLocal(&member)) {
+                        continue;
+                    }
+                    if (member->IsUndefined() || member->IsFunction()) {
+                        continue;
+                    }
+
+                    std::string key = v8pp::from_v8<std::string>(isolate, name);
+                    if (!keys.insert(key).second) {
+                        logError("append data failed, component already exists: $0", key);
+                        continue;
+                    }
+                    writer.key(key);
+                    if (!writeJsValueToJson(isolate, member, writer, 1)) {
+                        logError("append data failed, value of $0 can not be json, component: $1", key, item->nodeId);
+                        return CODE_FAIL;
+                    }
+                }
+            }
+            return CODE_OK;
+        }
+
+    }
     
     int SightNodeGraph::saveToFile(const char* path, bool set, bool saveAnyway, SaveReason saveReason) {
+        if (!path) {
+            path = this->filepath.c_str();
+        }
+        bool ownFile = path == this->filepath;
         if (set) {
             this->setFilePath(path);
         }
@@ -32,174 +193,470 @@ namespace sight {
             return CODE_FAIL;
         }
 
-        // ctor yaml object
-        YAML::Emitter out;
-        out << YAML::BeginMap;
-        // file header
-        out << YAML::Key << whoAmI << YAML::Value << "sight-graph";
-        // nodes
-        out << YAML::Key << "nodes";
-        out << YAML::Value << YAML::BeginMap;
+        SightGraphBinaryWriter data;
+        snapshot(data);
 
-        loopOf([&out](SightNode* node) {
-            out << YAML::Key << node->nodeId;
-            out << YAML::Value << *node;
-        });
-        out << YAML::EndMap;
+        // an older snapshot must not overwrite this one.
+        waitGraphSave(path);
+        int status = writeGraphSnapshot(path, binaryCachePathOf(path), data);
+        if (status == CODE_OK && saveReason == SaveReason::User) {
+            logDebug("save over to: $0", path);
+        }
+        if (status == CODE_OK && (ownFile || set)) {
+            resetJournalBase();
+        }
+        if (status == CODE_OK && currentProject() && currentProject()->getTemplateUsageIndex().updateGraph(path, data)) {
+            currentProject()->markGraphStale(path);
+        }
+        return status;
+    }
 
-        // connections
-        out << YAML::Key << "connections";
-        out << YAML::Value << YAML::BeginMap;
+    bool SightNodeGraph::isSameAsFile() const {
+        if (endsWith(filepath, SIGHT_GRAPH_BINARY_EXT) || isOwnWrite(filepath)) {
+            return true;
+        }
 
-        loopOf([&out](SightNodeConnection* connection) {
-            out << YAML::Key << connection->connectionId << YAML::Value << *connection;
-        });
-        out << YAML::EndMap;
+        SightGraphBinaryWriter disk;
+        if (readGraphYamlRecords(filepath, disk) != CODE_OK) {
+            return true;
+        }
+        if (getSightSettings()->graphJournal) {
+            replayGraphJournal(filepath, disk);
+        }
+        SightGraphBinaryWriter memory;
+        snapshot(memory);
 
-        // other info
-        // settings
-        out << YAML::Key << "settings" << YAML::Value << YAML::BeginMap;
-        out << YAML::Key << "lang.type" << YAML::Value << settings.language.type;
-        out << YAML::Key << "lang.version" << YAML::Value << settings.language.version;
-        out << YAML::Key << "outputFilePath" << YAML::Value << settings.outputFilePath;
-        out << YAML::Key << "codeTemplate" << YAML::Value << settings.codeTemplate;
-        out << YAML::Key << "graphName" << YAML::Value << settings.graphName;
-        out << YAML::Key << "connectionCodeTemplate" << YAML::Value << settings.connectionCodeTemplate;
-        out << YAML::Key << "enterNode" << YAML::Value << settings.enterNode;
-        out << YAML::EndMap;
-
-        // this->saveAsJsonHistory
-        out << YAML::Key << "saveAsJsonHistory" << YAML::Value << this->saveAsJsonHistory;
-        
-        out << YAML::EndMap;     // end of 1st begin map
+        SightGraphRecordHashes diskHashes;
+        SightGraphRecordHashes memoryHashes;
+        hashGraphRecords(disk, diskHashes);
+        hashGraphRecords(memory, memoryHashes);
+        return diskHashes == memoryHashes;
+    }
 
-        // save file
-        std::ofstream outToFile(path, std::ios::out | std::ios::trunc);
-        outToFile << out.c_str() << std::endl;
-        outToFile.close();
+    int SightNodeGraph::load(std::string_view path, SightGraphBinaryWriter const& records) {
+        this->filepath = path;
+        journalBase = {};
 
-        if (saveReason == SaveReason::User) {
-            logDebug("save over to: $0", path);
+        int status = loadRecords(records);
+        if (status == CODE_OK) {
+            resetJournalBase();
         }
-        return CODE_OK;
+        return status;
     }
 
     int SightNodeGraph::load(std::string_view path) {
         this->filepath = path;
+        // the file may be saved by the save thread.
+        waitGraphSave(path);
+
+        journalBase = {};
+
+        if (endsWith(this->filepath, SIGHT_GRAPH_BINARY_EXT)) {
+            return loadBinary(path);
+        }
+        SightGraphBinaryWriter records;
+        size_t journalSize = 0;
+        int count = 0;
+        auto prefetched = takePrefetchedGraph(path);
+        bool hasJournal = !prefetched && getSightSettings()->graphJournal && hasGraphJournal(path);
+        if (prefetched) {
+            records = std::move(prefetched->data);
+            journalSize = prefetched->journalSize;
+            count = prefetched->journalEntries;
+        } else if (hasJournal) {
+            int status = readGraphYamlRecords(path, records);
+            if (status != CODE_OK) {
+                return status == CODE_FILE_FORMAT_ERROR ? CODE_FILE_ERROR : status;
+            }
+            // the app did not save the yaml file last time, apply unsaved changes.
+            count = replayGraphJournal(path, records, &journalSize);
+        }
+        if (prefetched || hasJournal) {
+            // nodes need templates, which belong to the ui thread, so they are made here.
+            int status = loadRecords(records);
+            if (status != CODE_OK) {
+                return status;
+            }
+            logDebug("load with $0 journal entries ok, prefetched: $1", count, prefetched.has_value());
+            resetJournalBase();
+            journalBase.journalSize = journalSize;
+            return CODE_OK;
+        }
+        if (loadBinaryCache(path) == CODE_OK) {
+            logDebug("load from binary cache ok");
+            resetJournalBase();
+            return CODE_OK;
+        }
 
         std::ifstream fin(path.data());
         if (!fin.is_open()) {
             return CODE_FILE_ERROR;
         }
 
-        int status = CODE_OK;
-        try {
-            auto root = YAML::Load(fin);
-
-            // nodes
-            auto nodeRoot = root["nodes"];
-            auto connectionRoot = root["connections"];
-            logDebug(nodeRoot.size());
-
-            int loadNodeStatus = CODE_OK;
-            SightNode* sightNode = nullptr;
-            for (const auto& nodeKeyPair : nodeRoot) {
-                auto yamlNode = nodeKeyPair.second;
-                loadNodeStatus = loadNodeData(yamlNode, sightNode, this);
-                if (loadNodeStatus != CODE_OK) {
-                    if (status == CODE_OK) {
-                        status = loadNodeStatus;
-                    }
+        beginBatch();
 
-                    broken = true;
-                    return CODE_FAIL;
-                }
+        // key: node id, value: loaded node or component, used to find the owner of components.
+        absl::flat_hash_map<uint, SightNode*> loadedNodes;
+        std::vector<std::string> history;
 
-                // registerNodeIds(sightNode);
-                registerNode(sightNode);
+        SightGraphYamlCallbacks callbacks;
+        callbacks.onNode = [this, &loadedNodes](SightGraphBinaryWriter const& data, SightGraphBinaryNode const& record, int line) {
+            SightNode* node = nullptr;
+            int status = loadNodeData(data, record, node, this);
+            if (status == CODE_OK) {
+                status = attachLoadedNode(node, record, loadedNodes);
             }
+            if (status == CODE_OK) {
+                return CODE_OK;
+            }
+
+            if (node) {
+                nodes.remove(node);
+            }
+            if (record.ownerKind != SightGraphBinaryOwner::None) {
+                // a bad component is skipped.
+                logWarning("line $0: skip component $1, error: $2", line, record.id, status);
+                return CODE_OK;
+            }
+            logWarning("line $0: load node $1 failed, error: $2", line, record.id, status);
+            return CODE_FAIL;
+        };
+        callbacks.onConnection = [this](SightGraphBinaryConnection const& record, int line) {
+            if (loadConnection(record) != CODE_OK) {
+                logWarning("line $0: load connection $1 failed", line, record.id);
+                return CODE_FAIL;
+            }
+            return CODE_OK;
+        };
+        callbacks.onSetting = [this](std::string_view key, std::string_view value) {
+            loadSetting(key, value);
+        };
+        callbacks.onSaveAsJsonHistory = [&history](std::string_view path) {
+            history.emplace_back(path);
+        };
+
+        SightGraphBinaryWriter data;
+        std::string errorMessage;
+        int status = readGraphYaml(fin, data, callbacks, &errorMessage);
+        if (status == CODE_FILE_FORMAT_ERROR) {
+            logError("read file $0 error: $1", path, errorMessage);
+            rollback();
+            this->reset();
+            return CODE_FILE_ERROR;     // bad file
+        } else if (status != CODE_OK) {
+            broken = true;
+            rollback();
+            return CODE_FAIL;
+        }
+
+        this->saveAsJsonHistory = std::move(history);
+        bindGraphRefs();
+
+        commit();
+        this->editing = false;
+        logDebug("load ok");
+        resetJournalBase();
+        // the binary cache is written by saves only, this may run on any thread.
+        return CODE_OK;
+    }
+
+    int SightNodeGraph::loadBinary(std::string_view path) {
+        SightGraphBinaryReader reader;
+        int status = reader.open(path);
+        if (status != CODE_OK) {
+            logError("read file $0 error: $1", path, status);
+            return status;
+        }
+        return loadRecords(reader);
+    }
+
+    int SightNodeGraph::loadBinaryCache(std::string_view yamlPath) {
+        auto cachePath = binaryCachePathOf(yamlPath);
+        if (cachePath.empty()) {
+            return CODE_FAIL;
+        }
+
+        SightGraphBinaryReader reader;
+        int status = openGraphBinaryCache(reader, cachePath, yamlPath);
+        if (status != CODE_OK) {
+            return status;
+        }
+
+        status = loadRecords(reader);
+        if (status != CODE_OK) {
+            // yaml is the source of truth, let caller load it.
+            broken = false;
+            brokenReason.clear();
+        }
+        return status;
+    }
+
+    template<class Source>
+    int SightNodeGraph::loadRecords(Source const& source) {
+        beginBatch();
+
+        // key: node id, value: loaded node or component, used to find the owner of components.
+        absl::flat_hash_map<uint, SightNode*> loadedNodes;
+        // components which owner is loaded later.
+        std::vector<SightGraphBinaryNode const*> delayedComponents;
 
-            // connections
-            for (const auto& item : connectionRoot) {
-                SightNodeConnection tmpConnection;
-                tmpConnection.graph = this;
+        // return false if the node is not loaded.
+        auto loadNode = [this, &source, &loadedNodes](SightGraphBinaryNode const& record) {
+            SightNode* node = nullptr;
+            if (loadNodeData(source, record, node, this) == CODE_OK && attachLoadedNode(node, record, loadedNodes) == CODE_OK) {
+                return true;
+            }
+            if (node) {
+                nodes.remove(node);
+            }
+            return false;
+        };
 
-                auto connectionId = item.first.as<int>();
-                item.second >> tmpConnection;
-                int ret = createConnection(tmpConnection.left, tmpConnection.right, connectionId, tmpConnection.priority);
-                if (ret < 0) {
+        for (auto const& record : nodesOf(source)) {
+            if (record.ownerKind == SightGraphBinaryOwner::None) {
+                if (!loadNode(record)) {
                     broken = true;
+                    rollback();
                     return CODE_FAIL;
                 }
-                auto con = findConnection(connectionId);
-                con->generateCode = tmpConnection.generateCode;
+            } else if (record.ownerKind == SightGraphBinaryOwner::Node && loadedNodes.contains(record.ownerId)) {
+                // same as yaml, a bad component is skipped.
+                loadNode(record);
+            } else {
+                delayedComponents.push_back(&record);
+            }
+        }
 
-                // tmpConnection will auto free when current loop ends, so let new connection have componentContainer
-                con->componentContainer = tmpConnection.componentContainer;
+        for (auto const& item : connectionsOf(source)) {
+            if (loadConnection(item) != CODE_OK) {
+                broken = true;
+                rollback();
+                return CODE_FAIL;
             }
+        }
 
-            // settings
-            auto settingsNode = root["settings"];
-            if (settingsNode.IsDefined()) {
-                settings.language.type = settingsNode["lang.type"].as<int>();
-                settings.language.version = settingsNode["lang.version"].as<int>();
-                settings.outputFilePath = settingsNode["outputFilePath"].as<std::string>();
-                if (settingsNode["codeTemplate"]) {
-                    settings.codeTemplate = settingsNode["codeTemplate"].as<std::string>();
-                }
-                if (settingsNode["graphName"]) {
-                    snprintf(settings.graphName, std::size(settings.graphName) - 1, "%s", settingsNode["graphName"].as<std::string>().c_str());
-                }
-                if (settingsNode["connectionCodeTemplate"]) {
-                    settings.connectionCodeTemplate = settingsNode["connectionCodeTemplate"].as<std::string>();
-                }
-                if (settingsNode["enterNode"]) {
-                    settings.enterNode = settingsNode["enterNode"].as<int>();
-                }
+        for (auto record : delayedComponents) {
+            if (!loadNode(*record)) {
+                logDebug("component $0 is not loaded, owner: $1", record->id, record->ownerId);
             }
+        }
 
-            auto saveAsJsonHistoryNode = root["saveAsJsonHistory"];
-            if (saveAsJsonHistoryNode.IsDefined()) {
-                this->saveAsJsonHistory = saveAsJsonHistoryNode.as<std::vector<std::string>>();
+        // settings
+        for (auto const& item : settingsOf(source)) {
+            loadSetting(source.str(item.key), source.str(item.value));
+        }
+
+        auto history = saveAsJsonHistoryOf(source);
+        this->saveAsJsonHistory.clear();
+        this->saveAsJsonHistory.reserve(history.size());
+        for (auto const& item : history) {
+            this->saveAsJsonHistory.emplace_back(source.str(item));
+        }
+
+        bindGraphRefs();
+
+        commit();
+        this->editing = false;
+        logDebug("load records ok, nodes: $0, connections: $1", nodesOf(source).size(), connectionsOf(source).size());
+        return CODE_OK;
+    }
+
+    void SightNodeGraph::resetJournalBase() {
+        journalBase = {};
+        journalBase.valid = getSightSettings()->graphJournal && !endsWith(filepath, SIGHT_GRAPH_BINARY_EXT);
+    }
+
+    int SightNodeGraph::attachLoadedNode(SightNode* node, SightGraphBinaryNode const& record, absl::flat_hash_map<uint, SightNode*>& loadedNodes) {
+        SightComponentContainer* container = nullptr;
+        switch (record.ownerKind) {
+        case SightGraphBinaryOwner::None:
+            registerNode(node);
+            loadedNodes[node->nodeId] = node;
+            return CODE_OK;
+        case SightGraphBinaryOwner::Node:
+            if (auto iter = loadedNodes.find(record.ownerId); iter != loadedNodes.end()) {
+                container = iter->second->getComponentContainer();
             }
+            break;
+        case SightGraphBinaryOwner::Connection:
+            if (auto connection = findConnection(record.ownerId)) {
+                container = connection->getComponentContainer();
+            }
+            break;
+        }
+
+        if (!container) {
+            return CODE_FAIL;
+        }
+        container->addComponent(node);
+        loadedNodes[node->nodeId] = node;
+        return CODE_OK;
+    }
+
+    int SightNodeGraph::loadConnection(SightGraphBinaryConnection const& record) {
+        if (createConnection(record.left, record.right, record.id, record.priority) < 0) {
+            return CODE_FAIL;
+        }
+        findConnection(record.id)->generateCode = record.generateCode != 0;
+        return CODE_OK;
+    }
+
+    void SightNodeGraph::loadSetting(std::string_view key, std::string_view value) {
+        if (key == "lang.type") {
+            absl::SimpleAtoi(value, &settings.language.type);
+        } else if (key == "lang.version") {
+            absl::SimpleAtoi(value, &settings.language.version);
+        } else if (key == "outputFilePath") {
+            settings.outputFilePath = value;
+        } else if (key == "codeTemplate") {
+            settings.codeTemplate = value;
+        } else if (key == "graphName") {
+            snprintf(settings.graphName, std::size(settings.graphName) - 1, "%.*s", static_cast<int>(value.size()), value.data());
+        } else if (key == "connectionCodeTemplate") {
+            settings.connectionCodeTemplate = value;
+        } else if (key == "enterNode") {
+            absl::SimpleAtoi(value, &settings.enterNode);
+        }
+    }
+
+    int SightNodeGraph::saveToBinaryFile(std::string_view path, std::string_view sourcePath) {
+        SightGraphBinaryWriter writer;
+        snapshot(writer);
+
+        if (!sourcePath.empty()) {
+            graphSourceStamp(sourcePath, writer.sourceSize, writer.sourceModifyTime);
+        }
+        return writer.writeTo(path);
+    }
+
+    void SightNodeGraph::snapshot(SightGraphBinaryWriter& writer) const {
+        loopOf([&writer](SightNode const* node) {
+            writeNodeData(writer, *node);
+        });
+
+        loopOf([&writer](SightNodeConnection const* connection) {
+            writeConnectionData(writer, *connection);
+        });
+
+        snapshotSettings(writer);
+    }
 
-            // set graph ref
-            // loop of this->nodes
-            for (auto& node : this->nodes) {
-                node.graph = this;
+    void SightNodeGraph::snapshotChanges(SightGraphJournalChanges& changes) const {
+        absl::flat_hash_set<uint> nodeIds;
+        absl::flat_hash_set<uint> connectionIds;
+        // key: component id, value: id of its top-level node or connection, it is filled when a component is changed.
+        absl::flat_hash_map<uint, uint> owners;
 
-                if (node.componentContainer) {
-                    // loop of container
-                    for (auto& component : node.componentContainer->components) {
-                        component->graph = this;
+        for (auto id : journalBase.changedIds) {
+            auto const& thing = findSightAnyThing(id);
+            SightNode const* node = nullptr;
+            switch (thing.type) {
+            case SightAnyThingType::Node:
+                node = thing.asNode();
+                break;
+            case SightAnyThingType::Port:
+                if (auto port = thing.asPort()) {
+                    node = port->node;
+                    for (auto connection : port->connections) {
+                        connectionIds.insert(connection->connectionId);
                     }
                 }
+                break;
+            case SightAnyThingType::Connection:
+                connectionIds.insert(id);
+                break;
+            default:
+                // removed, ids of nodes and connections do not overlap.
+                nodeIds.insert(id);
+                connectionIds.insert(id);
+                break;
+            }
+            if (!node) {
+                continue;
+            }
+            if (!node->isComponent()) {
+                nodeIds.insert(node->nodeId);
+                continue;
             }
 
-            // loop of this->connections
-            for (auto& connection : this->connections) {
-                connection.graph = this;
-
-                if (connection.componentContainer) {
-                    // loop of container
-                    for (auto& component : connection.componentContainer->components) {
-                        component->graph = this;
+            if (owners.empty()) {
+                for (auto const& item : nodes) {
+                    if (!item.isComponent()) {
+                        collectComponentOwners(item.componentContainer, item.nodeId, owners);
                     }
                 }
+                for (auto const& item : connections) {
+                    collectComponentOwners(item.componentContainer, item.connectionId, owners);
+                }
             }
+            if (auto iter = owners.find(node->nodeId); iter != owners.end()) {
+                auto owner = findSightAnyThing(iter->second).type;
+                (owner == SightAnyThingType::Connection ? connectionIds : nodeIds).insert(iter->second);
+            }
+        }
 
-            this->editing = false;
-            logDebug("load ok");
-            return status;
-        } catch (const YAML::BadConversion& e) {
-            logError("read file %s error!", path.data());
-            logError("%s", e.what() );
+        for (auto id : nodeIds) {
+            auto node = findSightAnyThing(id).asNode();
+            if (node && !node->isDeleted()) {
+                writeNodeData(changes.data, *node);
+            } else {
+                changes.removedNodes.push_back(id);
+            }
+        }
+        for (auto id : connectionIds) {
+            auto connection = findSightAnyThing(id).asConnection();
+            if (connection && !connection->isDeleted()) {
+                writeConnectionData(changes.data, *connection);
+            } else {
+                changes.removedConnections.push_back(id);
+            }
+        }
 
-            this->reset();
-            return CODE_FILE_ERROR;     // bad file
+        changes.settings = journalBase.settingsChanged;
+        if (changes.settings) {
+            snapshotSettings(changes.data);
+        }
+    }
+
+    void SightNodeGraph::snapshotSettings(SightGraphBinaryWriter& writer) const {
+        // same keys as yaml.
+        writer.addSetting("lang.type", std::to_string(settings.language.type));
+        writer.addSetting("lang.version", std::to_string(settings.language.version));
+        writer.addSetting("outputFilePath", settings.outputFilePath);
+        writer.addSetting("codeTemplate", settings.codeTemplate);
+        writer.addSetting("graphName", settings.graphName);
+        writer.addSetting("connectionCodeTemplate", settings.connectionCodeTemplate);
+        writer.addSetting("enterNode", std::to_string(settings.enterNode));
+
+        for (auto const& item : saveAsJsonHistory) {
+            writer.saveAsJsonHistory.push_back(writer.addString(item));
+        }
+    }
+
+    void SightNodeGraph::bindGraphRefs() {
+        // loop of this->nodes
+        for (auto& node : this->nodes) {
+            node.graph = this;
+
+            if (node.componentContainer) {
+                // loop of container
+                for (auto& component : node.componentContainer->components) {
+                    component->graph = this;
+                }
+            }
         }
 
-        // return 0;
+        // loop of this->connections
+        for (auto& connection : this->connections) {
+            connection.graph = this;
+
+            if (connection.componentContainer) {
+                // loop of container
+                for (auto& component : connection.componentContainer->components) {
+                    component->graph = this;
+                }
+            }
+        }
     }
 
     void SightNodeGraph::dispose() {
@@ -223,6 +680,7 @@ namespace sight {
     }
 
     void SightNodeGraph::registerNodeIds(SightNode* p) {
+        markNodeAdjacencyStale(*p);
 
         idMap[p->nodeId] = {
             SightAnyThingType::Node,
@@ -243,6 +701,7 @@ namespace sight {
     }
 
     void SightNodeGraph::unregisterNodeIds(SightNode const* p) {
+        markNodeAdjacencyStale(*p);
 
         auto nodeFunc = [this](std::vector<SightNodePort> const& list) {
             for (auto& item : list) {
@@ -344,21 +803,34 @@ namespace sight {
         assert(right);
 
         left->connections.push_back(p);
-        left->sortConnections();
-
         right->connections.push_back(p);
-        right->sortConnections();
+        if (batch.depth > 0) {
+            batch.connections.push_back(p->connectionId);
+            batch.unsortedPorts.insert(left->getId());
+            batch.unsortedPorts.insert(right->getId());
+        } else {
+            left->sortConnections();
+            right->sortConnections();
+        }
+        markPortAdjacencyStale(left->getId());
+        markPortAdjacencyStale(right->getId());
+        markDirty(connection.connectionId);
     }
 
     void SightNodeGraph::registerNode(SightNode* p) {
         p->graph = this;
         p->updateChainPortPointer();
         registerNodeIds(p);
+        if (batch.depth > 0) {
+            batch.nodes.push_back(p);
+            batch.dirty = true;
+            return;
+        }
+
         p->callEventOnInstantiate();
         SimpleEventBus::nodeAdded()->dispatch(p);
 
-        // this->editing = true;
-        markDirty();
+        markDirty(p->nodeId);
     }
 
     const SightArray<SightNode>& SightNodeGraph::getNodes() const {
@@ -400,16 +872,24 @@ namespace sight {
 
     int SightNodeGraph::verifyId(bool errorStop, std::function<void(SightNode*)> onNodeError, std::function<void(SightNodePort*)> onPortError,
                                  std::function<void(SightNodeConnection*)> onConnectionError) {
-        using set = absl::flat_hash_set<uint>;
-        set nodeIdSet;
-        set portIdSet;
-        set connectionIdSet;
+        bool hasCallback = onNodeError || onPortError || onConnectionError;
+        if (!hasCallback && idVerifiedVersion == structureVersion) {
+            // nothing changed since last check.
+            return CODE_OK;
+        }
+
+        // node, port and connection ids share one id space.
+        absl::flat_hash_set<uint> idSet;
+        idSet.reserve(idMap.size());
+        auto& nodeIdSet = idSet;
+        auto& portIdSet = idSet;
+        auto& connectionIdSet = idSet;
 
         int status = CODE_OK;
         const uint maxNodeOrPortId = currentProject()->maxNodeOrPortId();
 
-        auto isIdInvalid = [&nodeIdSet, &portIdSet, &connectionIdSet, maxNodeOrPortId](uint id) {
-            return nodeIdSet.contains(id) || portIdSet.contains(id) || connectionIdSet.contains(id) || id > maxNodeOrPortId || id < START_NODE_ID;
+        auto isIdInvalid = [&idSet, maxNodeOrPortId](uint id) {
+            return idSet.contains(id) || id > maxNodeOrPortId || id < START_NODE_ID;
         };
 
         auto nodeFunc = [&onPortError, &isIdInvalid, &portIdSet, &status](std::vector<SightNodePort>& list) {
@@ -475,6 +955,9 @@ namespace sight {
             }
         }
 
+        if (status == CODE_OK) {
+            idVerifiedVersion = structureVersion;
+        }
         return status;
     }
 
@@ -513,6 +996,27 @@ namespace sight {
     }
 
     void SightNodeGraph::markDirty() {
+        journalBase.valid = false;
+        markEdited();
+    }
+
+    void SightNodeGraph::markDirty(uint anyThingId) {
+        if (journalBase.valid) {
+            journalBase.changedIds.insert(anyThingId);
+        }
+        markEdited();
+    }
+
+    void SightNodeGraph::markSettingsDirty() {
+        journalBase.settingsChanged = true;
+        markEdited();
+    }
+
+    void SightNodeGraph::markEdited() {
+        if (batch.depth > 0) {
+            batch.dirty = true;
+            return;
+        }
         editing = true;
     }
 
@@ -628,9 +1132,19 @@ namespace sight {
             return CODE_NODE_HAS_CONNECTIONS;
         }
 
+        if (batch.depth > 0) {
+            auto& list = batch.nodes;
+            list.erase(std::remove(list.begin(), list.end(), &(*result)), list.end());
+        }
+
+        if (result->isComponent()) {
+            // components are saved with their owner, which is not known here.
+            markDirty();
+        } else if (!result->isDeleted()) {
+            markDirty(id);
+        }
         unregisterNodeIds(&(*result));
         nodes.erase(result);
-        markDirty();
         return CODE_OK;
     }
 
@@ -653,8 +1167,16 @@ namespace sight {
         }
         idMap.erase(id);
 
+        // a deleted one is not in the file already.
+        bool deleted = result->isDeleted();
         connections.erase(result);
-        markDirty();
+        if (!removeRefs) {
+            // ports may still hold it, their rows can not be read from them.
+            markAdjacencyStale();
+        }
+        if (!deleted) {
+            markDirty(id);
+        }
         return CODE_OK;
     }
 
@@ -663,11 +1185,46 @@ namespace sight {
             return CODE_OK;
         }
 
-        auto c = saveToFile(this->filepath.c_str(), false, false, saveReason);
-        if (c == CODE_OK) {
-            this->editing = false;
+        if (isBroken()) {
+            return CODE_FAIL;
         }
-        return c;
+
+        this->editing = false;
+        auto project = currentProject();
+
+        bool yamlFile = !endsWith(filepath, SIGHT_GRAPH_BINARY_EXT);
+        if (saveReason == SaveReason::Automatic && yamlFile && getSightSettings()->graphJournal && journalBase.valid &&
+            journalBase.journalSize < SIGHT_GRAPH_JOURNAL_COMPACT_SIZE) {
+            // only what is marked is snapshotted. The template usages of this graph are read again
+            // at the next refresh, the journal size is a part of their stamp.
+            SightGraphJournalChanges changes;
+            snapshotChanges(changes);
+            journalBase.changedIds.clear();
+            journalBase.settingsChanged = false;
+
+            std::string entry;
+            if (makeGraphJournalEntry(changes, entry)) {
+                if (journalBase.journalSize == 0) {
+                    journalBase.journalSize = sizeof(SightGraphJournalHeader);
+                }
+                journalBase.journalSize += entry.size();
+                queueGraphJournal(filepath, std::move(entry));
+                if (project) {
+                    project->markGraphStale(filepath);
+                }
+            }
+            return CODE_OK;
+        }
+
+        SightGraphBinaryWriter data;
+        snapshot(data);
+        if (project && project->getTemplateUsageIndex().updateGraph(filepath, data)) {
+            project->markGraphStale(filepath);
+        }
+        // a full save, it also compacts the journal.
+        resetJournalBase();
+        queueGraphSave(filepath, binaryCachePathOf(filepath), std::move(data), saveReason);
+        return CODE_OK;
     }
 
     SightNodeGraph::SightNodeGraph() {
@@ -681,6 +1238,8 @@ namespace sight {
         this->nodes.clear();
         this->connections.clear();
         this->idMap.clear();
+        this->adjacency.clear();
+        this->batch = {};
     }
 
     void SightNodeGraph::rebuildIdMap() {
@@ -752,6 +1311,12 @@ namespace sight {
 
 
     void SightNodeGraph::addPortId(SightNodePort const& port) {
+        // the port vector may be reallocated.
+        if (port.node) {
+            markNodeAdjacencyStale(*port.node);
+        } else {
+            markAdjacencyStale();
+        }
         if (idMap.find(port.getId()) != idMap.end()) {
             logError("port id already exists: $0", port.getId());
             return;
@@ -778,44 +1343,61 @@ namespace sight {
 
     int SightNodeGraph::outputJson(std::string_view path, bool overwrite, SightNodeGraphOutputJsonConfig const& config) const {
         logDebug("try output json to $0", path);
-        using namespace v8;
+
+        // check path has file ?
+        if (std::filesystem::exists(path) && !overwrite) {
+            return CODE_FILE_EXISTS;
+        }
+
+        // json is written while walking the graph, into a temp file, so a failed output does not break the old file.
+        std::filesystem::path target(path);
+        auto tempPath = target;
+        tempPath.replace_filename("." + target.filename().generic_string() + ".tmp");
+        std::ofstream out(tempPath, std::ios::trunc | std::ios::binary);
+        if (!out.is_open()) {
+            return CODE_FILE_ERROR;
+        }
 
         int status = CODE_OK;
-        auto setValue = [&status](crude_json::value& tmp, const SightNodeValue& value) {
+        SightJsonWriter writer(out, 2);
+
+        auto writeValue = [&status, &writer](const SightNodeValue& value) {
             switch (value.getType()) {
             case IntTypeString:
-                tmp[VALUE_STR] = value.getString();
+                writer.value(value.getString());
                 break;
             case IntTypeLargeString:
-                tmp[VALUE_STR] = value.getLargeStringCopy();
+                writer.value(std::string_view(value.u.largeString.pointer, value.u.largeString.size));
                 break;
             case IntTypeFloat:
-                tmp[VALUE_STR] = value.u.f;
+                writer.value(static_cast<double>(value.u.f));
                 break;
             case IntTypeInt:
-                tmp[VALUE_STR] = value.u.i * 1.0;
+                writer.value(value.u.i * 1.0);
                 break;
             case IntTypeDouble:
             case IntTypeLong:
-                tmp[VALUE_STR] = value.u.d;
+                writer.value(value.u.d);
                 break;
             case IntTypeBool:
-                tmp[VALUE_STR] = value.u.b;
+                writer.value(value.u.b);
                 break;
             case IntTypeProcess:
                 logWarning("not support process type, will fill use an empty array.");
-                tmp[VALUE_STR] = crude_json::value(crude_json::type_t::array);
+                writer.beginArray().endArray();
                 break;
             default:
             {
                 auto [typeInfo, isFind] = currentProject()->findTypeInfo(value.getType());
                 if (isFind) {
-                    if (!typeInfo.writeToJson(value, tmp, VALUE_STR)) {
+                    if (!typeInfo.writeToJson(value, writer)) {
                         logError("failed to write to json: $0", typeInfo.getSimpleName());
+                        writer.null();
                         status = CODE_FAIL;
                     }
                 } else {
                     logError("unknown type: $0", value.getType());
+                    writer.null();
                     status = CODE_FAIL;
                 }
                 break;
@@ -824,199 +1406,400 @@ namespace sight {
             }
         };
 
-        auto doComponents = [](crude_json::value& parent, SightComponentContainer* componentContainer) {
-            // logDebug("doComponents, component valid: $0", componentContainer != nullptr);
-            if (!componentContainer) {
-                return;
+        auto nodeFunc = [&config, &writeValue, &writer](std::vector<SightNodePort> const& list) {
+            for (auto& item : list) {
+                if (item.portName.empty()) {
+                    // title input/output port
+                    continue;
+                }
+
+                writer.beginObject();
+                writer.key("name").value(changeStringToCase(item.portName.str(), config.fieldNameCaseType));
+                writer.key("id").value(item.id * 1.0);
+                if (item.templateNodePort) {
+                    writer.key(VALUE_STR);
+                    writeValue(item.value);
+                }
+                writer.endObject();
             }
+        };
 
-            auto isolate = getJsIsolate();
-            for (auto& item : componentContainer->components) {
-                const auto& component = item->templateNode->component;
-                if (!component.appendDataToOutput) {
+        // keys: written keys of `data`, the first port wins.
+        auto dataNodeFunc = [&config, &writeValue, &writer](std::vector<SightNodePort> const& list, absl::flat_hash_set<std::string>& keys) {
+            for (auto& item : list) {
+                if (item.portName.empty()) {
+                    // title input/output port
+                    continue;
+                }
+                if (item.getType() != IntTypeProcess && item.isConnect()) {
+                    //  if this is connected, then it should using the port value.   todo
                     continue;
                 }
 
-                auto result = component.appendDataToOutput.callByReadonly(isolate, item);
-                if (!result.IsEmpty()) {
-                    // v8::JSON::Stringify(Local<Context> context, Local<Value> json_object)
-                    std::string str = v8pp::from_v8<std::string>(isolate, result.ToLocalChecked());
-                    // logDebug("try append string: $0", str);
+                auto key = changeStringToCase(item.portName.str(), config.fieldNameCaseType);
+                if (!keys.insert(key).second) {
+                    logDebug("key $0 repeat, so jump it." , key);
+                    continue;
+                }
 
-                    // convert and merge
-                    auto fromComponent = crude_json::value::parse(str);
-                    if (!fromComponent.is_object()) {
-                        logError("append data failed, component not return object json string: $0", item->nodeId);
-                        continue;
+                writer.key(key);
+                if (item.getType() == IntTypeProcess) {
+                    writer.beginArray();
+                    for (auto& connection : item.connections) {
+                        writer.value(connection->connectionId * 1.0);
                     }
+                    writer.endArray();
+                } else {
+                    writeValue(item.value);
+                }
+            }
+        };
 
-                    // loop of
-                    for (const auto& item : fromComponent.underlyingObject()) {
-                        if (parent.contains(item.first)) {
-                            logError("append data failed, component already exists: $0", item.first);
-                            continue;
-                        }
+        writer.beginObject();
 
-                        parent[item.first] = item.second;
-                    }
+        // nodes
+        writer.key(config.nodeRootName).beginArray();
+        absl::flat_hash_set<std::string> keys;
+        this->loopOf([&](const SightNode* np) {
+            const auto& item = *np;
+            writer.beginObject();
+            writer.key("id").value(item.nodeId * 1.0);
+            writer.key("name").value(item.nodeName);
+            if (item.templateNode) {
+                // templateName
+                writer.key("templateName").value(item.templateNode->nodeName);
+            }
+
+            writer.key("members").beginArray();
+            CALL_NODE_FUNC(np);
+            writer.endArray();
+
+            if (config.exportData) {
+                keys.clear();
+                writer.key("data").beginObject();
+                dataNodeFunc(item.fields, keys);
+                dataNodeFunc(item.inputPorts, keys);
+                dataNodeFunc(item.outputPorts, keys);
+                writer.endObject();
+            }
+            writer.endObject();
+        });
+        writer.endArray();
+
+        // connections
+        writer.key(config.connectionRootName).beginArray();
+        this->loopOf([&](const SightNodeConnection* c) {
+            if (status != CODE_OK) {
+                return;
+            }
+            const auto& item = *c;
+
+            keys = { "id", "left", "right" };
+            writer.beginObject();
+            writer.key("id").value(item.connectionId * 1.0);
+            writer.key("left").value(item.left * 1.0);
+            writer.key("right").value(item.right * 1.0);
+
+            if (config.includeNodeIdOnConnectionData) {
+                auto port = item.findLeftPort();
+                if (port) {    
+                    writer.key("leftNode").value(port->getNodeId() * 1.0);
+                    keys.insert("leftNode");
+                }
+
+                port = item.findRightPort();
+                if (port) {     
+                    writer.key("rightNode").value(port->getNodeId() * 1.0);
+                    keys.insert("rightNode");
                 }
             }
-        };
 
-        // check path has file ?
-        if (std::filesystem::exists(path)) {
-            if (!overwrite) {
-                return CODE_FILE_EXISTS;
+            if (writeComponentData(item.componentContainer, writer, keys) != CODE_OK) {
+                status = CODE_FAIL;
+            } else {
+                writer.endObject();
             }
+        });
 
-            // delete
-            // std::filesystem::remove(path);
+        std::error_code ec;
+        if (status == CODE_OK) {
+            writer.endArray();
+            writer.endObject();
+            out << '\n';
+            out.close();
+            if (!writer.done() || out.fail()) {
+                status = CODE_FILE_ERROR;
+            } else {
+                std::filesystem::rename(tempPath, target, ec);
+                if (ec) {
+                    status = CODE_FILE_ERROR;
+                }
+            }
+        }
+        if (status != CODE_OK) {
+            out.close();
+            std::filesystem::remove(tempPath, ec);
+        }
+        
+        logDebug("output json to $0 over: $1 ", path, status);
+        return status;
+    }
+
+    int SightNodeGraph::outputRuntimeGraph(std::string_view path, bool overwrite, SightNodeGraphOutputJsonConfig const& config) const {
+        namespace rt = sight::runtime;
+        logDebug("try output runtime graph to $0", path);
+
+        if (std::filesystem::exists(path) && !overwrite) {
+            return CODE_FILE_EXISTS;
         }
 
-        // generate json
-        crude_json::value root;
-        crude_json::value nodes;
-        crude_json::value connections;
+        int status = CODE_OK;
+        std::string strings;
+        absl::flat_hash_map<std::string, rt::StringRef> stringRefs;
+        auto addString = [&strings, &stringRefs](std::string_view str) {
+            auto [iter, inserted] = stringRefs.try_emplace(str);
+            if (inserted) {
+                iter->second = { static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(str.size()) };
+                strings.append(str);
+                strings.push_back('\0');
+            }
+            return iter->second;
+        };
+
+        std::vector<rt::Node> nodes;
+        std::vector<rt::Member> members;
+        std::vector<rt::DataItem> dataItems;
+        std::vector<rt::Connection> connections;
+        std::vector<uint32_t> ids;
 
-        auto nodeFunc = [&config, &setValue](std::vector<SightNodePort> const& list, crude_json::value& root) {
-            // logDebug("list size: $0", list.size());
+        auto toValue = [&status, &addString](const SightNodeValue& value, rt::Value& out) {
+            switch (value.getType()) {
+            case IntTypeString:
+                out.kind = rt::ValueKind::String;
+                out.u.string = addString(value.getString());
+                break;
+            case IntTypeLargeString:
+                out.kind = rt::ValueKind::String;
+                out.u.string = addString(std::string_view(value.u.largeString.pointer, value.u.largeString.size));
+                break;
+            case IntTypeFloat:
+                out.kind = rt::ValueKind::Float;
+                out.u.f = value.u.f;
+                break;
+            case IntTypeInt:
+                out.kind = rt::ValueKind::Int;
+                out.u.i = value.u.i;
+                break;
+            case IntTypeDouble:
+            case IntTypeLong:
+                out.kind = rt::ValueKind::Double;
+                out.u.d = value.u.d;
+                break;
+            case IntTypeBool:
+                out.kind = rt::ValueKind::Bool;
+                out.u.b = value.u.b ? 1 : 0;
+                break;
+            case IntTypeProcess:
+                // same as json, an empty array.
+                out.kind = rt::ValueKind::Ids;
+                break;
+            default:
+            {
+                auto [typeInfo, isFind] = currentProject()->findTypeInfo(value.getType());
+                if (isFind && typeInfo.render.kind == TypeInfoRenderKind::ComboBox) {
+                    out.kind = rt::ValueKind::Int;
+                    out.u.i = value.u.i;
+                } else {
+                    logError("unknown type: $0", value.getType());
+                    status = CODE_FAIL;
+                }
+                break;
+            }
+            }
+        };
+
+        auto nodeFunc = [&config, &members, &addString, &toValue](std::vector<SightNodePort> const& list) {
             for (auto& item : list) {
                 if (item.portName.empty()) {
                     // title input/output port
                     continue;
                 }
 
-                crude_json::value tmp;
-                tmp["name"] = changeStringToCase(item.portName, config.fieldNameCaseType);
-                tmp["id"] = item.id * 1.0;
+                auto& member = members.emplace_back();
+                member.name = addString(changeStringToCase(item.portName.str(), config.fieldNameCaseType));
+                member.id = item.id;
                 if (item.templateNodePort) {
-                    setValue(tmp, item.value);
+                    toValue(item.value, member.value);
                 }
-
-                root.push_back(tmp);
             }
         };
 
-        auto dataNodeFunc = [&config, &setValue](std::vector<SightNodePort> const& list, crude_json::value& root) {
+        absl::flat_hash_set<std::string> keys;
+        auto dataNodeFunc = [&config, &dataItems, &ids, &keys, &addString, &toValue](std::vector<SightNodePort> const& list) {
             for (auto& item : list) {
-                if (item.portName.empty()) {
-                    // title input/output port
+                if (item.portName.empty() || (item.getType() != IntTypeProcess && item.isConnect())) {
+                    continue;
+                }
+                auto key = changeStringToCase(item.portName.str(), config.fieldNameCaseType);
+                if (!keys.insert(key).second) {
                     continue;
                 }
 
-                crude_json::value tmp;
+                auto& dataItem = dataItems.emplace_back();
+                dataItem.key = addString(key);
                 if (item.getType() == IntTypeProcess) {
-                    crude_json::value connectionArray(crude_json::type_t::array);
+                    dataItem.value.kind = rt::ValueKind::Ids;
+                    dataItem.value.u.ids.first = static_cast<uint32_t>(ids.size());
+                    dataItem.value.u.ids.count = static_cast<uint32_t>(item.connections.size());
                     for (auto& connection : item.connections) {
-                        connectionArray.push_back(crude_json::value((double)connection->connectionId));
+                        ids.push_back(connection->connectionId);
                     }
-                    tmp[VALUE_STR] 	= connectionArray;
                 } else {
-                    if (item.isConnect()) {
-                        continue;
-                    }
-
-                    //  if this is connected, then it should using the port value.   todo
-                    setValue(tmp, item.value);
+                    toValue(item.value, dataItem.value);
                 }
+            }
+        };
 
-                auto key = changeStringToCase(item.portName, config.fieldNameCaseType);
-                // contains key, then ignore
-                auto const& map = root.underlyingObject();
-                if (map.find(key) != map.end()) {
-                    logDebug("key $0 repeat, so jump it." , key);
-                    continue;
+        auto rightConnectionFunc = [&ids](std::vector<SightNodePort> const& list) {
+            for (auto& item : list) {
+                for (auto& connection : item.connections) {
+                    if (connection->left == item.id) {
+                        ids.push_back(connection->connectionId);
+                    }
                 }
-
-                root[key] = tmp[VALUE_STR];
             }
         };
 
-        // fill nodes data
-        auto index = -1;
-        auto nodeWork = [&](const SightNode* np) {
-            index++;
-
+        this->loopOf([&](const SightNode* np) {
             const auto& item = *np;
-            crude_json::value node;
-            node["id"] = item.nodeId * 1.0;
-            node["name"] = item.nodeName;
+            rt::Node node;
+            node.id = item.nodeId;
+            node.name = addString(item.nodeName);
             if (item.templateNode) {
-                // templateName
-                node["templateName"] = item.templateNode->nodeName;
+                node.templateName = addString(item.templateNode->nodeName);
             }
 
-            //
-            crude_json::value members{ crude_json::type_t::array };
-            CALL_NODE_FUNC(np, members);
-            node["members"] = members;
+            node.firstMember = static_cast<uint32_t>(members.size());
+            CALL_NODE_FUNC(np);
+            node.memberCount = static_cast<uint32_t>(members.size()) - node.firstMember;
 
             if (config.exportData) {
-                crude_json::value data{ crude_json::type_t::object };
-                dataNodeFunc(item.fields, data);
-                dataNodeFunc(item.inputPorts, data);
-                dataNodeFunc(item.outputPorts, data);
-
-                node["data"] = data;
+                keys.clear();
+                node.firstData = static_cast<uint32_t>(dataItems.size());
+                dataNodeFunc(item.fields);
+                dataNodeFunc(item.inputPorts);
+                dataNodeFunc(item.outputPorts);
+                node.dataCount = static_cast<uint32_t>(dataItems.size()) - node.firstData;
             }
 
-            nodes[index] = node;
-        };
-        
-        this->loopOf(nodeWork);
-
-        
-        // fill connections data
-        index = -1;
-        auto connWork = [&](const SightNodeConnection* c) {
-            index++;
+            if (config.includeRightConnections) {
+                node.firstRightConnection = static_cast<uint32_t>(ids.size());
+                rightConnectionFunc(item.inputPorts);
+                rightConnectionFunc(item.outputPorts);
+                rightConnectionFunc(item.fields);
+                node.rightConnectionCount = static_cast<uint32_t>(ids.size()) - node.firstRightConnection;
+            }
+            nodes.push_back(node);
+        });
 
+        this->loopOf([&](const SightNodeConnection* c) {
+            if (status != CODE_OK) {
+                return;
+            }
             const auto& item = *c;
-
-            crude_json::value connection;
-
-            connection["id"] = item.connectionId * 1.0;
-            connection["left"] = item.left * 1.0;
-            connection["right"] = item.right * 1.0;
-
+            rt::Connection connection;
+            connection.id = item.connectionId;
+            connection.left = item.left;
+            connection.right = item.right;
             if (config.includeNodeIdOnConnectionData) {
-                auto port = item.findLeftPort();
-                if (port) {    
-                    connection["leftNode"] = port->getNodeId() * 1.0;
+                if (auto port = item.findLeftPort()) {
+                    connection.leftNode = port->getNodeId();
                 }
-
-                port = item.findRightPort();
-                if (port) {     
-                    connection["rightNode"] = port->getNodeId() * 1.0;
+                if (auto port = item.findRightPort()) {
+                    connection.rightNode = port->getNodeId();
                 }
             }
 
-            doComponents(connection, item.componentContainer);
-            connections[index] = connection;
-        };
-
-        this->loopOf(connWork);
-
-        if (status == CODE_OK) {
-            // get file output stream
-            std::ofstream out;
-            out.open(path.data(), std::ios::trunc);
-
-            if (!out.is_open()) {
-                return CODE_FILE_ERROR;
+            if (item.componentContainer && !item.componentContainer->components.empty()) {
+                std::ostringstream out;
+                SightJsonWriter writer(out, 0);
+                keys.clear();
+                writer.beginObject();
+                if (writeComponentData(item.componentContainer, writer, keys) != CODE_OK) {
+                    status = CODE_FAIL;
+                    return;
+                }
+                writer.endObject();
+                if (!keys.empty()) {
+                    connection.componentData = addString(out.str());
+                }
             }
+            connections.push_back(connection);
+        });
 
-            root[config.nodeRootName] = nodes;
-            root[config.connectionRootName] = connections;
+        if (status != CODE_OK) {
+            logDebug("output runtime graph to $0 over: $1 ", path, status);
+            return status;
+        }
 
-            out << root.dump(2);
-            out.close();
+        auto byId = [](auto const& a, auto const& b) { return a.id < b.id; };
+        std::sort(nodes.begin(), nodes.end(), byId);
+        std::sort(connections.begin(), connections.end(), byId);
+
+        rt::Header header;
+        std::memcpy(header.magic, rt::graphMagic, sizeof(header.magic));
+        header.nodeRootName = addString(config.nodeRootName);
+        header.connectionRootName = addString(config.connectionRootName);
+        header.caseType = static_cast<uint32_t>(config.fieldNameCaseType);
+        if (config.exportData) {
+            header.flags |= rt::HeaderFlags::ExportData;
         }
-        
-        logDebug("output json to $0 over: $1 ", path, status);
+        if (config.includeRightConnections) {
+            header.flags |= rt::HeaderFlags::IncludeRightConnections;
+        }
+        if (config.includeNodeIdOnConnectionData) {
+            header.flags |= rt::HeaderFlags::IncludeNodeIdOnConnectionData;
+        }
+
+        std::string buffer(sizeof(header), '\0');
+        auto appendSection = [&buffer](rt::Section& section, const void* data, size_t count, size_t recordSize) {
+            buffer.resize((buffer.size() + 7) & ~static_cast<size_t>(7), '\0');
+            section.offset = buffer.size();
+            section.count = count;
+            buffer.append(static_cast<const char*>(data), count * recordSize);
+        };
+        appendSection(header.strings, strings.data(), strings.size(), 1);
+        appendSection(header.nodes, nodes.data(), nodes.size(), sizeof(rt::Node));
+        appendSection(header.members, members.data(), members.size(), sizeof(rt::Member));
+        appendSection(header.data, dataItems.data(), dataItems.size(), sizeof(rt::DataItem));
+        appendSection(header.connections, connections.data(), connections.size(), sizeof(rt::Connection));
+        appendSection(header.ids, ids.data(), ids.size(), sizeof(uint32_t));
+        std::memcpy(buffer.data(), &header, sizeof(header));
+
+        status = writeFileAtomic(path, buffer) ? CODE_OK : CODE_FILE_ERROR;
+        logDebug("output runtime graph to $0 over: $1 ", path, status);
         return status;
     }
 
+    void prefetchGraph(std::string_view yamlPath) {
+        PrefetchedGraph item;
+        item.path = yamlPath;
+        if (!graphSourceStamp(yamlPath, item.size, item.modifyTime)) {
+            return;
+        }
+        int status = readGraphYamlRecords(yamlPath, item.data);
+        if (status != CODE_OK) {
+            logDebug("prefetch graph failed: $0, $1", yamlPath, status);
+            return;
+        }
+        if (getSightSettings()->graphJournal && hasGraphJournal(yamlPath)) {
+            item.journalEntries = replayGraphJournal(yamlPath, item.data, &item.journalSize);
+        }
+
+        std::lock_guard lock(prefetchMutex);
+        prefetchedGraph = std::move(item);
+    }
+
     SightComponentContainer* SightNodeGraph::createComponentContainer() {
         auto c = this->componentContainers.add();
         c->graph = this;
@@ -1047,8 +1830,9 @@ namespace sight {
             return CODE_NODE_HAS_CONNECTIONS;
         }
 
-        
+        // markAsDeleted also marks rows of its ports stale.
         node->markAsDeleted();
+        markDirty(node->nodeId);
         SimpleEventBus::nodeRemoved()->dispatch(*node);
         return CODE_OK;
     }
@@ -1056,6 +1840,7 @@ namespace sight {
     int SightNodeGraph::fakeDeleteConnection(SightNodeConnection* connection) {
         connection->removeRefs();
         connection->markAsDeleted();
+        markDirty(connection->connectionId);
         return CODE_OK;
     }
 
@@ -1104,18 +1889,22 @@ namespace sight {
                 if (c->leftPortId() == fromPort->getId()) {
                     c->left = toPort->getId();     // this way will keep all connection info.
                     toPort->addConnection(c);
+                    batch.unsortedPorts.insert(toPort->getId());
 
                 } else if (c->rightPortId() == fromPort->getId()) {
                     c->right = toPort->getId();
                     toPort->addConnection(c);
+                    batch.unsortedPorts.insert(toPort->getId());
                 } else {
                     logError("connection $0 ids are not match. left=$0, right=$1", c->connectionId, c->leftPortId(), c->rightPortId());
                 }
             }
             connections.clear();
+            markPortAdjacencyStale(fromPort->getId());
 
         };
 
+        beginBatch();
         connectionFunc(from->chainInPort, to->chainInPort);
         connectionFunc(from->chainOutPort, to->chainOutPort);
 
@@ -1150,6 +1939,7 @@ namespace sight {
         to->position = from->position;
         from->position = pos;
 
+        commit();
         return true;
     }
 
@@ -1183,11 +1973,13 @@ namespace sight {
         auto oldLeftConnectionSize = leftTypeSafePort->connectionsSize();
         auto oldRightConnectionSize = rightTypeSafePort->connectionsSize();
         
+        beginBatch();
         connectionRightPort->removeConnection(connectionId);
         connection->right = leftTypeSafePort->getId();
         leftTypeSafePort->addConnection(connection);
 
         createConnection(rightTypeSafePort->getId(), connectionRightPort->getId());
+        commit();
 
         if (leftTypeSafePort->connections.size() != oldLeftConnectionSize + 1) {
             logError("something error left");
@@ -1223,8 +2015,8 @@ namespace sight {
             node->chainInPort->clearLinks();
             node->chainOutPort->clearLinks();
         } else if (titleBarOprType == 1) {
-            auto lc = node->chainInPort->connections[0];
-            auto rc = node->chainOutPort->connections[0];
+            auto lc = predecessors(node->chainInPort->getId()).front().connection;
+            auto rc = successors(node->chainOutPort->getId()).front().connection;
 
             lc->changeRight(rc->rightPortId());
 
@@ -1288,7 +2080,474 @@ namespace sight {
             saveAsJsonHistory.pop_back();     // 删除最后一个元素
         }
 
-        markDirty();
+        markSettingsDirty();
+    }
+
+    SightNodeGraphAdjacency const& SightNodeGraph::getAdjacency() {
+        if (adjacency.isStale()) {
+            adjacency.update(*this);
+        }
+        return adjacency;
+    }
+
+    void SightNodeGraph::markAdjacencyStale() {
+        adjacency.markStale();
+        structureVersion++;
+    }
+
+    void SightNodeGraph::markPortAdjacencyStale(uint portId) {
+        adjacency.markPortStale(portId);
+        structureVersion++;
+        // connections of the port are changed, the journal needs them too.
+        if (journalBase.valid) {
+            journalBase.changedIds.insert(portId);
+        }
+    }
+
+    void SightNodeGraph::markNodeAdjacencyStale(SightNode const& node) {
+        auto nodeFunc = [this](std::vector<SightNodePort> const& list) {
+            for (auto const& item : list) {
+                markPortAdjacencyStale(item.getId());
+                for (auto c : item.connections) {
+                    markPortAdjacencyStale(c->leftPortId());
+                    markPortAdjacencyStale(c->rightPortId());
+                }
+            }
+        };
+        CALL_NODE_FUNC(&node);
+        structureVersion++;
+    }
+
+    SightNodeGraphAdjacency::EdgeRange SightNodeGraph::successors(uint portId) {
+        return getAdjacency().successors(portId);
+    }
+
+    SightNodeGraphAdjacency::EdgeRange SightNodeGraph::predecessors(uint portId) {
+        return getAdjacency().predecessors(portId);
+    }
+
+    void SightNodeGraph::beginBatch() {
+        batch.depth++;
+    }
+
+    int SightNodeGraph::commit(bool rollbackOnEventError) {
+        if (batch.depth <= 0) {
+            logError("commit without beginBatch");
+            return CODE_FAIL;
+        }
+        if (--batch.depth > 0) {
+            return CODE_OK;
+        }
+
+        // take the state first, events may start a new batch.
+        auto state = std::move(batch);
+        batch = {};
+
+        for (const auto& id : state.unsortedPorts) {
+            auto port = findPort(id);
+            if (port) {
+                port->sortConnections();
+            }
+        }
+
+        bool eventFailed = false;
+        for (const auto& node : state.nodes) {
+            if (!node->callEventOnInstantiate()) {
+                eventFailed = true;
+            }
+        }
+        if (eventFailed && rollbackOnEventError) {
+            discardBatch(state);
+            return CODE_FAIL;
+        }
+        for (const auto& node : state.nodes) {
+            SimpleEventBus::nodeAdded()->dispatch(node);
+        }
+
+        // nodes of the batch are changed as a whole, their events may change them again.
+        for (const auto& node : state.nodes) {
+            markDirty(node->nodeId);
+        }
+        if (state.dirty) {
+            markEdited();
+        }
+        return CODE_OK;
+    }
+
+    void SightNodeGraph::rollback() {
+        if (batch.depth <= 0) {
+            return;
+        }
+
+        auto state = std::move(batch);
+        batch = {};
+        discardBatch(state);
+    }
+
+    void SightNodeGraph::discardBatch(BatchState const& state) {
+        // nothing is changed after rollback, keep the dirty flag.
+        auto oldEditing = this->editing;
+
+        // connections first, a node which has connections can not be deleted.
+        for (auto iter = state.connections.rbegin(); iter != state.connections.rend(); ++iter) {
+            delConnection(*iter);
+        }
+        for (auto iter = state.nodes.rbegin(); iter != state.nodes.rend(); ++iter) {
+            delNode(*iter);
+        }
+        this->editing = oldEditing;
+    }
+
+    bool SightNodeGraph::isInBatch() const {
+        return batch.depth > 0;
+    }
+
+    uint SightNodeGraph::getStructureVersion() const {
+        return structureVersion;
+    }
+
+    int SightNodeGraph::reclaimDeleted(absl::flat_hash_set<uint> const& referencedIds, int budget) {
+        if (batch.depth > 0) {
+            return 0;
+        }
+
+        // collect first, removing from SightArray while iterating it is not safe.
+        std::vector<uint> connectionIds;
+        for (auto const& item : connections) {
+            if (item.isDeleted() && !referencedIds.contains(item.connectionId)) {
+                connectionIds.push_back(item.connectionId);
+            }
+        }
+        std::vector<SightNode*> deletedNodes;
+        for (auto& item : nodes) {
+            if (item.isDeleted() && !referencedIds.contains(item.nodeId)) {
+                deletedNodes.push_back(&item);
+            }
+        }
+
+        // freed objects are not saved anyway, keep the dirty flag.
+        auto oldEditing = this->editing;
+        int count = 0;
+        for (auto id : connectionIds) {
+            if (budget > 0 && count >= budget) {
+                break;
+            }
+            // redo of Delete does not remove refs, so do it here.
+            if (delConnection(id, true) == CODE_OK) {
+                count++;
+            }
+        }
+        for (auto p : deletedNodes) {
+            if (budget > 0 && count >= budget) {
+                break;
+            }
+            if (p->hasConnections()) {
+                // a live connection still points to it, wait for it.
+                continue;
+            }
+            unregisterNodeIds(p);
+            // components are nodes of this graph, free them with the container.
+            if (p->componentContainer) {
+                removeComponentContainer(p->componentContainer);
+                p->componentContainer = nullptr;
+            }
+            if (nodes.remove(p)) {
+                count++;
+            }
+        }
+        this->editing = oldEditing;
+
+        if (count > 0) {
+            logDebug("reclaimed $0 deleted nodes/connections", count);
+        }
+        return count;
+    }
+
+    SightNodeGraphAnalysis const& SightNodeGraph::analyze() {
+        uint enterNode = settings.enterNode > 0 ? static_cast<uint>(settings.enterNode) : 0;
+        if (analysisVersion == structureVersion && analysis.enterNode == enterNode) {
+            return analysis;
+        }
+
+        analysis = {};
+        analysis.enterNode = enterNode;
+
+        // dense index
+        std::vector<SightNode*> list;
+        absl::flat_hash_map<uint, uint> indexOf;
+        loopOf([&list, &indexOf](SightNode* node) {
+            indexOf[node->getNodeId()] = static_cast<uint>(list.size());
+            list.push_back(node);
+        });
+
+        // process-chain edges, same as parseNode
+        auto& adjacency = getAdjacency();
+        std::vector<std::vector<uint>> next(list.size());
+        for (size_t i = 0; i < list.size(); i++) {
+            auto port = list[i]->findPortByProcess();
+            if (!port) {
+                continue;
+            }
+            for (const auto& edge : adjacency.successors(port->getId())) {
+                auto iter = indexOf.find(edge.target->node->getNodeId());
+                if (iter != indexOf.end()) {
+                    next[i].push_back(iter->second);
+                }
+            }
+        }
+
+        // reachability
+        constexpr uint none = static_cast<uint>(-1);
+        std::vector<bool> reachable(list.size(), false);
+        if (auto iter = indexOf.find(enterNode); iter != indexOf.end()) {
+            std::vector<uint> stack{ iter->second };
+            reachable[iter->second] = true;
+            while (!stack.empty()) {
+                auto v = stack.back();
+                stack.pop_back();
+                for (auto w : next[v]) {
+                    if (!reachable[w]) {
+                        reachable[w] = true;
+                        stack.push_back(w);
+                    }
+                }
+            }
+        }
+
+        // tarjan, iterative. components come out in reverse topological order.
+        std::vector<uint> order(list.size(), none), lowLink(list.size(), 0);
+        std::vector<bool> onStack(list.size(), false);
+        std::vector<uint> sccStack;
+        std::vector<std::vector<uint>> components;
+        // (vertex, next edge index)
+        std::vector<std::pair<uint, size_t>> callStack;
+        uint counter = 0;
+
+        for (uint root = 0; root < list.size(); root++) {
+            if (order[root] != none) {
+                continue;
+            }
+
+            callStack.push_back({ root, 0 });
+            while (!callStack.empty()) {
+                auto& [v, edgeIndex] = callStack.back();
+                if (edgeIndex == 0) {
+                    order[v] = lowLink[v] = counter++;
+                    sccStack.push_back(v);
+                    onStack[v] = true;
+                }
+
+                if (edgeIndex < next[v].size()) {
+                    auto w = next[v][edgeIndex++];
+                    if (order[w] == none) {
+                        callStack.push_back({ w, 0 });
+                    } else if (onStack[w]) {
+                        lowLink[v] = std::min(lowLink[v], order[w]);
+                    }
+                    continue;
+                }
+
+                // all edges of v are visited
+                auto current = v;
+                if (lowLink[current] == order[current]) {
+                    std::vector<uint> component;
+                    uint w = 0;
+                    do {
+                        w = sccStack.back();
+                        sccStack.pop_back();
+                        onStack[w] = false;
+                        component.push_back(w);
+                    } while (w != current);
+                    std::reverse(component.begin(), component.end());
+                    components.push_back(std::move(component));
+                }
+
+                callStack.pop_back();
+                if (!callStack.empty()) {
+                    auto parent = callStack.back().first;
+                    lowLink[parent] = std::min(lowLink[parent], lowLink[current]);
+                }
+            }
+        }
+
+        for (auto iter = components.rbegin(); iter != components.rend(); ++iter) {
+            auto const& component = *iter;
+            bool isCycle = component.size() > 1;
+            if (!isCycle) {
+                auto v = component.front();
+                isCycle = std::find(next[v].begin(), next[v].end(), v) != next[v].end();
+            }
+
+            if (isCycle) {
+                std::vector<uint> ids;
+                ids.reserve(component.size());
+                for (auto v : component) {
+                    ids.push_back(list[v]->getNodeId());
+                }
+                if (reachable[component.front()]) {
+                    analysis.reachableCycles.push_back(analysis.cycles.size());
+                }
+                analysis.cycles.push_back(std::move(ids));
+            }
+
+            for (auto v : component) {
+                if (reachable[v]) {
+                    analysis.topologicalOrder.push_back(list[v]->getNodeId());
+                } else {
+                    analysis.unreachableNodes.push_back(list[v]->getNodeId());
+                }
+            }
+        }
+
+        analysisVersion = structureVersion;
+        return analysis;
+    }
+
+    std::string SightNodeGraphAnalysis::cycleMessage() const {
+        std::string msg;
+        for (const auto& index : reachableCycles) {
+            auto const& ids = cycles[index];
+            msg += "cycle: ";
+            for (const auto& id : ids) {
+                msg += std::to_string(id);
+                msg += " -> ";
+            }
+            msg += std::to_string(ids.front());
+            msg += "\n";
+        }
+        return msg;
+    }
+
+    SightNodeGraphAdjacency::EdgeRange SightNodeGraphAdjacency::successors(uint portId) const {
+        assert(!isStale());
+        return find(outRows, portId);
+    }
+
+    SightNodeGraphAdjacency::EdgeRange SightNodeGraphAdjacency::predecessors(uint portId) const {
+        assert(!isStale());
+        return find(inRows, portId);
+    }
+
+    SightNodeGraphAdjacency::EdgeRange SightNodeGraphAdjacency::edgesOf(SightNodePort const& port) const {
+        if (port.kind == NodePortType::Input) {
+            return predecessors(port.getId());
+        }
+        return successors(port.getId());
+    }
+
+    void SightNodeGraphAdjacency::markStale() {
+        stale = true;
+        stalePorts.clear();
+    }
+
+    void SightNodeGraphAdjacency::markPortStale(uint portId) {
+        if (!stale) {
+            stalePorts.insert(portId);
+        }
+    }
+
+    bool SightNodeGraphAdjacency::isStale() const {
+        return stale || !stalePorts.empty();
+    }
+
+    void SightNodeGraphAdjacency::update(SightNodeGraph& graph) {
+        if (stale) {
+            rebuild(graph);
+            return;
+        }
+
+        for (auto portId : stalePorts) {
+            updatePort(graph, portId);
+        }
+        stalePorts.clear();
+    }
+
+    void SightNodeGraphAdjacency::rebuild(SightNodeGraph& graph) {
+        clear();
+
+        graph.loopOf([&](SightNodeConnection* c) {
+            auto left = graph.findPort(c->leftPortId());
+            auto right = graph.findPort(c->rightPortId());
+            if (!left || !right) {
+                return;
+            }
+
+            outRows[c->leftPortId()].push_back({ c, left, right });
+            inRows[c->rightPortId()].push_back({ c, right, left });
+        });
+
+        // order every row the same way as SightNodePort::sortConnections
+        for (auto rows : { &outRows, &inRows }) {
+            for (auto& [portId, row] : *rows) {
+                sortRow(row);
+            }
+        }
+
+        stale = false;
+    }
+
+    void SightNodeGraphAdjacency::clear() {
+        outRows.clear();
+        inRows.clear();
+        stalePorts.clear();
+        stale = true;
+    }
+
+    SightNodeGraphAdjacency::EdgeRange SightNodeGraphAdjacency::find(Rows const& rows, uint portId) {
+        auto iter = rows.find(portId);
+        if (iter == rows.end() || iter->second.empty()) {
+            return {};
+        }
+
+        auto data = iter->second.data();
+        return { data, data + iter->second.size() };
+    }
+
+    void SightNodeGraphAdjacency::sortRow(std::vector<SightNodeGraphEdge>& row) {
+        if (row.size() > 1) {
+            std::sort(row.begin(), row.end(), [](SightNodeGraphEdge const& e1, SightNodeGraphEdge const& e2) {
+                return SightNodeConnection::orderBefore(e1.connection, e2.connection);
+            });
+        }
+    }
+
+    void SightNodeGraphAdjacency::updatePort(SightNodeGraph& graph, uint portId) {
+        auto port = graph.findPort(portId);
+        if (!port) {
+            outRows.erase(portId);
+            inRows.erase(portId);
+            return;
+        }
+
+        // same edges as `rebuild` makes for this port, from the connections which the port holds.
+        std::vector<SightNodeGraphEdge> outRow;
+        std::vector<SightNodeGraphEdge> inRow;
+        for (auto c : port->connections) {
+            if (c->isDeleted()) {
+                continue;
+            }
+            if (c->leftPortId() == portId) {
+                if (auto right = graph.findPort(c->rightPortId())) {
+                    outRow.push_back({ c, port, right });
+                }
+            }
+            if (c->rightPortId() == portId) {
+                if (auto left = graph.findPort(c->leftPortId())) {
+                    inRow.push_back({ c, port, left });
+                }
+            }
+        }
+
+        auto setRow = [portId](Rows& rows, std::vector<SightNodeGraphEdge>&& row) {
+            if (row.empty()) {
+                rows.erase(portId);
+            } else {
+                sortRow(row);
+                rows[portId] = std::move(row);
+            }
+        };
+        setRow(outRows, std::move(outRow));
+        setRow(inRows, std::move(inRow));
     }
 
     SightNodePort* getReplaceablePort(std::vector<SightNodePort> &ports, SightNodePort const& targetPort, absl::flat_hash_set<uint> const& ignoreIds) {
@@ -21,6 +21,8 @@
 #include <atomic>
 #include <algorithm>
 #include <fstream>
+#include <deque>
+#include <mutex>
 #include <yaml-cpp/emittermanip.h>
 
 #include "sight_js_parser.h"
@@ -35,6 +37,8 @@
 #include "sight_project.h"
 #include "sight_ui.h"
 #include "sight_log.h"
+#include "sight_graph_binary.h"
+#include "sight_ui_search.h"
 
 #include "v8-json.h"
 #include "v8-local-handle.h"
@@ -46,6 +50,7 @@
 #include "v8pp/convert.hpp"
 #include "v8pp/class.hpp"
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_split.h"
 #include "v8pp/object.hpp"
@@ -73,11 +78,209 @@ namespace sight {
     namespace {
         // private members and functions
 
+        std::string_view templateAddressPath(std::string_view fullAddress) {
+            if (fullAddress.starts_with(addressPrefix)) {
+                fullAddress.remove_prefix(addressPrefixLen);
+            }
+            return fullAddress;
+        }
+
+        /**
+         * @brief One level of the template address tree, `indexes` is the index of `list` by name.
+         */
+        struct TemplateLevel {
+            std::vector<SightNodeTemplateAddress>* list;
+            absl::flat_hash_map<std::string, size_t>* indexes;
+
+            static TemplateLevel childrenOf(SightNodeTemplateAddress& address) {
+                return { &address.children, &address.childIndexes };
+            }
+
+            SightNodeTemplateAddress* find(std::string_view name) const {
+                auto iter = indexes->find(name);
+                return iter == indexes->end() ? nullptr : &(*list)[iter->second];
+            }
+
+            SightNodeTemplateAddress& add(SightNodeTemplateAddress&& address) {
+                (*indexes)[address.name] = list->size();
+                return list->emplace_back(std::move(address));
+            }
+
+            bool erase(std::string_view name) {
+                auto iter = indexes->find(name);
+                if (iter == indexes->end()) {
+                    return false;
+                }
+                auto index = iter->second;
+                indexes->erase(iter);
+                list->erase(list->begin() + index);
+                // the order is kept for the context menu, so indexes after it are moved.
+                for (auto& item : *indexes) {
+                    if (item.second > index) {
+                        item.second--;
+                    }
+                }
+                return true;
+            }
+        };
+
+        /**
+         * @brief Remove the template of `address` and templates of its children, at any depth,
+         * from `templateNodeMap` and the search index.
+         */
+        void unregisterTemplates(NodeEditorStatus& status, SightNodeTemplateAddress const& address) {
+            if (address.templateNode) {
+                auto const& fullName = address.templateNode->fullTemplateAddress;
+                status.templateNodeMap.erase(templateAddressPath(fullName));
+                removeTemplateFromSearch(fullName);
+            }
+            for (const auto& item : address.children) {
+                unregisterTemplates(status, item);
+            }
+        }
+
+        bool isSameValue(SightNodeValue const& lhs, SightNodeValue const& rhs) {
+            if (lhs.getType() != rhs.getType()) {
+                return false;
+            }
+            if (lhs.getType() == IntTypeLargeString) {
+                return std::strcmp(lhs.getLargeString(), rhs.getLargeString()) == 0;
+            }
+            return std::memcmp(&lhs.u, &rhs.u, sizeof(lhs.u)) == 0;
+        }
+
+        bool isSameTemplatePort(SightJsNodePort const& lhs, SightJsNodePort const& rhs) {
+            auto const& a = *lhs.options;
+            auto const& b = *rhs.options;
+            bool sameAlternatives = a.alternatives == b.alternatives
+                || (a.alternatives && b.alternatives && *a.alternatives == *b.alternatives);
+            return lhs.portName == rhs.portName && lhs.kind == rhs.kind && lhs.type == rhs.type
+                && a.showValue == b.showValue && a.show == b.show && a.readonly == b.readonly && a.errorMsg == b.errorMsg
+                && a.typeList == b.typeList && a.dynamic == b.dynamic && sameAlternatives
+                && isSameValue(lhs.value, rhs.value)
+                && lhs.onValueChange.sourceCode == rhs.onValueChange.sourceCode
+                && lhs.onAutoComplete.sourceCode == rhs.onAutoComplete.sourceCode
+                && lhs.onConnect.sourceCode == rhs.onConnect.sourceCode
+                && lhs.onDisconnect.sourceCode == rhs.onDisconnect.sourceCode
+                && lhs.onClick.sourceCode == rhs.onClick.sourceCode;
+        }
+
+        /**
+         * @brief Point ports of the nodes of `templateNode` in the current graph to its ports again, by name.
+         * Ports removed from the template become plain ports, ports added to the template are added to the nodes.
+         * Deleted nodes which are kept for undo and components are patched too, the old template ports are freed.
+         */
+        void patchTemplateInstances(SightJsNode const* templateNode) {
+            auto graph = currentGraph();
+            if (!graph) {
+                return;
+            }
+
+            int count = 0;
+            for (auto& item : graph->getNodes()) {
+                auto node = &item;
+                if (node->templateNode != templateNode) {
+                    continue;
+                }
+
+                bool portsAdded = false;
+                auto patchFunc = [node, graph, &portsAdded](std::vector<SightNodePort>& ports, std::vector<SightJsNodePort*> const& templatePorts) {
+                    for (auto& port : ports) {
+                        if (port.isTitleBarPort() || port.parent != 0) {
+                            continue;
+                        }
+                        auto iter = std::find_if(templatePorts.begin(), templatePorts.end(), [&port](SightJsNodePort const* item) {
+                            return item->portName == port.portName;
+                        });
+                        if (iter == templatePorts.end()) {
+                            // `type` is set when it is instantiated, the old template port is freed already.
+                            port.templateNodePort = nullptr;
+                            continue;
+                        }
+
+                        auto templatePort = *iter;
+                        port.templateNodePort = templatePort;
+                        port.kind = templatePort->kind;
+                        if (port.value.getType() != templatePort->type) {
+                            port.value = templatePort->value;
+                            port.oldValue = port.value;
+                        }
+                        // errorMsg and readonly may be set by scripts, they are kept. Other ports share the new options.
+                        if (port.options->errorMsg.empty() && port.options->readonly == templatePort->options->readonly) {
+                            port.options = templatePort->options;
+                        } else {
+                            auto& options = port.options.edit();
+                            options.showValue = templatePort->options->showValue;
+                            options.show = templatePort->options->show;
+                            options.typeList = templatePort->options->typeList;
+                            options.dynamic = templatePort->options->dynamic;
+                            options.alternatives = templatePort->options->alternatives;
+                        }
+                    }
+
+                    // ports forked from a dynamic port follow their parent.
+                    for (auto& port : ports) {
+                        if (port.parent == 0) {
+                            continue;
+                        }
+                        auto iter = std::find_if(ports.begin(), ports.end(), [&port](SightNodePort const& item) {
+                            return item.getId() == port.parent;
+                        });
+                        port.templateNodePort = iter == ports.end() ? nullptr : iter->templateNodePort;
+                    }
+
+                    std::vector<SightJsNodePort const*> newPorts;
+                    for (auto templatePort : templatePorts) {
+                        auto iter = std::find_if(ports.begin(), ports.end(), [templatePort](SightNodePort const& item) {
+                            return item.portName == templatePort->portName;
+                        });
+                        if (iter == ports.end()) {
+                            newPorts.push_back(templatePort);
+                        }
+                    }
+                    if (newPorts.empty()) {
+                        return;
+                    }
+
+                    // grow once, pointers to ports of this node are refreshed by the caller.
+                    ports.reserve(ports.size() + newPorts.size());
+                    for (auto templatePort : newPorts) {
+                        auto& port = ports.emplace_back(templatePort->instantiate());
+                        port.node = node;
+                        port.id = nextNodeOrPortId();
+                        // ports of a deleted node are registered when it is restored.
+                        if (!node->isDeleted()) {
+                            graph->addPortId(port);
+                        }
+                    }
+                    portsAdded = true;
+                };
+                patchFunc(node->inputPorts, templateNode->inputPorts);
+                patchFunc(node->outputPorts, templateNode->outputPorts);
+                patchFunc(node->fields, templateNode->fields);
+
+                // the port vectors may be moved. Other code holds ports by id (id map, SightNodePortHandle),
+                // only the chain ports and edges of the adjacency index keep pointers.
+                node->updateChainPortPointer();
+                if (portsAdded) {
+                    graph->markNodeAdjacencyStale(*node);
+                }
+                if (!node->isDeleted()) {
+                    graph->markDirty(node->nodeId);
+                    count++;
+                }
+            }
+
+            if (count > 0) {
+                logDebug("patched $0 nodes of $1", count, templateNode->fullTemplateAddress);
+            }
+        }
+
     }
 
     void onNodePortValueChange(SightNodePort* port) {
         auto node = port->node;
-        node->graph->editing = true;
+        node->graph->markDirty(port->getId());
         if (!port->templateNodePort) {
             return;
         }
@@ -117,6 +320,14 @@ namespace sight {
 
         char buf[FILENAME_BUF_SIZE];
         sprintf(buf, "%s.yaml", pathWithoutExt);
+        if (!std::filesystem::exists(buf)) {
+            // a graph which uses binary as primary format.
+            char binaryPath[FILENAME_BUF_SIZE];
+            snprintf(binaryPath, std::size(binaryPath), "%s%s", pathWithoutExt, SIGHT_GRAPH_BINARY_EXT);
+            if (std::filesystem::exists(binaryPath)) {
+                snprintf(buf, std::size(buf), "%s", binaryPath);
+            }
+        }
         g_NodeEditorStatus->loadOrCreateGraph(buf);
 
         if (CURRENT_GRAPH) {
@@ -186,7 +397,13 @@ namespace sight {
         }
 
         // remove connection
+        auto connection = *it;
         connections.erase(it);
+        if (auto g = getGraph()) {
+            g->markPortAdjacencyStale(this->getId());
+            g->markPortAdjacencyStale(connection->leftPortId());
+            g->markPortAdjacencyStale(connection->rightPortId());
+        }
 
         return true;
     }
@@ -213,18 +430,24 @@ namespace sight {
             }
         }
         connections.push_back(connection);
+        if (auto g = getGraph()) {
+            g->markPortAdjacencyStale(connection->leftPortId());
+            g->markPortAdjacencyStale(connection->rightPortId());
+        }
         return true;
     }
 
 
     void SightNodePort::sortConnections() {
+        // priority may be changed.
+        if (auto g = getGraph()) {
+            g->markPortAdjacencyStale(this->getId());
+        }
         if (this->connections.size() <= 1) {
             return;
         }
 
-        std::sort(connections.begin(), connections.end(), [](SightNodeConnection* c1, SightNodeConnection* c2) {
-            return c1->priority > c2->priority;
-        });
+        std::sort(connections.begin(), connections.end(), SightNodeConnection::orderBefore);
 
     }
 
@@ -268,21 +491,22 @@ namespace sight {
 
     int SightNode::addNewPort(std::string_view name, NodePortType kind, uint type, const SightJsNodePort* templateNodePort, uint parent) {
         assert(kind != NodePortType::Both);
+        SightPortName portName{ name };
         if (kind == NodePortType::Input) {
             for(auto const& item: this->inputPorts){
-                if(item.portName == name){
+                if(item.portName == portName){
                     return CODE_PORT_NAME_REPEAT;
                 }
             }
         } else if (kind == NodePortType::Output) {
             for(auto const& item: this->outputPorts){
-                if(item.portName == name){
+                if(item.portName == portName){
                     return CODE_PORT_NAME_REPEAT;
                 }
             }
         } else if (kind == NodePortType::Field) {
             for(auto const& item: this->fields){
-                if(item.portName == name){
+                if(item.portName == portName){
                     return CODE_PORT_NAME_REPEAT;
                 }
             }
@@ -291,8 +515,8 @@ namespace sight {
         }
         
         SightNodePort port(kind, type, templateNodePort);
-        port.portName = name;
-        logDebug("add new port: $0", port.portName);
+        port.portName = portName;
+        logDebug("add new port: $0", port.portName.str());
         port.node = this;
         port.id = nextNodeOrPortId();
         port.parent = parent;
@@ -301,7 +525,7 @@ namespace sight {
         addPort(port);
         if(graph){
             graph->addPortId(port);
-            graph->markDirty();
+            graph->markDirty(nodeId);
         }
 
         return CODE_OK;
@@ -364,8 +588,8 @@ namespace sight {
         this->templateNode = node->templateNode;
 
         if (generateId) {
-            graph->markDirty();
             this->nodeId = nextNodeOrPortId();
+            graph->markDirty(this->nodeId);
 
             if (copyFromType == CopyFromType::Duplicate) {
                 // ignore other types
@@ -374,6 +598,7 @@ namespace sight {
         }
 
         auto copyFunc = [copyFromType, this, generateId](std::vector<SightNodePort> const& src, std::vector<SightNodePort>& dst) {
+            dst.reserve(dst.size() + src.size());
             for (const auto &item : src) {
                 dst.push_back(item);
                 auto& port = dst.back();
@@ -409,11 +634,14 @@ namespace sight {
 
         if (copyFromType == CopyFromType::Duplicate) {
             updateChainPortPointer();
-            graph->markDirty();
+            graph->markDirty(nodeId);
         }
     }
 
     void SightNode::markAsDeleted(bool f) {
+        if (graph) {
+            graph->markNodeAdjacencyStale(*this);
+        }
 
         if (f) {
             this->flags |= (uchar)SightNodeFlags::Deleted;
@@ -455,30 +683,32 @@ namespace sight {
     }
 
     SightNodePortConnection SightNode::findConnectionByProcess() {
-        SightNodeConnection* connection = nullptr;
+        const SightNodeGraphEdge* edge = nullptr;
+        auto& adjacency = graph->getAdjacency();
 
         for (const auto &outputPort : outputPorts) {
-            if (!outputPort.isConnect()) {
+            auto edges = adjacency.successors(outputPort.getId());
+            if (edges.empty()) {
                 continue;
             }
 
             if (outputPort.getType() == IntTypeProcess) {
                 //
-                connection = outputPort.connections.front();
+                edge = &edges.front();
                 break;
             } else {
-                if (connection) {
+                if (edge) {
                     // has one.
-                    connection = nullptr;
+                    edge = nullptr;
                     break;
                 } else {
-                    connection = outputPort.connections.front();
+                    edge = &edges.front();
                 }
             }
         }
 
-        if (connection) {
-            return SightNodePortConnection(graph, connection, this);
+        if (edge) {
+            return *edge;
         }
         return {};
     }
@@ -603,9 +833,15 @@ namespace sight {
         }
 
         SightNodePortHandle portHandle = {};
-        auto func = [&portHandle, name, this](std::vector<SightNodePort> const& list) {
+        SightPortName portName;
+        if (!SightPortName::find(name, portName)) {
+            // never interned, so no port has this name.
+            return portHandle;
+        }
+
+        auto func = [&portHandle, &portName, this](std::vector<SightNodePort> const& list) {
             for (const auto& item : list) {
-                if (item.portName == name) {
+                if (item.portName == portName) {
                     portHandle.node = this;
                     portHandle.portId = item.id;
                     return true;
@@ -652,8 +888,8 @@ namespace sight {
         return nullptr;
     }
 
-    void SightNode::callEventOnInstantiate() {
-        templateNode->callEventOnInstantiate(this);
+    bool SightNode::callEventOnInstantiate() {
+        return templateNode->callEventOnInstantiate(this);
     }
 
     bool SightNode::checkAsComponent() const {
@@ -708,13 +944,13 @@ namespace sight {
         auto nodeFunc = [&object, isolate, &context](std::vector<SightNodePort> const& list) {
             for (const auto& item : list) {
                 auto v = getPortValue(isolate, item.getType(), item.value);
-                auto key = v8pp::to_v8(isolate, item.portName);
+                auto key = v8pp::to_v8(isolate, item.portName.str());
 
                 // check contains
                 auto hasResult = object->Has(context, key);
                 if (hasResult.IsJust() && hasResult.FromJust()) {
                     // already exists
-                    logWarning("port name already exists: $0", item.portName);
+                    logWarning("port name already exists: $0", item.portName.str());
                     continue;
                 }
 
@@ -755,7 +991,7 @@ namespace sight {
             this->originalInputPorts.push_back(copy);
             copy.kind = NodePortType::Output;
             this->originalOutputPorts.push_back(copy);
-            this->bothPortList.insert(port.portName);
+            this->bothPortList.insert(port.portName.str());
         } else if (port.kind == NodePortType::Field) {
             this->originalFields.push_back(port);
         }
@@ -784,6 +1020,29 @@ namespace sight {
         this->originalOutputPorts.clear();
     }
 
+    bool SightJsNode::isSameDefinition(SightJsNode const& node) const {
+        auto samePorts = [](std::vector<SightJsNodePort*> const& ports, std::vector<SightJsNodePort> const& originalPorts, std::vector<SightJsNodePort> const& nodePorts) {
+            if (ports.empty()) {
+                return std::equal(originalPorts.begin(), originalPorts.end(), nodePorts.begin(), nodePorts.end(), isSameTemplatePort);
+            }
+            return std::equal(ports.begin(), ports.end(), nodePorts.begin(), nodePorts.end(), [](SightJsNodePort const* lhs, SightJsNodePort const& rhs) {
+                return isSameTemplatePort(*lhs, rhs);
+            });
+        };
+
+        auto const& a = this->component;
+        auto const& b = node.component;
+        return nodeName == node.nodeName && options.titleBarPortType == node.options.titleBarPortType
+            && bothPortList == node.bothPortList && functionsSource == node.functionsSource
+            && onInstantiate.sourceCode == node.onInstantiate.sourceCode && onDestroyed.sourceCode == node.onDestroyed.sourceCode
+            && onReload.sourceCode == node.onReload.sourceCode && onMsg.sourceCode == node.onMsg.sourceCode
+            && a.active == b.active && a.onlyComponent == b.onlyComponent && a.allowNode == b.allowNode
+            && a.allowConnection == b.allowConnection && a.activeOnReverse == b.activeOnReverse
+            && samePorts(fields, originalFields, node.originalFields)
+            && samePorts(inputPorts, originalInputPorts, node.originalInputPorts)
+            && samePorts(outputPorts, originalOutputPorts, node.originalOutputPorts);
+    }
+
     // SightNode* SightJsNode::instantiate(bool generateId) const {
     //     throw std::runtime_error("not support instantiate");    // I do not want to use new operator.
 
@@ -845,6 +1104,7 @@ namespace sight {
         this->onDestroyed = node.onDestroyed;
         this->onReload = node.onReload;
         this->onMsg = node.onMsg;
+        this->functionsSource = node.functionsSource;
     }
 
     void SightJsNode::reset() {
@@ -868,7 +1128,7 @@ namespace sight {
                     typeStyle.maxCharSize = charSize;
                 }
 
-                if (isField || item.options.showValue) {
+                if (isField || item.options->showValue) {
                     int tmpWidth = 0;
                     switch (item.type) {
                     case IntTypeVector3:
@@ -932,8 +1192,11 @@ namespace sight {
         return nodeStyle.initialized;
     }
 
-    void SightJsNode::callEventOnInstantiate(SightNode* p) const {
-        onInstantiate(currentUIStatus()->isolate, p);
+    bool SightJsNode::callEventOnInstantiate(SightNode* p) const {
+        if (!onInstantiate) {
+            return true;
+        }
+        return !onInstantiate(currentUIStatus()->isolate, p).IsEmpty();
     }
 
     bool SightJsNode::checkAsComponent() const {
@@ -942,10 +1205,11 @@ namespace sight {
 
     void SightJsNode::instantiate(SightNode* p, bool generateId, SightNodeGraph* graph) const {
         auto portCopyFunc = [p](std::vector<SightJsNodePort*> const& src, std::vector<SightNodePort>& dst) {
+            // +1 for the chain port.
+            dst.reserve(dst.size() + src.size() + 1);
             for (const auto& item : src) {
-                auto copy = item->instantiate();
-                copy.templateNodePort = item;
-                dst.push_back(copy);
+                // instantiate() already points templateNodePort to item, and the name/alternatives are shared with it.
+                dst.push_back(item->instantiate());
                 auto& element = dst.back();
                 // element.oldValue = element.value;    // what this line means?
                 element.node = p;
@@ -1001,6 +1265,8 @@ namespace sight {
             auto & c = rightPort->connections;
             c.erase(std::remove(c.begin(), c.end(), this), c.end());
         }
+        graph->markPortAdjacencyStale(leftPortId());
+        graph->markPortAdjacencyStale(rightPortId());
     }
 
     void SightNodeConnection::makeRefs() {
@@ -1031,6 +1297,8 @@ namespace sight {
                 logError("connection already exists, port: $0, connection: $1", rightPortId(), connectionId);
             }            
         }
+        graph->markPortAdjacencyStale(leftPortId());
+        graph->markPortAdjacencyStale(rightPortId());
     }
 
     uint SightNodeConnection::leftPortId() const {
@@ -1079,6 +1347,10 @@ namespace sight {
     }
 
     void SightNodeConnection::markAsDeleted(bool f) {
+        if (graph) {
+            graph->markPortAdjacencyStale(leftPortId());
+            graph->markPortAdjacencyStale(rightPortId());
+        }
 
         if (f) {
             this->flags |= (uchar)SightNodeFlags::Deleted;
@@ -1116,6 +1388,8 @@ namespace sight {
             rp->removeConnection(this->connectionId);
             newRp->addConnection(this);
             this->right = newRight;
+            graph->markPortAdjacencyStale(leftPortId());
+            graph->markPortAdjacencyStale(newRight);
             return true;
         }
 
@@ -1134,12 +1408,43 @@ namespace sight {
             lp->removeConnection(this->connectionId);
             newLp->addConnection(this);
             this->left = newLeft;
+            graph->markPortAdjacencyStale(newLeft);
+            graph->markPortAdjacencyStale(rightPortId());
             return true;
         }
 
         return false;
     }
 
+    int SightNodeConnection::getPriority() const {
+        return this->priority;
+    }
+
+    void SightNodeConnection::setPriority(int priority) {
+        if (this->priority == priority) {
+            return;
+        }
+
+        this->priority = priority;
+        if (!graph) {
+            return;
+        }
+
+        if (auto lp = findLeftPort()) {
+            lp->sortConnections();
+        }
+        if (auto rp = findRightPort()) {
+            rp->sortConnections();
+        }
+    }
+
+    bool SightNodeConnection::orderBefore(SightNodeConnection const* c1, SightNodeConnection const* c2) {
+        if (c1->priority != c2->priority) {
+            return c1->priority > c2->priority;
+        }
+        return c1->connectionId < c2->connectionId;
+    }
+
 
     SightNode *SightAnyThingWrapper::asNode() const {
         if (type != SightAnyThingType::Node) {
@@ -1286,131 +1591,115 @@ namespace sight {
 
         SightJsNode* templateNode = templateAddress.templateNode;
         templateNode->fullTemplateAddress = templateAddress.name;
-        auto address = resolveAddress(templateAddress.name);
-        auto pointer = address;
-        // compare and put.
-        auto* list = &g_NodeEditorStatus->templateAddressList;
-
-        while (pointer) {
-            bool findElement = false;
-            if (!pointer->next) {
-                // no next, this is the last element, it should be the node's name.
-                // check name exist
-                auto findResult = std::find_if(list->begin(), list->end(), [pointer](SightNodeTemplateAddress const& address) {
-                    return address.name == pointer->part;
-                });
-
-                if (findResult == list->end()) {
-                    // not found
-                    templateNode->compact();
-                    auto tmpPointer = g_NodeEditorStatus->templateNodeArray.add(*templateNode);
-                    if (isUpdate) {   
-                        tmpPointer->nodeStyle.initialized = false;
-                    }
-                    auto tmpAddress = SightNodeTemplateAddress(pointer->part, tmpPointer);
-                    tmpAddress.setNodeMemoryFromArray();
-                    list->push_back(tmpAddress);
-                } else {
-                    // find
-                    std::string tmpMsg = "replace template node: ";
-                    tmpMsg += pointer->part;
-                    logDebug(tmpMsg);
-                    auto willCopy = *templateNode;
-
-                    // src1: pointers, src2:
-                    auto copyFunc = [](std::vector<SightJsNodePort*>& dst, std::vector<SightJsNodePort*>& src1, std::vector<SightJsNodePort>& src2) {
-                        if (!dst.empty()) {
-                            logDebug("Oops! dst not empty, clear!");
-                            dst.clear();
-                        }
-                        
-                        auto& templateNodePortArray = g_NodeEditorStatus->templateNodePortArray;
+        auto path = templateAddressPath(templateAddress.name);
+        std::vector<std::string_view> parts = absl::StrSplit(path, '/');
+        auto& status = *g_NodeEditorStatus;
+        TemplateLevel level{ &status.templateAddressList, &status.templateAddressIndexes };
+
+        // folders
+        for (size_t i = 0; i + 1 < parts.size(); i++) {
+            auto folder = level.find(parts[i]);
+            if (!folder) {
+                folder = &level.add(SightNodeTemplateAddress(std::string(parts[i])));
+            }
+            level = TemplateLevel::childrenOf(*folder);
+        }
+
+        // the node's name
+        auto const& name = parts.back();
+        auto findResult = level.find(name);
+        if (!findResult) {
+            templateNode->compact();
+            auto tmpPointer = status.templateNodeArray.add();
+            *tmpPointer = std::move(*templateNode);
+            if (isUpdate) {
+                tmpPointer->nodeStyle.initialized = false;
+            }
+            auto tmpAddress = SightNodeTemplateAddress(std::string(name), tmpPointer);
+            tmpAddress.setNodeMemoryFromArray();
+            level.add(std::move(tmpAddress));
+            status.templateNodeMap[path] = tmpPointer;
+            indexTemplateForSearch(templateAddress.name);
+        } else if (!findResult->templateNode) {
+            logError("template address is a folder: $0", templateAddress.name);
+            return -1;
+        } else if (findResult->templateNode->isSameDefinition(*templateNode)) {
+            // nothing is changed, so the style, ports and compiled events are kept, nodes of it are not touched.
+            // the js thread functions are new objects which belong to the reloaded module.
+            auto existing = findResult->templateNode;
+            existing->generateCodeWork = templateNode->generateCodeWork;
+            existing->onReverseActive = templateNode->onReverseActive;
+            existing->component.beforeGenerate = std::move(templateNode->component.beforeGenerate);
+            existing->component.afterGenerate = std::move(templateNode->component.afterGenerate);
+            existing->component.appendDataToOutput = std::move(templateNode->component.appendDataToOutput);
+        } else {
+            logDebug("replace template node: $0", name);
 
-                        // clear old data.
-                        for(auto& item: src1){
-                            templateNodePortArray.remove(item);
-                        }
-                        src1.clear();
+            // src1: pointers, src2:
+            auto copyFunc = [](std::vector<SightJsNodePort*>& dst, std::vector<SightJsNodePort*>& src1, std::vector<SightJsNodePort>& src2) {
+                if (!dst.empty()) {
+                    logDebug("Oops! dst not empty, clear!");
+                    dst.clear();
+                }
+                
+                auto& templateNodePortArray = g_NodeEditorStatus->templateNodePortArray;
 
-                        // copy data
-                        for( const auto& item: src2){
-                            dst.push_back(templateNodePortArray.add(item));
-                        }
-                        src2.clear();
+                // clear old data.
+                for(auto& item: src1){
+                    templateNodePortArray.remove(item);
+                }
+                src1.clear();
 
-                    };
+                // copy data
+                for( const auto& item: src2){
+                    dst.push_back(templateNodePortArray.add(item));
+                }
+                src2.clear();
 
-                    // copy and compact
-                    // fields, inputPorts, outputPorts
-                    copyFunc(willCopy.fields, findResult->templateNode->fields, willCopy.originalFields);
-                    copyFunc(willCopy.inputPorts, findResult->templateNode->inputPorts, willCopy.originalInputPorts);
-                    copyFunc(willCopy.outputPorts, findResult->templateNode->outputPorts, willCopy.originalOutputPorts);
+            };
 
-                    if (isUpdate) {
-                        willCopy.nodeStyle.initialized = false;
-                    }
-                    *findResult->templateNode = willCopy;
-                }
-                break;
-            }
+            // the node of `templateAddress` is not used after this, so it is moved instead of copied.
+            // fields, inputPorts, outputPorts
+            copyFunc(templateNode->fields, findResult->templateNode->fields, templateNode->originalFields);
+            copyFunc(templateNode->inputPorts, findResult->templateNode->inputPorts, templateNode->originalInputPorts);
+            copyFunc(templateNode->outputPorts, findResult->templateNode->outputPorts, templateNode->originalOutputPorts);
 
-            for(auto iter = list->begin(); iter != list->end(); iter++){
-                if (iter->name == pointer->part) {
-                    findElement = true;
-                    list = & iter->children;
-                    break;
-                }
+            if (isUpdate) {
+                templateNode->nodeStyle.initialized = false;
             }
+            *findResult->templateNode = std::move(*templateNode);
+            patchTemplateInstances(findResult->templateNode);
 
-            if (!findElement) {
-                list->push_back(SightNodeTemplateAddress(pointer->part));
-                list = & list->back().children;
+            if (auto project = currentProject()) {
+                project->markTemplateStale(templateAddress.name);
             }
-
-            pointer = pointer->next;
         }
 
-        freeAddress(address);
         return CODE_OK;
     }
 
     bool delTemplateNode(std::string_view fullName) {
-        auto address = resolveAddress(std::string{ fullName });
-        auto pointer = address;
-        auto* list = &g_NodeEditorStatus->templateAddressList;
-        bool delFlag = false;
-
-        while (pointer) {
-            if (!pointer->next) {
-                // this is the name
-                auto findResult = std::find_if(list->begin(), list->end(), [pointer](SightNodeTemplateAddress const& address) {
-                    return address.name == pointer->part;
-                });
-
-                if (findResult != list->end()) {
-                    list->erase(findResult);
-                    delFlag = true;
-                }
-            } else {
-                bool findElement = false;
-                for (auto iter = list->begin(); iter != list->end(); iter++) {
-                    if (iter->name == pointer->part) {
-                        findElement = true;
-                        list = &iter->children;
-                        break;
-                    }
-                }
-
-                if (!findElement) {
-                    list->push_back(SightNodeTemplateAddress(pointer->part));
-                    list = &list->back().children;
-                }
+        auto path = templateAddressPath(fullName);
+        std::vector<std::string_view> parts = absl::StrSplit(path, '/');
+        auto& status = *g_NodeEditorStatus;
+        TemplateLevel level{ &status.templateAddressList, &status.templateAddressIndexes };
+
+        for (size_t i = 0; i + 1 < parts.size(); i++) {
+            auto folder = level.find(parts[i]);
+            if (!folder) {
+                return false;
             }
+            level = TemplateLevel::childrenOf(*folder);
+        }
 
-            pointer = pointer->next;
+        auto address = level.find(parts.back());
+        if (!address) {
+            return false;
         }
-        freeAddress(address);
-        return delFlag;
+        // the template, or every template in the folder.
+        unregisterTemplates(status, *address);
+        level.erase(parts.back());
+        return true;
     }
 
     const SightJsNode* findTemplateNode(const SightNode *node) {
@@ -1464,7 +1753,7 @@ namespace sight {
         auto portWork = [&out, &writeFloatArray](SightNodePort const& item) {
             out << YAML::Key << item.id;
             out << YAML::Value << YAML::BeginMap;
-            out << YAML::Key << "name" << YAML::Value << item.portName;
+            out << YAML::Key << "name" << YAML::Value << item.portName.str();
             out << YAML::Key << "type" << YAML::Value << item.type;
 
             if(item.parent){
@@ -1528,7 +1817,7 @@ namespace sight {
             }
 
             out << YAML::Key << "options" << YAML::BeginMap;
-            out << YAML::Key << "customPortName" << YAML::Value << item.ownOptions.customPortName ;
+            out << YAML::Key << "customPortName" << YAML::Value << item.ownOptions.customPortName.str();
             out << YAML::Key << "dynamicPort" << YAML::Value << item.ownOptions.dynamicPort ;
             out << YAML::EndMap;
 
@@ -1650,7 +1939,7 @@ namespace sight {
     int loadPortInfo(YAML::detail::iterator_value const& item, NodePortType nodePortType, std::vector<SightNodePort>& list, bool useOldId) {
         auto id = item.first.as<uint>(0);
         auto values = item.second;
-        auto portName = values["name"].as<std::string>();
+        SightPortName portName{ values["name"].as<std::string>() };
         auto typeNode = values["type"];
         uint type = 0;
         if (typeNode.IsDefined()) {
@@ -1681,7 +1970,7 @@ namespace sight {
         }
         
         if (!pointer) {
-            logDebug("$0 not found", portName);
+            logDebug("$0 not found", portName.str());
             return CODE_FAIL;
         }
 
@@ -1844,18 +2133,13 @@ namespace sight {
     }
 
     int regenerateId(std::vector<SightNode*>& nodes, std::vector<SightNodeConnection>& connections, bool genConId) {
-        auto nodeFunc = [&connections](std::vector<SightNodePort>& list) {
+        // key: old port id, value: new port id
+        absl::flat_hash_map<uint, uint> portIdMap;
+        auto nodeFunc = [&portIdMap](std::vector<SightNodePort>& list) {
             for (auto& item : list) {
                 auto oldId = item.id;
                 item.id = nextNodeOrPortId();
-
-                for (auto& c : connections) {
-                    if (c.left == oldId) {
-                        c.left = item.id;
-                    } else if (c.right == oldId) {
-                        c.right = item.id;
-                    }
-                }
+                portIdMap[oldId] = item.id;
             }
         };
     
@@ -1865,6 +2149,15 @@ namespace sight {
             CALL_NODE_FUNC(item);
         }
 
+        for (auto& c : connections) {
+            if (auto iter = portIdMap.find(c.left); iter != portIdMap.end()) {
+                c.left = iter->second;
+            }
+            if (auto iter = portIdMap.find(c.right); iter != portIdMap.end()) {
+                c.right = iter->second;
+            }
+        }
+
         if (genConId) {
             for(auto& item: connections){
                 item.connectionId = nextNodeOrPortId();
@@ -2062,6 +2355,30 @@ namespace sight {
         return *this;
     }
 
+    SightNodeValue::SightNodeValue(SightNodeValue&& rhs) noexcept
+    {
+        this->type = rhs.type;
+        this->u = rhs.u;
+        if (type == IntTypeLargeString) {
+            // rhs do not own the buffer any more.
+            rhs.u.largeString = {};
+        }
+    }
+
+    SightNodeValue& SightNodeValue::operator=(SightNodeValue&& rhs) noexcept {
+        if (this != &rhs) {
+            if (this->type == IntTypeLargeString) {
+                stringFree();
+            }
+            this->type = rhs.type;
+            this->u = rhs.u;
+            if (type == IntTypeLargeString) {
+                rhs.u.largeString = {};
+            }
+        }
+        return *this;
+    }
+
     SightNodeValue::~SightNodeValue()
     {
         if (this->type == IntTypeLargeString) {
@@ -2143,16 +2460,17 @@ namespace sight {
         if (eventType == JsEventType::AutoComplete) {
             // 
             auto result = mayResult.ToLocalChecked();
-            auto & options = thisNodePort->options;
-            options.alternatives.clear();
+            auto & options = thisNodePort->options.edit();
+            // do not touch the old list, it may be shared with other ports.
+            auto alternatives = std::make_shared<std::vector<std::string>>();
             if (!result->IsNullOrUndefined()) {
                 if (result->IsArray()) {
-                    auto list = v8pp::from_v8<std::vector<std::string>>(isolate, result);
-                    options.alternatives.assign(list.begin(), list.end());
+                    *alternatives = v8pp::from_v8<std::vector<std::string>>(isolate, result);
                 } else if (IS_V8_STRING(result)) {
-                    options.alternatives.push_back(v8pp::from_v8<std::string>(isolate, result));
+                    alternatives->push_back(v8pp::from_v8<std::string>(isolate, result));
                 }
             }
+            options.alternatives = std::move(alternatives);
         }
     }
 
@@ -2222,6 +2540,99 @@ namespace sight {
         
     }
 
+    namespace {
+        /**
+         * @brief The global port name symbol table. Ports are created by both the js thread and the ui thread.
+         */
+        struct PortNameTable {
+            std::mutex mutex;
+            // index is the id, deque keeps the address of each name stable.
+            std::deque<std::string> names;
+            absl::flat_hash_map<std::string_view, uint> ids;
+
+            PortNameTable() {
+                names.emplace_back();
+            }
+        };
+
+        PortNameTable& portNameTable() {
+            static PortNameTable table;
+            return table;
+        }
+
+        const std::string emptyPortName;
+    }
+
+    SightPortName::SightPortName(std::string_view name) {
+        *this = name;
+    }
+
+    SightPortName& SightPortName::operator=(std::string_view name) {
+        if (name.empty()) {
+            this->id = 0;
+            this->pointer = &emptyPortName;
+            return *this;
+        }
+
+        auto& table = portNameTable();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        auto iter = table.ids.find(name);
+        if (iter != table.ids.end()) {
+            this->id = iter->second;
+        } else {
+            this->id = static_cast<uint>(table.names.size());
+            auto& str = table.names.emplace_back(name);
+            table.ids[str] = this->id;
+        }
+        this->pointer = &table.names[this->id];
+        return *this;
+    }
+
+    bool SightPortName::find(std::string_view name, SightPortName& out) {
+        if (name.empty()) {
+            out = SightPortName();
+            return true;
+        }
+
+        auto& table = portNameTable();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        auto iter = table.ids.find(name);
+        if (iter == table.ids.end()) {
+            return false;
+        }
+        out.id = iter->second;
+        out.pointer = &table.names[out.id];
+        return true;
+    }
+
+    uint SightPortName::getId() const {
+        return id;
+    }
+
+    std::string const& SightPortName::str() const {
+        return pointer ? *pointer : emptyPortName;
+    }
+
+    const char* SightPortName::c_str() const {
+        return str().c_str();
+    }
+
+    size_t SightPortName::size() const {
+        return str().size();
+    }
+
+    bool SightPortName::empty() const {
+        return id == 0;
+    }
+
+    bool SightPortName::operator==(SightPortName const& rhs) const {
+        return id == rhs.id;
+    }
+
+    bool SightPortName::operator==(std::string_view name) const {
+        return str() == name;
+    }
+
     void SightBaseNodePort::setKind(int intKind) {
         this->kind = NodePortType(intKind);
     }
@@ -2234,6 +2645,21 @@ namespace sight {
         return portName.c_str();
     }
 
+    SightBaseNodePortOptions const& SightBaseNodePort::getOptions() const {
+        return *options;
+    }
+
+    SightPortOptionsRef::SightPortOptionsRef()
+        : pointer(std::make_shared<SightBaseNodePortOptions>()) {
+    }
+
+    SightBaseNodePortOptions& SightPortOptionsRef::edit() {
+        if (pointer.use_count() > 1) {
+            pointer = std::make_shared<SightBaseNodePortOptions>(*pointer);
+        }
+        return *pointer;
+    }
+
     SightNodeGraph* SightNodePort::getGraph() {
         if (this->node) {
             return this->node->graph;
@@ -2299,36 +2725,17 @@ namespace sight {
     }
 
     SightJsNode* NodeEditorStatus::findTemplateNode(const char* path) {
-        auto address = resolveAddress(path);
-        auto pointer = address;
-        // compare and put.
-        auto* list = &g_NodeEditorStatus->templateAddressList;
-
-        bool findElement = false;
-        SightJsNode* result = nullptr;
-        while (pointer) {
-            for (auto iter = list->begin(); iter != list->end(); iter++) {
-                if (iter->name == pointer->part) {
-                    if (!pointer->next) {
-                        // the node
-                        result = iter->templateNode;
-                    }
-
-                    findElement = true;
-                    list = &iter->children;
-                    break;
-                }
-            }
-            if (!findElement || result) {
-                break;
-            }
-
-            pointer = pointer->next;
+        auto iter = templateNodeMap.find(templateAddressPath(path));
+        if (iter != templateNodeMap.end()) {
+            return iter->second;
         }
 
-
-        freeAddress(address);
-        return result;
+        // template nodes of entities are added when they are used, other threads call `ensureEntityTemplates` first.
+        auto project = currentProject();
+        if (project && isUIThread() && project->registerEntityTemplate(path)) {
+            return findTemplateNode(path);
+        }
+        return nullptr;
     }
 
     void NodeEditorStatus::updateTemplateNodeStyles() {
@@ -2381,6 +2788,21 @@ namespace sight {
         
     }
 
+    SightNodePortOptions::SightNodePortOptions(SightNodePortOptions const& rhs)
+        : typeList(rhs.typeList), showAddChild(rhs.showAddChild), dynamicPort(rhs.dynamicPort), customPortName(rhs.customPortName) {
+        if (rhs.varName) {
+            initVarName();
+            snprintf(varName, varNameLength, "%s", rhs.varName);
+        }
+    }
+
+    SightNodePortOptions::SightNodePortOptions(SightNodePortOptions&& rhs) noexcept
+        : typeList(rhs.typeList), showAddChild(rhs.showAddChild), dynamicPort(rhs.dynamicPort),
+          varName(rhs.varName), varNameLength(rhs.varNameLength), customPortName(rhs.customPortName) {
+        rhs.varName = nullptr;
+        rhs.varNameLength = 0;
+    }
+
     SightNodePortOptions::~SightNodePortOptions()
     {
         freeVarName();
@@ -2439,7 +2861,7 @@ namespace sight {
         p->markAsComponent();
 
         graph->registerNodeIds(p);
-        graph->markDirty();
+        graph->markDirty(p->nodeId);
         return true;
     }
 
@@ -13,15 +13,23 @@
 
 #include "v8-context.h"
 #include "v8-local-handle.h"
+#include "v8-script.h"
 #include "v8pp/convert.hpp"
 #include "v8pp/call_v8.hpp"
 #include "v8pp/object.hpp"
 #include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <cstring>
 #include <iterator>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_join.h"
+
 #ifdef NOT_WIN32
 #    include <unistd.h>
 #endif
@@ -42,6 +50,200 @@ namespace sight {
     namespace {
         PluginManager* g_pluginManager = new PluginManager();
 
+        // a load file is compiled as a script which returns this function, the same as `runJsFile` compiles it.
+        // the prefix has no line break, so line numbers of errors do not change.
+        constexpr std::string_view loadFilePrefix = "(function (module, exports) {";
+        constexpr std::string_view loadFileSuffix = "\n})";
+
+        /**
+         * @brief Give the whole file to V8 at once. The file is read by the thread which runs the streaming task.
+         */
+        class LoadFileSourceStream : public v8::ScriptCompiler::ExternalSourceStream {
+        public:
+            LoadFileSourceStream(std::string const& path, std::string* source)
+                : path(path), source(source) {
+            }
+
+            size_t GetMoreData(const uint8_t** src) override {
+                if (done) {
+                    return 0;
+                }
+                done = true;
+
+                FILE* file = fopen(path.c_str(), "rb");
+                if (!file) {
+                    return 0;
+                }
+                fseek(file, 0, SEEK_END);
+                auto size = static_cast<size_t>(ftell(file));
+                rewind(file);
+
+                source->reserve(loadFilePrefix.size() + size + loadFileSuffix.size());
+                source->append(loadFilePrefix);
+                source->resize(loadFilePrefix.size() + size);
+                auto readSize = fread(source->data() + loadFilePrefix.size(), 1, size, file);
+                fclose(file);
+                if (readSize != size) {
+                    source->clear();
+                    return 0;
+                }
+                source->append(loadFileSuffix);
+
+                // V8 takes the buffer.
+                auto buffer = new uint8_t[source->size()];
+                memcpy(buffer, source->data(), source->size());
+                *src = buffer;
+                return source->size();
+            }
+
+        private:
+            std::string const& path;
+            std::string* source;
+            bool done = false;
+        };
+
+        struct StreamedLoadFile {
+            std::string path;
+            // filled by the stream, V8 needs it again when the compile is finished.
+            std::string source;
+            std::unique_ptr<v8::ScriptCompiler::StreamedSource> streamedSource;
+            std::unique_ptr<v8::ScriptCompiler::ScriptStreamingTask> task;
+        };
+
+        struct PluginLoadFiles {
+            Plugin* plugin = nullptr;
+            // the address is used by the stream, so they are not moved.
+            std::vector<std::unique_ptr<StreamedLoadFile>> files;
+        };
+
+        /**
+         * @brief Sort plugins by `depends`, a plugin comes after the ones it depends on.
+         * Missing and circular depends are reported, they do not stop loading.
+         */
+        class PluginDependsSorter {
+        public:
+            PluginDependsSorter(std::vector<Plugin*> const& plugins, absl::flat_hash_map<std::string, Plugin*> const& loaded)
+                : plugins(plugins), loaded(loaded), marks(plugins.size(), Mark::None) {
+                for (size_t i = 0; i < plugins.size(); i++) {
+                    indexes[plugins[i]->getName()] = i;
+                }
+            }
+
+            std::vector<Plugin*> sort() {
+                for (size_t i = 0; i < plugins.size(); i++) {
+                    visit(i);
+                }
+                return std::move(sorted);
+            }
+
+        private:
+            enum class Mark {
+                None,
+                Visiting,
+                Done,
+            };
+
+            std::vector<Plugin*> const& plugins;
+            absl::flat_hash_map<std::string, Plugin*> const& loaded;
+            absl::flat_hash_map<std::string_view, size_t> indexes;
+            std::vector<Mark> marks;
+            // plugins which are visiting, for reporting cycles.
+            std::vector<size_t> visiting;
+            std::vector<Plugin*> sorted;
+
+            void visit(size_t i) {
+                if (marks[i] == Mark::Done) {
+                    return;
+                }
+                auto const& name = plugins[i]->getName();
+                if (marks[i] == Mark::Visiting) {
+                    auto begin = std::find(visiting.begin(), visiting.end(), i);
+                    std::vector<std::string_view> names;
+                    for (auto iter = begin; iter != visiting.end(); ++iter) {
+                        names.push_back(plugins[*iter]->getName());
+                    }
+                    names.push_back(name);
+                    logError("circular depends of plugins: $0", absl::StrJoin(names, " -> "));
+                    return;
+                }
+
+                marks[i] = Mark::Visiting;
+                visiting.push_back(i);
+                for (const auto& item : plugins[i]->getDepends()) {
+                    if (loaded.contains(item)) {
+                        continue;
+                    }
+                    auto iter = indexes.find(item);
+                    if (iter == indexes.end()) {
+                        logError("plugin $0 depends on $1, which is not found", name, item);
+                        continue;
+                    }
+                    visit(iter->second);
+                }
+                visiting.pop_back();
+                marks[i] = Mark::Done;
+                sorted.push_back(plugins[i]);
+            }
+        };
+
+        /**
+         * @brief Run streaming tasks of all files by background threads, the calling thread helps too.
+         */
+        void runStreamingTasks(std::vector<PluginLoadFiles>& list) {
+            std::vector<v8::ScriptCompiler::ScriptStreamingTask*> tasks;
+            for (auto& item : list) {
+                for (auto& file : item.files) {
+                    tasks.push_back(file->task.get());
+                }
+            }
+
+            std::atomic<size_t> next{ 0 };
+            auto work = [&tasks, &next]() {
+                for (size_t i; (i = next.fetch_add(1)) < tasks.size();) {
+                    tasks[i]->Run();
+                }
+            };
+            size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), tasks.size());
+            std::vector<std::thread> threads;
+            for (size_t i = 1; i < threadCount; i++) {
+                threads.emplace_back(work);
+            }
+            work();
+            for (auto& item : threads) {
+                item.join();
+            }
+        }
+
+        /**
+         * @brief Finish compiling files of a plugin, files which fail are left to `compileJsFile`, it reports the errors.
+         */
+        Plugin::CompiledFiles finishStreamedFiles(v8::Isolate* isolate, v8::Local<v8::Context> context, PluginLoadFiles& item) {
+            Plugin::CompiledFiles result;
+            for (auto& file : item.files) {
+                if (file->source.empty()) {
+                    continue;
+                }
+
+                v8::TryCatch tryCatch(isolate);
+                auto sourceCode = v8::String::NewFromUtf8(isolate, file->source.data(), v8::NewStringType::kNormal, static_cast<int>(file->source.size()));
+                if (sourceCode.IsEmpty()) {
+                    continue;
+                }
+                v8::ScriptOrigin scriptOrigin(isolate, v8pp::to_v8(isolate, file->path), 0, 0);
+                auto mayScript = v8::ScriptCompiler::Compile(context, file->streamedSource.get(), sourceCode.ToLocalChecked(), scriptOrigin);
+                if (mayScript.IsEmpty()) {
+                    logDebug("streamed compile failed: $0", file->path);
+                    continue;
+                }
+                auto mayFunction = mayScript.ToLocalChecked()->Run(context);
+                v8::Local<v8::Value> function;
+                if (mayFunction.ToLocal(&function) && function->IsFunction()) {
+                    result[file->path] = function.As<v8::Function>();
+                }
+            }
+            return result;
+        }
+
     }
 
     PluginManager::~PluginManager() {
@@ -80,13 +282,85 @@ namespace sight {
             afterPluginLoadSuccess(plugin);
         }
 
+        std::vector<std::string> paths;
         for (auto it = directory_iterator{ "./plugins" }; it != directory_iterator{}; ++it) {
-            loadPluginAt(it->path().string());
+            paths.push_back(it->path().string());
         }
+        loadPluginsAt(paths);
 
         return 0;
     }
 
+    int PluginManager::loadPluginsAt(std::vector<std::string> const& paths) {
+        fs::path sightBasePath{ "./plugins/sight-base" };
+        v8::HandleScope handle_scope(isolate);
+        auto context = isolate->GetCurrentContext();
+
+        // read `package.js` of all plugins first, so depends are known.
+        std::vector<Plugin*> plugins;
+        absl::flat_hash_set<std::string> names;
+        for (const auto& path : paths) {
+            if (fs::exists(sightBasePath) && fs::equivalent(sightBasePath, path)) {
+                continue;
+            }
+
+            auto plugin = new Plugin(this, path);
+            int i = plugin->loadPackage();
+            if (i != CODE_OK && i != CODE_PLUGIN_DISABLED_BY_PROJECT) {
+                if (i != CODE_PLUGIN_DISABLED) {
+                    logDebug("plugin load fail: $0", path);
+                }
+                delete plugin;
+                continue;
+            }
+            if (pluginMap.contains(plugin->getName()) || !names.insert(plugin->getName()).second) {
+                logDebug("maybe name repeat: $0", plugin->getName());
+                delete plugin;
+                continue;
+            }
+
+            if (i == CODE_PLUGIN_DISABLED_BY_PROJECT) {
+                afterPluginLoadSuccess(plugin);
+            } else {
+                plugins.push_back(plugin);
+            }
+        }
+
+        auto sorted = PluginDependsSorter(plugins, pluginMap).sort();
+
+        // start compiling all load files, V8 parses them on background threads.
+        std::vector<PluginLoadFiles> loadFiles;
+        for (auto plugin : sorted) {
+            auto& item = loadFiles.emplace_back();
+            item.plugin = plugin;
+            for (auto& path : plugin->getLoadFilePaths()) {
+                auto file = std::make_unique<StreamedLoadFile>();
+                file->path = std::move(path);
+                file->streamedSource = std::make_unique<v8::ScriptCompiler::StreamedSource>(
+                    std::make_unique<LoadFileSourceStream>(file->path, &file->source), v8::ScriptCompiler::StreamedSource::UTF8);
+                file->task.reset(v8::ScriptCompiler::StartStreaming(isolate, file->streamedSource.get()));
+                item.files.push_back(std::move(file));
+            }
+        }
+        runStreamingTasks(loadFiles);
+
+        // run them in order.
+        int count = 0;
+        for (auto& item : loadFiles) {
+            v8::HandleScope scope(isolate);
+            auto plugin = item.plugin;
+            auto compiledFiles = finishStreamedFiles(isolate, context, item);
+            if (plugin->justLoad(context, &compiledFiles) != CODE_OK) {
+                logDebug("plugin load fail: $0", plugin->getPath());
+                delete plugin;
+                continue;
+            }
+            afterPluginLoadSuccess(plugin);
+            count++;
+        }
+        return count;
+    }
+
     int PluginManager::loadPluginAt(std::string_view path) {
 
         fs::path sightBasePath{ "./plugins/sight-base" };
@@ -280,10 +554,21 @@ namespace sight {
             }
         }
 
-        return justLoad(context);
+        return CODE_OK;
     }
 
     int Plugin::load() {
+        auto code = loadPackage();
+        if (code != CODE_OK) {
+            return code;
+        }
+
+        auto isolate = this->pluginManager->getIsolate();
+        v8::HandleScope handle_scope(isolate);
+        return justLoad(isolate->GetCurrentContext());
+    }
+
+    int Plugin::loadPackage() {
         if (!std::filesystem::exists(path)) {
             return CODE_FAIL;
         }
@@ -416,7 +701,7 @@ namespace sight {
         return code;
     }
 
-    int Plugin::justLoad(v8::Local<v8::Context> context) {
+    int Plugin::justLoad(v8::Local<v8::Context> context, CompiledFiles const* compiledFiles) {
         if (status == PluginStatus::Loaded) {
             return CODE_PLUGIN_ALREADY_LOAD;
         }
@@ -424,19 +709,36 @@ namespace sight {
         auto isolate = this->pluginManager->getIsolate();
         v8::HandleScope handle_scope(isolate);
 
-        // load files.
-        auto module = this->module.IsEmpty() ? v8::Object::New(isolate) : this->module.Get(isolate);
-        fs::path rootPath = this->path;
-        for (const auto& item : loadFiles) {
-            fs::path path = rootPath / item;
-            if (!fs::exists(path)) {
+        // compile all files first, so nothing runs if one of them is broken.
+        auto loadFilePaths = getLoadFilePaths();
+        std::vector<v8::Local<v8::Function>> functions;
+        functions.reserve(loadFilePaths.size());
+        for (const auto& fullPath : loadFilePaths) {
+            CompiledFiles::const_iterator iter;
+            if (compiledFiles && (iter = compiledFiles->find(fullPath)) != compiledFiles->end()) {
+                functions.push_back(iter->second);
                 continue;
             }
+            v8::Local<v8::Function> function;
+            if (compileJsFile(isolate, fullPath.c_str(), true, function) != CODE_OK) {
+                logDebug("js compile failed: $0", fullPath);
+                return CODE_PLUGIN_FILE_ERROR;
+            }
+            functions.push_back(function);
+        }
+
+        // send nodes of others, then the batch only has what this plugin adds, and it can be dropped.
+        flushJsNodeCache();
 
-            auto fullPath = std::filesystem::canonical(path);
-            auto code = runJsFile(isolate, fullPath.string().c_str(), nullptr, module);
-            if (code != CODE_OK) {
-                logDebug("js run failed: $0", fullPath.string().c_str());
+        // load files.
+        auto module = this->module.IsEmpty() ? v8::Object::New(isolate) : this->module.Get(isolate);
+        fs::path rootPath = this->path;
+        for (size_t i = 0; i < loadFilePaths.size(); i++) {
+            logDebug(loadFilePaths[i]);
+            if (callJsFileFunction(isolate, functions[i], module) != CODE_OK) {
+                logDebug("js run failed: $0", loadFilePaths[i]);
+                // templates and nodes which earlier files added are not registered.
+                clearJsNodeCache();
                 return CODE_PLUGIN_FILE_ERROR;
             }
         }
@@ -505,6 +807,22 @@ namespace sight {
         return this->disabledByProject;        
     }
 
+    std::vector<std::string> const& Plugin::getDepends() const {
+        return this->depends;
+    }
+
+    std::vector<std::string> Plugin::getLoadFilePaths() const {
+        std::vector<std::string> result;
+        fs::path rootPath = this->path;
+        for (const auto& item : loadFiles) {
+            fs::path path = rootPath / item;
+            if (fs::exists(path)) {
+                result.push_back(fs::canonical(path).string());
+            }
+        }
+        return result;
+    }
+
     PluginManager *pluginManager() {
         return g_pluginManager;
     }
@@ -16,6 +16,12 @@
 #include "sight_memory.h"
 #include "sight_widgets.h"
 #include "sight_code_set.h"
+#include "sight_graph_binary.h"
+#include "sight_project_index.h"
+#include "sight_entity_store.h"
+#include "sight_build_manifest.h"
+#include "sight_graph_saver.h"
+#include "sight_ui_search.h"
 
 
 #include "yaml-cpp/node/parse.h"
@@ -24,8 +30,10 @@
 #include <filesystem>
 #include <fstream>
 #include <algorithm>
+#include <chrono>
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iterator>
 #include <stdint.h>
@@ -38,6 +46,9 @@
 #include <vector>
 #include <yaml-cpp/emittermanip.h>
 
+#include "absl/container/btree_set.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
 #include "absl/strings/substitute.h"
 
 
@@ -56,71 +67,83 @@ namespace sight {
 
     namespace  {
         
-        bool isGraphFile(std::string const& path){
-            std::ifstream fin(path);
-            if (!fin.is_open()) {
-                return false;
-            }
-
-            try {
-                auto root = YAML::Load(fin);
-                auto node = root["who-am-i"];
-                if (node.IsDefined()) {
-                    return node.as<std::string>() == "sight-graph";
-                }
-            } catch (const YAML::BadConversion & e){
-                return false;
-            }
+        // key: directory path, value: [begin, end) of its regular files in the scanned files.
+        using DirectoryFiles = absl::flat_hash_map<std::string, std::pair<size_t, size_t>>;
 
-            return false;
-        }
-
-        void fillFiles(ProjectFile & parent){
+        /**
+         * @brief Add directories to `parent`, and collect regular files. Files of a directory are collected together.
+         */
+        void collectFiles(ProjectFile& parent, std::vector<ProjectIndexFile>& files, DirectoryFiles& directoryFiles) {
             parent.files.clear();
 
+            std::vector<std::string> directories;
+            size_t begin = files.size();
             for (const auto& item : directory_iterator{ parent.path }) {
-                if (startsWith(item.path().filename().generic_string(), ".")) {
+                auto filename = item.path().filename().generic_string();
+                if (startsWith(filename, ".")) {
                     continue;
                 }
-                std::string fullpath = std::filesystem::canonical(item.path()).string();
                 if (item.is_directory()) {
-                    parent.files.emplace_back(ProjectFileType::Directory, fullpath, item.path().filename().generic_string());
-                    fillFiles(parent.files.back());
-                    continue;
+                    directories.push_back(filename);
+                } else if (item.is_regular_file()) {
+                    // parent.path is canonical, so the child is.
+                    files.push_back({ (fs::path(parent.path) / filename).string() });
                 }
-                if (item.is_regular_file()) {
-                    auto filename = item.path().filename();
-                    if (filename == ".DS_Store") {
-                        continue;
+            }
+            directoryFiles[parent.path] = { begin, files.size() };
+
+            for (auto& name : directories) {
+                auto fullpath = (fs::path(parent.path) / name).string();
+                parent.files.emplace_back(ProjectFileType::Directory, fullpath, std::move(name));
+                collectFiles(parent.files.back(), files, directoryFiles);
+            }
+        }
+
+        /**
+         * @brief Add files to directories, by their kinds from the index.
+         */
+        void placeFiles(ProjectFile& parent, std::vector<ProjectIndexFile> const& files, DirectoryFiles const& directoryFiles) {
+            for (auto& item : parent.files) {
+                placeFiles(item, files, directoryFiles);
+            }
+
+            auto iter = directoryFiles.find(parent.path);
+            if (iter != directoryFiles.end()) {
+                auto [begin, end] = iter->second;
+                // name without ext
+                absl::flat_hash_set<std::string> yamlFiles;
+                absl::flat_hash_set<std::string> graphs;
+                for (auto i = begin; i < end; i++) {
+                    fs::path path(files[i].path);
+                    if (path.extension() == ".yaml") {
+                        yamlFiles.insert(path.stem().generic_string());
+                        if (files[i].kind == ProjectIndexKind::YamlGraph) {
+                            graphs.insert(path.stem().generic_string());
+                        }
                     }
+                }
 
-                    if (item.path().has_extension()) {
-                        auto ext = item.path().extension();
-                        if (ext == ".yaml") {
-                            // check the is a graph or not.
-                            if (isGraphFile(item.path().generic_string())) {
-                                parent.files.emplace_back(ProjectFileType::Graph, fullpath, removeExt(filename.generic_string()));
-
-                                continue;
-                            }
-                        } else if (ext == ".json") {
-                            // graph position file
-                            std::string nameWithoutExt = removeExt(filename.string());
-                            auto findResult = std::find_if(parent.files.begin(), parent.files.end(), [&nameWithoutExt](ProjectFile const& f){ 
-                                return f.fileType == ProjectFileType::Graph && f.filename == nameWithoutExt;
-                            });
-                            if (findResult != parent.files.end()) {
-                                // has graph, ignore this file.
-                                continue;
-                            }
-
-                            if (isGraphFile(removeExt(item.path().generic_string()) + ".yaml")) {
-                                continue;
-                            }
+                for (auto i = begin; i < end; i++) {
+                    auto const& file = files[i];
+                    fs::path path(file.path);
+                    auto filename = path.filename().generic_string();
+                    auto ext = path.extension();
+                    if (file.kind == ProjectIndexKind::YamlGraph) {
+                        parent.files.emplace_back(ProjectFileType::Graph, file.path, removeExt(filename));
+                        continue;
+                    } else if (file.kind == ProjectIndexKind::BinaryGraph) {
+                        // binary graph, the yaml one is preferred if both exist.
+                        if (!yamlFiles.contains(path.stem().generic_string())) {
+                            graphs.insert(path.stem().generic_string());
+                            parent.files.emplace_back(ProjectFileType::Graph, file.path, removeExt(filename));
                         }
+                        continue;
+                    } else if (ext == ".json" && graphs.contains(path.stem().generic_string())) {
+                        // graph position file
+                        continue;
                     }
 
-                    parent.files.emplace_back(ProjectFileType::Regular, fullpath, filename.generic_string());
+                    parent.files.emplace_back(ProjectFileType::Regular, file.path, filename);
                 }
             }
 
@@ -135,36 +158,60 @@ namespace sight {
                 
                 return false;
             });
+        }
 
-            
+        void collectGraphPaths(ProjectFile const& parent, std::vector<std::string>& paths) {
+            for (auto const& item : parent.files) {
+                if (item.fileType == ProjectFileType::Graph) {
+                    paths.push_back(item.path);
+                } else if (item.fileType == ProjectFileType::Directory) {
+                    collectGraphPaths(item, paths);
+                }
+            }
         }
 
-        YAML::Emitter& operator << (YAML::Emitter& out, SightEntity const& entity){
-            out << YAML::Key << entity.templateAddress << YAML::BeginMap;            
-            out << YAML::Key << "name" << YAML::Value << entity.name;
-            out << YAML::Key << "typeId" << YAML::Value << entity.typeId;
-            out << YAML::Key << "parentEntity" << YAML::Value << entity.parentEntity;
+        int readStyleInfo(std::string const& path, std::vector<std::pair<uint, TypeStyle>>& styles) {
+            std::ifstream fin(path);
+            if (!fin.is_open()) {
+                return CODE_FILE_ERROR;
+            }
 
-            out << YAML::Key << "fields" << YAML::BeginMap;
-            for( const auto& item: entity.fields){
-                out << YAML::Key << item.name << YAML::BeginMap;
-                out << YAML::Key << "type" << YAML::Value << item.type;
-                out << YAML::Key << "defaultValue" << YAML::Value << item.defaultValue;
+            try {
+                auto root = YAML::Load(fin);
+                auto temp = root[whoAmI];
+                if (temp.IsDefined()) {
+                    if (temp.as<std::string>() != "sight-styles") {
+                        logDebug("style file who-am-i error: $0", path);
+                        return CODE_FILE_ERROR;
+                    }
+                }
 
-                out << YAML::Key << "options" << YAML::BeginMap;
-                out << YAML::Key << "portType" << YAML::Value << item.options.portTypeValue();
-                out << YAML::Key << "show" << YAML::Value << item.options.portOptions.show;
-                out << YAML::Key << "showValue" << YAML::Value << item.options.portOptions.showValue;
-                out << YAML::Key << "readonly" << YAML::Value << item.options.portOptions.readonly;
-                out << YAML::EndMap;
+                temp = root["typeMap"];
+                if (temp.IsDefined()) {
+                    for (const auto& item : temp) {
+                        styles.emplace_back(item.first.as<uint>(), TypeStyle{
+                            item.second["color"].as<uint>(),
+                            static_cast<IconType>(item.second["icon"].as<int>())
+                        });
+                    }
+                }
 
-                out << YAML::EndMap;
+            } catch (const YAML::BadConversion& e) {
+                logDebug("load project config error. $0, $1", path.c_str(), e.what());
+                return CODE_FILE_FORMAT_ERROR;
             }
-            out << YAML::EndMap;
-
+            return CODE_OK;
+        }
 
-            out << YAML::EndMap;
-            return out;
+        /**
+         * @param partial  true if `parent` is not the project folder, index items of other folders are kept.
+         */
+        void fillFiles(ProjectFile & parent, ProjectFileIndex& index, bool partial = false){
+            std::vector<ProjectIndexFile> files;
+            DirectoryFiles directoryFiles;
+            collectFiles(parent, files, directoryFiles);
+            index.refresh(files, partial ? (fs::path(parent.path) / "").string() : std::string());
+            placeFiles(parent, files, directoryFiles);
         }
 
         // Serialization
@@ -190,39 +237,6 @@ namespace sight {
             rhs.fieldNameCaseType = static_cast<CaseTypes>(node["fieldNameCaseType"].as<int>());
             return true;
         }
-
-        SightEntity loadEntity(std::string const& templateAddress, YAML::Node const& node){
-            SightEntity entity;
-            entity.templateAddress = templateAddress;
-            entity.name = node["name"].as<std::string>();
-            auto tmp = node["typeId"];
-            if (tmp.IsDefined()) {
-                entity.typeId = tmp.as<uint>();
-            }
-            
-            // tmp = node["parentEntity"];
-            if (node["parentEntity"]) {
-                entity.parentEntity = node["parentEntity"].as<std::string>();
-            }
-
-            auto fieldsNode = node["fields"];
-            for( const auto& item: fieldsNode){
-                std::string name = item.first.as<std::string>();
-                auto &dataNode = item.second;
-                entity.fields.emplace_back(name, dataNode["type"].as<std::string>(), dataNode["defaultValue"].as<std::string>());
-
-                auto & f = entity.fields.back();
-                auto optionsNode = dataNode["options"];
-                if (optionsNode.IsDefined()) {
-                    f.options.portType = static_cast<NodePortType>(optionsNode["portType"].as<int>());
-                    f.options.portOptions.show = optionsNode["show"].as<bool>();
-                    f.options.portOptions.showValue = optionsNode["showValue"].as<bool>();
-                    f.options.portOptions.readonly = optionsNode["readonly"].as<bool>();
-                }
-            }
-
-            return entity;
-        }
     }
 
     int Project::build(const char* target) {
@@ -243,6 +257,8 @@ namespace sight {
     int Project::clean() {
         // remove target/graph folder
         std::filesystem::remove_all(pathTargetFolder() + "graph");
+        std::error_code ec;
+        std::filesystem::remove(pathTargetFolder() + SIGHT_BUILD_MANIFEST_FILE, ec);
         return CODE_OK;
     }
 
@@ -295,18 +311,138 @@ namespace sight {
         return baseDir + "styles.yaml";
     }
 
-    std::string Project::pathEntitiesConfigFile() const {
-        return baseDir + "entities.yaml";
+    void ProjectLoadTimings::begin(ProjectLoadPhase phase) {
+        auto now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        beginTimes[static_cast<int>(phase)] = now;
+        endTimes[static_cast<int>(phase)] = 0;
+    }
+
+    void ProjectLoadTimings::end(ProjectLoadPhase phase) {
+        endTimes[static_cast<int>(phase)] = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    float ProjectLoadTimings::elapsedMs(ProjectLoadPhase phase, bool* finished) const {
+        int64_t beginTime = beginTimes[static_cast<int>(phase)];
+        int64_t endTime = endTimes[static_cast<int>(phase)];
+        if (finished) {
+            *finished = endTime > 0;
+        }
+        if (beginTime <= 0) {
+            return -1;
+        }
+        if (endTime <= 0) {
+            endTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+        return (endTime - beginTime) / 1000.0f;
+    }
+
+    const char* ProjectLoadTimings::name(ProjectLoadPhase phase) {
+        switch (phase) {
+        case ProjectLoadPhase::Config:
+            return "Config";
+        case ProjectLoadPhase::Style:
+            return "Style";
+        case ProjectLoadPhase::Entities:
+            return "Entities";
+        case ProjectLoadPhase::FileIndex:
+            return "File index";
+        case ProjectLoadPhase::LastGraph:
+            return "Last graph";
+        case ProjectLoadPhase::Plugins:
+            return "Plugins";
+        case ProjectLoadPhase::Count:
+            break;
+        }
+        return "";
+    }
+
+    Project::~Project() {
+        stopWatcher();
+        joinLoadThreads();
     }
 
     int Project::load() {
         int i;
-        CHECK_CODE(loadConfigFile(), i);
-        CHECK_CODE(loadStyleInfo(), i);
-        CHECK_CODE(loadEntities(), i);
-        // CHECK_CODE(loadPlugins(), i);    // NEED INIT V8 FIRST
+        loadTimings.begin(ProjectLoadPhase::Config);
+        i = loadConfigFile();
+        loadTimings.end(ProjectLoadPhase::Config);
+        if (i != CODE_OK) {
+            return i;
+        }
+
+        // files are read on worker threads, types are not thread safe, so styles and entities are applied here, in order.
+        std::vector<std::pair<uint, TypeStyle>> styles;
+        int styleStatus = CODE_OK;
+        std::thread styleThread([this, &styles, &styleStatus]() {
+            loadTimings.begin(ProjectLoadPhase::Style);
+            styleStatus = readStyleInfo(pathStyleConfigFile(), styles);
+            loadTimings.end(ProjectLoadPhase::Style);
+        });
+        int entityStatus = CODE_OK;
+        entitiesMap.clear();
+        std::thread entityThread([this, &entityStatus]() {
+            loadTimings.begin(ProjectLoadPhase::Entities);
+            entityStatus = entityStore.load(baseDir, entitiesMap);
+            loadTimings.end(ProjectLoadPhase::Entities);
+        });
 
-        return 0;
+        // nobody reads them until `waitFileScan`
+        fileScanThread = std::thread([this]() {
+            loadTimings.begin(ProjectLoadPhase::FileIndex);
+            buildFilesCache();
+            filesCacheReady = true;
+            filesCacheReady.notify_all();
+            loadTimings.end(ProjectLoadPhase::FileIndex);
+        });
+        if (!lastOpenGraph.empty()) {
+            lastGraphThread = std::thread([path = lastOpenGraph + ".yaml", this]() {
+                loadTimings.begin(ProjectLoadPhase::LastGraph);
+                prefetchGraph(path);
+                loadTimings.end(ProjectLoadPhase::LastGraph);
+            });
+        }
+
+        styleThread.join();
+        entityThread.join();
+        if (styleStatus == CODE_OK) {
+            applyStyleInfo(styles);
+        }
+        i = applyEntities(entityStatus);
+        if (styleStatus != CODE_OK) {
+            return styleStatus;
+        }
+        return i;
+    }
+
+    void Project::waitLoadTasks() {
+        waitFileScan();
+        if (lastGraphThread.joinable()) {
+            lastGraphThread.join();
+        }
+    }
+
+    void Project::joinLoadThreads() {
+        if (fileScanThread.joinable()) {
+            fileScanThread.join();
+        }
+        if (lastGraphThread.joinable()) {
+            lastGraphThread.join();
+        }
+    }
+
+    void Project::waitFileScan() {
+        if (fileScanThread.joinable()) {
+            fileScanThread.join();
+        }
+        if (!filesCacheReady) {
+            buildFilesCache();
+            filesCacheReady = true;
+            filesCacheReady.notify_all();
+        }
+    }
+
+    ProjectLoadTimings const& Project::getLoadTimings() const {
+        return loadTimings;
     }
 
     int Project::save() {
@@ -370,18 +506,18 @@ namespace sight {
         out << YAML::Key << whoAmI << YAML::Value << "sight-styles";
 
         out << YAML::Key << "typeMap" << YAML::BeginMap;
-        for (const auto& item : this->typeInfoMap) {
-            if (!item.second.style) {
-                continue;
+        typeRegistry.forEach([&out](TypeInfo const& item) {
+            if (!item.style) {
+                return;
             }
 
-            out << YAML::Key << item.first;
+            out << YAML::Key << item.intValue;
             out << YAML::BeginMap;
-            auto style = item.second.style;
+            auto style = item.style;
             out << YAML::Key << "icon" << YAML::Value << static_cast<int>(style->iconType);
             out << YAML::Key << "color" << YAML::Value << style->color;
             out << YAML::EndMap;
-        }
+        });
         out << YAML::EndMap;
 
         out << YAML::EndMap;
@@ -394,18 +530,7 @@ namespace sight {
     }
 
     int Project::saveEntities() {
-        YAML::Emitter out;
-        out << YAML::BeginMap;
-        out << YAML::Key << whoAmI << YAML::Value << "sight-entities";
-        for( const auto& item: this->entitiesMap){
-            out << item.second;
-        }
-        out << YAML::EndMap;
-
-        std::ofstream outToFile(pathEntitiesConfigFile(), std::ios::out | std::ios::trunc);
-        outToFile << out.c_str() << std::endl;
-        outToFile.close();
-        return CODE_OK;
+        return entityStore.save(entitiesMap);
     }
 
     int Project::loadConfigFile() {
@@ -466,92 +591,58 @@ namespace sight {
     }
 
     int Project::loadStyleInfo() {
-        std::string path = pathStyleConfigFile();
-
-        std::ifstream fin(path);
-        if (!fin.is_open()) {
-            return CODE_FILE_ERROR;
+        std::vector<std::pair<uint, TypeStyle>> styles;
+        int status = readStyleInfo(pathStyleConfigFile(), styles);
+        if (status == CODE_OK) {
+            applyStyleInfo(styles);
         }
+        return status;
+    }
 
-        try {
-            auto root = YAML::Load(fin);
-            auto temp = root[whoAmI];
-            if (temp.IsDefined()) {
-                if (temp.as<std::string>() != "sight-styles") {
-                    logDebug("style file who-am-i error: $0", path);
-                    return CODE_FILE_ERROR;
-                }
+    void Project::applyStyleInfo(std::vector<std::pair<uint, TypeStyle>> const& styles) {
+        for (const auto& [id, typeStyle] : styles) {
+            auto typeInfoPointer = typeRegistry.find(id);
+            if (!typeInfoPointer) {
+                logDebug("type not found: $0", id);
+                continue;
             }
 
-            temp = root["typeMap"];
-            if (temp.IsDefined()) {
-                for (const auto& item : temp) {
-                    auto id = item.first.as<uint>();
-                    TypeStyle typeStyle = {
-                        item.second["color"].as<uint>(),
-                        static_cast<IconType>(item.second["icon"].as<int>())
-                    };
-
-                    auto iter = typeInfoMap.find(id);
-                    if (iter == typeInfoMap.end()) {
-                        logDebug("type not found: $0", id);
-                        continue;
-                    }
-
-                    auto& typeInfo = iter->second;
-                    if (typeInfo.style) {
-                        *typeInfo.style = typeStyle;
-                    } else {
-                        typeInfo.style = typeStyleArray.add(typeStyle);
-                    }
-                }
+            auto& typeInfo = *typeInfoPointer;
+            if (typeInfo.style) {
+                *typeInfo.style = typeStyle;
+            } else {
+                typeInfo.style = typeStyleArray.add(typeStyle);
             }
-
-        } catch (const YAML::BadConversion& e) {
-            logDebug("load project config error. $0, $1", path.c_str(), e.what());
-            return CODE_FILE_FORMAT_ERROR;
         }
-        return CODE_OK;
     }
 
     int Project::loadEntities() {
-        auto path = pathEntitiesConfigFile();
-        std::ifstream fin(path);
-        if (!fin.is_open()) {
-            return CODE_FILE_ERROR;
-        }
-
-        try {
-            auto root = YAML::Load(fin);
-            auto temp = root[whoAmI];
-            if (temp.IsDefined()) {
-                if (temp.as<std::string>() != "sight-entities") {
-                    logDebug("entity file who-am-i error: $0", path);
-                    return CODE_FILE_ERROR;
-                }
-            }
-
-            for( const auto& item: root){
-                auto key = item.first.as<std::string>();
-                if (key == whoAmI) {
-                    continue;
-                }
-
-                auto entity = loadEntity(key, item.second);
-                this->entitiesMap[entity.name] = entity;
+        entitiesMap.clear();
+        return applyEntities(entityStore.load(baseDir, entitiesMap));
+    }
 
-                getIntType(entity.name, true);
+    int Project::applyEntities(int status) {
+        pendingEntityTemplates.clear();
+        if (status != CODE_OK) {
+            if (status == CODE_FILE_ERROR && createIfNotExist) {
+                return saveEntities();
             }
-            
-        } catch (const YAML::BadConversion& e) {
-            logDebug("load project config error. $0, $1", path.c_str(), e.what());
-            return CODE_FILE_FORMAT_ERROR;
+            return status;
         }
 
+        removeAllEntitiesFromSearch();
+        for (auto& [name, entity] : entitiesMap) {
+            entity.typeId = getIntType(name, true);
+            // template nodes are added when they are used, see `registerEntityTemplate`
+            pendingEntityTemplates[entity.templateAddress] = name;
+            indexEntityForSearch(entity, entityStore.indexFieldsOf(name));
+        }
+        entityTemplatesPending = !pendingEntityTemplates.empty();
         return CODE_OK;
     }
 
     int Project::loadPlugins() {
+        loadTimings.begin(ProjectLoadPhase::Plugins);
         auto path = pathPluginsFolder();
         // loop of path child folder
         auto mgr = pluginManager();
@@ -559,10 +650,12 @@ namespace sight {
             int i = mgr->loadPluginAt(child.path().string());
 
             if (i != CODE_OK) {
+                loadTimings.end(ProjectLoadPhase::Plugins);
                 return i;
             }
         }
         
+        loadTimings.end(ProjectLoadPhase::Plugins);
         return CODE_OK;
     }
 
@@ -607,16 +700,16 @@ namespace sight {
     }
 
     bool Project::delIntType(uint type) {
-        auto iter = typeInfoMap.find(type);
-        if (iter == typeInfoMap.end()) {
+        auto typeInfo = typeRegistry.find(type);
+        if (!typeInfo) {
             return false;
         }
 
-        if (typeMap.erase(iter->second.name) <= 0) {
-            logDebug("del failed from typeMap: $0", iter->second.name);
+        if (typeMap.erase(typeInfo->name) <= 0) {
+            logDebug("del failed from typeMap: $0", typeInfo->name);
         }
         
-        return typeInfoMap.erase(iter), true;
+        return typeRegistry.remove(type);
     }
 
     std::string Project::getBaseDir() const {
@@ -634,7 +727,7 @@ namespace sight {
         std::filesystem::path temp(targetPath);
         if (temp.has_extension()) {
             std::string ext = temp.extension().generic_string();
-            if (ext == ".json" || ext == ".yaml") {
+            if (ext == ".json" || ext == ".yaml" || ext == SIGHT_GRAPH_BINARY_EXT) {
                 targetPath = std::string(targetPath, 0, targetPath.rfind('.'));
             }
         }
@@ -689,6 +782,9 @@ namespace sight {
         // f.fileType = fileType;
         // f.path = filepath.generic_string();
         parent->files.emplace_back(fileType, filepath.generic_string(), filepath.filename().generic_string());
+        if (fileType == ProjectFileType::Graph) {
+            updateGraphPaths();
+        }
     }
 
     void Project::addNewGraphToFileCache(std::string_view graphName) {
@@ -696,7 +792,18 @@ namespace sight {
     }
 
     void Project::buildFilesCache() {
-        fillFiles(this->fileCache);
+        if (!fileIndexLoaded) {
+            // a missing or bad index is rebuilt by the scan.
+            fileIndex.load(baseDir);
+            fileIndexLoaded = true;
+        }
+
+        fillFiles(this->fileCache, fileIndex);
+        updateGraphPaths();
+        logDebug("build files cache, index hits: $0, sniffed: $1", fileIndex.hits, fileIndex.sniffed);
+        if (fileIndex.save() != CODE_OK) {
+            logWarning("save project file index failed");
+        }
     }
 
     int Project::openFile(ProjectFile const& file) {
@@ -705,9 +812,9 @@ namespace sight {
     }
 
     std::string const &Project::getTypeName(int type) {
-        auto a = typeInfoMap.find(type);
-        if (a != typeInfoMap.end()) {
-            return a->second.name;
+        auto typeInfo = typeRegistry.find(type);
+        if (typeInfo) {
+            return typeInfo->name;
         }
         return emptyString;
     }
@@ -719,8 +826,10 @@ namespace sight {
         }
 
         auto type = iter->second;
-        auto &info = typeInfoMap[type];
-        info.name = to;
+        auto info = typeRegistry.find(type);
+        if (info) {
+            info->name = to;
+        }
 
         typeMap.erase(iter);
         typeMap[to] = type;
@@ -783,8 +892,8 @@ namespace sight {
         return baseDir + "plugins/";
     }
 
-    absl::btree_map<uint, TypeInfo> const& Project::getTypeInfoMap() const {
-        return typeInfoMap;
+    TypeRegistry const& Project::getTypeRegistry() const {
+        return typeRegistry;
     }
 
     std::string Project::getLastOpenGraph() const {
@@ -796,7 +905,8 @@ namespace sight {
     }
 
     SightEntity const* Project::getSightEntity(std::string_view fullName) const {
-        return const_cast<Project*>(this)->getSightEntity(fullName);
+        auto iter = entitiesMap.find(fullName);
+        return iter == entitiesMap.end() ? nullptr : &iter->second;
     }
 
     SightEntity* Project::getSightEntity(std::string_view fullName) {
@@ -805,6 +915,14 @@ namespace sight {
             return nullptr;
         }
 
+        if (!entityStore.isLoaded(fullName)) {
+            int status = entityStore.loadFields(iter->second);
+            if (status != CODE_OK) {
+                logWarning("load entity failed: $0, $1", fullName, status);
+            } else {
+                indexEntityForSearch(iter->second);
+            }
+        }
         return &iter->second;
     }
 
@@ -824,6 +942,8 @@ namespace sight {
             }
         }
 
+        entityStore.markDirty(entity.name);
+        indexEntityForSearch(entity);
         // update to template
         return (this->entitiesMap[entity.name] = entity).effect() == CODE_OK;
     }
@@ -848,6 +968,10 @@ namespace sight {
                 return false;
             }
 
+            iter = this->entitiesMap.find(oldEntity.name);
+            if (iter == this->entitiesMap.end()) {
+                return false;
+            }
             changeTypeName(oldEntity.name, entity.name);
         } else {
             if (iter == this->entitiesMap.end()) {
@@ -860,25 +984,33 @@ namespace sight {
             // template address have been changed.
 
             // delete old
-            // auto eraseResult = entitiesMap.erase(entity.name);
-            // delTemplateNode(editTemplateAddress);
-            auto eraseResult = delEntity(entity.name);
+            auto eraseResult = delEntity(oldEntity.name);
             assert(eraseResult);
 
             // add new one
-            this->entitiesMap[entity.templateAddress] = entity;
+            this->entitiesMap[entity.name] = entity;
         } else {
             // update fields
-            auto& entityInMap = iter->second;
-            auto& f = entityInMap.fields;
-            f.clear();
-            f.assign(entity.fields.begin(), entity.fields.end());
-
+            auto entityInMap = std::move(iter->second);
+            entityInMap.fields.assign(entity.fields.begin(), entity.fields.end());
             entityInMap.name = entity.name;
+
+            if (entity.name != oldEntity.name) {
+                entityStore.markRemoved(oldEntity.name);
+                this->entitiesMap.erase(iter);
+            }
+            this->entitiesMap[entity.name] = std::move(entityInMap);
         }
+        entityStore.markDirty(entity.name);
+        pendingEntityTemplates.erase(entity.templateAddress);
+        if (entity.name != oldEntity.name) {
+            removeEntityFromSearch(oldEntity.name);
+        }
+        indexEntityForSearch(this->entitiesMap[entity.name]);
 
-        // update template node
+        // update template node, graphs of a template which is not added yet are marked here.
         addTemplateNode(entity, true);
+        markTemplateStale(entity.templateAddress);
 
         return true;
     }
@@ -892,34 +1024,171 @@ namespace sight {
                 delIntType(entity.typeId);
                 entity.typeId = 0;
             }
-            delTemplateNode(entity.templateAddress);
+            if (pendingEntityTemplates.erase(entity.templateAddress) == 0) {
+                delTemplateNode(entity.templateAddress);
+            }
+            markTemplateStale(entity.templateAddress);
+            entityStore.markRemoved(fullName);
+            removeEntityFromSearch(fullName);
             entitiesMap.erase(iter);
             return true;
         }
         return false;
     }
 
-    void Project::updateEntitiesToTemplateNode() const {
-        for( const auto& item: this->entitiesMap){
-            addTemplateNode(item.second);
+    bool Project::registerEntityTemplate(std::string_view templateAddress) {
+        auto iter = pendingEntityTemplates.find(templateAddress);
+        if (iter == pendingEntityTemplates.end()) {
+            return false;
         }
+
+        auto name = std::move(iter->second);
+        pendingEntityTemplates.erase(iter);
+        entityTemplatesPending = !pendingEntityTemplates.empty();
+        auto entity = getSightEntity(name);
+        return entity && addTemplateNode(*entity) == CODE_OK;
+    }
+
+    void Project::updateEntitiesToTemplateNode() {
+        if (pendingEntityTemplates.empty()) {
+            return;
+        }
+
+        auto pending = std::move(pendingEntityTemplates);
+        pendingEntityTemplates.clear();
+        entityTemplatesPending = false;
+        for (const auto& [templateAddress, name] : pending) {
+            if (auto entity = getSightEntity(name)) {
+                addTemplateNode(*entity);
+            }
+        }
+    }
+
+    bool Project::hasPendingEntityTemplates() const {
+        return entityTemplatesPending;
     }
 
     void Project::parseAllGraphs() const {
-        auto targetPathString = pathTargetFolder();
-        targetPathString += "graph/";
+        buildGraphs(getGraphPaths(), true);
+    }
 
-        for (const auto& item : directory_iterator(pathGraphFolder())) {
-            if (item.is_directory()) {
-                
-            } else if (item.is_regular_file()) {
-                auto path = item.path();
-                if (!path.has_extension() || path.extension().generic_string() != ".yaml") {
+    std::vector<std::string> Project::getGraphPaths() const {
+        filesCacheReady.wait(false);
+        std::lock_guard lock(graphPathsLock);
+        return graphPathsCache;
+    }
+
+    void Project::updateGraphPaths() {
+        std::vector<std::string> paths;
+        collectGraphPaths(fileCache, paths);
+        std::lock_guard lock(graphPathsLock);
+        graphPathsCache = std::move(paths);
+    }
+
+    void Project::parseGraphs(std::vector<std::string> const& graphPaths) const {
+        buildGraphs(graphPaths, false);
+    }
+
+    void Project::buildGraphs(std::vector<std::string> const& graphPaths, bool all) const {
+        // graphs use template nodes of entities, add them before any graph is read.
+        ensureEntityTemplates();
+
+        BuildManifest manifest;
+        auto manifestPath = pathTargetFolder() + SIGHT_BUILD_MANIFEST_FILE;
+        int status = manifest.load(manifestPath);
+        if (status == CODE_FILE_FORMAT_ERROR) {
+            logWarning("build manifest is bad, build all graphs.");
+        }
+
+        // plugins are not tracked per template, any plugin changed will build all graphs.
+        BuildHasher pluginHasher;
+        std::vector<Plugin const*> plugins;
+        for (const auto& [name, plugin] : pluginManager()->getPluginMap()) {
+            plugins.push_back(plugin);
+        }
+        std::sort(plugins.begin(), plugins.end(), [](Plugin const* a, Plugin const* b) { return a->getName() < b->getName(); });
+        for (auto plugin : plugins) {
+            pluginHasher.add(plugin->getName());
+            pluginHasher.add(std::string_view(plugin->getVersion()));
+            pluginHasher.add(plugin->getPluginStatus());
+        }
+
+        // entities are saved when they are changed, so the file is the definition, loaded or not.
+        absl::flat_hash_map<std::string, uint64_t> entityHashes;
+        for (const auto& [name, entity] : entitiesMap) {
+            BuildHasher hasher;
+            hasher.add(entity.name);
+            hashFileContent(entityStore.filePathOf(name), hasher);
+            entityHashes[entity.templateAddress] = hasher.value;
+        }
+
+        std::vector<std::string> keys;
+        SightGraphBinaryWriter records;
+        // graphs which outputs are up to date, sent to the ui thread.
+        std::string builtPaths;
+        int regenerated = 0;
+        int skipped = 0;
+        for (const auto& pathString : graphPaths) {
+            std::error_code ec;
+            auto key = std::filesystem::relative(pathString, baseDir, ec).generic_string();
+            keys.push_back(key);
+
+            BuildManifestEntry entry;
+            bool upToDate = false;
+            bool hashed = hashGraphBuildInputs(pathString, pluginHasher.value, entityHashes, entry, records) == CODE_OK;
+            if (hashed) {
+                auto last = manifest.find(key);
+                upToDate = last && last->graphHash == entry.graphHash && last->inputHash == entry.inputHash &&
+                    BuildManifest::isOutputUpToDate(*last);
+            } else {
+                // build it anyway, and build it again next time.
+                entry.graphHash = 0;
+            }
+
+            if (upToDate) {
+                skipped++;
+            } else {
+                regenerated++;
+                int parseStatus;
+                if (hashed) {
+                    // the yaml file is read once, by the hash.
+                    SightNodeGraph graph;
+                    parseStatus = graph.load(pathString, records);
+                    if (parseStatus == CODE_OK) {
+                        parseStatus = parseGraph(graph, true, true, &entry.outputPath);
+                    }
+                } else {
+                    parseStatus = parseGraph(pathString, true, true, &entry.outputPath);
+                }
+                if (parseStatus != CODE_OK) {
+                    manifest.remove(key);
                     continue;
                 }
+                if (entry.graphHash == 0) {
+                    manifest.remove(key);
+                } else {
+                    if (!entry.outputPath.empty()) {
+                        BuildHasher outputHasher;
+                        hashFileContent(entry.outputPath, outputHasher);
+                        entry.outputHash = outputHasher.value;
+                    }
+                    manifest.set(key, std::move(entry));
+                }
+            }
 
-                parseGraph(path.string());
+            if (!builtPaths.empty()) {
+                builtPaths += '\n';
             }
+            builtPaths += pathString;
+        }
+
+        if (all) {
+            manifest.retain(keys);
+        }
+        manifest.save();
+        logDebug("graphs built: $0, up to date: $1", regenerated, skipped);
+        if (!builtPaths.empty()) {
+            addUICommand(UICommandType::GraphsBuilt, strdup(builtPaths.c_str()), static_cast<int>(builtPaths.size()), true);
         }
     }
 
@@ -946,30 +1215,250 @@ namespace sight {
             currentGraphPath = g->getFilePath();
         }
 
-        for (const auto& item : directory_iterator(pathGraphFolder())) {
-            if (!item.is_regular_file()) {
+        // other graphs, by the usage index instead of loading them.
+        for (auto const& item : findTemplateUsages(templateAddress)) {
+            if (!currentGraphPath.empty() && std::filesystem::path(item.graphPath) == std::filesystem::path(currentGraphPath)) {
+                continue;
+            }
+            if (pathOut) {
+                pathOut->assign(item.graphPath);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    std::vector<TemplateUsage> Project::findTemplateUsages(std::string_view templateAddress) {
+        refreshTemplateUsages();
+        return templateUsageIndex.find(templateAddress);
+    }
+
+    TemplateUsageIndex& Project::getTemplateUsageIndex() {
+        return templateUsageIndex;
+    }
+
+    void Project::refreshTemplateUsages() {
+        // `fileCache` is written by the scan thread until it is ready.
+        waitFileScan();
+        templateUsageIndex.refresh(getGraphPaths());
+    }
+
+    void Project::applyStaleTemplates() {
+        if (staleTemplates.empty() && staleCodeTemplates.empty()) {
+            return;
+        }
+
+        refreshTemplateUsages();
+        for (const auto& item : staleTemplates) {
+            staleOutputs.markTemplate(templateUsageIndex, item);
+        }
+        for (const auto& item : staleCodeTemplates) {
+            staleOutputs.markCodeTemplate(templateUsageIndex, item);
+        }
+        staleTemplates.clear();
+        staleCodeTemplates.clear();
+    }
+
+    void Project::markTemplateStale(std::string_view templateAddress) {
+        staleTemplates.emplace(templateAddress);
+    }
+
+    void Project::markCodeTemplateStale(std::string_view codeTemplate) {
+        staleCodeTemplates.emplace(codeTemplate);
+    }
+
+    void Project::markGraphStale(std::string_view graphPath) {
+        staleOutputs.markGraph(templateUsageIndex, graphPath);
+    }
+
+    void Project::onGraphsBuilt(std::string_view graphPaths) {
+        // templates which are changed before the build, their graphs are built now.
+        applyStaleTemplates();
+        for (auto path : absl::StrSplit(graphPaths, '\n', absl::SkipEmpty())) {
+            staleOutputs.markBuilt(path);
+        }
+    }
+
+    StaleOutputs const& Project::getStaleOutputs() {
+        applyStaleTemplates();
+        return staleOutputs;
+    }
+
+    void Project::startWatcher() {
+        if (!getSightSettings()->watchProject || watcher.isRunning()) {
+            return;
+        }
+
+        std::vector<std::string> folders = { pathSrcFolder(), pathPluginsFolder(), baseDir + SIGHT_ENTITIES_FOLDER };
+        int status = watcher.start(std::move(folders), [](std::vector<std::string>&& paths) {
+            auto joined = absl::StrJoin(paths, "\n");
+            addUICommand(UICommandType::ProjectFilesChanged, strdup(joined.c_str()), static_cast<int>(joined.size()), true);
+        });
+        if (status != CODE_OK) {
+            logDebug("watch project failed: $0", status);
+        }
+    }
+
+    void Project::stopWatcher() {
+        watcher.stop();
+    }
+
+    void Project::onFilesChanged(std::string_view paths) {
+        auto pluginsFolder = pathPluginsFolder();
+        auto entitiesFolder = baseDir + SIGHT_ENTITIES_FOLDER;
+        auto graphFolder = pathGraphFolder();
+
+        absl::btree_set<std::string> folders;
+        absl::btree_set<std::string> pluginFolders;
+        absl::flat_hash_set<std::string> graphs;
+        std::vector<EntityFileChange> entityChanges;
+        for (auto item : absl::StrSplit(paths, '\n', absl::SkipEmpty())) {
+            std::string path(item);
+            fs::path fsPath(path);
+            // temp files and journals are only written by sight, and files which are written by sight are known.
+            if (endsWith(path, ".tmp") || endsWith(path, ".sgj") || isOwnWrite(path)) {
                 continue;
             }
+            if (endsWith(path, "/")) {
+                folders.insert(path);
+            } else {
+                folders.insert(fsPath.parent_path().generic_string() + "/");
+            }
 
-            auto path = item.path();
-            if (!path.has_extension() || path.extension().generic_string() != ".yaml") {
+            if (startsWith(path, pluginsFolder)) {
+                auto rest = path.substr(pluginsFolder.size());
+                if (!rest.empty()) {
+                    pluginFolders.insert(pluginsFolder + rest.substr(0, rest.find('/')));
+                }
+                continue;
+            }
+            if (startsWith(path, entitiesFolder)) {
+                auto file = path.substr(entitiesFolder.size());
+                if (!file.empty() && file.find('/') == std::string::npos) {
+                    int status = entityStore.reloadFile(file, entitiesMap, entityChanges);
+                    if (status != CODE_OK) {
+                        logWarning("read entity file failed: $0, $1", file, status);
+                    }
+                }
+                continue;
+            }
+            if (!startsWith(path, graphFolder)) {
                 continue;
             }
-            if (path.generic_string() == currentGraphPath) {
+
+            auto filename = fsPath.filename().generic_string();
+            if (!startsWith(filename, ".") && (endsWith(filename, ".yaml") || endsWith(filename, SIGHT_GRAPH_BINARY_EXT))) {
+                graphs.insert(TemplateUsageIndex::keyOf(path));
+            }
+        }
+
+        // file tree, a folder is skipped if its parent is read.
+        if (filesCacheReady) {
+            std::string lastFolder;
+            for (const auto& folder : folders) {
+                if (!lastFolder.empty() && startsWith(folder, lastFolder)) {
+                    continue;
+                }
+                lastFolder = folder;
+                refreshFilesAt(folder);
+            }
+            updateGraphPaths();
+            if (fileIndex.save() != CODE_OK) {
+                logWarning("save project file index failed");
+            }
+        }
+
+        for (const auto& graphPath : graphs) {
+            markGraphStale(graphPath);
+        }
+        auto graph = currentGraph();
+        if (graph && graphs.contains(TemplateUsageIndex::keyOf(graph->getFilePath())) && !isGraphSaving(graph->getFilePath()) &&
+            !graph->isSameAsFile()) {
+            if (graph->editing) {
+                currentUIStatus()->toastController.warning().toast("Graph is changed outside", "It has unsaved changes, reload it by hand.");
+            } else {
+                logDebug("reload graph: $0", graph->getFilePath());
+                uiReloadGraph();
+            }
+        }
+
+        applyEntityFileChanges(entityChanges);
+
+        for (const auto& folder : pluginFolders) {
+            addJsCommand(JsCommandType::PluginReloadAt, CommandArgs::copyFrom(folder));
+        }
+
+        if (getSightSettings()->buildOnProjectChange) {
+            buildStaleOutputs();
+        }
+    }
+
+    void Project::refreshFilesAt(std::string_view folder) {
+        auto relative = std::string_view(folder);
+        if (!startsWith(std::string(relative), baseDir)) {
+            return;
+        }
+        relative.remove_prefix(baseDir.size());
+
+        auto node = &fileCache;
+        for (auto part : absl::StrSplit(relative, '/', absl::SkipEmpty())) {
+            auto child = node->findChild(part);
+            if (!child || child->fileType != ProjectFileType::Directory) {
+                break;
+            }
+            node = child;
+        }
+        fillFiles(*node, fileIndex, node != &fileCache);
+    }
+
+    void Project::applyEntityFileChanges(std::vector<EntityFileChange> const& changes) {
+        for (const auto& change : changes) {
+            if (change.removed) {
+                delEntity(change.name);
                 continue;
             }
 
-            SightNodeGraph graph;
-            if (graph.load(path.string()) != CODE_OK) {
-                logDebug("graph load failed: $0", path.c_str());
+            auto iter = entitiesMap.find(change.name);
+            if (iter == entitiesMap.end()) {
+                continue;
+            }
+            auto& entity = iter->second;
+            indexEntityForSearch(entity);
+            if (change.added) {
+                entity.typeId = getIntType(entity.name, true);
+                pendingEntityTemplates[entity.templateAddress] = entity.name;
+                markTemplateStale(entity.templateAddress);
                 continue;
             }
 
-            if (checkNodesFunc(&graph)) {
-                return true;
+            // template nodes of pending entities are not added yet.
+            bool added = !pendingEntityTemplates.contains(change.oldTemplateAddress);
+            if (change.oldTemplateAddress != entity.templateAddress) {
+                if (added) {
+                    delTemplateNode(change.oldTemplateAddress);
+                } else {
+                    pendingEntityTemplates.erase(change.oldTemplateAddress);
+                }
+                markTemplateStale(change.oldTemplateAddress);
+            }
+            if (added) {
+                addTemplateNode(entity, true);
+            } else {
+                pendingEntityTemplates[entity.templateAddress] = entity.name;
             }
+            markTemplateStale(entity.templateAddress);
         }
-        return false;
+        entityTemplatesPending = !pendingEntityTemplates.empty();
+    }
+
+    void Project::buildStaleOutputs() {
+        applyStaleTemplates();
+        if (staleOutputs.empty()) {
+            return;
+        }
+
+        auto graphPaths = absl::StrJoin(staleOutputs.graphPaths(), "\n");
+        addJsCommand(JsCommandType::ProjectBuildGraphs, CommandArgs::copyFrom(graphPaths));
     }
 
     std::string Project::pathEntityFolder() const {
@@ -1003,17 +1492,17 @@ namespace sight {
         }
 
         if (id > 0) {
-            auto iter = typeInfoMap.find(id);
-            if (iter != typeInfoMap.end()) {
+            auto typeInfo = typeRegistry.find(id);
+            if (typeInfo) {
                 if (merge) {
-                    iter->second.mergeFrom(info);
+                    typeInfo->mergeFrom(info);
 
                     if (info.style) {
                         typeStyleArray.remove(info.style);
                         info.style = nullptr;
                     }
-                    logDebug("$0, $1, type merged.", iter->first, iter->second.name);
-                    return iter->first;
+                    logDebug("$0, $1, type merged.", id, typeInfo->name);
+                    return id;
                 } else {
                     logDebug("already exist: $0", info.intValue);
                     return 0;
@@ -1028,29 +1517,25 @@ namespace sight {
             info.style = typeStyleArray.add(typeStyle);
             // info.style->init();
         }
-        typeInfoMap[info.intValue] = info;
+        if (!typeRegistry.add(info)) {
+            typeStyleArray.remove(info.style);
+            return 0;
+        }
         typeMap[info.name] = info.intValue;
 
         resetTypeListCache();
         return info.intValue;
     }
 
-    TypeInfo const& Project::getTypeInfo(uint id, bool* isFind) {
-        auto iter = typeInfoMap.find(id);
-        if (iter == typeInfoMap.end()) {
-            if (isFind) {
-                *isFind = false;
-            }
-        } else {
-            if (isFind) {
-                *isFind = true;
-            }
-            return iter->second;
+    TypeInfo const& Project::getTypeInfo(uint id, bool* isFind) const {
+        auto typeInfo = typeRegistry.find(id);
+        if (isFind) {
+            *isFind = typeInfo != nullptr;
         }
-        return emptyTypeInfo;
+        return typeInfo ? *typeInfo : emptyTypeInfo;
     }
 
-    std::tuple<TypeInfo const&, bool> Project::findTypeInfo(uint id) {
+    std::tuple<TypeInfo const&, bool> Project::findTypeInfo(uint id) const {
         bool find = false;
         auto & typeInfo = getTypeInfo(id, &find);
         return std::forward_as_tuple(typeInfo, find);
@@ -1069,6 +1554,22 @@ namespace sight {
         return g_Project;
     }
 
+    void ensureEntityTemplates() {
+        auto project = currentProject();
+        if (!project || !project->hasPendingEntityTemplates() || !currentUIStatus()) {
+            return;
+        }
+
+        if (isUIThread()) {
+            project->updateEntitiesToTemplateNode();
+            return;
+        }
+        std::promise<int> promise;
+        auto future = promise.get_future();
+        addUICommand(UICommandType::RegisterEntityTemplates, CommandArgs{ .promise = &promise });
+        future.wait();
+    }
+
     void onProjectAndUILoadSuccess(Project* project){
         if (!project || project->isLoadCallbackCalled) {
             return;
@@ -1082,9 +1583,9 @@ namespace sight {
         project->isLoadCallbackCalled = true;
         status->selection.projectPath = project->getBaseDir();
         
-        project->buildFilesCache();
-        project->updateEntitiesToTemplateNode();
+        project->waitLoadTasks();
         project->checkOpenLastGraph();
+        project->startWatcher();
 
     }
 
@@ -1176,11 +1677,7 @@ namespace sight {
     }
 
     bool checkTypeCompatibility(uint type1, uint type2) {
-        if (type1 == type2) {
-            return true;
-        }
-
-        return type2 == IntTypeObject && type1 != IntTypeProcess;
+        return TypeRegistry::checkRule(type1, type2);
     }
 
     TypeInfoRender::TypeInfoRender()
@@ -1224,7 +1721,7 @@ namespace sight {
     void TypeInfoRender::operator()(const char* labelBuf, SightNodePort* port, std::function<void()> onValueChange) const {
         SightNodeValue& value = port->value;
         auto oldValue = port->value;
-        auto & options = port->options;
+        auto const& options = *port->options;
         switch (kind) {
         case TypeInfoRenderKind::Default:
             ImGui::Text(" ");
@@ -1312,12 +1809,12 @@ namespace sight {
         return getLastAfter(name, ".");
     }
 
-    bool TypeInfo::writeToJson(SightNodeValue const& value, crude_json::value & parent, std::string_view key) const {
+    bool TypeInfo::writeToJson(SightNodeValue const& value, SightJsonWriter& writer) const {
         switch (render.kind) {
             case TypeInfoRenderKind::Default:
                 break;
             case TypeInfoRenderKind::ComboBox:
-                parent[key.data()] = crude_json::value(static_cast<double>(value.u.i));
+                writer.value(static_cast<double>(value.u.i));
                 return true;
         }
         
@@ -1389,7 +1886,7 @@ namespace sight {
             if (!item.defaultValue.empty()) {
                 port.value.setValue(item.defaultValue);
             }
-            port.options = item.options.portOptions;
+            port.options.edit() = item.options.portOptions;
 
             node.addPort(port);
         }
@@ -0,0 +1,228 @@
+#include "sight_project_index.h"
+
+#include "sight.h"
+#include "sight_graph_binary.h"
+#include "sight_graph_yaml.h"
+#include "sight_log.h"
+#include "sight_util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+namespace sight {
+
+    namespace {
+
+        // bytes read to find `who-am-i`, the app always writes it as the first key.
+        constexpr size_t sniffSize = 4096;
+        // files per thread, a small project is refreshed on the caller thread only.
+        constexpr size_t filesPerThread = 64;
+
+        std::string_view trimValue(std::string_view value) {
+            auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+            while (!value.empty() && isSpace(value.front())) {
+                value.remove_prefix(1);
+            }
+            if (auto pos = value.find(" #"); pos != std::string_view::npos) {
+                value = value.substr(0, pos);
+            }
+            while (!value.empty() && isSpace(value.back())) {
+                value.remove_suffix(1);
+            }
+            if (value.size() >= 2 && (value.front() == '"' || value.front() == '\'') && value.back() == value.front()) {
+                value = value.substr(1, value.size() - 2);
+            }
+            return value;
+        }
+
+        bool isYamlGraph(std::string_view path) {
+            std::ifstream fin{ std::string(path), std::ios::in | std::ios::binary };
+            if (!fin.is_open()) {
+                return false;
+            }
+            char buf[sniffSize];
+            fin.read(buf, sizeof(buf));
+            std::string_view head(buf, static_cast<size_t>(fin.gcount()));
+            bool wholeFile = head.size() < sizeof(buf);
+            if (head.starts_with("\xEF\xBB\xBF")) {
+                head.remove_prefix(3);
+            }
+
+            // a top level `who-am-i: xxx` line
+            constexpr std::string_view key = "who-am-i:";
+            size_t lineStart = 0;
+            while (lineStart < head.size()) {
+                auto lineEnd = head.find('\n', lineStart);
+                if (lineEnd == std::string_view::npos) {
+                    if (!wholeFile) {
+                        // the line may be cut.
+                        break;
+                    }
+                    lineEnd = head.size();
+                }
+                auto line = head.substr(lineStart, lineEnd - lineStart);
+                if (line.starts_with(key)) {
+                    return trimValue(line.substr(key.size())) == "sight-graph";
+                }
+                lineStart = lineEnd + 1;
+            }
+
+            if (wholeFile && head.find("who-am-i") == std::string_view::npos) {
+                return false;
+            }
+            // not written by the app, e.g. flow style or the key is at the end.
+            return readYamlWhoAmI(path) == "sight-graph";
+        }
+
+    }
+
+    ProjectIndexKind sniffProjectFile(std::string_view path) {
+        if (endsWith(std::string(path), ".yaml")) {
+            return isYamlGraph(path) ? ProjectIndexKind::YamlGraph : ProjectIndexKind::Regular;
+        } else if (endsWith(std::string(path), SIGHT_GRAPH_BINARY_EXT)) {
+            return isGraphBinaryFile(path) ? ProjectIndexKind::BinaryGraph : ProjectIndexKind::Regular;
+        }
+        return ProjectIndexKind::Regular;
+    }
+
+    int ProjectFileIndex::load(std::string_view baseDir) {
+        this->baseDir = baseDir;
+        this->items.clear();
+        this->dirty = false;
+
+        std::ifstream fin{ this->baseDir + SIGHT_PROJECT_INDEX_FILE, std::ios::in | std::ios::binary };
+        if (!fin.is_open()) {
+            return CODE_FILE_NOT_EXISTS;
+        }
+        std::string content{ std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>() };
+
+        SightProjectIndexHeader header;
+        if (content.size() < sizeof(header)) {
+            return CODE_FILE_FORMAT_ERROR;
+        }
+        std::memcpy(&header, content.data(), sizeof(header));
+        if (std::memcmp(header.magic, sightProjectIndexMagic, sizeof(header.magic)) != 0 || header.version != sightProjectIndexVersion) {
+            return CODE_FILE_FORMAT_ERROR;
+        }
+
+        items.reserve(header.count);
+        size_t offset = sizeof(header);
+        for (uint32_t i = 0; i < header.count; i++) {
+            SightProjectIndexItem record;
+            if (content.size() - offset < sizeof(record)) {
+                items.clear();
+                return CODE_FILE_FORMAT_ERROR;
+            }
+            std::memcpy(&record, content.data() + offset, sizeof(record));
+            offset += sizeof(record);
+            if (content.size() - offset < record.pathLength) {
+                items.clear();
+                return CODE_FILE_FORMAT_ERROR;
+            }
+            items[content.substr(offset, record.pathLength)] = { record.size, record.modifyTime, record.kind };
+            offset += record.pathLength;
+        }
+        return CODE_OK;
+    }
+
+    int ProjectFileIndex::save() {
+        if (!dirty || baseDir.empty()) {
+            return CODE_OK;
+        }
+
+        SightProjectIndexHeader header;
+        std::memcpy(header.magic, sightProjectIndexMagic, sizeof(header.magic));
+        header.count = static_cast<uint32_t>(items.size());
+
+        std::string content(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (auto const& [path, item] : items) {
+            SightProjectIndexItem record;
+            record.size = item.size;
+            record.modifyTime = item.modifyTime;
+            record.kind = item.kind;
+            record.pathLength = static_cast<uint32_t>(path.size());
+            content.append(reinterpret_cast<const char*>(&record), sizeof(record));
+            content.append(path);
+        }
+
+        if (!writeFileAtomic(baseDir + SIGHT_PROJECT_INDEX_FILE, content)) {
+            return CODE_FILE_ERROR;
+        }
+        dirty = false;
+        return CODE_OK;
+    }
+
+    void ProjectFileIndex::refresh(std::vector<ProjectIndexFile>& files, std::string_view folder) {
+        // only graph files are read, other files need no stat.
+        std::vector<ProjectIndexFile*> candidates;
+        for (auto& file : files) {
+            file.kind = ProjectIndexKind::Regular;
+            if (endsWith(file.path, ".yaml") || endsWith(file.path, SIGHT_GRAPH_BINARY_EXT)) {
+                candidates.push_back(&file);
+            }
+        }
+
+        std::atomic<size_t> next{ 0 };
+        std::atomic<uint> hitCount{ 0 };
+        auto work = [this, &candidates, &next, &hitCount]() {
+            // `items` is only read here.
+            for (size_t i; (i = next.fetch_add(1)) < candidates.size();) {
+                auto& file = *candidates[i];
+                if (!graphSourceStamp(file.path, file.size, file.modifyTime)) {
+                    continue;
+                }
+                auto iter = items.find(relativePath(file.path));
+                if (iter != items.end() && iter->second.size == file.size && iter->second.modifyTime == file.modifyTime) {
+                    file.kind = iter->second.kind;
+                    hitCount++;
+                    continue;
+                }
+                file.kind = sniffProjectFile(file.path);
+            }
+        };
+
+        size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), candidates.size() / filesPerThread + 1);
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < threadCount; i++) {
+            threads.emplace_back(work);
+        }
+        work();
+        for (auto& item : threads) {
+            item.join();
+        }
+
+        hits = hitCount;
+        sniffed = static_cast<uint>(candidates.size()) - hits;
+
+        absl::flat_hash_map<std::string, Item> nextItems;
+        nextItems.reserve(candidates.size());
+        if (!folder.empty()) {
+            auto prefix = relativePath(folder);
+            for (auto const& [path, item] : items) {
+                if (!std::string_view(path).starts_with(prefix)) {
+                    nextItems.emplace(path, item);
+                }
+            }
+        }
+        for (auto file : candidates) {
+            nextItems[relativePath(file->path)] = { file->size, file->modifyTime, file->kind };
+        }
+        if (sniffed > 0 || nextItems.size() != items.size()) {
+            dirty = true;
+        }
+        items = std::move(nextItems);
+    }
+
+    std::string_view ProjectFileIndex::relativePath(std::string_view path) const {
+        if (path.starts_with(baseDir)) {
+            path.remove_prefix(baseDir.size());
+        }
+        return path;
+    }
+
+}
@@ -0,0 +1,229 @@
+#include "sight_project_watcher.h"
+
+#include "sight.h"
+#include "sight_log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+
+#ifdef __linux__
+#    include <poll.h>
+#    include <sys/inotify.h>
+#    include <unistd.h>
+#endif
+
+#include "absl/container/btree_set.h"
+#include "absl/container/flat_hash_map.h"
+
+namespace sight {
+
+#ifdef __linux__
+
+    namespace {
+
+        // changes are reported after no event for this time.
+        constexpr int debounceMs = 200;
+        // and no later than this, if events keep coming.
+        constexpr int maxDelayMs = 2000;
+
+        constexpr uint32_t watchMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF;
+
+        struct WatchState {
+            int fd = -1;
+            // key: watch descriptor, value: folder, ends with `/`
+            absl::flat_hash_map<int, std::string> folders;
+            std::vector<std::string> roots;
+        };
+
+        void addWatch(WatchState& state, std::string const& folder) {
+            int wd = inotify_add_watch(state.fd, folder.c_str(), watchMask);
+            if (wd < 0) {
+                logDebug("watch folder failed: $0", folder);
+                return;
+            }
+            state.folders[wd] = folder;
+
+            std::error_code ec;
+            for (const auto& item : std::filesystem::directory_iterator(folder, ec)) {
+                if (item.is_directory(ec) && !item.is_symlink(ec)) {
+                    addWatch(state, item.path().generic_string() + "/");
+                }
+            }
+        }
+
+        /**
+         * @return false if the queue is overflowed, changes are unknown.
+         */
+        bool readEvents(WatchState& state, absl::btree_set<std::string>& changes) {
+            alignas(inotify_event) char buf[16 * 1024];
+            bool ok = true;
+            while (true) {
+                auto length = read(state.fd, buf, sizeof(buf));
+                if (length <= 0) {
+                    break;
+                }
+
+                for (char* p = buf; p < buf + length;) {
+                    auto event = reinterpret_cast<inotify_event*>(p);
+                    p += sizeof(inotify_event) + event->len;
+
+                    if (event->mask & IN_Q_OVERFLOW) {
+                        ok = false;
+                        continue;
+                    }
+                    auto iter = state.folders.find(event->wd);
+                    if (iter == state.folders.end()) {
+                        continue;
+                    }
+                    if (event->mask & IN_IGNORED) {
+                        state.folders.erase(iter);
+                        continue;
+                    }
+
+                    auto folder = iter->second;
+                    if (event->len == 0) {
+                        // the folder itself
+                        changes.insert(folder);
+                        continue;
+                    }
+
+                    auto path = folder + event->name;
+                    if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+                        // files may be added before the watch, they are found by refreshing the folder.
+                        addWatch(state, path + "/");
+                    }
+                    changes.insert(std::move(path));
+                }
+            }
+            return ok;
+        }
+
+        void watchLoop(WatchState state, int wakeFd, std::atomic<bool>& running, ProjectWatcher::Callback const& callback) {
+            using clock = std::chrono::steady_clock;
+            absl::btree_set<std::string> changes;
+            // time of the first change which is not reported.
+            clock::time_point firstChange;
+            auto elapsedMs = [&firstChange]() {
+                return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - firstChange).count());
+            };
+
+            while (running) {
+                pollfd fds[2] = {
+                    { state.fd, POLLIN, 0 },
+                    { wakeFd, POLLIN, 0 },
+                };
+                int timeout = changes.empty() ? -1 : std::clamp(maxDelayMs - elapsedMs(), 0, debounceMs);
+                int n = poll(fds, 2, timeout);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    logError("watch project failed: $0", errno);
+                    break;
+                }
+                if (fds[1].revents) {
+                    break;
+                }
+
+                if (n > 0 && (fds[0].revents & POLLIN)) {
+                    bool hadChanges = !changes.empty();
+                    if (!readEvents(state, changes)) {
+                        logWarning("too many file changes, refresh watched folders.");
+                        changes.insert(state.roots.begin(), state.roots.end());
+                    }
+                    if (!hadChanges) {
+                        firstChange = clock::now();
+                    }
+                    if (elapsedMs() < maxDelayMs) {
+                        continue;
+                    }
+                }
+
+                if (!changes.empty()) {
+                    std::vector<std::string> paths(changes.begin(), changes.end());
+                    changes.clear();
+                    callback(std::move(paths));
+                }
+            }
+
+            for (const auto& [wd, folder] : state.folders) {
+                inotify_rm_watch(state.fd, wd);
+            }
+        }
+
+    }
+
+    int ProjectWatcher::start(std::vector<std::string> folders, Callback callback) {
+        if (running) {
+            return CODE_FAIL;
+        }
+
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0) {
+            return CODE_FILE_ERROR;
+        }
+        if (pipe(wakeFds) != 0) {
+            close(inotifyFd);
+            inotifyFd = -1;
+            return CODE_FILE_ERROR;
+        }
+
+        WatchState state;
+        state.fd = inotifyFd;
+        std::error_code ec;
+        for (auto& folder : folders) {
+            if (std::filesystem::is_directory(folder, ec)) {
+                addWatch(state, folder);
+                state.roots.push_back(std::move(folder));
+            }
+        }
+        logDebug("watch project, folders: $0", state.folders.size());
+
+        running = true;
+        thread = std::thread([this, state = std::move(state), callback = std::move(callback)]() mutable {
+            watchLoop(std::move(state), wakeFds[0], running, callback);
+        });
+        return CODE_OK;
+    }
+
+    void ProjectWatcher::stop() {
+        if (!thread.joinable()) {
+            return;
+        }
+
+        running = false;
+        char c = 0;
+        if (write(wakeFds[1], &c, 1) < 0) {
+            logDebug("wake project watcher failed");
+        }
+        thread.join();
+
+        close(inotifyFd);
+        close(wakeFds[0]);
+        close(wakeFds[1]);
+        inotifyFd = -1;
+        wakeFds[0] = wakeFds[1] = -1;
+    }
+
+#else
+
+    int ProjectWatcher::start(std::vector<std::string> folders, Callback callback) {
+        return CODE_NOT_IMPLEMENTED;
+    }
+
+    void ProjectWatcher::stop() {
+    }
+
+#endif
+
+    ProjectWatcher::~ProjectWatcher() {
+        stop();
+    }
+
+    bool ProjectWatcher::isRunning() const {
+        return running;
+    }
+
+}
@@ -0,0 +1,379 @@
+#include "sight_search_index.h"
+
+#include "sight_log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_split.h"
+
+namespace sight {
+
+    namespace {
+
+        constexpr size_t maxResults = 200;
+        // the match is tried from at most this many places of the first char.
+        constexpr int maxMatchStarts = 8;
+        // how often a query checks whether a newer one comes, in items.
+        constexpr size_t cancelCheckInterval = 1024;
+
+        struct SearchEntry {
+            SearchItem item;
+            // bits of chars in `item.text`, a query can match only if all of its bits are in it.
+            uint64_t charMask = 0;
+            bool alive = false;
+        };
+
+        struct SearchIndex {
+            // guards entries and sources, queries take it shared.
+            std::shared_mutex dataMutex;
+            std::vector<SearchEntry> entries;
+            std::vector<size_t> freeEntries;
+            // key: source, value: indexes of entries
+            absl::flat_hash_map<std::string, std::vector<size_t>> sources;
+
+            // guards the query and results.
+            std::mutex queryMutex;
+            std::condition_variable queryCond;
+            std::string pendingQuery;
+            bool hasPendingQuery = false;
+            // increased by every query, a query stops if it is not the newest one.
+            std::atomic<uint> queryGeneration = 0;
+            std::vector<SearchResult> results;
+            std::string resultQuery;
+            bool hasNewResults = false;
+            bool stop = false;
+            std::thread thread;
+        };
+
+        // never freed, so the thread is not destroyed with static objects while it is running.
+        SearchIndex& searchIndex() {
+            static auto index = new SearchIndex();
+            return *index;
+        }
+
+        char lowerChar(char c) {
+            return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+
+        uint64_t charMaskOf(std::string_view str) {
+            uint64_t mask = 0;
+            for (char c : str) {
+                mask |= uint64_t(1) << (static_cast<unsigned char>(lowerChar(c)) % 64);
+            }
+            return mask;
+        }
+
+        bool isWordStart(std::string_view text, size_t i) {
+            if (i == 0) {
+                return true;
+            }
+            char prev = text[i - 1];
+            char c = text[i];
+            if (prev == '.' || prev == '/' || prev == '_' || prev == '-' || prev == ' ' || prev == ':') {
+                return true;
+            }
+            // camelCase
+            return prev >= 'a' && prev <= 'z' && c >= 'A' && c <= 'Z';
+        }
+
+        size_t findChar(std::string_view text, size_t from, char c, bool wordStartOnly) {
+            for (size_t i = from; i < text.size(); i++) {
+                if (lowerChar(text[i]) == c && (!wordStartOnly || isWordStart(text, i))) {
+                    return i;
+                }
+            }
+            return std::string_view::npos;
+        }
+
+        /**
+         * @param preferWordStarts  match a char at the next start of a word if there is one, e.g. `sn` in `stringNode`.
+         */
+        int matchFrom(std::string_view query, std::string_view text, size_t start, bool preferWordStarts) {
+            int score = 0;
+            size_t q = 0;
+            size_t last = start;
+            for (size_t i = start; i < text.size() && q < query.size(); i++) {
+                auto c = lowerChar(query[q]);
+                if (q > 0 && preferWordStarts) {
+                    auto next = findChar(text, i, c, true);
+                    i = next != std::string_view::npos ? next : findChar(text, i, c, false);
+                } else {
+                    i = findChar(text, i, c, false);
+                }
+                if (i == std::string_view::npos) {
+                    break;
+                }
+
+                score += 1;
+                if (isWordStart(text, i)) {
+                    score += 8;
+                }
+                if (q > 0) {
+                    if (i == last + 1) {
+                        score += 6;
+                    } else {
+                        score -= static_cast<int>(std::min<size_t>(i - last - 1, 4));
+                    }
+                }
+                last = i;
+                q++;
+            }
+            if (q < query.size()) {
+                return -1;
+            }
+
+            if (start == 0) {
+                score += 12;
+            }
+            // shorter text first
+            score -= static_cast<int>(std::min<size_t>((text.size() - query.size()) / 8, 8));
+            return std::max(score, 0);
+        }
+
+        void removeSourceEntries(SearchIndex& index, std::vector<size_t> const& entryIndexes) {
+            for (auto i : entryIndexes) {
+                auto& entry = index.entries[i];
+                entry.alive = false;
+                entry.item = {};
+                index.freeEntries.push_back(i);
+            }
+        }
+
+        /**
+         * @return false if a newer query comes, `results` is incomplete then.
+         */
+        bool runQuery(SearchIndex& index, std::string_view query, uint generation, std::vector<SearchResult>& results) {
+            // every term must match.
+            std::vector<std::string_view> terms = absl::StrSplit(query, ' ', absl::SkipWhitespace());
+            if (terms.empty()) {
+                return true;
+            }
+            uint64_t queryMask = 0;
+            for (auto const& term : terms) {
+                queryMask |= charMaskOf(term);
+            }
+
+            std::shared_lock lock(index.dataMutex);
+            // score, entry index
+            std::vector<std::pair<int, size_t>> matched;
+            for (size_t i = 0; i < index.entries.size(); i++) {
+                if (i % cancelCheckInterval == 0 && index.queryGeneration != generation) {
+                    return false;
+                }
+
+                auto const& entry = index.entries[i];
+                if (!entry.alive || (entry.charMask & queryMask) != queryMask) {
+                    continue;
+                }
+
+                int score = 0;
+                for (auto const& term : terms) {
+                    int termScore = fuzzyMatchScore(term, entry.item.text);
+                    if (termScore < 0) {
+                        score = -1;
+                        break;
+                    }
+                    score += termScore;
+                }
+                if (score >= 0) {
+                    matched.emplace_back(score, i);
+                }
+            }
+
+            auto count = std::min(matched.size(), maxResults);
+            std::partial_sort(matched.begin(), matched.begin() + count, matched.end(), [&index](auto const& lhs, auto const& rhs) {
+                if (lhs.first != rhs.first) {
+                    return lhs.first > rhs.first;
+                }
+                return index.entries[lhs.second].item.text < index.entries[rhs.second].item.text;
+            });
+
+            results.reserve(count);
+            for (size_t i = 0; i < count; i++) {
+                results.push_back({ index.entries[matched[i].second].item, matched[i].first });
+            }
+            return true;
+        }
+
+        void searchThreadRun() {
+            auto& index = searchIndex();
+            std::unique_lock<std::mutex> lock(index.queryMutex);
+            while (true) {
+                index.queryCond.wait(lock, [&index]() { return index.stop || index.hasPendingQuery; });
+                if (index.stop) {
+                    break;
+                }
+
+                auto query = std::move(index.pendingQuery);
+                index.hasPendingQuery = false;
+                uint generation = index.queryGeneration;
+                lock.unlock();
+
+                std::vector<SearchResult> results;
+                bool done = runQuery(index, query, generation, results);
+
+                lock.lock();
+                if (done && generation == index.queryGeneration) {
+                    index.results = std::move(results);
+                    index.resultQuery = std::move(query);
+                    index.hasNewResults = true;
+                }
+            }
+        }
+
+    }
+
+    const char* getSearchItemKindName(SearchItemKind kind) {
+        switch (kind) {
+        case SearchItemKind::Template:
+            return "Template";
+        case SearchItemKind::Entity:
+            return "Entity";
+        case SearchItemKind::EntityField:
+            return "Field";
+        case SearchItemKind::Graph:
+            return "Graph";
+        case SearchItemKind::Node:
+            return "Node";
+        case SearchItemKind::PortValue:
+            return "Value";
+        }
+        return "";
+    }
+
+    void setSearchItems(std::string_view source, std::vector<SearchItem>&& items) {
+        auto& index = searchIndex();
+        std::unique_lock lock(index.dataMutex);
+        auto& entryIndexes = index.sources[source];
+        removeSourceEntries(index, entryIndexes);
+        entryIndexes.clear();
+
+        for (auto& item : items) {
+            size_t i = 0;
+            if (index.freeEntries.empty()) {
+                i = index.entries.size();
+                index.entries.emplace_back();
+            } else {
+                i = index.freeEntries.back();
+                index.freeEntries.pop_back();
+            }
+
+            auto& entry = index.entries[i];
+            entry.charMask = charMaskOf(item.text);
+            entry.item = std::move(item);
+            entry.alive = true;
+            entryIndexes.push_back(i);
+        }
+        if (entryIndexes.empty()) {
+            index.sources.erase(source);
+        }
+    }
+
+    void removeSearchItems(std::string_view source) {
+        auto& index = searchIndex();
+        std::unique_lock lock(index.dataMutex);
+        auto iter = index.sources.find(source);
+        if (iter == index.sources.end()) {
+            return;
+        }
+        removeSourceEntries(index, iter->second);
+        index.sources.erase(iter);
+    }
+
+    void removeSearchItemsByPrefix(std::string_view prefix) {
+        auto& index = searchIndex();
+        std::unique_lock lock(index.dataMutex);
+        for (auto iter = index.sources.begin(); iter != index.sources.end();) {
+            if (std::string_view(iter->first).starts_with(prefix)) {
+                removeSourceEntries(index, iter->second);
+                index.sources.erase(iter++);
+            } else {
+                ++iter;
+            }
+        }
+    }
+
+    size_t getSearchItemCount() {
+        auto& index = searchIndex();
+        std::shared_lock lock(index.dataMutex);
+        return index.entries.size() - index.freeEntries.size();
+    }
+
+    void postSearchQuery(std::string_view query) {
+        auto& index = searchIndex();
+        std::unique_lock<std::mutex> lock(index.queryMutex);
+        index.pendingQuery = query;
+        index.hasPendingQuery = true;
+        index.queryGeneration++;
+
+        if (!index.thread.joinable()) {
+            index.stop = false;
+            index.thread = std::thread(searchThreadRun);
+        }
+        lock.unlock();
+        index.queryCond.notify_one();
+    }
+
+    bool takeSearchResults(std::vector<SearchResult>& out, std::string* queryOut) {
+        auto& index = searchIndex();
+        std::lock_guard<std::mutex> lock(index.queryMutex);
+        if (!index.hasNewResults) {
+            return false;
+        }
+
+        out = std::move(index.results);
+        index.results.clear();
+        if (queryOut) {
+            *queryOut = std::move(index.resultQuery);
+        }
+        index.hasNewResults = false;
+        return true;
+    }
+
+    int fuzzyMatchScore(std::string_view query, std::string_view text) {
+        if (query.empty()) {
+            return 0;
+        }
+        if (query.size() > text.size()) {
+            return -1;
+        }
+
+        int best = -1;
+        int starts = 0;
+        auto first = lowerChar(query[0]);
+        for (size_t start = 0; start + query.size() <= text.size() && starts < maxMatchStarts; start++) {
+            if (lowerChar(text[start]) != first) {
+                continue;
+            }
+            starts++;
+            auto score = matchFrom(query, text, start, false);
+            if (score < 0) {
+                // no match from here, so none from later places either.
+                break;
+            }
+            best = std::max({ best, score, matchFrom(query, text, start, true) });
+        }
+        return best;
+    }
+
+    void stopSearchThread() {
+        auto& index = searchIndex();
+        {
+            std::lock_guard<std::mutex> lock(index.queryMutex);
+            index.stop = true;
+        }
+        index.queryCond.notify_one();
+        if (index.thread.joinable()) {
+            index.thread.join();
+        }
+        logDebug("search thread stopped");
+    }
+
+}
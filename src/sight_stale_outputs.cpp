@@ -0,0 +1,65 @@
+#include "sight_stale_outputs.h"
+
+#include "sight_log.h"
+#include "sight_template_usage.h"
+
+#include "absl/strings/substitute.h"
+
+namespace sight {
+
+    void StaleOutputs::markTemplate(TemplateUsageIndex const& index, std::string_view templateAddress) {
+        auto reason = absl::Substitute("template: $0", templateAddress);
+        for (auto const& item : index.find(templateAddress)) {
+            mark(index, item.graphPath, reason);
+        }
+    }
+
+    void StaleOutputs::markCodeTemplate(TemplateUsageIndex const& index, std::string_view codeTemplate) {
+        auto reason = absl::Substitute("code template: $0", codeTemplate);
+        for (auto const& item : index.findByCodeTemplate(codeTemplate)) {
+            mark(index, item, reason);
+        }
+    }
+
+    void StaleOutputs::markGraph(TemplateUsageIndex const& index, std::string_view graphPath) {
+        mark(index, TemplateUsageIndex::keyOf(graphPath), "graph");
+    }
+
+    void StaleOutputs::markBuilt(std::string_view graphPath) {
+        outputs.erase(TemplateUsageIndex::keyOf(graphPath));
+    }
+
+    std::vector<std::string> StaleOutputs::graphPaths() const {
+        std::vector<std::string> result;
+        result.reserve(outputs.size());
+        for (auto const& [key, item] : outputs) {
+            result.push_back(key);
+        }
+        return result;
+    }
+
+    absl::btree_map<std::string, StaleOutput> const& StaleOutputs::getOutputs() const {
+        return outputs;
+    }
+
+    bool StaleOutputs::empty() const {
+        return outputs.empty();
+    }
+
+    void StaleOutputs::clear() {
+        outputs.clear();
+    }
+
+    void StaleOutputs::mark(TemplateUsageIndex const& index, std::string const& key, std::string_view reason) {
+        auto outputPath = index.outputOf(key);
+        auto iter = outputs.find(key);
+        if (iter != outputs.end()) {
+            // keep the first reason, but the output file may be changed by the graph.
+            iter->second.outputPath = std::move(outputPath);
+            return;
+        }
+        logDebug("stale output: $0, $1", key, reason);
+        outputs[key] = { key, std::move(outputPath), std::string(reason) };
+    }
+
+}
@@ -0,0 +1,254 @@
+#include "sight_template_usage.h"
+
+#include "sight.h"
+#include "sight_graph_binary.h"
+#include "sight_graph_journal.h"
+#include "sight_graph_saver.h"
+#include "sight_log.h"
+#include "sight_util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <system_error>
+#include <thread>
+
+namespace sight {
+
+    namespace {
+
+        // graphs per thread when reading changed graphs.
+        constexpr size_t graphsPerThread = 4;
+
+        std::string graphKey(std::string_view path) {
+            std::error_code ec;
+            auto result = std::filesystem::absolute(path, ec);
+            return (ec ? std::filesystem::path(path) : result).lexically_normal().generic_string();
+        }
+
+        bool stampGraph(std::string const& path, uint64_t& size, int64_t& modifyTime, uint64_t& journalSize) {
+            if (!graphSourceStamp(path, size, modifyTime)) {
+                return false;
+            }
+            std::error_code ec;
+            journalSize = std::filesystem::file_size(graphJournalPath(path), ec);
+            if (ec) {
+                journalSize = 0;
+            }
+            return true;
+        }
+
+        template<class Source>
+        void countTemplates(Source const& source, TemplateUsageIndex::GraphInfo& info) {
+            for (auto const& record : nodesOf(source)) {
+                auto address = source.str(record.templateAddress);
+                if (!address.empty()) {
+                    info.templates[address]++;
+                }
+            }
+            for (auto const& setting : settingsOf(source)) {
+                auto key = source.str(setting.key);
+                if (key == "codeTemplate") {
+                    info.codeTemplate = source.str(setting.value);
+                } else if (key == "outputFilePath") {
+                    info.outputPath = source.str(setting.value);
+                }
+            }
+        }
+
+        /**
+         * @brief Read records of a graph file, same as `SightNodeGraph::load` but no node is created.
+         */
+        int readGraphTemplates(std::string const& path, TemplateUsageIndex::GraphInfo& info) {
+            if (endsWith(path, SIGHT_GRAPH_BINARY_EXT)) {
+                SightGraphBinaryReader reader;
+                int status = reader.open(path);
+                if (status == CODE_OK) {
+                    countTemplates(reader, info);
+                }
+                return status;
+            }
+
+            SightGraphBinaryWriter data;
+            int status = readGraphYamlRecords(path, data);
+            if (status != CODE_OK) {
+                return status;
+            }
+            if (getSightSettings()->graphJournal) {
+                replayGraphJournal(path, data);
+            }
+            countTemplates(data, info);
+            info.contentHash = data.contentHash();
+            return CODE_OK;
+        }
+
+    }
+
+    bool TemplateUsageIndex::updateGraph(std::string_view path, SightGraphBinaryWriter const& data) {
+        auto key = graphKey(path);
+        auto contentHash = data.contentHash();
+        if (auto iter = graphs.find(key); iter != graphs.end() && iter->second.contentHash == contentHash) {
+            // same content, the stat is taken again after it is written.
+            iter->second.stamped = false;
+            return false;
+        }
+
+        GraphInfo info;
+        countTemplates(data, info);
+        info.contentHash = contentHash;
+        setGraph(key, std::move(info));
+        return true;
+    }
+
+    void TemplateUsageIndex::refresh(std::vector<std::string> const& graphPaths) {
+        struct Task {
+            std::string key;
+            GraphInfo info;
+            bool ok = false;
+        };
+        std::vector<Task> tasks;
+
+        absl::flat_hash_map<std::string, bool> alive;
+        for (auto const& path : graphPaths) {
+            auto key = graphKey(path);
+            alive[key] = true;
+
+            GraphInfo info;
+            if (!stampGraph(key, info.size, info.modifyTime, info.journalSize)) {
+                continue;
+            }
+            auto iter = graphs.find(key);
+            if (iter != graphs.end()) {
+                auto& old = iter->second;
+                if (!old.stamped) {
+                    // counted from a snapshot, it is on disk once the save thread is done with it.
+                    if (!isGraphSaving(key)) {
+                        old.size = info.size;
+                        old.modifyTime = info.modifyTime;
+                        old.journalSize = info.journalSize;
+                        old.stamped = true;
+                    }
+                    continue;
+                }
+                if (old.size == info.size && old.modifyTime == info.modifyTime && old.journalSize == info.journalSize) {
+                    continue;
+                }
+            }
+            info.stamped = true;
+            tasks.push_back({ std::move(key), std::move(info) });
+        }
+
+        std::vector<std::string> removed;
+        for (auto const& [key, info] : graphs) {
+            if (!alive.contains(key)) {
+                removed.push_back(key);
+            }
+        }
+        for (auto const& key : removed) {
+            removeGraph(key);
+        }
+
+        std::atomic<size_t> next{ 0 };
+        auto work = [&tasks, &next]() {
+            for (size_t i; (i = next.fetch_add(1)) < tasks.size();) {
+                auto& task = tasks[i];
+                task.ok = readGraphTemplates(task.key, task.info) == CODE_OK;
+            }
+        };
+        size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), tasks.size() / graphsPerThread + 1);
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < threadCount; i++) {
+            threads.emplace_back(work);
+        }
+        work();
+        for (auto& item : threads) {
+            item.join();
+        }
+
+        for (auto& task : tasks) {
+            if (task.ok) {
+                setGraph(task.key, std::move(task.info));
+            } else {
+                logDebug("read templates of graph failed: $0", task.key);
+                removeGraph(task.key);
+            }
+        }
+        if (!tasks.empty()) {
+            logDebug("template usage, read graphs: $0, all graphs: $1", tasks.size(), graphs.size());
+        }
+    }
+
+    std::vector<TemplateUsage> TemplateUsageIndex::find(std::string_view templateAddress) const {
+        std::vector<TemplateUsage> result;
+        auto iter = usages.find(templateAddress);
+        if (iter == usages.end()) {
+            return result;
+        }
+        for (auto const& [path, count] : iter->second) {
+            result.push_back({ path, count });
+        }
+        std::sort(result.begin(), result.end(), [](TemplateUsage const& a, TemplateUsage const& b) { return a.graphPath < b.graphPath; });
+        return result;
+    }
+
+    std::vector<std::string> TemplateUsageIndex::findByCodeTemplate(std::string_view codeTemplate) const {
+        std::vector<std::string> result;
+        auto iter = codeTemplateUsages.find(codeTemplate);
+        if (iter != codeTemplateUsages.end()) {
+            result.assign(iter->second.begin(), iter->second.end());
+            std::sort(result.begin(), result.end());
+        }
+        return result;
+    }
+
+    std::string TemplateUsageIndex::outputOf(std::string_view graphPath) const {
+        auto iter = graphs.find(graphKey(graphPath));
+        return iter == graphs.end() ? std::string() : iter->second.outputPath;
+    }
+
+    std::string TemplateUsageIndex::keyOf(std::string_view graphPath) {
+        return graphKey(graphPath);
+    }
+
+    void TemplateUsageIndex::clear() {
+        graphs.clear();
+        usages.clear();
+        codeTemplateUsages.clear();
+    }
+
+    void TemplateUsageIndex::setGraph(std::string const& key, GraphInfo&& info) {
+        removeGraph(key);
+        for (auto const& [address, count] : info.templates) {
+            usages[address][key] = count;
+        }
+        if (!info.codeTemplate.empty()) {
+            codeTemplateUsages[info.codeTemplate].insert(key);
+        }
+        graphs[key] = std::move(info);
+    }
+
+    void TemplateUsageIndex::removeGraph(std::string const& key) {
+        auto iter = graphs.find(key);
+        if (iter == graphs.end()) {
+            return;
+        }
+        for (auto const& [address, count] : iter->second.templates) {
+            auto usage = usages.find(address);
+            if (usage == usages.end()) {
+                continue;
+            }
+            usage->second.erase(key);
+            if (usage->second.empty()) {
+                usages.erase(usage);
+            }
+        }
+        if (auto codeTemplate = codeTemplateUsages.find(iter->second.codeTemplate); codeTemplate != codeTemplateUsages.end()) {
+            codeTemplate->second.erase(key);
+            if (codeTemplate->second.empty()) {
+                codeTemplateUsages.erase(codeTemplate);
+            }
+        }
+        graphs.erase(iter);
+    }
+
+}
@@ -0,0 +1,86 @@
+#include "sight_type_registry.h"
+
+#include "sight.h"
+#include "sight_log.h"
+#include "sight_project.h"
+
+namespace sight {
+
+    namespace {
+
+        // slots of built-in ids, ids in `[builtInSlots, IntTypeNext)` are not used.
+        constexpr size_t builtInSlots = IntTypeButton + 1;
+
+    }
+
+    TypeRegistry::TypeRegistry() = default;
+
+    TypeRegistry::~TypeRegistry() = default;
+
+    size_t TypeRegistry::slotOf(uint id) {
+        if (id < builtInSlots) {
+            return id;
+        }
+        if (id >= IntTypeNext) {
+            return builtInSlots + (id - IntTypeNext);
+        }
+        return invalidSlot;
+    }
+
+    TypeInfo const* TypeRegistry::find(uint id) const {
+        auto slot = slotOf(id);
+        return slot < types.size() ? types[slot].get() : nullptr;
+    }
+
+    TypeInfo* TypeRegistry::find(uint id) {
+        auto slot = slotOf(id);
+        return slot < types.size() ? types[slot].get() : nullptr;
+    }
+
+    TypeInfo* TypeRegistry::add(TypeInfo const& info) {
+        auto slot = slotOf(info.intValue);
+        if (slot == invalidSlot) {
+            logError("bad type id: $0, $1", info.intValue, info.name);
+            return nullptr;
+        }
+
+        if (slot >= types.size()) {
+            types.resize(slot + 1);
+        }
+        auto& item = types[slot];
+        if (item) {
+            *item = info;
+        } else {
+            item = std::make_unique<TypeInfo>(info);
+            count++;
+        }
+        return item.get();
+    }
+
+    bool TypeRegistry::remove(uint id) {
+        auto slot = slotOf(id);
+        if (slot >= types.size() || !types[slot]) {
+            return false;
+        }
+
+        types[slot].reset();
+        count--;
+        while (!types.empty() && !types.back()) {
+            types.pop_back();
+        }
+        return true;
+    }
+
+    size_t TypeRegistry::size() const {
+        return count;
+    }
+
+    bool TypeRegistry::checkRule(uint from, uint to) {
+        if (from == to) {
+            return true;
+        }
+
+        return to == IntTypeObject && from != IntTypeProcess;
+    }
+
+}
@@ -27,12 +27,14 @@
 #include "sight_widgets.h"
 #include "sight_render.h"
 #include "sight_ui_hierarchy.h"
+#include "sight_ui_search.h"
 
 #include "v8pp/convert.hpp"
 
 #include "IconsMaterialDesign.h"
 
 #include <algorithm>
+#include <memory>
 #include <cassert>
 #include <corecrt_math.h>
 #include <cstddef>
@@ -72,6 +74,8 @@
 
 static sight::UIStatus* g_UIStatus = nullptr;
 static std::atomic<bool> uiCommandFree = true;
+// the thread which runs the ui loop, set by `showLoadingWindow`.
+static std::atomic<std::thread::id> g_UIThreadId;
 
 namespace sight {
 
@@ -198,6 +202,9 @@ namespace sight {
                 if (ImGui::MenuItem("CodeSetSettings")) {
                     g_UIStatus->windowStatus.codeSetSettingsWindow = true;
                 }
+                if (ImGui::MenuItem("StaleOutputs")) {
+                    g_UIStatus->windowStatus.staleOutputsWindow = true;
+                }
 
                 ImGui::EndMenu();
             }
@@ -219,6 +226,10 @@ namespace sight {
             if (ImGui::MenuItem("codeSetBuild")) {
                 addJsCommand(JsCommandType::ProjectCodeSetBuild);
             }
+            if (ImGui::MenuItem("Build stale outputs", nullptr, false, !currentProject()->getStaleOutputs().empty())) {
+                saveAnyThing();
+                currentProject()->buildStaleOutputs();
+            }
             if (ImGui::MenuItem(MENU_LANGUAGE_KEYS.rebuild)) {
                 // currentProject()->rebuild();
                 addJsCommand(JsCommandType::ProjectRebuild);
@@ -476,7 +487,7 @@ for(const item of a) {
                     ImGui::InputText("## node.name", nameBuf, std::size(nameBuf));
                     if (ImGui::IsItemDeactivatedAfterEdit()) {
                         node->nodeName = nameBuf;
-                        node->graph->markDirty();
+                        node->graph->markDirty(node->nodeId);
                     }
 
                     // fields
@@ -497,13 +508,13 @@ for(const item of a) {
 
                     leftText("priority: ");
                     if (ImGui::InputInt("## connection.priority", &connection->priority)) {
-                        graph->markDirty();
+                        graph->markDirty(connection->connectionId);
                         connection->findLeftPort()->sortConnections();
                         connection->findRightPort()->sortConnections();
                     }
                     leftText("generateCode: ");
                     if (ImGui::Checkbox("##generateCode", &connection->generateCode)) {
-                        graph->markDirty();
+                        graph->markDirty(connection->connectionId);
                     }
 
                     showNodeComponents(connection->componentContainer, nullptr, connection->graph, connection->connectionId, true);
@@ -960,6 +971,17 @@ for(const item of a) {
                         uiDeleteEntity(name);
                         g_UIStatus->createEntityData.showInfoEntityName.clear();
                     }
+                    ImGui::SameLine();
+                    auto& usages = g_UIStatus->createEntityData.showInfoUsages;
+                    if (ImGui::Button(ICON_MD_SEARCH "##usages-") && entityData) {
+                        usages = currentProject()->findTemplateUsages(entityData->templateAddress);
+                        if (usages.empty()) {
+                            toast("Find usages", "Not used by any saved graph.");
+                        }
+                    }
+                    for (auto const& item : usages) {
+                        ImGui::BulletText("%s (%u)", item.graphPath.c_str(), item.count);
+                    }
                 }
             }
             ImGui::End();
@@ -1009,8 +1031,10 @@ for(const item of a) {
                     std::string editButtonLabel{ ICON_MD_EDIT "##edit-" };
                     editButtonLabel += name;
                     if (ImGui::Button(editButtonLabel.c_str())) {
-                        // edit
-                        uiEditEntity(info);
+                        // edit, fields of the entity may be not read yet.
+                        if (auto entity = p->getSightEntity(name)) {
+                            uiEditEntity(*entity);
+                        }
                     }
 
                     width = width - buttonSize - buttonInterval;
@@ -1091,6 +1115,12 @@ for(const item of a) {
                     ImGui::Text("Path: %s", p->getBaseDir().c_str());
                     ImGui::Text("Loaded Plugins: %u", pluginManager()->getLoadedPluginCount());
 
+                    auto const& batchStats = getJsNodeBatchStats();
+                    ImGui::Text("Script Node Batches: %u", batchStats.batchCount);
+                    ImGui::Text("   Nodes: %zu, Template Nodes: %zu, Max Batch: %zu", batchStats.nodeCount, batchStats.templateNodeCount, batchStats.maxBatchSize);
+                    ImGui::Text("   Latency(ms) last: %.2f, max: %.2f, avg: %.2f", batchStats.lastLatencyMs, batchStats.maxLatencyMs,
+                                batchStats.batchCount > 0 ? batchStats.totalLatencyMs / batchStats.batchCount : 0.0f);
+
                     auto memUsage = currentProcessUsageInfo();
                     ImGui::Text("Memory Usage.");
                     ImGui::Text("   Virtual Memory(mb): %.2f", memUsage.virtualMemBytes / 1024.0 / 1024);
@@ -1098,8 +1128,8 @@ for(const item of a) {
 
                 } else if (panelTypes) {
                     // show types.
-                    auto typeInfoMap = currentProject()->getTypeInfoMap();
-                    for (const auto& [key, value] : typeInfoMap) {
+                    currentProject()->getTypeRegistry().forEach([](TypeInfo const& value) {
+                        auto key = value.intValue;
                         ImGui::Text("%4d: %8s", key, value.name.c_str());
                         // show style
                         if (value.style) {
@@ -1131,7 +1161,7 @@ for(const item of a) {
                                 style->color = ImColor(color);
                             }
                         }
-                    }
+                    });
                 } else if (panelPlugins) {
                     // show loaded plugins.
                     auto map = pluginManager()->getSnapshotMap();
@@ -1234,6 +1264,8 @@ for(const item of a) {
             undo();
         } else if (keybindings->redo) {
             redo();
+        } else if (keybindings->search) {
+            openSearchPalette();
         } else if (keybindings->copy) {
             auto& selectedNodeOrLinks = g_UIStatus->selection.selectedNodeOrLinks;
             if (selectedNodeOrLinks.size() == 1) {
@@ -1337,6 +1369,10 @@ for(const item of a) {
         if (windowStatus.codeSetSettingsWindow) {
             showCodeSetSettingsWindow();
         }
+        if (windowStatus.staleOutputsWindow) {
+            showStaleOutputsWindow();
+        }
+        showSearchPalette();
 
         nodeEditorFrameEnd();
 
@@ -1361,29 +1397,35 @@ for(const item of a) {
             g_UIStatus->loadingStatus.jsThread = true;
             break;
         }
-        case UICommandType::AddNode:
+        case UICommandType::AddNodeBatch:
         {
-            // command->args.needFree = false;
-            auto* nodePointer = (SightNode**)command->args.data;
-            auto size = command->args.dataLength;
-            for (int i = 0; i < size; ++i) {
-                uiAddNode(nodePointer[i]);
-                delete nodePointer[i];
-            }
-            // pluginManager()->getPluginStatus().addNodesFinished = true;
-            break;
-        }
-        case UICommandType::AddTemplateNode:
-        {
-            auto* pointer = (SightNodeTemplateAddress**)command->args.data;
-            auto size = command->args.dataLength;
-            for (int i = 0; i < size; ++i) {
-                auto p = pointer[i];
-                addTemplateNode(*p);
-                p->dispose();     // free SightJsNode first.
-                delete p;
+            std::unique_ptr<JsNodeBatch> batch(static_cast<JsNodeBatch*>(command->args.data));
+            command->args.data = nullptr;
+
+            for (auto& item : batch->templateNodes) {
+                addTemplateNode(item);
+                item.dispose();     // free SightJsNode.
+            }
+
+            auto graph = currentGraph();
+            if (!graph) {
+                if (!batch->nodes.empty()) {
+                    logDebug("no graph, drop $0 nodes", batch->nodes.size());
+                }
+            } else {
+                for (auto& node : batch->nodes) {
+                    auto p = graph->getNodes().add();
+                    *p = std::move(node);
+                    p->graph = graph;
+                    for (auto list : { &p->inputPorts, &p->outputPorts, &p->fields }) {
+                        for (auto& port : *list) {
+                            port.node = p;
+                        }
+                    }
+                    uiAddNode(p);
+                }
             }
-            // pluginManager()->getPluginStatus().addTemplateNodesFinished = true;
+            recordJsNodeBatch(*batch);
             break;
         }
         case UICommandType::RegScriptGlobalFunctions:
@@ -1412,6 +1454,27 @@ for(const item of a) {
             // std::string msg= "";
             g_UIStatus->toastController.toast("Plugin Reload", command->args.argString);
             break;
+        case UICommandType::CodeTemplateChanged:
+            if (auto project = currentProject()) {
+                project->markCodeTemplateStale(command->args.argString);
+            }
+            break;
+        case UICommandType::GraphsBuilt:
+            if (auto project = currentProject()) {
+                project->onGraphsBuilt(command->args.argString);
+            }
+            break;
+        case UICommandType::ProjectFilesChanged:
+            if (auto project = currentProject()) {
+                project->onFilesChanged(command->args.argString);
+            }
+            break;
+        case UICommandType::RegisterEntityTemplates:
+            if (auto project = currentProject()) {
+                project->updateEntitiesToTemplateNode();
+            }
+            command->args.promise->set_value(CODE_OK);
+            break;
         }
 
         command->args.dispose();
@@ -1446,6 +1509,7 @@ for(const item of a) {
 
         ImGuiIO& io = ImGui::GetIO();
         // init ...
+        g_UIThreadId = std::this_thread::get_id();
         g_UIStatus = new UIStatus({
             true,
             &io,
@@ -1459,6 +1523,7 @@ for(const item of a) {
         initNodeEditor();
 
         initHierarchy();
+        initSearchPalette();
 
         // init keys
         initKeys();
@@ -1570,6 +1635,26 @@ for(const item of a) {
                 } else {
                     ImGui::Text("Loading plugins...");
                 }
+
+                // time of phases
+                auto const& timings = project->getLoadTimings();
+                if (ImGui::BeginTable("load timings", 2, ImGuiTableFlags_SizingFixedFit)) {
+                    for (int i = 0; i < static_cast<int>(ProjectLoadPhase::Count); i++) {
+                        auto phase = static_cast<ProjectLoadPhase>(i);
+                        bool finished = false;
+                        float ms = timings.elapsedMs(phase, &finished);
+                        ImGui::TableNextRow();
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%s", ProjectLoadTimings::name(phase));
+                        ImGui::TableNextColumn();
+                        if (ms < 0) {
+                            ImGui::TextDisabled("waiting");
+                        } else {
+                            ImGui::Text(finished ? "%.1f ms" : "%.1f ms ...", ms);
+                        }
+                    }
+                    ImGui::EndTable();
+                }
             } else {
                 ImGui::Text("If project doesn't exist, then will create it.");
                 if (ImGui::Button(MENU_LANGUAGE_KEYS.openProject)) {
@@ -1695,6 +1780,7 @@ for(const item of a) {
         cleanUpWindow(sightWindow);
 
         disposeHierarchy();
+        disposeSearchPalette();
 
         return 0;
     }
@@ -1788,6 +1874,10 @@ for(const item of a) {
         return g_UIStatus;
     }
 
+    bool isUIThread() {
+        return g_UIThreadId.load() == std::this_thread::get_id();
+    }
+
     void showNodePorts(SightNode* node, bool showField, bool showValue, bool showOutput, bool showInput) {
         if (!showField && !showValue && !showOutput && !showInput) {
             return;
@@ -1795,10 +1885,10 @@ for(const item of a) {
 
         auto nodeWork = [](std::vector<SightNodePort>& list, bool showValue, bool alwaysShow) {
             for (auto& item : list) {
-                if (alwaysShow || (showValue && item.options.showValue) || item.options.typeList) {
+                if (alwaysShow || (showValue && item.options->showValue) || item.options->typeList) {
                     ImGui::Text("%7s: ", item.portName.c_str());
                     ImGui::SameLine();
-                    if (item.options.typeList) {
+                    if (item.options->typeList) {
                         //
                         // ImGui::InputText("##name", char *buf, size_t buf_size)
                         // ImGui::SameLine();
@@ -1916,6 +2006,7 @@ for(const item of a) {
 
     void openEntityInfoWindow(std::string_view entityName) {
         g_UIStatus->createEntityData.showInfoEntityName = entityName;
+        g_UIStatus->createEntityData.showInfoUsages.clear();
 
         showOrFocusWindow(g_UIStatus->windowStatus.entityInfoWindow, WINDOW_LANGUAGE_KEYS.entityInfo);
     }
@@ -2105,23 +2196,14 @@ for(const item of a) {
             auto graph = currentGraph();
             for (const auto& item : nodes) {     // find .......
                 for (const auto& port : item->outputPorts) {
-                    if (!port.isConnect()) {
-                        continue;
-                    }
-
-                    for (const auto& connection : port.connections) {
-                        SightNodePortConnection c(graph, connection, item);
-                        if (!c.target) {
-                            continue;
-                        }
-
+                    for (const auto& edge : graph->successors(port.getId())) {
                         for (const auto& nodePointer : nodes) {
                             if (item == nodePointer) {
                                 continue;
                             }
 
-                            if (c.target->node == nodePointer) {
-                                connections.push_back(*connection);
+                            if (edge.target->node == nodePointer) {
+                                connections.push_back(*edge.connection);
                                 break;
                             }
                         }
@@ -27,6 +27,8 @@
 #include "sight_colors.h"
 #include "sight_node.h"
 #include "sight_node_graph.h"
+#include "sight_runtime_graph.h"
+#include "sight_graph_saver.h"
 #include "sight_project.h"
 #include "sight_undo.h"
 #include "sight_widgets.h"
@@ -50,6 +52,7 @@
 #define PIN_CONTEXT_MENU "PinContextMenu"
 #define NODE_CONTEXT_MENU "NodeContextMenu"
 #define COMPONENT_CONTEXT_MENU "ComponentContextMenu"
+#define RECLAIM_BUDGET_PER_FRAME 64
 
 namespace ed = ax::NodeEditor;
 
@@ -203,7 +206,7 @@ namespace sight {
         // this function need node editor be suspend
         void showContextMenu(uint nodeId, uint linkId, uint pinId, SightNodeGraph* graph, ImVec2 const& mousePos) {
             auto showPortDebugInfo = [](SightNodePort const& item) {
-                auto portInfoMsg = absl::Substitute("$0, $1", item.getId(), item.portName);
+                auto portInfoMsg = absl::Substitute("$0, $1", item.getId(), item.portName.str());
                 logDebug(portInfoMsg);
             };
 
@@ -275,9 +278,9 @@ namespace sight {
                     }
                 }
                 if (ImGui::MenuItem("ShowFlow")) {
-                    for (const auto& item : port->connections) {
-                        ed::Flow(item->connectionId);
-                        logDebug(item->connectionId);
+                    for (const auto& edge : graph->getAdjacency().edgesOf(*port)) {
+                        ed::Flow(edge.connection->connectionId);
+                        logDebug(edge.connection->connectionId);
                     }
                 } else if (ImGui::MenuItem("MarkPort")) {
                     tryMarkPort(*port);
@@ -328,6 +331,7 @@ namespace sight {
                     g_ContextStatus->nextNodePosition = ImGui::GetMousePos();
                 }
                 g_ContextStatus->componentForWhich = 0;
+                currentProject()->updateEntitiesToTemplateNode();
                 for (auto& item : currentNodeStatus()->templateAddressList) {
                     item.showContextMenu(g_ContextStatus->createComponents);
                 }
@@ -591,11 +595,11 @@ namespace sight {
 
             // fields
             for (auto& item : node->fields) {
-                if (!item.options.show) {
+                if (!item.options->show) {
                     continue;
                 }
 
-                auto& options = item.options;
+                auto const& options = *item.options;
                 bool showErrorMsg = false;
                 if (options.errorMsg.empty()) {
                     ImGui::Text("%*s", nodeStyle.fieldStype.maxCharSize, item.portName.c_str());
@@ -621,7 +625,7 @@ namespace sight {
                 ImGui::BeginGroup();
                 isInputGroupShow = true;
                 for (auto& item : node->inputPorts) {
-                    if (item.portName.empty() || !item.options.show) {
+                    if (item.portName.empty() || !item.options->show) {
                         continue;     // do not show the chain port. (Process port)
                     }
 
@@ -644,7 +648,7 @@ namespace sight {
                     ImGui::Text("%s", item.portName.c_str());
                     ImGui::PopStyleVar();
 
-                    if (item.type != IntTypeProcess && item.options.showValue) {
+                    if (item.type != IntTypeProcess && item.options->showValue) {
                         ImGui::SameLine();
                         showNodePortValue(&item, true, nodeStyle.inputStype.inputWidth);
                     }
@@ -658,7 +662,7 @@ namespace sight {
             // outputs
             ImGui::BeginGroup();
             for (SightNodePort& item : node->outputPorts) {
-                if (item.portName.empty() || !item.options.show) {
+                if (item.portName.empty() || !item.options->show) {
                     continue;     // do not show the title bar port.
                 }
 
@@ -682,7 +686,7 @@ namespace sight {
                     }
                 }
 
-                if (item.options.dynamic) {
+                if (item.options->dynamic) {
                     // dynamic port
                     showDynamicRootPort(item, nodeStyle.outputStype.maxCharSize);
                 } else {
@@ -969,6 +973,15 @@ namespace sight {
             }
             ImGui::SameLine();
             ImGui::Checkbox("Auto Save", &(sightSettings->autoSave));
+            if (isGraphSaving(graph->getFilePath())) {
+                ImGui::SameLine();
+                ImGui::TextDisabled("Saving...");
+            }
+            if (takeGraphSaveFailure(graph->getFilePath())) {
+                // try again at next save.
+                logError("save graph failed: $0", getGraphSaveStatus().lastError);
+                graph->markDirty();
+            }
             if (graph->isBroken()) {
                 ImGui::SameLine();
                 ImGui::TextColored(uiStatus.uiColors->errorText, "Graph Broken: %s", graph->getBrokenReason().c_str());
@@ -1215,6 +1228,11 @@ namespace sight {
                 g_ContextStatus->needSaveGraph = true;
             }
 
+            // idle frame, free a few deleted nodes/connections.
+            if (!ImGui::IsAnyItemActive() && !ImGui::IsMouseDown(ImGuiMouseButton_Left)) {
+                reclaimDeletedObjects(graph, RECLAIM_BUDGET_PER_FRAME);
+            }
+
             return CODE_OK;
         }
     }
@@ -1299,7 +1317,7 @@ namespace sight {
         }
         auto target = convert(pos);
         node->position = target;
-        node->graph->markDirty();
+        node->graph->markDirty(node->nodeId);
 
         // logDebug("set node pos, name: $0, pos: $1, $2", node->nodeName, target.x, target.y);
     }
@@ -1361,7 +1379,7 @@ namespace sight {
         assert(width > 0);
 
         // do not handle type-list-port
-        assert(!port->options.typeList);
+        assert(!port->options->typeList);
         if (port->type > 0 && port->getType() != port->type) {
             // fake type, do not show it's value.
             return;
@@ -1386,7 +1404,7 @@ namespace sight {
         };
 
         const float dragFloatSpeed = 0.25f;
-        auto& options = port->options;
+        auto const& options = *port->options;
         switch (type) {
         case IntTypeFloat:
         {
@@ -1427,14 +1445,14 @@ namespace sight {
 
             } else {
                 // only show in inspector
-                if (!options.alternatives.empty()) {
+                if (options.alternatives && !options.alternatives->empty()) {
                     std::string comboLabel = labelBuf;
                     comboLabel += ".combo";
                     if (ImGui::BeginCombo(comboLabel.c_str(), port->value.u.string, ImGuiComboFlags_NoArrowButton)) {
                         std::string filterLabel = comboLabel + ".filter";
                         static char filterText[NAME_BUF_SIZE] = { 0 };
                         ImGui::InputText(filterLabel.c_str(), filterText, std::size(filterText));
-                        for (const auto& item : options.alternatives) {
+                        for (const auto& item : *options.alternatives) {
                             if (strlen(filterText) > 0 && !startsWith(item, filterText)) {
                                 continue;
                             }
@@ -1678,6 +1696,8 @@ namespace sight {
     int uiAddMultipleNodes(std::vector<SightNode*>& nodes, std::vector<SightNodeConnection> const& connections, ImVec2 startPos, bool selectNode) {
         getRuntimeId(StartOrStop::Start);
         auto graph = currentGraph();
+        // nodes and connections are added together, or not at all.
+        graph->beginBatch();
         if (!nodes.empty()) {
             // position
             // find left-most node.
@@ -1695,10 +1715,6 @@ namespace sight {
                 }
             }
 
-            if (selectNode) {
-                ed::ClearSelection();
-            }
-
             // add
             auto leftNodePos = leftNode->position;
             setNodePos(leftNode, startPos);
@@ -1708,23 +1724,52 @@ namespace sight {
                     auto pos = startPos + convert(item->position - leftNodePos);
                     setNodePos(item, pos);
                 }
-                auto nodeId = item->getNodeId();
-                ed::SetNodePosition(nodeId, getNodePos(item));
-                uiAddNode(item);
-                if (selectNode) {
-                    ed::SelectNode(nodeId, true);
-                }
+                ed::SetNodePosition(item->getNodeId(), getNodePos(item));
+                // undo is recorded after the batch is committed.
+                graph->registerNode(item);
             }
         }
-        if (!connections.empty()) {
-            for (const auto& item : connections) {
-                uiAddConnection(item.left, item.right, item.connectionId, item.priority);
-                auto connection = graph->findConnection(item.connectionId);
-                if (connection) {
-                    // componentContainer is required from graph, so just copy.
-                    // however, this is not a good design, should be refactored.
-                    connection->componentContainer = item.componentContainer;
-                }
+
+        std::vector<uint> created;
+        created.reserve(connections.size());
+        for (const auto& item : connections) {
+            auto connectionId = graph->createConnection(item.left, item.right, item.connectionId, item.priority);
+            if (connectionId <= 0) {
+                logError("add nodes failed, can not connect $0 to $1", item.left, item.right);
+                graph->rollback();
+                getRuntimeId(StartOrStop::Stop);
+                return CODE_FAIL;
+            }
+            auto connection = graph->findConnection(connectionId);
+            if (connection) {
+                // componentContainer is required from graph, so just copy.
+                // however, this is not a good design, should be refactored.
+                connection->componentContainer = item.componentContainer;
+            }
+            created.push_back(connectionId);
+        }
+
+        // onInstantiate of the nodes is called here, before onConnect of their connections.
+        if (graph->commit(true) != CODE_OK) {
+            logError("add nodes failed, onInstantiate throws.");
+            getRuntimeId(StartOrStop::Stop);
+            return CODE_FAIL;
+        }
+
+        if (selectNode && !nodes.empty()) {
+            ed::ClearSelection();
+        }
+        for (const auto& item : nodes) {
+            recordUndo(UndoRecordType::Create, item->getNodeId(), convert(item->position));
+            if (selectNode) {
+                ed::SelectNode(item->getNodeId(), true);
+            }
+        }
+        // the same events as `uiAddConnection`.
+        for (const auto& id : created) {
+            if (auto connection = graph->findConnection(id)) {
+                onConnect(connection);
+                recordUndo(UndoRecordType::Create, id);
             }
         }
         getRuntimeId(StartOrStop::Stop);
@@ -1745,7 +1790,6 @@ namespace sight {
     int uiAddConnection(uint left, uint right, uint id, int priority) {
         auto graph = currentGraph();
         auto connectionId = graph->createConnection(left, right, id, priority);
-        graph->markDirty();
         if (connectionId > 0) {
             auto connection = graph->findConnection(id);
             onConnect(connection);
@@ -1892,7 +1936,7 @@ namespace sight {
         ImGui::Text(fmt, "Name");
         ImGui::SameLine();
         if (ImGui::InputText("##graphName", settings.graphName, std::size(settings.graphName))) {
-            graph->markDirty();
+            graph->markSettingsDirty();
         }
 
         ImGui::Text("Language Info");
@@ -1903,7 +1947,7 @@ namespace sight {
                 if (ImGui::Selectable(DefLanguageTypeNames[i], i == settings.language.type)) {
                     //
                     settings.language.type = i;
-                    graph->markDirty();
+                    graph->markSettingsDirty();
                 }
             }
             ImGui::EndCombo();
@@ -1911,7 +1955,7 @@ namespace sight {
         ImGui::Text(fmt, "Version");
         ImGui::SameLine();
         if (ImGui::InputInt("##version", &settings.language.version)) {
-            graph->markDirty();
+            graph->markSettingsDirty();
         }
 
         ImGui::Text(fmt, "OutputFile");
@@ -1925,7 +1969,7 @@ namespace sight {
             if (status == CODE_OK) {
                 settings.outputFilePath = path;
                 logDebug(path);
-                graph->markDirty();
+                graph->markSettingsDirty();
             } else {
                 if (status == CODE_USER_CANCELED) {
                     logDebug("User cancelled.");
@@ -1947,7 +1991,7 @@ namespace sight {
             for (const auto& item : names) {
                 if (ImGui::Selectable(item.c_str(), item == settings.codeTemplate)) {
                     settings.codeTemplate = item;
-                    graph->markDirty();
+                    graph->markSettingsDirty();
                 }
             }
             ImGui::EndCombo();
@@ -1962,7 +2006,7 @@ namespace sight {
             for (const auto& item : names) {
                 if (ImGui::Selectable(item.c_str(), item == settings.connectionCodeTemplate)) {
                     settings.connectionCodeTemplate = item;
-                    graph->markDirty();
+                    graph->markSettingsDirty();
                 }
             }
             ImGui::EndCombo();
@@ -1972,7 +2016,7 @@ namespace sight {
         ImGui::Text(fmt, "EnterNode");
         ImGui::SameLine();
         if (ImGui::InputInt("##enter-node", &settings.enterNode)) {
-            graph->markDirty();
+            graph->markSettingsDirty();
         }
         if (settings.enterNode > 0) {
             // show name
@@ -1992,6 +2036,7 @@ namespace sight {
         auto g = currentGraph();
         SightAnyThingType type = g->findSightAnyThing(tmpId).type;
         if (ImGui::BeginPopup(COMPONENT_CONTEXT_MENU)) {
+            currentProject()->updateEntitiesToTemplateNode();
             for (auto& item : currentNodeStatus()->templateAddressList) {
                 if (item.isAnyItemCanShow(true, type)) {
                     item.showContextMenu(true);
@@ -2082,7 +2127,7 @@ namespace sight {
         if (delIndex >= 0) {
             // container->components.erase(container->components.begin() + delIndex);
             container->removeComponent(delIndex);
-            graph->markDirty();
+            graph->markDirty(id);
         }
 
         if (fromInspector) {
@@ -2168,6 +2213,7 @@ namespace sight {
             currentProject()->saveConfigFile();
         }
 
+        reclaimDeletedObjects(g);
         g->save(g_ContextStatus->lastSaveGraphReason);
         g_ContextStatus->lastSaveGraphReason = SaveReason::Automatic;     // change to auto
     }
@@ -2224,6 +2270,8 @@ namespace sight {
             if (g_ContextStatus->outputJsonFilePathError) {
                 ImGui::PopStyleColor();
             }
+            ImGui::SameLine();
+            helpMarker("Use the " SIGHT_RUNTIME_GRAPH_EXT " extension to output the binary runtime graph, see sight_runtime_graph.h");
 
             // nodeRootName
             char nodeRootName[32];
@@ -8,6 +8,7 @@
 
 #include "IconsMaterialDesign.h"
 #include "sight_ui.h"
+#include "sight_ui_node_editor.h"
 
 #include "imgui.h"
 #include "sight_widgets.h"
@@ -171,6 +172,46 @@ namespace sight {
         ImGui::End();
     }
 
+    void showStaleOutputsWindow() {
+        auto uiStatus = currentUIStatus();
+        auto project = currentProject();
+        if (ImGui::Begin("StaleOutputs", &(uiStatus->windowStatus.staleOutputsWindow))) {
+            auto const& outputs = project->getStaleOutputs().getOutputs();
+
+            ImGui::BeginDisabled(outputs.empty());
+            if (ImGui::Button(ICON_MD_BUILD " Build")) {
+                trySaveCurrentGraph();
+                project->buildStaleOutputs();
+            }
+            ImGui::EndDisabled();
+            ImGui::SameLine();
+            ImGui::Text("%zu stale", outputs.size());
+            helpMarker("Only these graphs are generated, graphs which are still up to date are skipped.");
+
+            if (ImGui::BeginTable("stale outputs", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_Resizable)) {
+                ImGui::TableSetupColumn("Graph");
+                ImGui::TableSetupColumn("Output");
+                ImGui::TableSetupColumn("Reason");
+                ImGui::TableHeadersRow();
+                for (const auto& [key, item] : outputs) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", item.graphPath.c_str());
+                    ImGui::TableNextColumn();
+                    if (item.outputPath.empty()) {
+                        ImGui::TextDisabled("none");
+                    } else {
+                        ImGui::Text("%s", item.outputPath.c_str());
+                    }
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", item.reason.c_str());
+                }
+                ImGui::EndTable();
+            }
+        }
+        ImGui::End();
+    }
+
     /**
      * Most copy from sight_ui.cpp showEntityOperations()
      */
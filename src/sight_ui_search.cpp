@@ -0,0 +1,336 @@
+#include "sight_ui_search.h"
+#include "sight.h"
+#include "sight_event_bus.h"
+#include "sight_log.h"
+#include "sight_node.h"
+#include "sight_node_graph.h"
+#include "sight_project.h"
+#include "sight_search_index.h"
+#include "sight_ui.h"
+#include "sight_ui_node_editor.h"
+
+#include <imgui.h>
+#include <imgui_node_editor.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+
+#include <IconsMaterialDesign.h>
+
+namespace ed = ax::NodeEditor;
+
+namespace sight {
+
+    namespace {
+
+        // prefixes of search sources
+        constexpr const char* templateSource = "template:";
+        constexpr const char* entitySource = "entity:";
+        constexpr const char* graphFilesSource = "graph-files";
+        constexpr const char* nodeSource = "node:";
+
+        struct SearchPaletteStatus {
+            bool open = false;
+            bool focusInput = false;
+            char query[NAME_BUF_SIZE]{ 0 };
+            // the last query which is sent to the search thread.
+            std::string postedQuery;
+            std::vector<SearchResult> results;
+            int selected = 0;
+            std::vector<EventDisposer> eventHandlerList;
+        };
+
+        SearchPaletteStatus* g_SearchPalette = nullptr;
+
+        std::string nodeSourceOf(uint nodeId) {
+            return absl::StrCat(nodeSource, nodeId);
+        }
+
+        void indexNode(SightNode const* node) {
+            std::vector<SearchItem> items;
+            auto nodeId = node->getNodeId();
+            auto templateAddress = node->templateNode ? node->templateNode->fullTemplateAddress : std::string();
+            items.push_back({ SearchItemKind::Node, node->nodeName, templateAddress, {}, nodeId });
+
+            auto addValues = [&items, node, nodeId](std::vector<SightNodePort> const& ports) {
+                for (const auto& port : ports) {
+                    auto type = port.getType();
+                    const char* value = nullptr;
+                    if (type == IntTypeString) {
+                        value = port.value.getString();
+                    } else if (type == IntTypeLargeString) {
+                        value = port.value.getLargeString();
+                    }
+                    if (value && value[0] != '\0') {
+                        items.push_back({ SearchItemKind::PortValue, value, absl::StrCat(node->nodeName, ".", port.getPortName()), {}, nodeId });
+                    }
+                }
+            };
+            addValues(node->inputPorts);
+            addValues(node->outputPorts);
+            addValues(node->fields);
+
+            setSearchItems(nodeSourceOf(nodeId), std::move(items));
+        }
+
+        void indexGraphFiles(ProjectFile const& file, std::vector<SearchItem>& items) {
+            if (file.fileType == ProjectFileType::Graph) {
+                items.push_back({ SearchItemKind::Graph, file.filename, file.path, file.path });
+            }
+            for (const auto& child : file.files) {
+                indexGraphFiles(child, items);
+            }
+        }
+
+        void closePalette() {
+            auto& status = *g_SearchPalette;
+            status.open = false;
+            status.query[0] = '\0';
+            status.postedQuery.clear();
+            status.results.clear();
+            status.selected = 0;
+        }
+
+        void createNodeFromTemplate(std::string const& templateAddress) {
+            auto graph = currentGraph();
+            auto templateNode = findTemplateNode(templateAddress.c_str());
+            if (!graph || !templateNode) {
+                logDebug("can not create node: $0", templateAddress);
+                return;
+            }
+
+            auto node = templateNode->instantiate(graph);
+            auto nodeId = node->getNodeId();
+            auto position = ed::ScreenToCanvas(ImGui::GetMainViewport()->GetCenter());
+            node->position = convert(position);
+            ed::SetNodePosition(nodeId, position);
+            uiAddNode(node);
+        }
+
+        void selectNode(uint nodeId) {
+            auto graph = currentGraph();
+            if (!graph || !graph->findNode(nodeId)) {
+                return;
+            }
+
+            auto& selection = currentUIStatus()->selection;
+            selection.selectedNodeOrLinks.clear();
+            selection.selectedNodeOrLinks.insert(nodeId);
+            ed::ClearSelection();
+            ed::SelectNode(nodeId);
+            ed::NavigateToSelection();
+        }
+
+        void activateResult(SearchItem const& item) {
+            switch (item.kind) {
+            case SearchItemKind::Template:
+                createNodeFromTemplate(item.target);
+                break;
+            case SearchItemKind::Entity:
+            case SearchItemKind::EntityField:
+                openEntityInfoWindow(item.target);
+                break;
+            case SearchItemKind::Graph:
+            {
+                auto g = currentGraph();
+                if (!g || item.target != g->getFilePath()) {
+                    uiChangeGraph(item.target);
+                }
+                break;
+            }
+            case SearchItemKind::Node:
+            case SearchItemKind::PortValue:
+                selectNode(item.id);
+                break;
+            }
+        }
+
+    }
+
+    void indexTemplateForSearch(std::string_view templateAddress) {
+        std::vector<SearchItem> items;
+        items.push_back({ SearchItemKind::Template, std::string(templateAddress), {}, std::string(templateAddress) });
+        setSearchItems(absl::StrCat(templateSource, templateAddress), std::move(items));
+    }
+
+    void removeTemplateFromSearch(std::string_view templateAddress) {
+        removeSearchItems(absl::StrCat(templateSource, templateAddress));
+    }
+
+    void indexEntityForSearch(SightEntity const& entity, std::vector<EntityIndexField> const* indexFields) {
+        std::vector<SearchItem> items;
+        items.push_back({ SearchItemKind::Entity, entity.name, entity.templateAddress, entity.name });
+        auto addField = [&items, &entity](std::string const& name, std::string const& type) {
+            items.push_back({ SearchItemKind::EntityField, name, absl::StrCat(entity.getSimpleName(), ": ", type), entity.name });
+        };
+        if (indexFields) {
+            for (const auto& field : *indexFields) {
+                addField(field.name, field.type);
+            }
+        } else {
+            for (const auto& field : entity.fields) {
+                addField(field.name, field.type);
+            }
+        }
+        setSearchItems(absl::StrCat(entitySource, entity.name), std::move(items));
+    }
+
+    void removeEntityFromSearch(std::string_view name) {
+        removeSearchItems(absl::StrCat(entitySource, name));
+    }
+
+    void removeAllEntitiesFromSearch() {
+        removeSearchItemsByPrefix(entitySource);
+    }
+
+    void indexGraphFilesForSearch(ProjectFile const& root) {
+        std::vector<SearchItem> items;
+        indexGraphFiles(root, items);
+        setSearchItems(graphFilesSource, std::move(items));
+    }
+
+    void indexGraphNodesForSearch(SightNodeGraph* graph) {
+        removeSearchItemsByPrefix(nodeSource);
+        if (!graph) {
+            return;
+        }
+        graph->loopOf([](SightNode* node) {
+            indexNode(node);
+        });
+    }
+
+    void initSearchPalette() {
+        g_SearchPalette = new SearchPaletteStatus();
+        auto& handlers = g_SearchPalette->eventHandlerList;
+
+        handlers.push_back(SimpleEventBus::nodeAdded()->addListener([](SightNode* node) {
+            indexNode(node);
+        }));
+        handlers.push_back(SimpleEventBus::nodeRemoved()->addListener([](SightNode const& node) {
+            removeSearchItems(nodeSourceOf(node.getNodeId()));
+        }));
+        handlers.push_back(SimpleEventBus::graphDisposed()->addListener([](SightNodeGraph const&) {
+            removeSearchItemsByPrefix(nodeSource);
+        }));
+        handlers.push_back(SimpleEventBus::graphOpened()->addListener([](SightNodeGraph* graph) {
+            indexGraphNodesForSearch(graph);
+        }));
+    }
+
+    void disposeSearchPalette() {
+        if (!g_SearchPalette) {
+            return;
+        }
+
+        for (auto& item : g_SearchPalette->eventHandlerList) {
+            item();
+        }
+        delete g_SearchPalette;
+        g_SearchPalette = nullptr;
+        stopSearchThread();
+    }
+
+    void openSearchPalette() {
+        if (!g_SearchPalette) {
+            return;
+        }
+
+        // values of ports are changed without events.
+        indexGraphNodesForSearch(currentGraph());
+        if (auto project = currentProject()) {
+            indexGraphFilesForSearch(project->getFileCache());
+        }
+        g_SearchPalette->open = true;
+        g_SearchPalette->focusInput = true;
+    }
+
+    void showSearchPalette() {
+        if (!g_SearchPalette || !g_SearchPalette->open) {
+            return;
+        }
+        auto& status = *g_SearchPalette;
+
+        auto viewport = ImGui::GetMainViewport();
+        ImGui::SetNextWindowPos(ImVec2(viewport->GetCenter().x, viewport->WorkPos.y + 60), ImGuiCond_Appearing, ImVec2(0.5f, 0));
+        ImGui::SetNextWindowSize(ImVec2(600, 400), ImGuiCond_Appearing);
+        if (ImGui::Begin("Search", &status.open, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoSavedSettings)) {
+            if (status.focusInput) {
+                ImGui::SetKeyboardFocusHere();
+                status.focusInput = false;
+            }
+            ImGui::SetNextItemWidth(-1);
+            ImGui::InputTextWithHint("##query", ICON_MD_SEARCH " templates, entities, graphs, nodes", status.query, std::size(status.query));
+
+            if (status.postedQuery != status.query) {
+                status.postedQuery = status.query;
+                postSearchQuery(status.postedQuery);
+            }
+            if (takeSearchResults(status.results)) {
+                status.selected = 0;
+            }
+
+            int count = static_cast<int>(status.results.size());
+            bool moved = false;
+            if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow)) && status.selected + 1 < count) {
+                status.selected++;
+                moved = true;
+            } else if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)) && status.selected > 0) {
+                status.selected--;
+                moved = true;
+            }
+
+            int activated = -1;
+            if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Enter)) && status.selected < count) {
+                activated = status.selected;
+            }
+
+            ImGui::Separator();
+            ImGui::TextDisabled("%d results, %zu items", count, getSearchItemCount());
+            if (ImGui::BeginChild("##results")) {
+                auto itemHeight = ImGui::GetTextLineHeightWithSpacing();
+                if (moved) {
+                    // keep the selected one visible.
+                    auto y = status.selected * itemHeight;
+                    if (y < ImGui::GetScrollY()) {
+                        ImGui::SetScrollY(y);
+                    } else if (y + itemHeight > ImGui::GetScrollY() + ImGui::GetWindowHeight()) {
+                        ImGui::SetScrollY(y + itemHeight - ImGui::GetWindowHeight());
+                    }
+                }
+
+                // only visible rows are drawn.
+                ImGuiListClipper clipper;
+                clipper.Begin(count, itemHeight);
+                while (clipper.Step()) {
+                    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                        auto const& item = status.results[i].item;
+                        ImGui::PushID(i);
+                        if (ImGui::Selectable(item.text.c_str(), i == status.selected)) {
+                            activated = i;
+                        }
+                        ImGui::SameLine(std::max(ImGui::GetWindowContentRegionMax().x - 260, 200.0f));
+                        ImGui::TextDisabled("%-8s %s", getSearchItemKindName(item.kind), item.detail.c_str());
+                        ImGui::PopID();
+                    }
+                }
+            }
+            ImGui::EndChild();
+
+            if (activated >= 0) {
+                auto item = status.results[activated].item;
+                closePalette();
+                activateResult(item);
+            } else if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Escape))) {
+                closePalette();
+            }
+        }
+        ImGui::End();
+
+        if (!status.open) {
+            closePalette();
+        }
+    }
+
+}
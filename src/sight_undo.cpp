@@ -9,6 +9,8 @@
 #include "sight_node_graph.h"
 #include "sight_ui_node_editor.h"
 
+#include "absl/container/flat_hash_set.h"
+
 #include <atomic>
 #include <cassert>
 #include <string>
@@ -26,6 +28,14 @@ namespace sight {
 
     static std::vector<UndoCommand> undoList;
     static std::vector<UndoCommand> redoList;
+    // increase when undoList/redoList changed.
+    static uint undoListVersion = 1;
+
+    static struct {
+        SightNodeGraph* graph = nullptr;
+        uint structureVersion = 0;
+        uint undoListVersion = 0;
+    } lastReclaim;
 
     UndoCommand::UndoCommand(uint id, UndoRecordType recordType)
         : id(id),
@@ -75,9 +85,11 @@ namespace sight {
                     // g->addConnection(connectionData);
                     connectionData->makeRefs();
                     connectionData->markAsDeleted(false);
+                    g->markDirty(connectionData->connectionId);
                 } else if (nodeData) {
                     nodeData->markAsDeleted(false);
                     ed::SetNodePosition(nodeData->nodeId, position);
+                    g->markDirty(nodeData->nodeId);
                 }
             }
             break;
@@ -111,10 +123,12 @@ namespace sight {
                     // g->addNode(nodeData);
                     nodeData->markAsDeleted(false);
                     ed::SetNodePosition(nodeData->nodeId, position);
+                    g->markDirty(nodeData->nodeId);
                 } else if (connectionData) {
                     // g->addConnection(connectionData);
                     connectionData->makeRefs();
                     connectionData->markAsDeleted(false);
+                    g->markDirty(connectionData->connectionId);
                 }
             }
             break;
@@ -127,9 +141,11 @@ namespace sight {
                     // g->delConnection(connectionData.connectionId);
                     // g->fakeDeleteConnection(connectionData);
                     connectionData->markAsDeleted();
+                    g->markDirty(connectionData->connectionId);
                 } else if (nodeData) {
                     // g->delNode(nodeData->getNodeId());
                     nodeData->markAsDeleted(true);
+                    g->markDirty(nodeData->nodeId);
                 }
             }
             break;
@@ -151,11 +167,33 @@ namespace sight {
         }
     }
 
-    void UndoCommand::freeNodeData() {
+    void UndoCommand::collectRefs(absl::flat_hash_set<uint>& ids, SightNodeGraph* graph) const {
+        // undo/redo of a connection needs its ports, so keep the nodes which own them.
+        auto connectionFunc = [&ids, graph](SightNodeConnection const* connection) {
+            if (!connection) {
+                return;
+            }
+            ids.insert(connection->connectionId);
+            for (auto portId : { connection->left, connection->right }) {
+                if (auto port = graph->findPort(portId)) {
+                    ids.insert(port->getNodeId());
+                }
+            }
+        };
+        auto idFunc = [&ids, graph, &connectionFunc](uint id) {
+            if (id == 0) {
+                return;
+            }
+            ids.insert(id);
+            connectionFunc(graph->findSightAnyThing(id).asConnection());
+        };
+
+        idFunc(anyThingId);
+        idFunc(anyThingId2);
         if (nodeData) {
-            nodeData->graph->delNode(nodeData->nodeId);     // real delete.
-            nodeData = nullptr;
+            ids.insert(nodeData->nodeId);
         }
+        connectionFunc(connectionData);
     }
 
     void UndoCommand::init() {
@@ -186,11 +224,12 @@ namespace sight {
     }
 
     int recordUndo(UndoRecordType recordType, uint anyThingId) {
+        undoListVersion++;
         redoList.clear();
         undoList.emplace_back(getRuntimeId(), recordType, anyThingId);
 
         while (undoList.size() > UNDO_LIST_COUNT) {
-            undoList.begin()->freeNodeData();
+            // objects of dropped records are freed by reclaimDeletedObjects()
             undoList.erase(undoList.begin());
         }
 
@@ -235,6 +274,7 @@ namespace sight {
             return;
         }
 
+        undoListVersion++;
         auto redoId = redoList.back().id;
         while (!redoList.empty()) {
             auto& c = redoList.back();
@@ -257,6 +297,7 @@ namespace sight {
             return;
         }
         
+        undoListVersion++;
         int undoId = undoList.back().id;
         while (!undoList.empty()) {
             auto& c = undoList.back();
@@ -270,6 +311,33 @@ namespace sight {
         }
     }
 
+    int reclaimDeletedObjects(SightNodeGraph* graph, int budget) {
+        if (!graph) {
+            return 0;
+        }
+        if (lastReclaim.graph == graph && lastReclaim.structureVersion == graph->getStructureVersion() &&
+            lastReclaim.undoListVersion == undoListVersion) {
+            // nothing changed since last finished pass.
+            return 0;
+        }
+
+        absl::flat_hash_set<uint> ids;
+        for (auto const& item : undoList) {
+            item.collectRefs(ids, graph);
+        }
+        for (auto const& item : redoList) {
+            item.collectRefs(ids, graph);
+        }
+
+        int count = graph->reclaimDeleted(ids, budget);
+        if (budget <= 0 || count < budget) {
+            lastReclaim.graph = graph;
+            lastReclaim.structureVersion = graph->getStructureVersion();
+            lastReclaim.undoListVersion = undoListVersion;
+        }
+        return count;
+    }
+
     int CopyText::loadAsNode(SightNode*& node, SightNodeGraph* graph) const {
         return loadNodeData(this->data, node, graph, false);
     }
@@ -0,0 +1,170 @@
+// Binary cache of yaml graphs: yaml -> sgb -> the same graph, and an outdated cache is not used.
+
+#include "sight.h"
+#include "sight_graph_binary.h"
+#include "sight_graph_saver.h"
+
+#include "sight_test.h"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+using namespace sight;
+namespace fs = std::filesystem;
+
+namespace {
+
+    constexpr std::string_view graphYaml = R"(who-am-i: sight-graph
+nodes:
+  3001:
+    name: Start
+    id: 3001
+    position: [10.5, -20]
+    template: test/start
+    inputs:
+      3002:
+        name: ""
+        type: 2
+        value: ~
+        options:
+          customPortName: ""
+          dynamicPort: false
+    outputs:
+      3003:
+        name: value
+        type: 5
+        parent: 3002
+        value: 42
+        options:
+          customPortName: abc
+          dynamicPort: true
+    fields:
+      3004:
+        name: color
+        type: 9
+        value:
+          - 0.5
+          - 1
+          - 0
+          - 1
+        options:
+          customPortName: ""
+          dynamicPort: false
+    components:
+      3010:
+        name: Comp
+        id: 3010
+        position: [0, 0]
+        template: test/comp
+        inputs: {}
+        outputs: {}
+        fields: {}
+connections:
+  3020:
+    id: 3020
+    left: 3003
+    right: 3002
+    priority: 10
+    generateCode: true
+settings:
+  graphName: "main"
+  enterNode: 3001
+saveAsJsonHistory:
+  - a.json
+)";
+
+    struct TestProject {
+        fs::path baseDir;
+        fs::path yaml;
+        std::string cachePath;
+    };
+
+    TestProject makeProject() {
+        TestProject project;
+        project.baseDir = test::makeTempFolder("sight-graph-cache-test");
+        project.yaml = project.baseDir / "src" / "graph" / "main.yaml";
+        test::writeText(project.yaml, graphYaml);
+        project.cachePath = graphBinaryCachePath(project.yaml.generic_string(), project.baseDir.generic_string() + "/");
+        return project;
+    }
+
+    /**
+     * @brief Save the yaml graph the way the save thread does, it writes the cache too.
+     */
+    bool saveWithCache(TestProject const& project, SightGraphBinaryWriter& records) {
+        return writeGraphSnapshot(project.yaml.generic_string(), project.cachePath, records) == CODE_OK;
+    }
+
+    void testCachePath(TestProject const& project) {
+        SIGHT_CHECK(project.cachePath == (project.baseDir / ".sight" / "cache" / "src" / "graph" / "main.yaml.sgb").generic_string());
+        // not in the project, no cache.
+        SIGHT_CHECK(graphBinaryCachePath((project.baseDir.parent_path() / "other.yaml").generic_string(), project.baseDir.generic_string()).empty());
+        SIGHT_CHECK(graphBinaryCachePath(project.yaml.generic_string(), "").empty());
+    }
+
+    void testRoundTrip(TestProject const& project) {
+        SightGraphBinaryWriter records;
+        SIGHT_CHECK(readGraphYamlRecords(project.yaml.generic_string(), records) == CODE_OK);
+        SIGHT_CHECK(saveWithCache(project, records));
+        SIGHT_CHECK(fs::exists(project.cachePath));
+
+        SightGraphBinaryReader reader;
+        if (!SIGHT_CHECK(openGraphBinaryCache(reader, project.cachePath, project.yaml.generic_string()) == CODE_OK)) {
+            return;
+        }
+        SIGHT_CHECK(reader.nodes().size() == 2);
+        SIGHT_CHECK(reader.connections().size() == 1);
+
+        // the graph from the cache is written as the same yaml as the graph from the yaml file.
+        auto folder = project.baseDir / "out";
+        fs::create_directories(folder);
+        SightGraphBinaryWriter fromYaml;
+        SIGHT_CHECK(readGraphYamlRecords(project.yaml.generic_string(), fromYaml) == CODE_OK);
+        SIGHT_CHECK(writeGraphYaml(fromYaml, (folder / "yaml.yaml").generic_string()) == CODE_OK);
+        SIGHT_CHECK(writeGraphYaml(reader, (folder / "cache.yaml").generic_string()) == CODE_OK);
+        auto expected = test::readText(folder / "yaml.yaml");
+        SIGHT_CHECK(!expected.empty());
+        SIGHT_CHECK(test::readText(folder / "cache.yaml") == expected);
+    }
+
+    void testStaleCache(TestProject const& project) {
+        auto yamlPath = project.yaml.generic_string();
+        SightGraphBinaryWriter records;
+        SIGHT_CHECK(readGraphYamlRecords(yamlPath, records) == CODE_OK);
+        SIGHT_CHECK(saveWithCache(project, records));
+
+        SightGraphBinaryReader reader;
+        SIGHT_CHECK(openGraphBinaryCache(reader, project.cachePath, yamlPath) == CODE_OK);
+        reader.close();
+
+        // size changed, e.g. edited by another program.
+        test::writeText(project.yaml, test::readText(project.yaml) + "\n");
+        SIGHT_CHECK(openGraphBinaryCache(reader, project.cachePath, yamlPath) == CODE_FAIL);
+
+        // saved again, the cache is up to date.
+        SIGHT_CHECK(saveWithCache(project, records));
+        SIGHT_CHECK(openGraphBinaryCache(reader, project.cachePath, yamlPath) == CODE_OK);
+        reader.close();
+
+        // same size, only the modify time changed.
+        auto time = fs::last_write_time(project.yaml);
+        fs::last_write_time(project.yaml, time + std::chrono::seconds(10));
+        SIGHT_CHECK(openGraphBinaryCache(reader, project.cachePath, yamlPath) == CODE_FAIL);
+
+        // no yaml file
+        fs::remove(project.yaml);
+        SIGHT_CHECK(openGraphBinaryCache(reader, project.cachePath, yamlPath) == CODE_FILE_NOT_EXISTS);
+    }
+
+}
+
+int main() {
+    auto project = makeProject();
+    testCachePath(project);
+    testRoundTrip(project);
+    testStaleCache(project);
+
+    fs::remove_all(project.baseDir);
+    return test::result();
+}
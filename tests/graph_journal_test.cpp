@@ -0,0 +1,178 @@
+// Journal of yaml graphs: a torn tail is dropped and cut off, and later entries are appended after the good ones.
+
+#include "sight.h"
+#include "sight_graph_binary.h"
+#include "sight_graph_journal.h"
+
+#include "sight_test.h"
+
+#include <filesystem>
+#include <string>
+
+using namespace sight;
+namespace fs = std::filesystem;
+
+namespace {
+
+    constexpr std::string_view graphYaml = R"(who-am-i: sight-graph
+nodes:
+  3001:
+    name: Start
+    id: 3001
+    position: [10, 20]
+    template: test/start
+    inputs: {}
+    outputs:
+      3002:
+        name: value
+        type: 5
+        value: 42
+        options:
+          customPortName: ""
+          dynamicPort: false
+    fields: {}
+  3003:
+    name: End
+    id: 3003
+    position: [200, 20]
+    template: test/end
+    inputs:
+      3004:
+        name: value
+        type: 5
+        value: 0
+        options:
+          customPortName: ""
+          dynamicPort: false
+    outputs: {}
+    fields: {}
+connections:
+  3005:
+    id: 3005
+    left: 3002
+    right: 3004
+    priority: 10
+    generateCode: true
+settings:
+  graphName: "main"
+)";
+
+    float positionOf(SightGraphBinaryWriter const& data, uint32_t nodeId) {
+        for (auto const& record : data.nodes) {
+            if (record.id == nodeId) {
+                return record.positionX;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Move a node, and append only that node to the journal, as autosave does.
+     */
+    bool appendMove(std::string const& yamlPath, SightGraphBinaryWriter& current, float x) {
+        SightGraphJournalChanges changes;
+        for (auto& record : current.nodes) {
+            if (record.id == 3001) {
+                record.positionX = x;
+                copyNodeRecord(changes.data, current, record);
+            }
+        }
+        std::string entry;
+        return makeGraphJournalEntry(changes, entry) && appendGraphJournal(yamlPath, entry) == CODE_OK;
+    }
+
+    void testTornTail(fs::path const& folder) {
+        auto yaml = folder / "main.yaml";
+        test::writeText(yaml, graphYaml);
+        auto yamlPath = yaml.generic_string();
+        auto journalPath = graphJournalPath(yamlPath);
+
+        SightGraphBinaryWriter current;
+        SIGHT_CHECK(readGraphYamlRecords(yamlPath, current) == CODE_OK);
+
+        SIGHT_CHECK(appendMove(yamlPath, current, 50));
+        auto goodSize = fs::file_size(journalPath);
+
+        // the app crashed while writing the second entry.
+        SIGHT_CHECK(appendMove(yamlPath, current, 60));
+        fs::resize_file(journalPath, goodSize + (fs::file_size(journalPath) - goodSize) / 2);
+
+        SightGraphBinaryWriter records;
+        SIGHT_CHECK(readGraphYamlRecords(yamlPath, records) == CODE_OK);
+        size_t journalSize = 0;
+        SIGHT_CHECK(replayGraphJournal(yamlPath, records, &journalSize) == 1);
+        SIGHT_CHECK(positionOf(records, 3001) == 50);
+        SIGHT_CHECK(journalSize == goodSize);
+        SIGHT_CHECK(fs::file_size(journalPath) == goodSize);
+
+        // keep editing after the recovery, from what is replayed.
+        current = std::move(records);
+        SIGHT_CHECK(appendMove(yamlPath, current, 70));
+
+        SightGraphBinaryWriter again;
+        SIGHT_CHECK(readGraphYamlRecords(yamlPath, again) == CODE_OK);
+        SIGHT_CHECK(replayGraphJournal(yamlPath, again, &journalSize) == 2);
+        SIGHT_CHECK(positionOf(again, 3001) == 70);
+        SIGHT_CHECK(journalSize == fs::file_size(journalPath));
+    }
+
+    void testBadChecksum(fs::path const& folder) {
+        auto yaml = folder / "checksum.yaml";
+        test::writeText(yaml, graphYaml);
+        auto yamlPath = yaml.generic_string();
+        auto journalPath = graphJournalPath(yamlPath);
+
+        SightGraphBinaryWriter current;
+        SIGHT_CHECK(readGraphYamlRecords(yamlPath, current) == CODE_OK);
+        SIGHT_CHECK(appendMove(yamlPath, current, 50));
+        auto goodSize = fs::file_size(journalPath);
+        SIGHT_CHECK(appendMove(yamlPath, current, 60));
+
+        // flip the last byte of the second entry.
+        auto content = test::readText(journalPath);
+        content.back() = static_cast<char>(~content.back());
+        test::writeText(journalPath, content);
+
+        SightGraphBinaryWriter records;
+        SIGHT_CHECK(readGraphYamlRecords(yamlPath, records) == CODE_OK);
+        size_t journalSize = 0;
+        SIGHT_CHECK(replayGraphJournal(yamlPath, records, &journalSize) == 1);
+        SIGHT_CHECK(positionOf(records, 3001) == 50);
+        SIGHT_CHECK(journalSize == goodSize);
+        SIGHT_CHECK(fs::file_size(journalPath) == goodSize);
+    }
+
+    void testRemove(fs::path const& folder) {
+        auto yaml = folder / "remove.yaml";
+        test::writeText(yaml, graphYaml);
+        auto yamlPath = yaml.generic_string();
+
+        // nothing is changed, nothing is appended.
+        SightGraphJournalChanges changes;
+        std::string entry;
+        SIGHT_CHECK(!makeGraphJournalEntry(changes, entry));
+
+        // a removed node takes its connections with it.
+        changes.removedNodes.push_back(3003);
+        SIGHT_CHECK(makeGraphJournalEntry(changes, entry));
+        SIGHT_CHECK(appendGraphJournal(yamlPath, entry) == CODE_OK);
+
+        SightGraphBinaryWriter records;
+        SIGHT_CHECK(readGraphYamlRecords(yamlPath, records) == CODE_OK);
+        SIGHT_CHECK(replayGraphJournal(yamlPath, records) == 1);
+        SIGHT_CHECK(positionOf(records, 3003) == -1);
+        SIGHT_CHECK(positionOf(records, 3001) == 10);
+        SIGHT_CHECK(records.connections.empty());
+    }
+
+}
+
+int main() {
+    auto folder = test::makeTempFolder("sight-graph-journal-test");
+    testTornTail(folder);
+    testBadChecksum(folder);
+    testRemove(folder);
+
+    fs::remove_all(folder);
+    return test::result();
+}
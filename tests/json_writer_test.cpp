@@ -0,0 +1,136 @@
+// SightJsonWriter: string escaping, number formatting and nesting, in compact and indented json.
+
+#include "sight_json_writer.h"
+
+#include "sight_test.h"
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
+
+using namespace sight;
+
+namespace {
+
+    std::string compactString(std::string_view str) {
+        std::ostringstream out;
+        SightJsonWriter writer(out, 0);
+        writer.value(str);
+        return out.str();
+    }
+
+    std::string compactNumber(double number) {
+        std::ostringstream out;
+        SightJsonWriter writer(out, 0);
+        writer.value(number);
+        return out.str();
+    }
+
+    void testEscape() {
+        SIGHT_CHECK(compactString("plain") == R"("plain")");
+        SIGHT_CHECK(compactString("") == R"("")");
+        SIGHT_CHECK(compactString(R"(say "hi")") == R"("say \"hi\"")");
+        SIGHT_CHECK(compactString(R"(a\b)") == R"("a\\b")");
+        SIGHT_CHECK(compactString("\n\r\t\b\f") == R"("\n\r\t\b\f")");
+
+        // other control characters, a NUL inside the view is written too.
+        SIGHT_CHECK(compactString(std::string_view("\x01\x1f", 2)) == R"("\u0001\u001f")");
+        SIGHT_CHECK(compactString(std::string_view("a\0b", 3)) == R"("a\u0000b")");
+        // DEL is not a control character in json.
+        SIGHT_CHECK(compactString("\x7f") == "\"\x7f\"");
+
+        // utf-8 is written as it is.
+        SIGHT_CHECK(compactString("caf\xc3\xa9 \xe4\xb8\xad") == "\"caf\xc3\xa9 \xe4\xb8\xad\"");
+        SIGHT_CHECK(compactString("\xf0\x9f\x98\x80\n") == "\"\xf0\x9f\x98\x80\\n\"");
+    }
+
+    void testNumber() {
+        SIGHT_CHECK(compactNumber(0) == "0");
+        SIGHT_CHECK(compactNumber(-0.0) == "0");
+        SIGHT_CHECK(compactNumber(3) == "3");
+        SIGHT_CHECK(compactNumber(-42) == "-42");
+        SIGHT_CHECK(compactNumber(4294967295.0) == "4294967295");
+
+        // shortest text which reads back to the same double.
+        SIGHT_CHECK(compactNumber(-0.5) == "-0.5");
+        SIGHT_CHECK(compactNumber(0.1) == "0.1");
+        SIGHT_CHECK(compactNumber(1.0 / 3) == "0.3333333333333333");
+        SIGHT_CHECK(compactNumber(1e300) == "1e+300");
+        SIGHT_CHECK(compactNumber(1.5e-7) == "1.5e-07");
+        SIGHT_CHECK(std::stod(compactNumber(1.0 / 3)) == 1.0 / 3);
+
+        // integral, but bigger than the exact integers of a double.
+        SIGHT_CHECK(compactNumber(9007199254740992.0) == "9007199254740992");
+        SIGHT_CHECK(compactNumber(1e21) == "1e+21");
+
+        // floats are written as the same double.
+        SIGHT_CHECK(compactNumber(1.5f) == "1.5");
+        SIGHT_CHECK(std::stod(compactNumber(0.1f)) == static_cast<double>(0.1f));
+
+        SIGHT_CHECK(compactNumber(std::numeric_limits<double>::quiet_NaN()) == "null");
+        SIGHT_CHECK(compactNumber(std::numeric_limits<double>::infinity()) == "null");
+        SIGHT_CHECK(compactNumber(-std::numeric_limits<double>::infinity()) == "null");
+    }
+
+    void writeNested(SightJsonWriter& writer) {
+        writer.beginObject();
+        writer.key("name").value("main");
+        writer.key("ids").beginArray().value(1.0).value(2.0).endArray();
+        writer.key("empty").beginObject().endObject();
+        writer.key("list").beginArray();
+        writer.beginObject().key("ok").value(true).key("none").null().endObject();
+        writer.beginArray().endArray();
+        writer.endArray();
+        writer.endObject();
+    }
+
+    void testNesting() {
+        std::ostringstream compact;
+        SightJsonWriter compactWriter(compact, 0);
+        writeNested(compactWriter);
+        SIGHT_CHECK(compactWriter.done());
+        SIGHT_CHECK(compact.str() == R"({"name":"main","ids":[1,2],"empty":{},"list":[{"ok":true,"none":null},[]]})");
+
+        std::ostringstream indented;
+        SightJsonWriter indentedWriter(indented);
+        writeNested(indentedWriter);
+        SIGHT_CHECK(indentedWriter.done());
+        SIGHT_CHECK(indented.str() == R"({
+  "name": "main",
+  "ids": [
+    1,
+    2
+  ],
+  "empty": {},
+  "list": [
+    {
+      "ok": true,
+      "none": null
+    },
+    []
+  ]
+})");
+
+        // not done while a level is open, or a key has no value.
+        std::ostringstream open;
+        SightJsonWriter openWriter(open, 0);
+        openWriter.beginArray();
+        SIGHT_CHECK(!openWriter.done());
+        openWriter.endArray();
+        SIGHT_CHECK(openWriter.done());
+
+        std::ostringstream dangling;
+        SightJsonWriter danglingWriter(dangling, 0);
+        danglingWriter.beginObject().key("k");
+        SIGHT_CHECK(!danglingWriter.done());
+    }
+
+}
+
+int main() {
+    testEscape();
+    testNumber();
+    testNesting();
+    return test::result();
+}
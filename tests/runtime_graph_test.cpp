@@ -0,0 +1,264 @@
+// Runtime graph files: a graph -> srg -> the same nodes, members and connections, and a broken file is not opened.
+
+#include "sight.h"
+#include "sight_node.h"
+#include "sight_node_graph.h"
+#include "sight_runtime_graph.h"
+
+#include "sight_test.h"
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace sight;
+namespace fs = std::filesystem;
+namespace rt = sight::runtime;
+
+namespace {
+
+    /**
+     * @brief A template node which is not registered in a project, its ports live in `ports`.
+     */
+    struct TestTemplate {
+        SightJsNode node;
+        std::deque<SightJsNodePort> ports;
+
+        explicit TestTemplate(std::string const& name) {
+            node.nodeName = name;
+            node.fullTemplateAddress = "test/" + name;
+        }
+
+        void addPort(std::string const& name, NodePortType kind, uint type, std::string_view value = {}) {
+            auto& port = ports.emplace_back(name, kind);
+            port.type = type;
+            port.value = SightNodeValue(type);
+            if (!value.empty()) {
+                port.value.setValue(value);
+            }
+
+            switch (kind) {
+            case NodePortType::Input:
+                node.inputPorts.push_back(&port);
+                break;
+            case NodePortType::Output:
+                node.outputPorts.push_back(&port);
+                break;
+            default:
+                node.fields.push_back(&port);
+                break;
+            }
+        }
+    };
+
+    /**
+     * @brief Ports get ids after the node's id: inputs, outputs and then fields, title bar ports are after the
+     * template ports of their list.
+     */
+    SightNode* addNode(SightNodeGraph& graph, TestTemplate const& tmpl, uint nodeId, std::string const& name) {
+        auto node = tmpl.node.instantiate(&graph, false);
+        node->nodeId = nodeId;
+        node->nodeName = name;
+        uint portId = nodeId;
+        auto nodeFunc = [&portId](std::vector<SightNodePort>& list) {
+            for (auto& item : list) {
+                item.id = ++portId;
+            }
+        };
+        CALL_NODE_FUNC(node);
+        graph.registerNode(node);
+        return node;
+    }
+
+    rt::Member const* findMember(rt::GraphFile const& file, rt::Node const& node, std::string_view name) {
+        for (auto const& item : file.members(node)) {
+            if (file.str(item.name) == name) {
+                return &item;
+            }
+        }
+        return nullptr;
+    }
+
+    rt::DataItem const* findData(rt::GraphFile const& file, rt::Node const& node, std::string_view key) {
+        for (auto const& item : file.data(node)) {
+            if (file.str(item.key) == key) {
+                return &item;
+            }
+        }
+        return nullptr;
+    }
+
+    bool isIds(rt::GraphFile const& file, rt::Value const& value, std::vector<uint32_t> const& expected) {
+        auto ids = file.ids(value);
+        return value.kind == rt::ValueKind::Ids && std::vector<uint32_t>(ids.begin(), ids.end()) == expected;
+    }
+
+    void checkGraph(rt::GraphFile const& file) {
+        auto const& header = file.header();
+        SIGHT_CHECK(file.str(header.nodeRootName) == "nodes");
+        SIGHT_CHECK(file.str(header.connectionRootName) == "connections");
+        SIGHT_CHECK(header.flags ==
+                    (rt::HeaderFlags::ExportData | rt::HeaderFlags::IncludeRightConnections | rt::HeaderFlags::IncludeNodeIdOnConnectionData));
+
+        // sorted by id, the end node is added first.
+        SIGHT_CHECK(file.nodes().size() == 2);
+        SIGHT_CHECK(file.nodes()[0].id == 3001);
+        SIGHT_CHECK(file.findNode(3002) == nullptr);
+        SIGHT_CHECK(file.findNode(9999) == nullptr);
+
+        auto start = file.findNode(3001);
+        if (SIGHT_CHECK(start)) {
+            SIGHT_CHECK(file.str(start->name) == "First");
+            SIGHT_CHECK(file.str(start->templateName) == "Start");
+            // title bar ports have no name, they are not members.
+            SIGHT_CHECK(file.members(*start).size() == 3);
+            SIGHT_CHECK(file.str(file.members(*start)[0].name) == "next");
+
+            auto next = findMember(file, *start, "next");
+            auto count = findMember(file, *start, "count");
+            auto title = findMember(file, *start, "title");
+            if (SIGHT_CHECK(next && count && title)) {
+                SIGHT_CHECK(next->id == 3003);
+                SIGHT_CHECK(isIds(file, next->value, {}));
+                SIGHT_CHECK(count->id == 3005);
+                SIGHT_CHECK(count->value.kind == rt::ValueKind::Int && count->value.u.i == 42);
+                SIGHT_CHECK(title->value.kind == rt::ValueKind::String && file.str(title->value.u.string) == "hello");
+            }
+
+            auto nextData = findData(file, *start, "next");
+            auto countData = findData(file, *start, "count");
+            SIGHT_CHECK(file.data(*start).size() == 3);
+            SIGHT_CHECK(nextData && isIds(file, nextData->value, { 3020 }));
+            SIGHT_CHECK(countData && countData->value.kind == rt::ValueKind::Int && countData->value.u.i == 42);
+
+            auto right = file.rightConnections(*start);
+            SIGHT_CHECK(std::vector<uint32_t>(right.begin(), right.end()) == std::vector<uint32_t>{ 3020 });
+        }
+
+        auto end = file.findNode(3010);
+        if (SIGHT_CHECK(end)) {
+            SIGHT_CHECK(file.str(end->name) == "End");
+            auto prev = findMember(file, *end, "prev");
+            auto ratio = findMember(file, *end, "ratio");
+            if (SIGHT_CHECK(prev && ratio)) {
+                SIGHT_CHECK(prev->id == 3011);
+                SIGHT_CHECK(ratio->value.kind == rt::ValueKind::Double && ratio->value.u.d == 0.5);
+            }
+            auto prevData = findData(file, *end, "prev");
+            SIGHT_CHECK(prevData && isIds(file, prevData->value, { 3020 }));
+            SIGHT_CHECK(file.rightConnections(*end).empty());
+        }
+
+        SIGHT_CHECK(file.connections().size() == 1);
+        auto connection = file.findConnection(3020);
+        if (SIGHT_CHECK(connection)) {
+            SIGHT_CHECK(connection->left == 3003 && connection->right == 3011);
+            SIGHT_CHECK(connection->leftNode == 3001 && connection->rightNode == 3010);
+            SIGHT_CHECK(file.str(connection->componentData).empty());
+        }
+        SIGHT_CHECK(file.findConnection(3001) == nullptr);
+    }
+
+    /**
+     * @brief Open the first `size` bytes of a copy of `bytes`, `change` edits the header of the copy.
+     */
+    bool openCopy(std::string const& bytes, size_t size, std::function<void(rt::Header&)> const& change = {}) {
+        // 8 bytes aligned
+        std::vector<uint64_t> buffer((bytes.size() + 7) / 8);
+        std::memcpy(buffer.data(), bytes.data(), bytes.size());
+        if (change && bytes.size() >= sizeof(rt::Header)) {
+            rt::Header header;
+            std::memcpy(&header, buffer.data(), sizeof(header));
+            change(header);
+            std::memcpy(buffer.data(), &header, sizeof(header));
+        }
+
+        rt::GraphFile file;
+        bool ok = file.openMemory(reinterpret_cast<const char*>(buffer.data()), size);
+        SIGHT_CHECK(ok == file.isOpen());
+        return ok;
+    }
+
+    void testBrokenFile(fs::path const& folder, std::string const& bytes) {
+        SIGHT_CHECK(openCopy(bytes, bytes.size()));
+
+        // truncated: in the last section, and in the header.
+        SIGHT_CHECK(!openCopy(bytes, bytes.size() - 1));
+        SIGHT_CHECK(!openCopy(bytes, sizeof(rt::Header) - 8));
+        SIGHT_CHECK(!openCopy(bytes, 0));
+
+        auto truncated = folder / "truncated.srg";
+        test::writeText(truncated, std::string_view(bytes).substr(0, bytes.size() / 2));
+        rt::GraphFile file;
+        SIGHT_CHECK(!file.open(truncated.generic_string().c_str()));
+        SIGHT_CHECK(!file.isOpen());
+        SIGHT_CHECK(!file.open((folder / "none.srg").generic_string().c_str()));
+
+        // bad sections
+        SIGHT_CHECK(!openCopy(bytes, bytes.size(), [&bytes](rt::Header& header) { header.connections.offset = bytes.size() + 8; }));
+        SIGHT_CHECK(!openCopy(bytes, bytes.size(), [](rt::Header& header) { header.nodes.offset += 4; }));
+        SIGHT_CHECK(!openCopy(bytes, bytes.size(), [](rt::Header& header) { header.members.count = UINT64_MAX / 2; }));
+        SIGHT_CHECK(!openCopy(bytes, bytes.size(), [](rt::Header& header) { header.strings.offset = UINT64_MAX - 7; }));
+
+        // not a runtime graph, or another version.
+        SIGHT_CHECK(!openCopy(bytes, bytes.size(), [](rt::Header& header) { header.magic[0] = 'X'; }));
+        SIGHT_CHECK(!openCopy(bytes, bytes.size(), [](rt::Header& header) { header.version++; }));
+        SIGHT_CHECK(!openCopy(bytes, bytes.size(), [](rt::Header& header) { header.byteOrder = 0x04030201; }));
+    }
+
+}
+
+int main() {
+    auto folder = test::makeTempFolder("sight-runtime-graph-test");
+
+    TestTemplate startTemplate("Start");
+    startTemplate.addPort("next", NodePortType::Output, IntTypeProcess);
+    startTemplate.addPort("count", NodePortType::Field, IntTypeInt, "42");
+    startTemplate.addPort("title", NodePortType::Field, IntTypeString, "hello");
+
+    TestTemplate endTemplate("End");
+    endTemplate.addPort("prev", NodePortType::Input, IntTypeProcess);
+    endTemplate.addPort("ratio", NodePortType::Field, IntTypeDouble, "0.5");
+
+    auto path = (folder / "main" SIGHT_RUNTIME_GRAPH_EXT).generic_string();
+    {
+        // templates live longer than the graph.
+        SightNodeGraph graph;
+        // ports: 3011 prev, 3012 and 3013 title bar, 3014 ratio
+        addNode(graph, endTemplate, 3010, "End");
+        // ports: 3002 title bar, 3003 next, 3004 title bar, 3005 count, 3006 title
+        addNode(graph, startTemplate, 3001, "First");
+        graph.addConnection(SightNodeConnection(3020, 3003, 3011, IM_COL32_WHITE, 10));
+
+        SightNodeGraphOutputJsonConfig config;
+        config.exportData = true;
+        config.includeRightConnections = true;
+        config.includeNodeIdOnConnectionData = true;
+        SIGHT_CHECK(graph.outputRuntimeGraph(path, false, config) == CODE_OK);
+        SIGHT_CHECK(graph.outputRuntimeGraph(path, false, config) == CODE_FILE_EXISTS);
+    }
+
+    rt::GraphFile file;
+    if (SIGHT_CHECK(file.open(path.c_str()))) {
+        checkGraph(file);
+    }
+    file.close();
+
+    // the same file from memory.
+    auto bytes = test::readText(path);
+    std::vector<uint64_t> buffer((bytes.size() + 7) / 8);
+    std::memcpy(buffer.data(), bytes.data(), bytes.size());
+    if (SIGHT_CHECK(file.openMemory(reinterpret_cast<const char*>(buffer.data()), bytes.size()))) {
+        checkGraph(file);
+    }
+    file.close();
+
+    testBrokenFile(folder, bytes);
+
+    fs::remove_all(folder);
+    return test::result();
+}
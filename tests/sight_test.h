@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Small helpers for test programs. A test is a program, `main` returns `sight::test::result()`,
+ * so ctest sees a failure as a non-zero exit code.
+ */
+namespace sight::test {
+
+    inline int failures = 0;
+
+    inline bool check(bool ok, const char* expr, const char* file, int line) {
+        if (!ok) {
+            failures++;
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+        }
+        return ok;
+    }
+
+    inline int result() {
+        if (failures > 0) {
+            std::fprintf(stderr, "%d checks failed\n", failures);
+            return 1;
+        }
+        return 0;
+    }
+
+    /**
+     * @brief An empty folder in the temp directory, removed first if it exists.
+     */
+    inline std::filesystem::path makeTempFolder(std::string_view name) {
+        auto path = std::filesystem::temp_directory_path() / name;
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+        return path;
+    }
+
+    inline void writeText(std::filesystem::path const& path, std::string_view text) {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        out << text;
+    }
+
+    inline std::string readText(std::filesystem::path const& path) {
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+    }
+
+}
+
+#define SIGHT_CHECK(expr) sight::test::check(static_cast<bool>(expr), #expr, __FILE__, __LINE__)
@@ -0,0 +1,115 @@
+// Template registry: register, update, find and delete 20k templates, and check the registry after each step.
+// Times are printed, the program fails only if a check fails.
+
+#include "sight.h"
+#include "sight_node.h"
+
+#include "sight_test.h"
+
+#include "absl/strings/str_cat.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace sight;
+
+namespace {
+
+    constexpr int templateCount = 20000;
+    constexpr int templatesPerFolder = 100;
+
+    std::string addressOf(int i) {
+        return absl::StrCat("sight://bench/group", i / templatesPerFolder, "/node", i);
+    }
+
+    /**
+     * @brief Time of `func` in milliseconds.
+     */
+    template<typename Func>
+    double measure(const char* name, Func&& func) {
+        auto begin = std::chrono::steady_clock::now();
+        func();
+        std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - begin;
+        std::printf("%-24s %10.2f ms\n", name, time.count());
+        return time.count();
+    }
+
+    /**
+     * @brief Register a template of every address, `outputName` is the name of its output port.
+     */
+    bool registerAll(std::vector<std::string> const& addresses, bool isUpdate, const char* outputName = "result") {
+        bool ok = true;
+        for (auto const& address : addresses) {
+            SightJsNode node;
+            node.nodeName = address.substr(address.rfind('/') + 1);
+            node.addPort(SightJsNodePort("value", NodePortType::Input));
+            node.addPort(SightJsNodePort(outputName, NodePortType::Output));
+            ok = addTemplateNode(SightNodeTemplateAddress(address, &node), isUpdate) == CODE_OK && ok;
+        }
+        return ok;
+    }
+
+    int countFound(std::vector<std::string> const& addresses) {
+        int found = 0;
+        for (auto const& address : addresses) {
+            if (auto node = findTemplateNode(address.c_str()); node && node->fullTemplateAddress == address) {
+                found++;
+            }
+        }
+        return found;
+    }
+
+}
+
+int main() {
+    SIGHT_CHECK(initNodeStatus() == CODE_OK);
+
+    std::vector<std::string> addresses;
+    addresses.reserve(templateCount);
+    for (int i = 0; i < templateCount; i++) {
+        addresses.push_back(addressOf(i));
+    }
+
+    measure("register", [&] { SIGHT_CHECK(registerAll(addresses, false)); });
+    int found = 0;
+    measure("find", [&] { found = countFound(addresses); });
+    SIGHT_CHECK(found == templateCount);
+
+    // a plugin reloads and every template is changed, they are replaced in place.
+    auto first = findTemplateNode(addresses.front().c_str());
+    measure("update changed", [&] { SIGHT_CHECK(registerAll(addresses, true, "output")); });
+    SIGHT_CHECK(findTemplateNode(addresses.front().c_str()) == first);
+    SIGHT_CHECK(first->outputPorts.size() == 1 && first->outputPorts.front()->portName == "output");
+    SIGHT_CHECK(countFound(addresses) == templateCount);
+
+    // reloaded again without changes, the templates are kept.
+    auto firstPort = first->outputPorts.front();
+    measure("update unchanged", [&] { SIGHT_CHECK(registerAll(addresses, true, "output")); });
+    SIGHT_CHECK(findTemplateNode(addresses.front().c_str()) == first);
+    SIGHT_CHECK(first->outputPorts.front() == firstPort);
+
+    // a folder and all templates in it.
+    measure("delete folder", [&] { SIGHT_CHECK(delTemplateNode("sight://bench/group0")); });
+    for (int i = 0; i < templatesPerFolder; i++) {
+        SIGHT_CHECK(findTemplateNode(addresses[i].c_str()) == nullptr);
+    }
+    SIGHT_CHECK(countFound(addresses) == templateCount - templatesPerFolder);
+    SIGHT_CHECK(!delTemplateNode("sight://bench/group0"));
+
+    // one template, the other templates of its folder are kept.
+    SIGHT_CHECK(delTemplateNode(addresses[templatesPerFolder]));
+    SIGHT_CHECK(findTemplateNode(addresses[templatesPerFolder].c_str()) == nullptr);
+    SIGHT_CHECK(findTemplateNode(addresses[templatesPerFolder + 1].c_str()) != nullptr);
+
+    // a deleted folder can be used again.
+    SIGHT_CHECK(registerAll({ addresses.front() }, false));
+    SIGHT_CHECK(findTemplateNode(addresses.front().c_str()) != nullptr);
+
+    measure("delete all", [&] { SIGHT_CHECK(delTemplateNode("sight://bench")); });
+    SIGHT_CHECK(countFound(addresses) == 0);
+
+    destoryNodeStatus();
+    return test::result();
+}